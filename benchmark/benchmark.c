@@ -0,0 +1,460 @@
+#define _POSIX_C_SOURCE 200809L
+#include "gamelib.h"
+#include "classifica.h"
+#include "mappa_compatta.h"
+#include "mappa_soa.h"
+#include "pianificatore.h"
+#include "politica.h"
+#include "probabilita.h"
+#include "ramo.h"
+#include "mcts.h"
+#include "rng.h"
+#include <stdatomic.h>
+#include <stdint.h>
+#include <unistd.h>
+
+// ============================================================================
+// BENCHMARK DEI PERCORSI CRITICI DEL GIOCO
+// ============================================================================
+// Misura generazione della mappa a dimensioni crescenti (anche compatta),
+// inserimento e cancellazione per posizione, conteggio e convalida ("Chiudi
+// Mappa"), liberazione della mappa, soluzione della politica ottima, singoli
+// combattimenti, partite headless complete (anche molte sessioni in
+// parallelo sul pianificatore) e classifica persistente.
+// I risultati escono su stdout in JSON (ns, allocazioni e byte per
+// operazione), così build diverse si confrontano con un diff o uno script.
+//
+// Le allocazioni si contano avvolgendo malloc, calloc e realloc al link
+// (-Wl,--wrap, vedi Makefile): ogni chiamata del gioco passa da qui.
+//
+// Uso: benchmark [--rapido]   (--rapido: dimensioni e tempi ridotti)
+
+// ============================================================================
+// CONTEGGIO DELLE ALLOCAZIONI
+// ============================================================================
+
+void* __real_malloc(size_t n);
+void* __real_calloc(size_t n, size_t dimensione);
+void* __real_realloc(void* p, size_t n);
+
+// Atomici: la generazione della mappa può girare su più thread
+static atomic_size_t allocazioni;
+static atomic_size_t byte_allocati;
+
+void* __wrap_malloc(size_t n) {
+    atomic_fetch_add_explicit(&allocazioni, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&byte_allocati, n, memory_order_relaxed);
+    return __real_malloc(n);
+}
+
+void* __wrap_calloc(size_t n, size_t dimensione) {
+    atomic_fetch_add_explicit(&allocazioni, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&byte_allocati, n * dimensione, memory_order_relaxed);
+    return __real_calloc(n, dimensione);
+}
+
+void* __wrap_realloc(void* p, size_t n) {
+    atomic_fetch_add_explicit(&allocazioni, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&byte_allocati, n, memory_order_relaxed);
+    return __real_realloc(p, n);
+}
+
+// ============================================================================
+// MISURE
+// ============================================================================
+
+typedef struct Misura {
+    const char* nome;
+    long long n;           // Dimensione del caso (zone, o tipo di nemico)
+    long long operazioni;
+    uint64_t ns;           // Solo il tempo delle operazioni misurate
+    size_t allocazioni;
+    size_t byte;
+} Misura;
+
+static double tempo_minimo = 0.5; // Secondi per caso (meno con --rapido)
+static Sessione* sessione = NULL;  // Sessione dei casi a thread singolo
+static int primo_risultato = 1;
+
+static uint64_t ora_ns() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000000ull + (uint64_t) t.tv_nsec;
+}
+
+// Intervallo misurato: tempo e allocazioni tra avvia e ferma si sommano alla misura
+static uint64_t inizio_ns;
+static size_t inizio_allocazioni, inizio_byte;
+
+static void avvia() {
+    inizio_allocazioni = atomic_load(&allocazioni);
+    inizio_byte = atomic_load(&byte_allocati);
+    inizio_ns = ora_ns();
+}
+
+static void ferma(Misura* m, long long operazioni) {
+    uint64_t fine = ora_ns();
+    m->ns += fine - inizio_ns;
+    m->allocazioni += atomic_load(&allocazioni) - inizio_allocazioni;
+    m->byte += atomic_load(&byte_allocati) - inizio_byte;
+    m->operazioni += operazioni;
+}
+
+static int tempo_scaduto(const Misura* m) {
+    return m->ns >= (uint64_t) (tempo_minimo * 1e9);
+}
+
+static void stampa_misura(const Misura* m) {
+    double op = m->operazioni > 0 ? (double) m->operazioni : 1.0;
+    printf("%s\n    {\"nome\": \"%s\", \"n\": %lld, \"operazioni\": %lld, \"ns_per_op\": %.1f, "
+           "\"allocazioni_per_op\": %.4f, \"byte_per_op\": %.1f}",
+           primo_risultato ? "" : ",", m->nome, m->n, m->operazioni, (double) m->ns / op,
+           (double) m->allocazioni / op, (double) m->byte / op);
+    primo_risultato = 0;
+    fflush(stdout);
+}
+
+static Misura nuova_misura(const char* nome, long long n) {
+    Misura m = { nome, n, 0, 0, 0, 0 };
+    return m;
+}
+
+// Mappa casuale di n zone con i parametri di genera_mappa, già chiusa
+static int prepara_mappa(size_t n, unsigned long long seme) {
+    Parametri_mappa p = PARAMETRI_MAPPA_DEFAULT;
+    p.zone = n;
+    p.seme = seme;
+    return mappa_genera(sessione, &p) && mappa_chiudi(sessione);
+}
+
+// ============================================================================
+// CASI
+// ============================================================================
+
+static void bench_genera(size_t n) {
+    Misura m = nuova_misura("genera_mappa", (long long) n);
+    Parametri_mappa p = PARAMETRI_MAPPA_DEFAULT;
+    p.zone = n;
+    prepara_mappa(n, 1); // Riscalda il pool: le mappe successive riusano i blocchi
+    for (unsigned long long seme = 2; !tempo_scaduto(&m); seme++) {
+        p.seme = seme;
+        avvia();
+        mappa_genera(sessione, &p);
+        ferma(&m, 1);
+    }
+    stampa_misura(&m);
+}
+
+// Mappa compatta generata e convalidata. Misurata per zona: byte_per_op è
+// la memoria di una coppia di zone
+static void bench_genera_compatta(size_t n) {
+    Misura m = nuova_misura("genera_compatta", (long long) n);
+    Parametri_mappa p = PARAMETRI_MAPPA_DEFAULT;
+    p.zone = n;
+    for (unsigned long long seme = 2; !tempo_scaduto(&m); seme++) {
+        Mappa_compatta c;
+        p.seme = seme;
+        avvia();
+        int ok = compatta_genera(&c, &p) && compatta_valida(&c) == SOA_VALIDA;
+        ferma(&m, (long long) n);
+        compatta_distruggi(&c);
+        if (!ok) return;
+    }
+    stampa_misura(&m);
+}
+
+// Inserimenti e cancellazioni in posizioni casuali (ricerca nell'indice)
+static void bench_inserisci_cancella(size_t n) {
+    Misura ins = nuova_misura("inserisci_zona", (long long) n);
+    Misura canc = nuova_misura("cancella_zona", (long long) n);
+    Rng r;
+    rng_semina(&r, n);
+    prepara_mappa(n, 1);
+    const int blocco = 1000;
+    while (!tempo_scaduto(&ins) || !tempo_scaduto(&canc)) {
+        // Stesso numero di inserimenti e cancellazioni: la mappa resta di n zone
+        avvia();
+        for (int k = 0; k < blocco; k++) {
+            int pos = rng_intervallo(&r, 0, mappa_conta_zone(sessione));
+            mappa_inserisci_zona(sessione, pos, bosco, nessun_nemico, nessun_oggetto, nessun_nemico);
+        }
+        ferma(&ins, blocco);
+        avvia();
+        for (int k = 0; k < blocco; k++) mappa_cancella_zona(sessione, rng_intervallo(&r, 0, mappa_conta_zone(sessione) - 1));
+        ferma(&canc, blocco);
+    }
+    stampa_misura(&ins);
+    stampa_misura(&canc);
+}
+
+static void bench_conta_chiudi(size_t n) {
+    Misura conta = nuova_misura("conta_zone", (long long) n);
+    Misura chiudi = nuova_misura("chiudi_mappa", (long long) n);
+    prepara_mappa(n, 1);
+    volatile int somma = 0;
+    while (!tempo_scaduto(&conta)) {
+        avvia();
+        for (int k = 0; k < 100000; k++) somma += mappa_conta_zone(sessione);
+        ferma(&conta, 100000);
+    }
+    while (!tempo_scaduto(&chiudi)) {
+        avvia();
+        somma += mappa_chiudi(sessione);
+        ferma(&chiudi, 1);
+    }
+    (void) somma;
+    stampa_misura(&conta);
+    stampa_misura(&chiudi);
+}
+
+static void bench_dealloca(size_t n) {
+    Misura m = nuova_misura("dealloca_mappa", (long long) n);
+    // La preparazione domina: si limita anche il tempo totale del caso
+    uint64_t scadenza = ora_ns() + (uint64_t) (4 * tempo_minimo * 1e9);
+    for (unsigned long long seme = 1; !tempo_scaduto(&m) && ora_ns() < scadenza; seme++) {
+        prepara_mappa(n, seme); // Non misurata
+        avvia();
+        mappa_libera(sessione);
+        ferma(&m, 1);
+    }
+    stampa_misura(&m);
+}
+
+// Politica ottima di un giocatore medio sull'intera mappa, su tutti i core
+static void bench_politica(size_t n) {
+    Misura m = nuova_misura("risolvi_politica", (long long) n);
+    Mappa_soa soa;
+    if (!prepara_mappa(n, 1) || !mappa_esporta_soa(sessione, &soa)) return;
+    while (!tempo_scaduto(&m)) {
+        avvia();
+        politica_distruggi(politica_risolvi(&soa, 10, 10, 10, 0));
+        ferma(&m, 1);
+    }
+    soa_distruggi(&soa);
+    stampa_misura(&m);
+}
+
+// Un ramo biforcato da uno scelto a caso, con un nemico sconfitto e una
+// lettura: il costo non dipende dalla mappa. L'arena si azzera ogni 4096 rami
+static void bench_ramo(size_t n) {
+    Misura m = nuova_misura("ramo_biforca", (long long) n);
+    Mappa_compatta base;
+    if (!prepara_mappa(n, 1) || !mappa_esporta_compatta(sessione, &base)) return;
+    Arena_rami a = ARENA_RAMI_INIT;
+    Ramo* rami[4096];
+    uint64_t x = 1;
+    while (!tempo_scaduto(&m)) {
+        avvia();
+        ramo_arena_azzera(&a);
+        rami[0] = ramo_radice(&a, &base);
+        for (size_t i = 1; i < 4096; i++) {
+            x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+            rami[i] = ramo_biforca(&a, rami[(x >> 33) % i]);
+            size_t pos = (size_t) (x >> 17) % n;
+            ramo_togli_nemico(&a, rami[i], pos, (int) (x >> 60) & 1);
+            x ^= ramo_zona(rami[i], pos);
+        }
+        ferma(&m, 4095);
+    }
+    ramo_arena_distruggi(&a);
+    compatta_distruggi(&base);
+    stampa_misura(&m);
+}
+
+static void bench_combatti(Tipo_nemico nemico) {
+    static const char* const nomi[] = { "", "combatti_billi", "combatti_democane", "combatti_demotorzone" };
+    Misura m = nuova_misura(nomi[nemico], nemico);
+    Giocatore g;
+    memset(&g, 0, sizeof(g));
+    snprintf(g.nome, sizeof(g.nome), "Benchmark");
+    g.attacco_pischico = 12; g.difesa_pischica = 12; g.fortuna = 10;
+    gioco_semina(sessione, nemico);
+    while (!tempo_scaduto(&m)) {
+        avvia();
+        for (int k = 0; k < 10000; k++) motore_scontro(sessione, &g, nemico, &agente_esploratore);
+        ferma(&m, 10000);
+    }
+    stampa_misura(&m);
+}
+
+// Partita completa: giocatori, mappa e ciclo dei round (al massimo 200).
+// agente: 0 esploratore, 1 casuale, 2 ottimo (soluzione della politica compresa)
+static void bench_partita(const char* nome, size_t zone, int agente) {
+    Misura m = nuova_misura(nome, (long long) zone);
+    const char* nomi[2] = { "A", "B" };
+    for (unsigned long long seme = 1; !tempo_scaduto(&m); seme++) {
+        unsigned int seme_agente = (unsigned int) seme;
+        Agente c = agente_casuale(&seme_agente);
+        Agente o = agente_ottimo(sessione);
+        const Agente* tipo = agente == 1 ? &c : agente == 2 ? &o : &agente_esploratore;
+        const Agente* agenti[2] = { tipo, tipo };
+        avvia();
+        gioco_semina(sessione, seme);
+        motore_imposta_giocatori(sessione, 2, nomi, NULL);
+        if (zone == 15) motore_genera_mappa(sessione);
+        else prepara_mappa(zone, seme);
+        motore_gioca(sessione, agenti, 200);
+        ferma(&m, 1);
+    }
+    stampa_misura(&m);
+}
+
+// Partita dell'esploratore su una mappa pigra: il costo non dipende dalle
+// zone della mappa ma da quelle raggiunte
+static void bench_partita_pigra(size_t zone) {
+    Misura m = nuova_misura("partita_pigra", (long long) zone);
+    const char* nomi[2] = { "A", "B" };
+    const Agente* agenti[2] = { &agente_esploratore, &agente_esploratore };
+    Parametri_mappa p = PARAMETRI_MAPPA_DEFAULT;
+    p.zone = zone;
+    for (unsigned long long seme = 1; !tempo_scaduto(&m); seme++) {
+        p.seme = seme;
+        avvia();
+        gioco_semina(sessione, seme);
+        motore_imposta_giocatori(sessione, 2, nomi, NULL);
+        if (mappa_genera_pigra(sessione, &p) && mappa_chiudi(sessione)) motore_gioca(sessione, agenti, 200);
+        ferma(&m, 1);
+    }
+    stampa_misura(&m);
+}
+
+// Decisioni MCTS al primo turno di una partita a due sulla mappa standard,
+// con un numero fisso di simulazioni su tutti i core: tempo per simulazione
+static void bench_mcts(unsigned long long simulazioni) {
+    Misura m = nuova_misura("mcts_simulazione", (long long) simulazioni);
+    const char* nomi[2] = { "A", "B" };
+    Opzioni_mcts o = OPZIONI_MCTS_DEFAULT;
+    o.millisecondi = 0;
+    o.simulazioni = simulazioni;
+    Mcts* mcts = mcts_crea(&o);
+    if (mcts == NULL) return;
+    gioco_semina(sessione, 1);
+    motore_imposta_giocatori(sessione, 2, nomi, NULL);
+    motore_genera_mappa(sessione);
+    partita_inizia(sessione, 200);
+    Decisione_mcts d;
+    while (!tempo_scaduto(&m)) {
+        avvia();
+        mcts_decidi(mcts, sessione, &d);
+        ferma(&m, (long long) d.simulazioni);
+    }
+    mcts_distruggi(mcts);
+    stampa_misura(&m);
+}
+
+// Blocchi di partite indipendenti, ognuna in una sessione propria, su tutti i core
+static void bench_sessioni_parallele(size_t partite) {
+    Misura m = nuova_misura("sessioni_parallele", (long long) partite);
+    Pianificatore* p = pianificatore_crea(0);
+    Partita_parallela* v = (Partita_parallela*) calloc(partite, sizeof(Partita_parallela));
+    unsigned int* semi = (unsigned int*) calloc(partite, sizeof(unsigned int));
+    Agente* agenti = (Agente*) calloc(partite, sizeof(Agente));
+    if (p == NULL || v == NULL || semi == NULL || agenti == NULL) { free(v); free(semi); free(agenti); pianificatore_distruggi(p); return; }
+    for (unsigned long long giro = 0; !tempo_scaduto(&m); giro++) {
+        for (size_t i = 0; i < partite; i++) {
+            semi[i] = (unsigned int) (giro * partite + i);
+            agenti[i] = agente_casuale(&semi[i]);
+            v[i].seme = giro * partite + i + 1;
+            v[i].numero_giocatori = 2;
+            v[i].agenti[0] = v[i].agenti[1] = (i % 2) ? &agenti[i] : &agente_esploratore;
+            v[i].max_round = 200;
+        }
+        avvia();
+        sessioni_gioca(p, v, partite);
+        ferma(&m, (long long) partite);
+    }
+    stampa_misura(&m);
+    free(v); free(semi); free(agenti);
+    pianificatore_distruggi(p);
+}
+
+// Log di n vittorie su file temporaneo: scrittura, riapertura dall'indice e
+// interrogazioni dei crediti (10 migliori, 10 recenti, un giocatore)
+static void bench_classifica(size_t n) {
+    char percorso[64], indice[72];
+    snprintf(percorso, sizeof(percorso), "/tmp/benchmark_classifica_%ld", (long) getpid());
+    snprintf(indice, sizeof(indice), "%s.indice", percorso);
+    remove(percorso);
+    remove(indice);
+    Classifica* c = classifica_apri(percorso);
+    if (c == NULL) return;
+
+    Misura m = nuova_misura("classifica_registra", (long long) n);
+    char nome[16];
+    avvia();
+    for (size_t i = 0; i < n; i++) {
+        snprintf(nome, sizeof(nome), "G%u", (unsigned) rng_contatore_limitato(1, 0, i, 10000));
+        classifica_registra(c, nome, 1 + (int) (i % 50), i);
+    }
+    ferma(&m, (long long) n);
+    stampa_misura(&m);
+    classifica_chiudi(c);
+
+    m = nuova_misura("classifica_apri", (long long) n);
+    while (!tempo_scaduto(&m)) {
+        avvia();
+        c = classifica_apri(percorso);
+        ferma(&m, 1);
+        if (c == NULL) break;
+        classifica_chiudi(c);
+    }
+    stampa_misura(&m);
+
+    c = classifica_apri(percorso);
+    if (c != NULL) {
+        Statistiche_vincitore migliori[10], s;
+        Vittoria_registrata recenti[10];
+        m = nuova_misura("classifica_interroga", (long long) n);
+        while (!tempo_scaduto(&m)) {
+            avvia();
+            for (int k = 0; k < 1000; k++) {
+                classifica_migliori(c, migliori, 10);
+                classifica_recenti(c, recenti, 10);
+                classifica_giocatore(c, migliori[k % 10].nome, &s);
+            }
+            ferma(&m, 1000);
+        }
+        stampa_misura(&m);
+        classifica_chiudi(c);
+    }
+    remove(percorso);
+    remove(indice);
+}
+
+int main(int argc, char* argv[]) {
+    int rapido = argc > 1 && strcmp(argv[1], "--rapido") == 0;
+    if (rapido) tempo_minimo = 0.05;
+    motore_silenzioso(1);
+    probabilita_inizializza(); // Come il gioco: la politica legge la tabella delle vittorie
+    sessione = sessione_crea(1);
+    if (sessione == NULL) return 1;
+
+    static const size_t dimensioni[] = { 15, 1000, 100000, 1000000 };
+    size_t casi = rapido ? 3 : 4;
+
+    printf("{\n  \"versione\": 1,\n  \"isa\": \"%s\",\n  \"rapido\": %s,\n  \"risultati\": [",
+           soa_isa(), rapido ? "true" : "false");
+    for (size_t i = 0; i < casi; i++) bench_genera(dimensioni[i]);
+    for (size_t i = 1; i < casi; i++) bench_genera_compatta(dimensioni[i]);
+    if (!rapido) bench_genera_compatta(50000000);
+    for (size_t i = 1; i < casi; i++) bench_inserisci_cancella(dimensioni[i]);
+    for (size_t i = 0; i < casi; i++) bench_conta_chiudi(dimensioni[i]);
+    for (size_t i = 1; i < casi; i++) bench_dealloca(dimensioni[i]);
+    for (size_t i = 1; i < casi; i++) bench_politica(dimensioni[i]);
+    for (size_t i = 1; i < casi; i++) bench_ramo(dimensioni[i]);
+    for (int nemico = billi; nemico <= demotorzone; nemico++) bench_combatti((Tipo_nemico) nemico);
+    bench_partita("partita_esploratore", 15, 0);
+    bench_partita("partita_casuale", 15, 1);
+    bench_partita("partita_ottimo", 15, 2);
+    bench_partita("partita_esploratore", 10000, 0);
+    bench_partita("partita_ottimo", 10000, 2);
+    bench_partita_pigra(10000);
+    bench_partita_pigra(1000000000);
+    bench_mcts(4096);
+    bench_sessioni_parallele(256);
+    for (size_t i = 1; i < casi; i++) bench_classifica(dimensioni[i]);
+    printf("\n  ]\n}\n");
+
+    sessione_distruggi(sessione);
+    return 0;
+}
@@ -0,0 +1,223 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <netdb.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+// ============================================================================
+// CLIENT DI CARICO PER IL SERVER DI GIOCO
+// ============================================================================
+// Apre molte connessioni verso un server avviato con "gioco -S": le attive
+// giocano con la strategia dell'agente esploratore (ricavata dalle righe
+// ?azione, vedi server.h) e a fine partita si ricollegano; le inattive
+// restano collegate senza mandare il nome, come giocatori che non si
+// siedono mai, e pesano solo sul ciclo di eventi.
+// Misura la latenza fra l'invio di una scelta e la richiesta successiva (o
+// la fine della partita) e stampa un riepilogo JSON su stdout.
+//
+// Uso: carico -a INDIRIZZO [-c ATTIVI] [-i INATTIVI] [-d SECONDI]
+
+#define MAX_EVENTI 256
+#define LATENZA_MAX_US 100000 // Oltre: nell'ultimo secchiello
+
+typedef struct Client {
+    int fd;
+    int attivo;
+    uint64_t inviato_ns; // 0: nessuna scelta in attesa di risposta
+    char riga[256];
+    size_t n_riga;
+} Client;
+
+static const char* indirizzo = NULL;
+static uint64_t latenze[LATENZA_MAX_US + 1]; // Secchielli da 1 µs
+static unsigned long long scelte, partite, connessioni, errori;
+
+static uint64_t ora_ns() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000000ull + (uint64_t) t.tv_nsec;
+}
+
+static int collega() {
+    int fd = -1;
+    if (strchr(indirizzo, '/') != NULL) {
+        struct sockaddr_un a;
+        memset(&a, 0, sizeof(a));
+        a.sun_family = AF_UNIX;
+        snprintf(a.sun_path, sizeof(a.sun_path), "%s", indirizzo);
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd >= 0 && connect(fd, (struct sockaddr*) &a, sizeof(a)) != 0) { close(fd); fd = -1; }
+    } else {
+        char host[256] = "localhost";
+        const char* porta = indirizzo;
+        const char* due_punti = strrchr(indirizzo, ':');
+        if (due_punti != NULL && due_punti > indirizzo && (size_t) (due_punti - indirizzo) < sizeof(host)) {
+            memcpy(host, indirizzo, (size_t) (due_punti - indirizzo));
+            host[due_punti - indirizzo] = '\0';
+            porta = due_punti + 1;
+        }
+        struct addrinfo suggerimenti, *elenco;
+        memset(&suggerimenti, 0, sizeof(suggerimenti));
+        suggerimenti.ai_socktype = SOCK_STREAM;
+        if (getaddrinfo(host, porta, &suggerimenti, &elenco) != 0) return -1;
+        for (struct addrinfo* a = elenco; a != NULL && fd < 0; a = a->ai_next) {
+            fd = socket(a->ai_family, a->ai_socktype | SOCK_CLOEXEC, a->ai_protocol);
+            if (fd >= 0 && connect(fd, a->ai_addr, a->ai_addrlen) != 0) { close(fd); fd = -1; }
+        }
+        freeaddrinfo(elenco);
+    }
+    return fd;
+}
+
+static void scrivi(Client* k, const char* s) {
+    size_t n = strlen(s);
+    // Righe corte su un socket che il server svuota: non si riempie mai
+    if (send(k->fd, s, n, MSG_NOSIGNAL) != (ssize_t) n) errori++;
+}
+
+static int apri(int ep, Client* k) {
+    k->fd = collega();
+    if (k->fd < 0) { errori++; return 0; }
+    k->n_riga = 0;
+    k->inviato_ns = 0;
+    connessioni++;
+    if (k->attivo) scrivi(k, "Carico\n");
+    struct epoll_event e;
+    e.events = EPOLLIN;
+    e.data.ptr = k;
+    epoll_ctl(ep, EPOLL_CTL_ADD, k->fd, &e);
+    return 1;
+}
+
+static void registra_latenza(Client* k) {
+    if (k->inviato_ns == 0) return;
+    uint64_t us = (ora_ns() - k->inviato_ns) / 1000;
+    latenze[us < LATENZA_MAX_US ? us : LATENZA_MAX_US]++;
+    k->inviato_ns = 0;
+}
+
+// Strategia dell'agente esploratore (senza raccogliere oggetti)
+static int scegli_azione(const char* campi) {
+    int mosso = 0, mondo = 0, nemico = 0, ultima = 0;
+    if (sscanf(campi, "%d %d %d %d", &mosso, &mondo, &nemico, &ultima) != 4) return 9;
+    if (nemico != 0) return 4;
+    if (mosso) return 9;
+    if (mondo == 0) return 3;
+    if (ultima) return 9;
+    return 1;
+}
+
+static void riga_ricevuta(Client* k, const char* riga) {
+    int scelta;
+    if (strncmp(riga, "?azione ", 8) == 0) scelta = scegli_azione(riga + 8);
+    else if (strncmp(riga, "?combattimento", 14) == 0) scelta = 1;
+    else if (strncmp(riga, "?oggetto", 8) == 0) scelta = 0;
+    else {
+        if (strncmp(riga, "#fine", 5) == 0) { registra_latenza(k); partite++; }
+        return;
+    }
+    registra_latenza(k);
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%d\n", scelta);
+    k->inviato_ns = ora_ns();
+    scelte++;
+    scrivi(k, buf);
+}
+
+// Restituisce 0 se il server ha chiuso la connessione
+static int leggi(Client* k) {
+    char buf[16384];
+    for (;;) {
+        ssize_t n = recv(k->fd, buf, sizeof(buf), MSG_DONTWAIT);
+        if (n == 0) return 0;
+        if (n < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        for (ssize_t i = 0; i < n; i++) {
+            if (buf[i] == '\n') {
+                k->riga[k->n_riga] = '\0';
+                k->n_riga = 0;
+                if (k->riga[0] == '?' || k->riga[0] == '#') riga_ricevuta(k, k->riga);
+            } else if (k->n_riga < sizeof(k->riga) - 1) {
+                k->riga[k->n_riga++] = buf[i];
+            }
+        }
+        if ((size_t) n < sizeof(buf)) return 1;
+    }
+}
+
+static double percentile(uint64_t totale, double p) {
+    uint64_t soglia = (uint64_t) (p * (double) totale), visti = 0;
+    for (int i = 0; i <= LATENZA_MAX_US; i++) {
+        visti += latenze[i];
+        if (visti > soglia) return i;
+    }
+    return LATENZA_MAX_US;
+}
+
+int main(int argc, char* argv[]) {
+    int attivi = 100, inattivi = 0;
+    double durata = 5.0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) indirizzo = argv[++i];
+        else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) attivi = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) inattivi = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) durata = atof(argv[++i]);
+    }
+    if (indirizzo == NULL || attivi < 0 || inattivi < 0) {
+        fprintf(stderr, "Uso: %s -a INDIRIZZO [-c ATTIVI] [-i INATTIVI] [-d SECONDI]\n", argv[0]);
+        return 2;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    struct rlimit l;
+    if (getrlimit(RLIMIT_NOFILE, &l) == 0) { l.rlim_cur = l.rlim_max; setrlimit(RLIMIT_NOFILE, &l); }
+
+    int n = attivi + inattivi;
+    Client* client = (Client*) calloc((size_t) (n > 0 ? n : 1), sizeof(Client));
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    if (client == NULL || ep < 0) return 2;
+    // Prima le inattive, così le attive giocano con tutte le connessioni aperte
+    for (int i = 0; i < n; i++) {
+        client[i].attivo = i >= inattivi;
+        if (!apri(ep, &client[i])) {
+            fprintf(stderr, "Connessione %d a %s fallita: %s\n", i, indirizzo, strerror(errno));
+            return 1;
+        }
+    }
+
+    uint64_t inizio = ora_ns(), fine = inizio + (uint64_t) (durata * 1e9);
+    struct epoll_event eventi[MAX_EVENTI];
+    for (uint64_t ora = inizio; ora < fine; ora = ora_ns()) {
+        int m = epoll_wait(ep, eventi, MAX_EVENTI, (int) ((fine - ora) / 1000000) + 1);
+        for (int i = 0; i < m; i++) {
+            Client* k = (Client*) eventi[i].data.ptr;
+            if (leggi(k)) continue;
+            // Partita finita (o server chiuso): le attive ricominciano
+            epoll_ctl(ep, EPOLL_CTL_DEL, k->fd, NULL);
+            close(k->fd);
+            if (!apri(ep, k)) k->fd = -1;
+        }
+    }
+    double secondi = (double) (ora_ns() - inizio) / 1e9;
+
+    uint64_t misure = 0;
+    for (int i = 0; i <= LATENZA_MAX_US; i++) misure += latenze[i];
+    printf("{\n  \"attivi\": %d,\n  \"inattivi\": %d,\n  \"secondi\": %.3f,\n", attivi, inattivi, secondi);
+    printf("  \"connessioni\": %llu,\n  \"partite\": %llu,\n  \"scelte\": %llu,\n  \"errori\": %llu,\n",
+           connessioni, partite, scelte, errori);
+    printf("  \"scelte_al_secondo\": %.1f,\n", (double) scelte / secondi);
+    printf("  \"latenza_us\": { \"p50\": %.0f, \"p90\": %.0f, \"p99\": %.0f, \"p999\": %.0f }\n}\n",
+           percentile(misure, 0.5), percentile(misure, 0.9), percentile(misure, 0.99), percentile(misure, 0.999));
+
+    for (int i = 0; i < n; i++) if (client[i].fd >= 0) close(client[i].fd);
+    close(ep);
+    free(client);
+    return 0;
+}
@@ -0,0 +1,509 @@
+#define _POSIX_C_SOURCE 200809L
+#include "classifica.h"
+#include "salvataggio.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define MAGIC_LOG "CSTRCLAS"
+#define MAGIC_INDICE "CSTRCLIX"
+#define DIM_INTESTAZIONE_LOG 16
+#define DIM_RECORD 128
+#define DIM_INTESTAZIONE_INDICE 40
+#define DIM_VOCE 128
+#define RECORD_PER_LETTURA 4096 // Rileggendo il log: 512 KB per lettura
+
+// Posizioni dei campi nel record del log
+#define REC_ISTANTE 0
+#define REC_ROUND   8
+#define REC_CRC     12
+#define REC_NOME    16
+
+// Posizioni dei campi nell'intestazione dell'indice
+#define IDX_VERSIONE    8
+#define IDX_CRC_ULTIMO  12
+#define IDX_COPERTI     16
+#define IDX_GIOCATORI   24
+#define IDX_CRC_CORPO   32
+#define IDX_CRC_INTEST  36
+
+#define NESSUNA ((size_t) -1)
+
+typedef struct Voce {
+    Statistiche_vincitore s;
+    size_t posto; // Posizione in ordine
+} Voce;
+
+struct Classifica {
+    pthread_mutex_t mutex;
+    int fd;
+    char* percorso_indice;
+    uint64_t record;     // Record validi nel log
+    uint32_t crc_ultimo; // CRC dell'ultimo record: lega l'indice a questo log
+    uint64_t vittorie;
+
+    Voce* voci;
+    size_t n_voci, capacita_voci;
+    size_t* tabella;     // Hash del nome -> indice in voci (NESSUNA se libero)
+    size_t capacita_tabella; // Potenza di 2, riempita al più per metà
+    size_t* ordine;      // Voci per vittorie decrescenti
+    // Per numero di vittorie v: primo posto in ordine e giocatori nel gruppo
+    size_t* inizio;
+    size_t* quanti;
+    size_t capacita_gruppi;
+};
+
+// ============================================================================
+// CODIFICA LITTLE-ENDIAN
+// ============================================================================
+
+static void scrivi_u32(unsigned char* p, uint32_t v) {
+    p[0] = (unsigned char) v; p[1] = (unsigned char) (v >> 8);
+    p[2] = (unsigned char) (v >> 16); p[3] = (unsigned char) (v >> 24);
+}
+
+static void scrivi_u64(unsigned char* p, uint64_t v) {
+    scrivi_u32(p, (uint32_t) v);
+    scrivi_u32(p + 4, (uint32_t) (v >> 32));
+}
+
+static uint32_t leggi_u32(const unsigned char* p) {
+    return (uint32_t) p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+static uint64_t leggi_u64(const unsigned char* p) {
+    return (uint64_t) leggi_u32(p) | (uint64_t) leggi_u32(p + 4) << 32;
+}
+
+// CRC del record con il campo del CRC a zero
+static uint32_t crc_record(const unsigned char* r) {
+    uint32_t crc = crc32_aggiorna(0, r, REC_CRC);
+    static const unsigned char zero[4] = { 0 };
+    crc = crc32_aggiorna(crc, zero, 4);
+    return crc32_aggiorna(crc, r + REC_NOME, DIM_RECORD - REC_NOME);
+}
+
+static void codifica_record(unsigned char* r, const Vittoria_registrata* v) {
+    memset(r, 0, DIM_RECORD);
+    scrivi_u64(r + REC_ISTANTE, v->istante);
+    scrivi_u32(r + REC_ROUND, (uint32_t) v->round);
+    snprintf((char*) r + REC_NOME, 100, "%s", v->nome);
+    scrivi_u32(r + REC_CRC, crc_record(r));
+}
+
+// 0 se il record è corrotto
+static int decodifica_record(const unsigned char* r, Vittoria_registrata* v) {
+    if (leggi_u32(r + REC_CRC) != crc_record(r) || memchr(r + REC_NOME, '\0', 100) == NULL) return 0;
+    v->istante = leggi_u64(r + REC_ISTANTE);
+    v->round = (int) (int32_t) leggi_u32(r + REC_ROUND);
+    memcpy(v->nome, r + REC_NOME, 100);
+    return 1;
+}
+
+// Scrive o legge esattamente n byte all'offset dato
+static int scrivi_tutto(int fd, const unsigned char* p, size_t n, off_t offset) {
+    while (n > 0) {
+        ssize_t k = pwrite(fd, p, n, offset);
+        if (k <= 0) return 0;
+        p += k; n -= (size_t) k; offset += k;
+    }
+    return 1;
+}
+
+static int leggi_tutto(int fd, unsigned char* p, size_t n, off_t offset) {
+    while (n > 0) {
+        ssize_t k = pread(fd, p, n, offset);
+        if (k <= 0) return 0;
+        p += k; n -= (size_t) k; offset += k;
+    }
+    return 1;
+}
+
+static off_t offset_record(uint64_t i) {
+    return (off_t) (DIM_INTESTAZIONE_LOG + i * DIM_RECORD);
+}
+
+// ============================================================================
+// INDICE IN MEMORIA
+// ============================================================================
+
+// FNV-1a a 64 bit
+static uint64_t hash_nome(const char* nome) {
+    uint64_t h = 14695981039346656037ull;
+    for (const unsigned char* p = (const unsigned char*) nome; *p; p++) h = (h ^ *p) * 1099511628211ull;
+    return h;
+}
+
+static size_t trova(const Classifica* c, const char* nome) {
+    if (c->capacita_tabella == 0) return NESSUNA;
+    size_t maschera = c->capacita_tabella - 1;
+    for (size_t i = (size_t) hash_nome(nome) & maschera; c->tabella[i] != NESSUNA; i = (i + 1) & maschera)
+        if (strcmp(c->voci[c->tabella[i]].s.nome, nome) == 0) return c->tabella[i];
+    return NESSUNA;
+}
+
+static void inserisci_in_tabella(Classifica* c, size_t voce) {
+    size_t maschera = c->capacita_tabella - 1;
+    size_t i = (size_t) hash_nome(c->voci[voce].s.nome) & maschera;
+    while (c->tabella[i] != NESSUNA) i = (i + 1) & maschera;
+    c->tabella[i] = voce;
+}
+
+// Spazio per una voce in più (tabella, voci e ordine). 0 se manca memoria
+static int riserva_voce(Classifica* c) {
+    if (c->n_voci == c->capacita_voci) {
+        size_t capacita = c->capacita_voci ? 2 * c->capacita_voci : 64;
+        Voce* v = (Voce*) realloc(c->voci, capacita * sizeof(Voce));
+        if (v == NULL) return 0;
+        c->voci = v;
+        size_t* o = (size_t*) realloc(c->ordine, capacita * sizeof(size_t));
+        if (o == NULL) return 0;
+        c->ordine = o;
+        c->capacita_voci = capacita;
+    }
+    if (2 * (c->n_voci + 1) > c->capacita_tabella) {
+        size_t capacita = c->capacita_tabella ? 2 * c->capacita_tabella : 128;
+        size_t* t = (size_t*) malloc(capacita * sizeof(size_t));
+        if (t == NULL) return 0;
+        free(c->tabella);
+        c->tabella = t;
+        c->capacita_tabella = capacita;
+        for (size_t i = 0; i < capacita; i++) t[i] = NESSUNA;
+        for (size_t i = 0; i < c->n_voci; i++) inserisci_in_tabella(c, i);
+    }
+    return 1;
+}
+
+// Gruppi fino a v vittorie comprese. 0 se manca memoria
+static int riserva_gruppi(Classifica* c, uint64_t v) {
+    if (v < c->capacita_gruppi) return 1;
+    size_t capacita = c->capacita_gruppi ? c->capacita_gruppi : 64;
+    while (capacita <= v) capacita *= 2;
+    size_t* i = (size_t*) realloc(c->inizio, capacita * sizeof(size_t));
+    if (i == NULL) return 0;
+    c->inizio = i;
+    size_t* q = (size_t*) realloc(c->quanti, capacita * sizeof(size_t));
+    if (q == NULL) return 0;
+    c->quanti = q;
+    for (size_t k = c->capacita_gruppi; k < capacita; k++) q[k] = 0;
+    c->capacita_gruppi = capacita;
+    return 1;
+}
+
+// Nuovo giocatore senza vittorie, in fondo all'ordine (dove sta il gruppo 0)
+static size_t nuova_voce(Classifica* c, const char* nome) {
+    if (!riserva_voce(c) || !riserva_gruppi(c, 0)) return NESSUNA;
+    size_t i = c->n_voci++;
+    Voce* v = &c->voci[i];
+    memset(v, 0, sizeof(*v));
+    snprintf(v->s.nome, sizeof(v->s.nome), "%s", nome);
+    v->posto = i;
+    c->ordine[i] = i;
+    if (c->quanti[0]++ == 0) c->inizio[0] = i;
+    inserisci_in_tabella(c, i);
+    return i;
+}
+
+// Una vittoria in più: il giocatore scambia il posto con il primo del suo
+// gruppo, che diventa l'ultimo del gruppo con una vittoria in più
+static int conta_vittoria(Classifica* c, const Vittoria_registrata* r) {
+    size_t i = trova(c, r->nome);
+    if (i == NESSUNA) i = nuova_voce(c, r->nome);
+    if (i == NESSUNA) return 0;
+    Voce* v = &c->voci[i];
+    uint64_t w = v->s.vittorie;
+    if (!riserva_gruppi(c, w + 1)) return 0;
+
+    size_t primo = c->inizio[w], altro = c->ordine[primo];
+    c->ordine[v->posto] = altro; c->voci[altro].posto = v->posto;
+    c->ordine[primo] = i; v->posto = primo;
+    c->quanti[w]--;
+    c->inizio[w] = primo + 1;
+    if (c->quanti[w + 1]++ == 0) c->inizio[w + 1] = primo;
+
+    v->s.vittorie++;
+    v->s.round_totali += (uint64_t) r->round;
+    if (v->s.vittorie == 1 || r->round < v->s.round_minimo) v->s.round_minimo = r->round;
+    if (r->istante > v->s.ultima) v->s.ultima = r->istante;
+    c->vittorie++;
+    return 1;
+}
+
+// Ricostruisce ordine e gruppi dalle vittorie delle voci (ordinamento per
+// conteggio), dopo aver caricato l'indice dal file
+static int ordina_voci(Classifica* c) {
+    uint64_t massimo = 0;
+    for (size_t i = 0; i < c->n_voci; i++) if (c->voci[i].s.vittorie > massimo) massimo = c->voci[i].s.vittorie;
+    if (!riserva_gruppi(c, massimo + 1)) return 0;
+    for (size_t i = 0; i < c->n_voci; i++) c->quanti[c->voci[i].s.vittorie]++;
+    size_t posto = 0;
+    for (uint64_t w = massimo + 1; w-- > 0; ) { c->inizio[w] = posto; posto += c->quanti[w]; }
+    for (uint64_t w = 0; w <= massimo; w++) c->quanti[w] = 0;
+    for (size_t i = 0; i < c->n_voci; i++) {
+        uint64_t w = c->voci[i].s.vittorie;
+        size_t p = c->inizio[w] + c->quanti[w]++;
+        c->ordine[p] = i;
+        c->voci[i].posto = p;
+    }
+    return 1;
+}
+
+static void azzera_indice(Classifica* c) {
+    c->n_voci = 0;
+    c->vittorie = 0;
+    for (size_t i = 0; i < c->capacita_tabella; i++) c->tabella[i] = NESSUNA;
+    for (size_t i = 0; i < c->capacita_gruppi; i++) c->quanti[i] = 0;
+}
+
+// ============================================================================
+// INDICE SU FILE
+// ============================================================================
+
+static void codifica_voce(unsigned char* p, const Statistiche_vincitore* s) {
+    memset(p, 0, DIM_VOCE);
+    memcpy(p, s->nome, 100);
+    p[99] = '\0';
+    scrivi_u32(p + 100, (uint32_t) s->round_minimo);
+    scrivi_u64(p + 104, s->vittorie);
+    scrivi_u64(p + 112, s->round_totali);
+    scrivi_u64(p + 120, s->ultima);
+}
+
+// Scrive l'indice su un file temporaneo e lo rinomina
+static int scrivi_indice(const Classifica* c) {
+    size_t dimensione = DIM_INTESTAZIONE_INDICE + c->n_voci * DIM_VOCE;
+    unsigned char* buf = (unsigned char*) malloc(dimensione);
+    if (buf == NULL) return 0;
+    unsigned char* corpo = buf + DIM_INTESTAZIONE_INDICE;
+    for (size_t p = 0; p < c->n_voci; p++) codifica_voce(corpo + p * DIM_VOCE, &c->voci[c->ordine[p]].s);
+
+    memset(buf, 0, DIM_INTESTAZIONE_INDICE);
+    memcpy(buf, MAGIC_INDICE, 8);
+    scrivi_u32(buf + IDX_VERSIONE, CLASSIFICA_VERSIONE);
+    scrivi_u32(buf + IDX_CRC_ULTIMO, c->crc_ultimo);
+    scrivi_u64(buf + IDX_COPERTI, c->record);
+    scrivi_u64(buf + IDX_GIOCATORI, c->n_voci);
+    scrivi_u32(buf + IDX_CRC_CORPO, crc32_aggiorna(0, corpo, dimensione - DIM_INTESTAZIONE_INDICE));
+    scrivi_u32(buf + IDX_CRC_INTEST, crc32_aggiorna(0, buf, IDX_CRC_INTEST));
+
+    size_t lunghezza = strlen(c->percorso_indice);
+    char* temporaneo = (char*) malloc(lunghezza + 5);
+    int ok = temporaneo != NULL;
+    if (ok) {
+        memcpy(temporaneo, c->percorso_indice, lunghezza);
+        memcpy(temporaneo + lunghezza, ".tmp", 5);
+        FILE* f = fopen(temporaneo, "wb");
+        ok = f != NULL && fwrite(buf, 1, dimensione, f) == dimensione;
+        if (f != NULL && fclose(f) != 0) ok = 0;
+        if (ok) ok = rename(temporaneo, c->percorso_indice) == 0;
+        if (!ok) remove(temporaneo);
+    }
+    free(temporaneo);
+    free(buf);
+    return ok;
+}
+
+// Carica l'indice se copre un prefisso di questo log. Restituisce i record
+// coperti (0 se l'indice manca o non vale: si rilegge tutto il log)
+static uint64_t carica_indice(Classifica* c, uint64_t record_log) {
+    FILE* f = fopen(c->percorso_indice, "rb");
+    if (f == NULL) return 0;
+    unsigned char intestazione[DIM_INTESTAZIONE_INDICE];
+    unsigned char* corpo = NULL;
+    uint64_t coperti = 0;
+    if (fread(intestazione, 1, sizeof(intestazione), f) != sizeof(intestazione)) goto fine;
+    if (memcmp(intestazione, MAGIC_INDICE, 8) != 0 || leggi_u32(intestazione + IDX_VERSIONE) != CLASSIFICA_VERSIONE) goto fine;
+    if (crc32_aggiorna(0, intestazione, IDX_CRC_INTEST) != leggi_u32(intestazione + IDX_CRC_INTEST)) goto fine;
+
+    uint64_t n = leggi_u64(intestazione + IDX_GIOCATORI);
+    uint64_t copre = leggi_u64(intestazione + IDX_COPERTI);
+    if (copre == 0 || copre > record_log || n > copre) goto fine;
+    // L'ultimo record coperto deve essere integro e lo stesso: altrimenti è
+    // l'indice di un altro log (o di uno rovinato dopo la chiusura)
+    unsigned char r[DIM_RECORD];
+    Vittoria_registrata ultima;
+    if (!leggi_tutto(c->fd, r, DIM_RECORD, offset_record(copre - 1)) || !decodifica_record(r, &ultima)) goto fine;
+    if (leggi_u32(r + REC_CRC) != leggi_u32(intestazione + IDX_CRC_ULTIMO)) goto fine;
+
+    size_t dimensione = (size_t) n * DIM_VOCE;
+    corpo = (unsigned char*) malloc(dimensione ? dimensione : 1);
+    if (corpo == NULL || fread(corpo, 1, dimensione, f) != dimensione) goto fine;
+    if (crc32_aggiorna(0, corpo, dimensione) != leggi_u32(intestazione + IDX_CRC_CORPO)) goto fine;
+
+    uint64_t vittorie = 0;
+    for (size_t k = 0; k < (size_t) n; k++) {
+        const unsigned char* p = corpo + k * DIM_VOCE;
+        if (memchr(p, '\0', 100) == NULL || trova(c, (const char*) p) != NESSUNA || !riserva_voce(c)) goto annulla;
+        Voce* v = &c->voci[c->n_voci];
+        memset(v, 0, sizeof(*v));
+        memcpy(v->s.nome, p, 100);
+        v->s.round_minimo = (int) (int32_t) leggi_u32(p + 100);
+        v->s.vittorie = leggi_u64(p + 104);
+        v->s.round_totali = leggi_u64(p + 112);
+        v->s.ultima = leggi_u64(p + 120);
+        if (v->s.vittorie == 0) goto annulla;
+        vittorie += v->s.vittorie;
+        inserisci_in_tabella(c, c->n_voci++);
+    }
+    if (vittorie != copre || !ordina_voci(c)) goto annulla;
+    c->vittorie = vittorie;
+    c->crc_ultimo = leggi_u32(intestazione + IDX_CRC_ULTIMO);
+    coperti = copre;
+    goto fine;
+annulla:
+    azzera_indice(c);
+fine:
+    free(corpo);
+    fclose(f);
+    return coperti;
+}
+
+// Rilegge i record del log da primo in poi. Restituisce i record validi
+// (quelli dopo il primo corrotto si scartano); UINT64_MAX se manca memoria
+static uint64_t rileggi_log(Classifica* c, uint64_t primo, uint64_t record_log) {
+    unsigned char* buf = (unsigned char*) malloc((size_t) RECORD_PER_LETTURA * DIM_RECORD);
+    if (buf == NULL) return UINT64_MAX;
+    uint64_t i = primo;
+    while (i < record_log) {
+        size_t blocco = (size_t) (record_log - i < RECORD_PER_LETTURA ? record_log - i : RECORD_PER_LETTURA);
+        if (!leggi_tutto(c->fd, buf, blocco * DIM_RECORD, offset_record(i))) break;
+        size_t k = 0;
+        for (; k < blocco; k++) {
+            Vittoria_registrata v;
+            if (!decodifica_record(buf + k * DIM_RECORD, &v)) break;
+            if (!conta_vittoria(c, &v)) { free(buf); return UINT64_MAX; }
+            c->crc_ultimo = leggi_u32(buf + k * DIM_RECORD + REC_CRC);
+        }
+        i += k;
+        if (k < blocco) break;
+    }
+    free(buf);
+    return i;
+}
+
+// ============================================================================
+// FUNZIONI PUBBLICHE
+// ============================================================================
+
+void classifica_chiudi(Classifica* c) {
+    if (c == NULL) return;
+    if (c->fd >= 0) {
+        if (c->record > 0) scrivi_indice(c);
+        close(c->fd);
+    }
+    pthread_mutex_destroy(&c->mutex);
+    free(c->percorso_indice);
+    free(c->voci);
+    free(c->tabella);
+    free(c->ordine);
+    free(c->inizio);
+    free(c->quanti);
+    free(c);
+}
+
+Classifica* classifica_apri(const char* percorso) {
+    Classifica* c = (Classifica*) calloc(1, sizeof(Classifica));
+    if (c == NULL) return NULL;
+    pthread_mutex_init(&c->mutex, NULL);
+    size_t lunghezza = strlen(percorso);
+    c->percorso_indice = (char*) malloc(lunghezza + 8);
+    c->fd = open(percorso, O_RDWR | O_CREAT, 0644);
+    if (c->percorso_indice == NULL || c->fd < 0) { classifica_chiudi(c); return NULL; }
+    memcpy(c->percorso_indice, percorso, lunghezza);
+    memcpy(c->percorso_indice + lunghezza, ".indice", 8);
+
+    struct stat st;
+    unsigned char intestazione[DIM_INTESTAZIONE_LOG];
+    if (fstat(c->fd, &st) != 0) { classifica_chiudi(c); return NULL; }
+    if (st.st_size == 0) {
+        memset(intestazione, 0, sizeof(intestazione));
+        memcpy(intestazione, MAGIC_LOG, 8);
+        scrivi_u32(intestazione + 8, CLASSIFICA_VERSIONE);
+        if (!scrivi_tutto(c->fd, intestazione, sizeof(intestazione), 0)) { classifica_chiudi(c); return NULL; }
+    } else if (st.st_size < DIM_INTESTAZIONE_LOG || !leggi_tutto(c->fd, intestazione, sizeof(intestazione), 0)
+               || memcmp(intestazione, MAGIC_LOG, 8) != 0 || leggi_u32(intestazione + 8) != CLASSIFICA_VERSIONE) {
+        close(c->fd); // Non è un log della classifica: non va toccato
+        c->fd = -1;
+        classifica_chiudi(c);
+        return NULL;
+    }
+
+    uint64_t record_log = st.st_size > DIM_INTESTAZIONE_LOG ? (uint64_t) (st.st_size - DIM_INTESTAZIONE_LOG) / DIM_RECORD : 0;
+    uint64_t validi = rileggi_log(c, carica_indice(c, record_log), record_log);
+    if (validi == UINT64_MAX) { classifica_chiudi(c); return NULL; }
+    c->record = validi;
+    // Coda incompleta o corrotta: le vittorie successive ripartono dall'ultimo record valido
+    if ((off_t) st.st_size != offset_record(validi) && ftruncate(c->fd, offset_record(validi)) != 0) {
+        classifica_chiudi(c);
+        return NULL;
+    }
+    return c;
+}
+
+int classifica_registra(Classifica* c, const char* nome, int round, uint64_t istante) {
+    Vittoria_registrata v;
+    v.istante = istante;
+    v.round = round;
+    snprintf(v.nome, sizeof(v.nome), "%s", nome);
+    unsigned char r[DIM_RECORD];
+    codifica_record(r, &v);
+
+    pthread_mutex_lock(&c->mutex);
+    // Prima il log: una vittoria nell'indice c'è sempre anche nel file
+    int ok = scrivi_tutto(c->fd, r, DIM_RECORD, offset_record(c->record));
+    if (ok) {
+        c->record++;
+        c->crc_ultimo = leggi_u32(r + REC_CRC);
+        ok = conta_vittoria(c, &v);
+    }
+    pthread_mutex_unlock(&c->mutex);
+    return ok;
+}
+
+int classifica_giocatore(Classifica* c, const char* nome, Statistiche_vincitore* out) {
+    pthread_mutex_lock(&c->mutex);
+    size_t i = trova(c, nome);
+    if (i != NESSUNA) *out = c->voci[i].s;
+    pthread_mutex_unlock(&c->mutex);
+    return i != NESSUNA;
+}
+
+size_t classifica_migliori(Classifica* c, Statistiche_vincitore* out, size_t k) {
+    pthread_mutex_lock(&c->mutex);
+    size_t n = 0;
+    // Le voci senza vittorie (rimaste da una scrittura fallita) non contano
+    for (; n < k && n < c->n_voci && c->voci[c->ordine[n]].s.vittorie > 0; n++) out[n] = c->voci[c->ordine[n]].s;
+    pthread_mutex_unlock(&c->mutex);
+    return n;
+}
+
+size_t classifica_recenti(Classifica* c, Vittoria_registrata* out, size_t n) {
+    pthread_mutex_lock(&c->mutex);
+    if (n > c->record) n = (size_t) c->record;
+    uint64_t primo = c->record - n;
+    size_t letti = 0;
+    unsigned char r[DIM_RECORD];
+    // Dal più recente: pochi record, una lettura ciascuno dalla cache del sistema
+    for (uint64_t i = primo + n; i-- > primo; ) {
+        if (!leggi_tutto(c->fd, r, DIM_RECORD, offset_record(i)) || !decodifica_record(r, &out[letti])) break;
+        letti++;
+    }
+    pthread_mutex_unlock(&c->mutex);
+    return letti;
+}
+
+uint64_t classifica_vittorie(Classifica* c) {
+    pthread_mutex_lock(&c->mutex);
+    uint64_t v = c->vittorie;
+    pthread_mutex_unlock(&c->mutex);
+    return v;
+}
+
+size_t classifica_giocatori(Classifica* c) {
+    pthread_mutex_lock(&c->mutex);
+    // Le voci senza vittorie sono il gruppo 0
+    size_t n = c->n_voci - (c->capacita_gruppi > 0 ? c->quanti[0] : 0);
+    pthread_mutex_unlock(&c->mutex);
+    return n;
+}
@@ -0,0 +1,72 @@
+#ifndef CLASSIFICA_H
+#define CLASSIFICA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ============================================================================
+// CLASSIFICA PERSISTENTE DEI VINCITORI
+// ============================================================================
+// Ogni vittoria è un record di dimensione fissa aggiunto in coda a un file di
+// log (mai riscritto). In memoria un indice per nome tiene vittorie e round
+// di ogni giocatore, e un ordinamento per vittorie aggiornato in O(1) a ogni
+// vittoria: i giocatori con le stesse vittorie sono contigui e chi vince
+// scambia il posto con il primo del proprio gruppo, che diventa l'ultimo del
+// gruppo sopra. Le interrogazioni non leggono mai il log intero:
+//   classifica_giocatore  O(1) (tabella hash)
+//   classifica_migliori   O(K)
+//   classifica_recenti    O(N) (lettura diretta degli ultimi N record)
+//
+// Alla chiusura l'indice viene scritto accanto al log (percorso + ".indice")
+// con il numero di record che copre: all'apertura si carica e si rileggono
+// solo i record aggiunti dopo. Senza indice valido si rilegge tutto il log.
+//
+//   log      intestazione 16 byte (magic, versione), poi record da 128 byte:
+//            istante (u64), round (u32), CRC-32 del record, nome (100 byte)
+//   indice   intestazione 40 byte (magic, versione, record coperti, CRC
+//            dell'ultimo record coperto, giocatori, CRC), poi un record da
+//            128 byte per giocatore in ordine di classifica
+//
+// Un record incompleto o corrotto in coda (processo interrotto durante la
+// scrittura) viene scartato e il log accorciato all'ultimo record valido.
+// Le funzioni sono sicure da thread diversi (un mutex per classifica).
+
+#define CLASSIFICA_VERSIONE 1
+
+typedef struct Classifica Classifica;
+
+typedef struct Vittoria_registrata {
+    uint64_t istante;  // Secondi dall'epoca Unix
+    int round;         // Round giocati per vincere
+    char nome[100];
+} Vittoria_registrata;
+
+typedef struct Statistiche_vincitore {
+    char nome[100];
+    uint64_t vittorie;
+    uint64_t round_totali;  // Somma dei round delle vittorie (media = round_totali / vittorie)
+    int round_minimo;       // Vittoria più rapida
+    uint64_t ultima;        // Istante dell'ultima vittoria
+} Statistiche_vincitore;
+
+// Apre (o crea) il log e ne costruisce l'indice. NULL se il file non è
+// accessibile, non è un log della classifica o manca la memoria
+Classifica* classifica_apri(const char* percorso);
+// Scrive l'indice accanto al log e libera tutto
+void classifica_chiudi(Classifica* c);
+
+// Aggiunge una vittoria al log e all'indice. Restituisce 1 se scritta
+int classifica_registra(Classifica* c, const char* nome, int round, uint64_t istante);
+
+// Statistiche di un giocatore: 1 se ha almeno una vittoria
+int classifica_giocatore(Classifica* c, const char* nome, Statistiche_vincitore* out);
+// I primi k per vittorie (a parità di vittorie in ordine qualunque).
+// Restituisce quanti ne ha scritti in out
+size_t classifica_migliori(Classifica* c, Statistiche_vincitore* out, size_t k);
+// Le ultime n vittorie, la più recente per prima. Restituisce quante
+size_t classifica_recenti(Classifica* c, Vittoria_registrata* out, size_t n);
+// Vittorie e giocatori distinti registrati
+uint64_t classifica_vittorie(Classifica* c);
+size_t classifica_giocatori(Classifica* c);
+
+#endif
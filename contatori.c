@@ -0,0 +1,242 @@
+#define _POSIX_C_SOURCE 200809L
+#include "contatori.h"
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const char* const nomi_contatori[NUMERO_CONTATORI] = {
+    "round", "turni", "avanza", "indietreggia", "cambia_mondo",
+    "scontri_billi", "scontri_democane", "scontri_demotorzone", "critici", "morti",
+    "oggetti_raccolti", "oggetti_usati", "estrazioni", "zone_allocate",
+};
+
+static const char* const nomi_tempi[NUMERO_TEMPI] = {
+    "genera_mappa", "chiudi_mappa", "avanza", "indietreggia", "cambia_mondo", "combatti",
+    "stampa_giocatore", "stampa_zona", "raccogli_oggetto", "utilizza_oggetto", "passa",
+};
+
+const char* contatori_nome(Contatore c) {
+    return (c >= 0 && c < NUMERO_CONTATORI) ? nomi_contatori[c] : "ignoto";
+}
+
+const char* contatori_nome_tempo(Tempo t) {
+    return (t >= 0 && t < NUMERO_TEMPI) ? nomi_tempi[t] : "ignoto";
+}
+
+#ifdef CONTATORI_DISATTIVI
+
+int contatori_attivi(void) { return 0; }
+
+int contatori_leggi(Istantanea_contatori* s) {
+    memset(s, 0, sizeof(*s));
+    return 0;
+}
+
+void contatori_azzera(void) {}
+
+#else
+
+int contatori_attivi(void) { return 1; }
+
+static uint64_t ora_ns(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000000ull + (uint64_t) t.tv_nsec;
+}
+
+#if !defined(__x86_64__) && !defined(__i386__) && !defined(__aarch64__)
+uint64_t contatori_ciclo(void) { return ora_ns(); }
+#endif
+
+_Thread_local Blocco_contatori* contatori_blocco = NULL;
+
+// Tutto ciò che segue è protetto da mutex: si tocca solo alla nascita e alla
+// fine di un thread e in lettura
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t chiave_pronta = PTHREAD_ONCE_INIT;
+static pthread_key_t chiave;        // Il distruttore ritira il blocco del thread
+static Blocco_contatori* vivi = NULL;
+static Blocco_contatori* riusabili = NULL; // Blocchi di thread terminati
+static Istantanea_contatori ritirati;      // Somme dei thread terminati
+
+// Orologio di riferimento per convertire i cicli in nanosecondi
+static uint64_t origine_ciclo, origine_ns;
+
+static void somma_blocco(Istantanea_contatori* s, Blocco_contatori* b) {
+    for (int i = 0; i < NUMERO_CONTATORI; i++) s->valori[i] += atomic_load_explicit(&b->valori[i], memory_order_relaxed);
+    for (int t = 0; t < NUMERO_TEMPI; t++) {
+        s->tempi[t].volte += atomic_load_explicit(&b->volte[t], memory_order_relaxed);
+        s->tempi[t].cicli += atomic_load_explicit(&b->cicli[t], memory_order_relaxed);
+        uint64_t max = atomic_load_explicit(&b->cicli_max[t], memory_order_relaxed);
+        if (max > s->tempi[t].cicli_max) s->tempi[t].cicli_max = max;
+    }
+}
+
+static void azzera_blocco(Blocco_contatori* b) {
+    for (int i = 0; i < NUMERO_CONTATORI; i++) atomic_store_explicit(&b->valori[i], 0, memory_order_relaxed);
+    for (int t = 0; t < NUMERO_TEMPI; t++) {
+        atomic_store_explicit(&b->volte[t], 0, memory_order_relaxed);
+        atomic_store_explicit(&b->cicli[t], 0, memory_order_relaxed);
+        atomic_store_explicit(&b->cicli_max[t], 0, memory_order_relaxed);
+    }
+}
+
+// Fine di un thread: le sue somme passano ai ritirati e il blocco si riusa
+static void ritira(void* p) {
+    Blocco_contatori* b = (Blocco_contatori*) p;
+    pthread_mutex_lock(&mutex);
+    somma_blocco(&ritirati, b);
+    for (Blocco_contatori** q = &vivi; *q != NULL; q = &(*q)->successivo) {
+        if (*q == b) { *q = b->successivo; break; }
+    }
+    azzera_blocco(b);
+    b->successivo = riusabili;
+    riusabili = b;
+    pthread_mutex_unlock(&mutex);
+    contatori_blocco = NULL;
+}
+
+static void crea_chiave(void) {
+    pthread_key_create(&chiave, ritira);
+    origine_ciclo = contatori_ciclo();
+    origine_ns = ora_ns();
+}
+
+// Senza memoria i conteggi del thread finiscono in un blocco condiviso
+// (con possibili incrementi persi, mai un crash)
+static Blocco_contatori riserva;
+
+Blocco_contatori* contatori_registra_thread(void) {
+    pthread_once(&chiave_pronta, crea_chiave);
+    pthread_mutex_lock(&mutex);
+    Blocco_contatori* b = riusabili;
+    if (b != NULL) riusabili = b->successivo;
+    else b = (Blocco_contatori*) calloc(1, sizeof(Blocco_contatori));
+    if (b != NULL) {
+        b->successivo = vivi;
+        vivi = b;
+    }
+    pthread_mutex_unlock(&mutex);
+    if (b == NULL) return &riserva;
+    pthread_setspecific(chiave, b);
+    contatori_blocco = b;
+    return b;
+}
+
+// Cicli per nanosecondo stimati sull'intervallo dalla prima registrazione
+// (almeno 10 ms, altrimenti si attende)
+static double stima_ns_per_ciclo(void) {
+#if !defined(__x86_64__) && !defined(__i386__) && !defined(__aarch64__)
+    return 1.0;
+#else
+    pthread_once(&chiave_pronta, crea_chiave);
+    uint64_t ns = ora_ns();
+    if (ns - origine_ns < 10000000ull) {
+        struct timespec attesa = { 0, (long) (10000000ull - (ns - origine_ns)) };
+        nanosleep(&attesa, NULL);
+        ns = ora_ns();
+    }
+    uint64_t cicli = contatori_ciclo() - origine_ciclo;
+    return cicli > 0 ? (double) (ns - origine_ns) / (double) cicli : 1.0;
+#endif
+}
+
+int contatori_leggi(Istantanea_contatori* s) {
+    memset(s, 0, sizeof(*s));
+    s->ns_per_ciclo = stima_ns_per_ciclo();
+    pthread_mutex_lock(&mutex);
+    somma_blocco(s, &riserva);
+    for (int i = 0; i < NUMERO_CONTATORI; i++) s->valori[i] += ritirati.valori[i];
+    for (int t = 0; t < NUMERO_TEMPI; t++) {
+        s->tempi[t].volte += ritirati.tempi[t].volte;
+        s->tempi[t].cicli += ritirati.tempi[t].cicli;
+        if (ritirati.tempi[t].cicli_max > s->tempi[t].cicli_max) s->tempi[t].cicli_max = ritirati.tempi[t].cicli_max;
+    }
+    for (Blocco_contatori* b = vivi; b != NULL; b = b->successivo) somma_blocco(s, b);
+    pthread_mutex_unlock(&mutex);
+    return 1;
+}
+
+// Un thread che sta scrivendo nello stesso istante può perdere l'azzeramento
+// di quel contatore
+void contatori_azzera(void) {
+    pthread_mutex_lock(&mutex);
+    memset(&ritirati, 0, sizeof(ritirati));
+    azzera_blocco(&riserva);
+    for (Blocco_contatori* b = vivi; b != NULL; b = b->successivo) azzera_blocco(b);
+    pthread_mutex_unlock(&mutex);
+}
+
+#endif
+
+// ============================================================================
+// ESPORTAZIONE
+// ============================================================================
+
+typedef struct Scrittore {
+    void (*scrivi)(const char* s, size_t n, void* dati);
+    void* dati;
+} Scrittore;
+
+static void scrivi_formato(const Scrittore* w, const char* formato, ...)
+#if defined(__GNUC__)
+    __attribute__((format(printf, 2, 3)))
+#endif
+    ;
+
+static void scrivi_formato(const Scrittore* w, const char* formato, ...) {
+    char buf[256];
+    va_list ap;
+    va_start(ap, formato);
+    int n = vsnprintf(buf, sizeof(buf), formato, ap);
+    va_end(ap);
+    if (n < 0) return;
+    w->scrivi(buf, (size_t) n < sizeof(buf) ? (size_t) n : sizeof(buf) - 1, w->dati);
+}
+
+static double media_ns(const Misura_tempo* m, double ns_per_ciclo) {
+    return m->volte > 0 ? (double) m->cicli / (double) m->volte * ns_per_ciclo : 0.0;
+}
+
+static void esporta_testo(const Scrittore* w, const Istantanea_contatori* s) {
+    scrivi_formato(w, "\nContatori\n");
+    for (int i = 0; i < NUMERO_CONTATORI; i++)
+        scrivi_formato(w, "%-20s %llu\n", nomi_contatori[i], (unsigned long long) s->valori[i]);
+    scrivi_formato(w, "\n%-20s %10s %14s %12s %12s\n", "Tempi", "volte", "cicli medi", "ns medi", "ns max");
+    for (int t = 0; t < NUMERO_TEMPI; t++) {
+        const Misura_tempo* m = &s->tempi[t];
+        double cicli_medi = m->volte > 0 ? (double) m->cicli / (double) m->volte : 0.0;
+        scrivi_formato(w, "%-20s %10llu %14.0f %12.0f %12.0f\n", nomi_tempi[t], (unsigned long long) m->volte,
+                       cicli_medi, media_ns(m, s->ns_per_ciclo), (double) m->cicli_max * s->ns_per_ciclo);
+    }
+    scrivi_formato(w, "(%.3f ns per ciclo)\n", s->ns_per_ciclo);
+}
+
+static void esporta_json(const Scrittore* w, const Istantanea_contatori* s) {
+    scrivi_formato(w, "{\n  \"ns_per_ciclo\": %.6f,\n  \"contatori\": {", s->ns_per_ciclo);
+    for (int i = 0; i < NUMERO_CONTATORI; i++)
+        scrivi_formato(w, "%s\n    \"%s\": %llu", i ? "," : "", nomi_contatori[i], (unsigned long long) s->valori[i]);
+    scrivi_formato(w, "\n  },\n  \"tempi\": {");
+    for (int t = 0; t < NUMERO_TEMPI; t++) {
+        const Misura_tempo* m = &s->tempi[t];
+        scrivi_formato(w, "%s\n    \"%s\": {\"volte\": %llu, \"cicli\": %llu, \"cicli_max\": %llu, \"ns_medi\": %.1f}",
+                       t ? "," : "", nomi_tempi[t], (unsigned long long) m->volte, (unsigned long long) m->cicli,
+                       (unsigned long long) m->cicli_max, media_ns(m, s->ns_per_ciclo));
+    }
+    scrivi_formato(w, "\n  }\n}\n");
+}
+
+void contatori_esporta(Formato_contatori formato, void (*scrivi)(const char* s, size_t n, void* dati), void* dati) {
+    Scrittore w = { scrivi, dati };
+    Istantanea_contatori s;
+    if (!contatori_leggi(&s)) {
+        if (formato == formato_json) scrivi_formato(&w, "{\"attivi\": false}\n");
+        else scrivi_formato(&w, "Contatori non disponibili (compilato con CONTATORI_DISATTIVI).\n");
+        return;
+    }
+    if (formato == formato_json) esporta_json(&w, &s);
+    else esporta_testo(&w, &s);
+}
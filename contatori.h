@@ -0,0 +1,144 @@
+#ifndef CONTATORI_H
+#define CONTATORI_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ============================================================================
+// CONTATORI E TEMPI DI ESECUZIONE
+// ============================================================================
+// Quanto fa davvero una sessione: eventi contati (turni, movimenti,
+// combattimenti, estrazioni, zone allocate...) e tempi in cicli di CPU delle
+// operazioni principali. Ogni thread accumula in un proprio blocco senza lock
+// (solo il thread proprietario scrive, con load/store relaxed che costano
+// come un normale incremento); la lettura somma i blocchi di tutti i thread e
+// quelli dei thread già terminati.
+//
+// Compilando con -DCONTATORI_DISATTIVI (make CONTATORI=0) le macro CONTA e
+// CRONOMETRO_* spariscono del tutto e l'esportazione segnala solo che i
+// contatori non sono disponibili.
+
+typedef enum {
+    contatore_round,
+    contatore_turni,
+    contatore_avanza,          // Movimenti riusciti, per tipo
+    contatore_indietreggia,
+    contatore_cambia_mondo,
+    contatore_scontri_billi,   // Combattimenti per nemico (stesso ordine di Tipo_nemico)
+    contatore_scontri_democane,
+    contatore_scontri_demotorzone,
+    contatore_critici,
+    contatore_morti,
+    contatore_oggetti_raccolti,
+    contatore_oggetti_usati,
+    contatore_estrazioni,      // Chiamate a casuale()
+    contatore_zone_allocate,
+    NUMERO_CONTATORI
+} Contatore;
+
+typedef enum {
+    tempo_genera_mappa,
+    tempo_chiudi_mappa,
+    tempo_avanza,              // Azioni di turno (stesso ordine del menu, 1-9)
+    tempo_indietreggia,
+    tempo_cambia_mondo,
+    tempo_combatti,
+    tempo_stampa_giocatore,
+    tempo_stampa_zona,
+    tempo_raccogli_oggetto,
+    tempo_utilizza_oggetto,
+    tempo_passa,
+    NUMERO_TEMPI
+} Tempo;
+
+typedef struct Misura_tempo {
+    uint64_t volte;
+    uint64_t cicli;     // Totale
+    uint64_t cicli_max;
+} Misura_tempo;
+
+// Somma di tutti i thread
+typedef struct Istantanea_contatori {
+    uint64_t valori[NUMERO_CONTATORI];
+    Misura_tempo tempi[NUMERO_TEMPI];
+    double ns_per_ciclo; // Stima dal confronto con l'orologio di sistema
+} Istantanea_contatori;
+
+typedef enum { formato_testo, formato_json } Formato_contatori;
+
+// 0 se compilato con CONTATORI_DISATTIVI
+int contatori_attivi(void);
+// Restituisce 0 se i contatori sono disattivati (*s azzerata)
+int contatori_leggi(Istantanea_contatori* s);
+void contatori_azzera(void);
+// Passa il testo a pezzi a scrivi (per lo schermo o per un file)
+void contatori_esporta(Formato_contatori formato, void (*scrivi)(const char* s, size_t n, void* dati), void* dati);
+const char* contatori_nome(Contatore c);
+const char* contatori_nome_tempo(Tempo t);
+
+#ifdef CONTATORI_DISATTIVI
+
+#define CONTA(c) ((void) 0)
+#define CONTA_N(c, n) ((void) 0)
+#define CRONOMETRO_AVVIA(nome)
+#define CRONOMETRO_SEGNA(var) ((void) 0)
+#define CRONOMETRO_FERMA(t, nome) ((void) 0)
+
+#else
+
+#include <stdatomic.h>
+
+typedef struct Blocco_contatori {
+    _Atomic uint64_t valori[NUMERO_CONTATORI];
+    _Atomic uint64_t volte[NUMERO_TEMPI];
+    _Atomic uint64_t cicli[NUMERO_TEMPI];
+    _Atomic uint64_t cicli_max[NUMERO_TEMPI];
+    struct Blocco_contatori* successivo; // Elenco dei blocchi dei thread vivi
+} Blocco_contatori;
+
+extern _Thread_local Blocco_contatori* contatori_blocco;
+// Primo uso nel thread: crea e registra il suo blocco (unica parte con lock)
+Blocco_contatori* contatori_registra_thread(void);
+
+static inline Blocco_contatori* contatori_locali(void) {
+    Blocco_contatori* b = contatori_blocco;
+    return b != NULL ? b : contatori_registra_thread();
+}
+
+// Scrive solo il thread proprietario: niente istruzioni atomiche read-modify-write
+static inline void contatori_somma(_Atomic uint64_t* v, uint64_t n) {
+    atomic_store_explicit(v, atomic_load_explicit(v, memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static inline uint64_t contatori_ciclo(void) { return __rdtsc(); }
+#elif defined(__aarch64__)
+static inline uint64_t contatori_ciclo(void) {
+    uint64_t v;
+    __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(v));
+    return v;
+}
+#else
+// Senza un contatore di cicli: nanosecondi dell'orologio monotono
+uint64_t contatori_ciclo(void);
+#endif
+
+static inline void contatori_tempo(Tempo t, uint64_t cicli) {
+    Blocco_contatori* b = contatori_locali();
+    contatori_somma(&b->volte[t], 1);
+    contatori_somma(&b->cicli[t], cicli);
+    if (cicli > atomic_load_explicit(&b->cicli_max[t], memory_order_relaxed))
+        atomic_store_explicit(&b->cicli_max[t], cicli, memory_order_relaxed);
+}
+
+#define CONTA(c) contatori_somma(&contatori_locali()->valori[(c)], 1)
+#define CONTA_N(c, n) contatori_somma(&contatori_locali()->valori[(c)], (uint64_t) (n))
+#define CRONOMETRO_AVVIA(nome) uint64_t nome = contatori_ciclo()
+// Come CRONOMETRO_AVVIA, su una variabile già dichiarata (uint64_t)
+#define CRONOMETRO_SEGNA(var) ((var) = contatori_ciclo())
+#define CRONOMETRO_FERMA(t, nome) contatori_tempo((t), contatori_ciclo() - (nome))
+
+#endif
+
+#endif
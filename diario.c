@@ -0,0 +1,449 @@
+#define _POSIX_C_SOURCE 200809L
+#include "diario.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define MAGIC "CSTRDIAR"
+#define DIM_INTESTAZIONE 40
+#define CAPACITA_INIZIALE 4096
+
+// Posizioni dei campi nell'intestazione
+#define OFF_VERSIONE   8
+#define OFF_INTERVALLO 12
+#define OFF_DIM_STATO  16
+#define OFF_DIM_EVENTI 24
+#define OFF_FOTOGRAMMI 32
+#define OFF_FLAG       36
+
+#define FLAG_COMPLETO 1
+#define BIT_LIBERI    1 // Primo dei 4 bit dei giocatori da tastiera
+
+// Byte di evento: 3 bit di tipo, 5 di valore (31 = segue un varint)
+#define BIT_VALORE    5
+#define VALORE_ESTESO 31
+
+// ============================================================================
+// CODIFICA
+// ============================================================================
+
+static void scrivi_u32(unsigned char* p, uint32_t v) {
+    p[0] = (unsigned char) v; p[1] = (unsigned char) (v >> 8);
+    p[2] = (unsigned char) (v >> 16); p[3] = (unsigned char) (v >> 24);
+}
+
+static void scrivi_u64(unsigned char* p, uint64_t v) {
+    scrivi_u32(p, (uint32_t) v);
+    scrivi_u32(p + 4, (uint32_t) (v >> 32));
+}
+
+static uint32_t leggi_u32(const unsigned char* p) {
+    return (uint32_t) p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+static uint64_t leggi_u64(const unsigned char* p) {
+    return (uint64_t) leggi_u32(p) | (uint64_t) leggi_u32(p + 4) << 32;
+}
+
+// Interi con segno piccoli in valore assoluto -> interi senza segno piccoli
+static uint64_t zigzag(int64_t v) {
+    return ((uint64_t) v << 1) ^ (uint64_t) (v >> 63);
+}
+
+static int64_t da_zigzag(uint64_t v) {
+    return (int64_t) (v >> 1) ^ -(int64_t) (v & 1);
+}
+
+// Zaino (3 valori 0-4) in un byte
+static unsigned char impacca_zaino(const unsigned char* z) {
+    return (unsigned char) (z[0] + 5 * z[1] + 25 * z[2]);
+}
+
+// Campi modificabili di una zona in un byte: nemico_mr | oggetto << 2 | nemico_ss << 5
+static unsigned char impacca_zona(const Modifica_zona* m) {
+    return (unsigned char) (m->nemico_mr | m->oggetto_mr << 2 | m->nemico_ss << 5);
+}
+
+// ============================================================================
+// REGISTRAZIONE
+// ============================================================================
+
+static int cresci(Diario* d, Buffer_diario* b, size_t n) {
+    if (b->capacita - b->usati >= n) return 1;
+    size_t capacita = b->capacita ? b->capacita : CAPACITA_INIZIALE;
+    while (capacita - b->usati < n) capacita *= 2;
+    unsigned char* dati = (unsigned char*) realloc(b->dati, capacita);
+    if (dati == NULL) { d->ok = 0; return 0; }
+    b->dati = dati;
+    b->capacita = capacita;
+    return 1;
+}
+
+static void metti_byte(Diario* d, Buffer_diario* b, unsigned char c) {
+    if (b->usati == b->capacita && !cresci(d, b, 1)) return;
+    b->dati[b->usati++] = c;
+}
+
+static void metti_varint(Diario* d, Buffer_diario* b, uint64_t v) {
+    if (!cresci(d, b, 10)) return;
+    while (v >= 0x80) { b->dati[b->usati++] = (unsigned char) (v | 0x80); v >>= 7; }
+    b->dati[b->usati++] = (unsigned char) v;
+}
+
+static void metti_evento(Diario* d, Tipo_evento t, uint64_t valore) {
+    if (!d->ok) return;
+    if (valore < VALORE_ESTESO) {
+        metti_byte(d, &d->eventi, (unsigned char) (t << BIT_VALORE | valore));
+        return;
+    }
+    metti_byte(d, &d->eventi, (unsigned char) (t << BIT_VALORE | VALORE_ESTESO));
+    metti_varint(d, &d->eventi, valore - VALORE_ESTESO);
+}
+
+int diario_inizia(Diario* d, const Stato_salvato* s, int intervallo) {
+    memset(d, 0, sizeof(*d));
+    d->ok = 1;
+    d->intervallo = intervallo > 0 ? intervallo : DIARIO_INTERVALLO_DEFAULT;
+    d->ultimo_round = 1;
+    d->dim_stato = salvataggio_dimensione(s);
+    d->stato = (unsigned char*) malloc(d->dim_stato);
+    if (d->stato == NULL) { d->ok = 0; return 0; }
+    salvataggio_codifica(s, d->stato);
+    return 1;
+}
+
+void diario_estrazione(Diario* d, int valore_meno_minimo) {
+    metti_evento(d, evento_estrazione, (uint64_t) valore_meno_minimo);
+}
+
+void diario_scelta(Diario* d, Tipo_evento tipo, int valore) {
+    metti_evento(d, tipo, zigzag(valore));
+}
+
+int diario_vuole_fotogramma(const Diario* d, int round) {
+    return round > 1 && (round - 1) % d->intervallo == 0;
+}
+
+void diario_round(Diario* d, const Fotogramma* f) {
+    if (f == NULL) { metti_evento(d, evento_round, 0); return; }
+    if (!d->ok) return;
+
+    // Indice: distanza in round e in byte dal fotogramma precedente
+    metti_varint(d, &d->indice, (uint64_t) (f->round - d->ultimo_round));
+    metti_varint(d, &d->indice, d->eventi.usati - d->ultima_posizione);
+    d->ultimo_round = f->round;
+    d->ultima_posizione = d->eventi.usati;
+    d->fotogrammi++;
+
+    Buffer_diario* b = &d->eventi;
+    metti_evento(d, evento_round, 1);
+    metti_varint(d, b, (uint64_t) f->round);
+    if (!cresci(d, b, 32)) return;
+    for (int i = 0; i < 4; i++, b->usati += 8) scrivi_u64(b->dati + b->usati, f->rng[i]);
+    for (int i = 0; i < 4; i++) {
+        const Giocatore_fotogramma* g = &f->giocatori[i];
+        metti_byte(d, b, (unsigned char) (g->presente ? 1 | g->mondo << 1 : 0));
+        if (!g->presente) continue;
+        metti_varint(d, b, (uint64_t) (g->pos_mr + 1));
+        metti_varint(d, b, zigzag(g->pos_ss - g->pos_mr)); // Di solito 0: i mondi si muovono insieme
+        metti_byte(d, b, impacca_zaino(g->zaino));
+    }
+    metti_varint(d, b, f->n_modifiche);
+    size_t precedente = 0;
+    for (size_t i = 0; i < f->n_modifiche; i++) {
+        metti_varint(d, b, f->modifiche[i].posizione - precedente);
+        metti_byte(d, b, impacca_zona(&f->modifiche[i]));
+        precedente = f->modifiche[i].posizione;
+    }
+}
+
+void diario_fine(Diario* d, const Risultato_partita* r) {
+    metti_evento(d, evento_fine, (uint64_t) r->esito);
+    metti_varint(d, &d->eventi, (uint64_t) (r->vincitore + 1));
+    metti_varint(d, &d->eventi, (uint64_t) r->round);
+    d->completo = 1;
+}
+
+Esito_diario diario_scrivi(const Diario* d, const char* percorso) {
+    if (!d->ok) return diario_errore_memoria;
+    unsigned char intestazione[DIM_INTESTAZIONE];
+    memset(intestazione, 0, sizeof(intestazione));
+    memcpy(intestazione, MAGIC, 8);
+    scrivi_u32(intestazione + OFF_VERSIONE, DIARIO_VERSIONE);
+    scrivi_u32(intestazione + OFF_INTERVALLO, (uint32_t) d->intervallo);
+    scrivi_u64(intestazione + OFF_DIM_STATO, d->dim_stato);
+    scrivi_u64(intestazione + OFF_DIM_EVENTI, d->eventi.usati);
+    scrivi_u32(intestazione + OFF_FOTOGRAMMI, (uint32_t) d->fotogrammi);
+    scrivi_u32(intestazione + OFF_FLAG, (d->completo ? FLAG_COMPLETO : 0) | (d->liberi & 0xFu) << BIT_LIBERI);
+
+    size_t lunghezza = strlen(percorso);
+    char* temporaneo = (char*) malloc(lunghezza + 5);
+    if (temporaneo == NULL) return diario_errore_memoria;
+    memcpy(temporaneo, percorso, lunghezza);
+    memcpy(temporaneo + lunghezza, ".tmp", 5);
+
+    FILE* f = fopen(temporaneo, "wb");
+    if (f == NULL) { free(temporaneo); return diario_errore_file; }
+    int ok = fwrite(intestazione, 1, sizeof(intestazione), f) == sizeof(intestazione)
+          && fwrite(d->stato, 1, d->dim_stato, f) == d->dim_stato
+          && (d->eventi.usati == 0 || fwrite(d->eventi.dati, 1, d->eventi.usati, f) == d->eventi.usati)
+          && (d->indice.usati == 0 || fwrite(d->indice.dati, 1, d->indice.usati, f) == d->indice.usati);
+    if (fclose(f) != 0) ok = 0;
+    if (ok) ok = rename(temporaneo, percorso) == 0;
+    if (!ok) remove(temporaneo);
+    free(temporaneo);
+    return ok ? diario_ok : diario_errore_file;
+}
+
+void diario_libera(Diario* d) {
+    free(d->stato);
+    free(d->eventi.dati);
+    free(d->indice.dati);
+    memset(d, 0, sizeof(*d));
+}
+
+// ============================================================================
+// LETTURA
+// ============================================================================
+
+// Varint limitato a [p, fine); 0 se troncato o più lungo di 64 bit
+static int prendi_varint(const unsigned char** p, const unsigned char* fine, uint64_t* v) {
+    uint64_t r = 0;
+    for (int spostamento = 0; spostamento < 64; spostamento += 7) {
+        if (*p >= fine) return 0;
+        unsigned char c = *(*p)++;
+        r |= (uint64_t) (c & 0x7F) << spostamento;
+        if (!(c & 0x80)) { *v = r; return 1; }
+    }
+    return 0;
+}
+
+static int leggi_fotogramma(Lettore_diario* l, Fotogramma* f) {
+    const unsigned char** p = &l->pos;
+    uint64_t v, w;
+    if (!prendi_varint(p, l->fine, &v) || v > INT32_MAX) return 0;
+    f->round = (int) v;
+    if (l->fine - *p < 32) return 0;
+    for (int i = 0; i < 4; i++, *p += 8) f->rng[i] = leggi_u64(*p);
+
+    for (int i = 0; i < 4; i++) {
+        Giocatore_fotogramma* g = &f->giocatori[i];
+        memset(g, 0, sizeof(*g));
+        g->pos_mr = g->pos_ss = -1;
+        if (*p >= l->fine || **p > 3) return 0;
+        unsigned char stato = *(*p)++;
+        if (!(stato & 1)) { if (stato) return 0; continue; }
+        g->presente = 1;
+        g->mondo = stato >> 1;
+        if (!prendi_varint(p, l->fine, &v) || v > l->n_zone) return 0;
+        if (!prendi_varint(p, l->fine, &w)) return 0;
+        g->pos_mr = (int64_t) v - 1;
+        g->pos_ss = g->pos_mr + da_zigzag(w);
+        if (g->pos_ss < -1 || g->pos_ss >= (int64_t) l->n_zone) return 0;
+        if (*p >= l->fine || **p >= 125) return 0;
+        unsigned char z = *(*p)++;
+        g->zaino[0] = z % 5; g->zaino[1] = z / 5 % 5; g->zaino[2] = z / 25;
+    }
+
+    if (!prendi_varint(p, l->fine, &v) || v > l->n_zone) return 0;
+    size_t n = (size_t) v;
+    if (n > l->capacita_modifiche) {
+        Modifica_zona* m = (Modifica_zona*) realloc(l->modifiche, n * sizeof(Modifica_zona));
+        if (m == NULL) return 0;
+        l->modifiche = m;
+        l->capacita_modifiche = n;
+    }
+    size_t posizione = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (!prendi_varint(p, l->fine, &v)) return 0;
+        if ((i > 0 && v == 0) || v >= l->n_zone - posizione) return 0; // Crescenti e dentro la mappa
+        posizione += (size_t) v;
+        if (*p >= l->fine) return 0;
+        unsigned char c = *(*p)++;
+        Modifica_zona* m = &l->modifiche[i];
+        m->posizione = posizione;
+        m->nemico_mr = c & 3;
+        m->oggetto_mr = (c >> 2) & 7;
+        m->nemico_ss = c >> 5;
+        if (m->nemico_mr > democane || m->oggetto_mr > schitarrata_metallica
+            || m->nemico_ss == billi || m->nemico_ss > demotorzone) return 0;
+    }
+    f->n_modifiche = n;
+    f->modifiche = l->modifiche;
+    return 1;
+}
+
+int diario_prossimo(Lettore_diario* l, Evento_diario* e, Fotogramma* f) {
+    if (l->pos >= l->fine) return 0;
+    unsigned char c = *l->pos++;
+    uint64_t v = c & VALORE_ESTESO;
+    if (v == VALORE_ESTESO) {
+        uint64_t resto;
+        if (!prendi_varint(&l->pos, l->fine, &resto) || resto > UINT32_MAX) { l->pos = l->fine; return 0; }
+        v += resto;
+    }
+
+    e->tipo = (Tipo_evento) (c >> BIT_VALORE);
+    e->fotogramma = 0;
+    int ok = 1;
+    switch (e->tipo) {
+        case evento_estrazione:
+            ok = v <= INT32_MAX;
+            e->valore = (int) v;
+            break;
+        case evento_azione: case evento_combattimento: case evento_oggetto: {
+            int64_t s = da_zigzag(v);
+            ok = s >= INT32_MIN && s <= INT32_MAX;
+            e->valore = (int) s;
+            break;
+        }
+        case evento_round:
+            e->valore = ++l->round;
+            e->fotogramma = (v == 1);
+            if (v > 1) ok = 0;
+            else if (v == 1) ok = leggi_fotogramma(l, f) && f->round == l->round;
+            break;
+        case evento_fine: {
+            uint64_t vincitore, round;
+            ok = v <= esito_limite_round && prendi_varint(&l->pos, l->fine, &vincitore) && vincitore <= 4
+                 && prendi_varint(&l->pos, l->fine, &round) && round <= INT32_MAX;
+            if (ok) {
+                e->risultato.esito = (Esito_partita) v;
+                e->risultato.vincitore = (int) vincitore - 1;
+                e->risultato.round = (int) round;
+            }
+            break;
+        }
+        default:
+            ok = 0;
+    }
+    if (!ok) { l->pos = l->fine; return 0; } // Corrotto: da qui in poi il diario è finito
+    l->letti++;
+    return 1;
+}
+
+int diario_cerca(Lettore_diario* l, int round, Fotogramma* f) {
+    // Ultimo fotogramma con round <= round (l'indice è ordinato)
+    int basso = 0, alto = l->fotogrammi;
+    while (basso < alto) {
+        int medio = basso + (alto - basso) / 2;
+        if (l->round_fotogramma[medio] <= round) basso = medio + 1;
+        else alto = medio;
+    }
+    l->letti = 0;
+    if (basso == 0) { l->pos = l->eventi; l->round = 0; return 0; }
+
+    const unsigned char* inizio = l->eventi + l->posizione_fotogramma[basso - 1];
+    l->pos = inizio;
+    l->round = l->round_fotogramma[basso - 1] - 1;
+    Evento_diario e;
+    if (!diario_prossimo(l, &e, f) || !e.fotogramma) { l->pos = l->eventi; l->round = 0; return 0; }
+    // Il fotogramma resta da leggere: la riproduzione lo ritrova e lo verifica
+    l->pos = inizio;
+    l->round = f->round - 1;
+    l->letti = 0;
+    return 1;
+}
+
+static Esito_diario leggi_indice(Lettore_diario* l, const unsigned char* p, const unsigned char* fine, uint32_t n) {
+    if (n > (uint64_t) (fine - p) / 2) return diario_errore_formato; // Almeno due byte per voce
+    l->round_fotogramma = (int*) malloc((n ? n : 1) * sizeof(int));
+    l->posizione_fotogramma = (size_t*) malloc((n ? n : 1) * sizeof(size_t));
+    if (l->round_fotogramma == NULL || l->posizione_fotogramma == NULL) return diario_errore_memoria;
+
+    uint64_t round = 1, posizione = 0, dr, dp;
+    size_t dim_eventi = (size_t) (l->fine - l->eventi);
+    for (uint32_t i = 0; i < n; i++) {
+        if (!prendi_varint(&p, fine, &dr) || !prendi_varint(&p, fine, &dp)) return diario_errore_formato;
+        if (dr == 0 || dr > INT32_MAX - round || (i > 0 && dp == 0) || dp >= dim_eventi - posizione)
+            return diario_errore_formato;
+        round += dr;
+        posizione += dp;
+        if (l->eventi[posizione] != (evento_round << BIT_VALORE | 1)) return diario_errore_formato;
+        l->round_fotogramma[i] = (int) round;
+        l->posizione_fotogramma[i] = (size_t) posizione;
+    }
+    l->fotogrammi = (int) n;
+    return p == fine ? diario_ok : diario_errore_formato;
+}
+
+Esito_diario diario_apri(const char* percorso, Lettore_diario* l, Stato_salvato* iniziale) {
+    memset(l, 0, sizeof(*l));
+    int fd = open(percorso, O_RDONLY);
+    if (fd < 0) return diario_errore_file;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) { close(fd); return diario_errore_file; }
+    if (st.st_size < DIM_INTESTAZIONE) { close(fd); return diario_errore_formato; }
+    size_t dimensione = (size_t) st.st_size;
+    void* dati = mmap(NULL, dimensione, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (dati == MAP_FAILED) return diario_errore_file;
+    l->dati = dati;
+    l->dimensione = dimensione;
+
+    const unsigned char* d = (const unsigned char*) dati;
+    Esito_diario e = diario_errore_formato;
+    uint64_t dim_stato = leggi_u64(d + OFF_DIM_STATO);
+    uint64_t dim_eventi = leggi_u64(d + OFF_DIM_EVENTI);
+    if (memcmp(d, MAGIC, 8) != 0) goto errore;
+    if (leggi_u32(d + OFF_VERSIONE) != DIARIO_VERSIONE) { e = diario_errore_versione; goto errore; }
+    if (dim_stato > dimensione - DIM_INTESTAZIONE || dim_eventi > dimensione - DIM_INTESTAZIONE - dim_stato) goto errore;
+
+    if (salvataggio_decodifica(d + DIM_INTESTAZIONE, (size_t) dim_stato, iniziale) != salvataggio_ok) {
+        e = diario_errore_stato;
+        goto errore;
+    }
+    l->n_zone = iniziale->mappa.n;
+    l->intervallo = (int) leggi_u32(d + OFF_INTERVALLO);
+    l->completo = (leggi_u32(d + OFF_FLAG) & FLAG_COMPLETO) != 0;
+    l->liberi = (leggi_u32(d + OFF_FLAG) >> BIT_LIBERI) & 0xFu;
+    l->eventi = d + DIM_INTESTAZIONE + dim_stato;
+    l->fine = l->eventi + dim_eventi;
+    l->pos = l->eventi;
+    e = leggi_indice(l, l->fine, d + dimensione, leggi_u32(d + OFF_FOTOGRAMMI));
+    if (e == diario_ok) return diario_ok;
+errore:
+    diario_chiudi(l);
+    return e;
+}
+
+void diario_chiudi(Lettore_diario* l) {
+    if (l->dati != NULL) munmap(l->dati, l->dimensione);
+    free(l->round_fotogramma);
+    free(l->posizione_fotogramma);
+    free(l->modifiche);
+    memset(l, 0, sizeof(*l));
+}
+
+int diario_fotogrammi_uguali(const Fotogramma* a, const Fotogramma* b) {
+    if (a->round != b->round || memcmp(a->rng, b->rng, sizeof(a->rng)) != 0) return 0;
+    for (int i = 0; i < 4; i++) {
+        const Giocatore_fotogramma* x = &a->giocatori[i];
+        const Giocatore_fotogramma* y = &b->giocatori[i];
+        if (x->presente != y->presente) return 0;
+        if (x->presente && (x->mondo != y->mondo || x->pos_mr != y->pos_mr || x->pos_ss != y->pos_ss
+                            || memcmp(x->zaino, y->zaino, 3) != 0)) return 0;
+    }
+    if (a->n_modifiche != b->n_modifiche) return 0;
+    for (size_t i = 0; i < a->n_modifiche; i++) {
+        const Modifica_zona* x = &a->modifiche[i];
+        const Modifica_zona* y = &b->modifiche[i];
+        if (x->posizione != y->posizione || impacca_zona(x) != impacca_zona(y)) return 0;
+    }
+    return 1;
+}
+
+const char* diario_messaggio(Esito_diario e) {
+    switch (e) {
+        case diario_ok: return "ok";
+        case diario_errore_file: return "impossibile accedere al file";
+        case diario_errore_formato: return "il file non e' un diario valido";
+        case diario_errore_versione: return "versione del diario non supportata";
+        case diario_errore_stato: return "stato iniziale del diario non valido";
+        case diario_errore_memoria: return "memoria insufficiente";
+        case diario_divergenza: return "la partita rigiocata diverge dal diario";
+    }
+    return "errore sconosciuto";
+}
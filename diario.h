@@ -0,0 +1,174 @@
+#ifndef DIARIO_H
+#define DIARIO_H
+
+#include "salvataggio.h"
+#include <stdint.h>
+
+// ============================================================================
+// DIARIO DI PARTITA (REGISTRAZIONE E RIPRODUZIONE)
+// ============================================================================
+// Registra tutto ciò che serve per rigiocare una partita identica: lo stato
+// iniziale, ogni estrazione di casuale() e ogni scelta degli agenti. Poiché il
+// gioco è deterministico dato lo stato del generatore, rigiocando con le
+// stesse scelte si devono ottenere le stesse estrazioni: se una differisce la
+// riproduzione si ferma e segnala il punto di divergenza.
+//
+//   intestazione  40 byte   magic, versione, intervallo dei fotogrammi,
+//                           dimensioni delle sezioni, flag (bit 0: partita
+//                           finita, bit 1-4: giocatori da tastiera)
+//   stato         immagine completa di salvataggio (salvataggio_codifica)
+//   eventi        un byte per evento: 3 bit di tipo e 5 di valore; il
+//                 valore 31 indica che il resto segue come varint
+//   indice        (round, posizione) dei fotogrammi, in delta come varint
+//
+// Le estrazioni sono salvate come distanza dal minimo dell'intervallo e le
+// scelte in zigzag, quindi quasi ogni evento occupa un solo byte. Ogni
+// 'intervallo' round un evento di round porta con sé un fotogramma: stato
+// del generatore, giocatori e zone cambiate rispetto allo stato iniziale
+// (posizioni in delta). Un fotogramma dipende solo dallo stato iniziale,
+// quindi per arrivare al round N basta partire dall'ultimo fotogramma
+// precedente invece di rigiocare tutta la partita.
+
+#define DIARIO_VERSIONE 1
+#define DIARIO_INTERVALLO_DEFAULT 32
+
+typedef enum {
+    evento_estrazione,    // valore - minimo di una chiamata a casuale()
+    evento_azione,        // Scelte restituite dagli agenti
+    evento_combattimento,
+    evento_oggetto,
+    evento_round,         // Inizio di un round, eventualmente con fotogramma
+    evento_fine           // Risultato della partita
+} Tipo_evento;
+
+typedef struct Giocatore_fotogramma {
+    int presente;
+    int mondo;
+    int64_t pos_mr;       // Indice della zona, -1 se nessuna
+    int64_t pos_ss;
+    unsigned char zaino[3];
+} Giocatore_fotogramma;
+
+typedef struct Modifica_zona {
+    size_t posizione;
+    unsigned char nemico_mr, oggetto_mr, nemico_ss;
+} Modifica_zona;
+
+// Stato all'inizio di un round. Nome, statistiche e tipo delle zone non
+// cambiano durante la partita e restano nello stato iniziale
+typedef struct Fotogramma {
+    int round;
+    uint64_t rng[4];
+    Giocatore_fotogramma giocatori[4];
+    size_t n_modifiche;             // Zone diverse dallo stato iniziale,
+    const Modifica_zona* modifiche; // in ordine crescente di posizione
+} Fotogramma;
+
+typedef struct Evento_diario {
+    Tipo_evento tipo;
+    int valore;                  // Estrazione, scelta o numero del round
+    int fotogramma;              // evento_round: 1 se è stato letto un fotogramma
+    Risultato_partita risultato; // evento_fine
+} Evento_diario;
+
+typedef struct Buffer_diario {
+    unsigned char* dati;
+    size_t usati, capacita;
+} Buffer_diario;
+
+// Diario in registrazione, tutto in memoria fino a diario_scrivi
+typedef struct Diario {
+    unsigned char* stato;  // Immagine dello stato iniziale
+    size_t dim_stato;
+    Buffer_diario eventi;
+    Buffer_diario indice;
+    int intervallo;
+    int fotogrammi;
+    int ultimo_round;      // Dell'ultimo fotogramma, per l'indice in delta
+    size_t ultima_posizione;
+    int completo;          // 1 dopo diario_fine
+    unsigned int liberi;   // Giocatori (bit) da tastiera, senza limiti di azioni e scambi
+    int ok;                // 0 se è mancata la memoria
+} Diario;
+
+// Diario aperto in lettura (mappato in memoria)
+typedef struct Lettore_diario {
+    void* dati;
+    size_t dimensione;
+    const unsigned char* eventi;     // Inizio degli eventi
+    const unsigned char* fine;       // Fine degli eventi
+    const unsigned char* pos;        // Prossimo evento
+    int intervallo;
+    int completo;
+    unsigned int liberi;             // Come in Diario
+    int fotogrammi;
+    int* round_fotogramma;           // Indice dei fotogrammi
+    size_t* posizione_fotogramma;
+    size_t n_zone;
+    Modifica_zona* modifiche;        // Buffer dell'ultimo fotogramma letto
+    size_t capacita_modifiche;
+    int round;                       // Ultimo round letto
+    uint64_t letti;                  // Eventi letti
+} Lettore_diario;
+
+typedef enum {
+    diario_ok,
+    diario_errore_file,      // Apertura, scrittura o mappatura fallita
+    diario_errore_formato,   // Non è un diario o è troncato
+    diario_errore_versione,  // Versione non supportata
+    diario_errore_stato,     // Stato iniziale non valido
+    diario_errore_memoria,
+    diario_divergenza        // La partita rigiocata non corrisponde al diario
+} Esito_diario;
+
+// --- Registrazione ---
+// Parte dallo stato iniziale s (copiato). Un fotogramma ogni 'intervallo'
+// round (<= 0 per DIARIO_INTERVALLO_DEFAULT)
+int diario_inizia(Diario* d, const Stato_salvato* s, int intervallo);
+void diario_estrazione(Diario* d, int valore_meno_minimo);
+void diario_scelta(Diario* d, Tipo_evento tipo, int valore);
+// 1 se al round indicato va registrato un fotogramma
+int diario_vuole_fotogramma(const Diario* d, int round);
+// Inizio di un round; f è NULL se non va registrato un fotogramma
+void diario_round(Diario* d, const Fotogramma* f);
+void diario_fine(Diario* d, const Risultato_partita* r);
+// Scrive su un file temporaneo e lo rinomina. Un diario senza diario_fine
+// (partita interrotta) resta riproducibile fino all'ultimo evento
+Esito_diario diario_scrivi(const Diario* d, const char* percorso);
+void diario_libera(Diario* d);
+
+// --- Lettura ---
+// Mappa il file e decodifica lo stato iniziale (la mappa di *iniziale punta
+// nel file fino a diario_chiudi). Il cursore è sul primo evento
+Esito_diario diario_apri(const char* percorso, Lettore_diario* l, Stato_salvato* iniziale);
+// Porta il cursore sull'ultimo fotogramma con round <= round e lo copia in *f
+// (senza consumarlo). Restituisce 0 se non c'è: il cursore torna all'inizio
+int diario_cerca(Lettore_diario* l, int round, Fotogramma* f);
+// Legge il prossimo evento; per evento_round con fotogramma compila *f
+// (valido fino alla lettura successiva). 0 a fine diario o se è corrotto
+int diario_prossimo(Lettore_diario* l, Evento_diario* e, Fotogramma* f);
+void diario_chiudi(Lettore_diario* l);
+
+int diario_fotogrammi_uguali(const Fotogramma* a, const Fotogramma* b);
+const char* diario_messaggio(Esito_diario e);
+
+// Esito di partita_riproduci
+typedef struct Rapporto_riproduzione {
+    int round_partenza;          // Round del fotogramma da cui si è ripartiti
+    int round_finale;            // Ultimo round rigiocato
+    uint64_t eventi;             // Eventi del diario verificati
+    int completo;                // 0 se il diario si interrompe prima della fine
+    int round_divergenza;        // Solo con diario_divergenza
+    const char* motivo;
+    Risultato_partita risultato;
+} Rapporto_riproduzione;
+
+// Conversioni con lo stato del gioco (implementate in gamelib.c)
+// Registra le partite successive nel file (NULL per smettere)
+void partita_registra(Sessione* s, const char* percorso, int intervallo);
+// Sostituisce la partita corrente con quella del diario e la rigioca senza
+// input; fino al round 'dal_round' nessun messaggio, poi con la verbosità
+// corrente
+Esito_diario partita_riproduci(Sessione* s, const char* percorso, int dal_round, Rapporto_riproduzione* r);
+
+#endif
@@ -1,152 +1,383 @@
 #include "gamelib.h"
+#include "probabilita.h"
+#include "generatore.h"
+#include "salvataggio.h"
+#include "diario.h"
+#include "mappa_testo.h"
+#include "uscita.h"
+#include "ingresso.h"
+#include "rng.h"
+#include "contatori.h"
+#include "pianificatore.h"
+#include "politica.h"
+#include "classifica.h"
+#include "mappa_compatta.h"
+#include "ramo.h"
+#include "mcts.h"
+#include "regole.h"
+#include <pthread.h>
 
 // ============================================================================
-// VARIABILI GLOBALI (STATICHE)
+// SESSIONE DI GIOCO
 // ============================================================================
-// Queste variabili mantengono lo stato del gioco ma sono visibili solo in questo file.
-
-// Array di puntatori ai giocatori (massimo 4)
-static struct Giocatore* giocatori[4] = {NULL, NULL, NULL, NULL};
-static int numero_giocatori = 0;
-
-// Puntatori all'inizio delle liste delle zone per i due mondi
-static struct Zona_mondoreale* prima_zona_mondoreale = NULL;
-static struct Zona_soprasotto* prima_zona_soprasotto = NULL;
-
-// Flag di stato del gioco
-static int undici_preso = 0;    // Assicura che il personaggio "Undici" sia scelto solo una volta
-static int gioco_pronto = 0;    // Indica se la mappa è stata chiusa correttamente
-static int gioco_terminato = 0; // Indica se la partita è finita (vittoria o morte totale)
-
-// Albo d'oro per i crediti (memorizza i nomi degli ultimi 3 vincitori)
-static char albo_doro[3][100] = {"-", "-", "-"};
+// Tutto lo stato di una partita sta in una Sessione passata a ogni funzione:
+// sessioni diverse non condividono nulla e possono girare su thread diversi
+// (una sessione alla volta per thread). L'unico stato globale è l'albo dei
+// vincitori condiviso, protetto da un mutex.
+
+// Dove si trova il motore di una partita a passi (vedi prosegui)
+typedef enum {
+    passo_fermo,   // Nessuna partita (o scontro) in corso
+    passo_round,   // Inizio del prossimo round
+    passo_turno,   // Prossimo giocatore del round
+    passo_scelta,  // Prossima azione del giocatore di turno
+    passo_scontro, // Prossimo scambio di colpi
+    passo_attesa   // Fermo sulla richiesta, riparte con partita_rispondi
+} Fase_passo;
+
+typedef struct Stato_passo {
+    Fase_passo fase;
+    Richiesta richiesta;       // In passo_attesa
+    int round, max_round;      // Prossimo round da giocare
+    int ordine[4], prossimo;   // Ordine dei turni del round e prossimo turno
+    struct Giocatore* g;       // Giocatore di turno
+    int indice;                // Suo indice in giocatori
+    int movimento_fatto, azioni;
+    unsigned int liberi;       // Giocatori (bit) da tastiera: senza limiti di azioni e scambi
+    int scelta;                // Azione in corso
+    uint64_t inizio_azione;    // Cicli all'inizio dell'azione (contatori.h)
+    int in_combattimento;      // Lo slot chiesto è per uno scontro
+    // Scontro in corso
+    Tipo_nemico nemico;
+    int hp_giocatore, hp_nemico, bonus_attacco, bonus_difesa;
+    int scambi;                // Scambi con il turno usato
+    int richieste_vuote;       // Scelte che non hanno usato il turno
+    int solo_scontro;          // motore_scontro: finito lo scontro ci si ferma
+    Esito_scontro esito;
+    Risultato_partita risultato; // Della partita finita
+} Stato_passo;
+
+// Politica di un giocatore e ciò da cui dipende
+typedef struct Politica_giocatore {
+    Politica* politica;
+    unsigned long long versione_mappa;
+    int attacco, difesa, fortuna;
+} Politica_giocatore;
+
+struct Sessione {
+    // Array di puntatori ai giocatori (massimo 4)
+    struct Giocatore* giocatori[4];
+    int numero_giocatori;
+
+    // Puntatori all'inizio delle liste delle zone per i due mondi
+    struct Zona_mondoreale* prima_zona_mondoreale;
+    struct Zona_soprasotto* prima_zona_soprasotto;
+
+    // Allocatore delle coppie di zone (MR + SS nello stesso slot)
+    Pool_zone pool_zone;
+    // Indice posizionale sulle coppie di zone (accesso per posizione in O(log n))
+    Indice_zone indice_zone;
+    // Nemici e oggetti della mappa (il numero di zone lo tiene l'indice)
+    Conteggi_mappa conteggi;
+
+    // Mappa pigra (vedi mappa_genera_pigra): le liste contengono solo le zone
+    // già raggiunte, le altre si generano in coda alla prima visita
+    int pigra;
+    Parametri_mappa parametri_pigra;
+    size_t prossima_pigra; // Indice nel generatore della prima zona non ancora in lista
+    size_t boss_pigra;     // Indice nel generatore del Demotorzone
+
+    // Flag di stato del gioco
+    int undici_preso;    // Assicura che il personaggio "Undici" sia scelto solo una volta
+    int gioco_pronto;    // Indica se la mappa è stata chiusa correttamente
+    int gioco_terminato; // Indica se la partita è finita (vittoria o morte totale)
+
+    // Albo d'oro per i crediti (memorizza i nomi degli ultimi 3 vincitori)
+    char albo_doro[3][100];
+
+    // Generatore di numeri casuali della partita (seme esplicito, vedi gioco_semina)
+    Rng rng_gioco;
+
+    // Stato del motore headless
+    int indice_vincitore; // Giocatore che ha sconfitto il Demotorzone
+    Tipo_nemico ucciso_da[4]; // Per giocatore, nemico che l'ha ucciso
+    int fuori_albo;       // Le vittorie non entrano nell'albo condiviso (vedi motore_albo_condiviso)
+
+    // Diario della partita in corso (vedi diario.h): al più uno dei due è attivo
+    Diario* registrazione;
+    Lettore_diario* riproduzione;
+
+    Diario diario_corrente;
+    char* percorso_registrazione; // NULL: partite non registrate
+    int intervallo_registrazione;
+
+    // Zone cambiate dall'inizio della partita (posizioni, anche ripetute)
+    size_t* zone_modificate;
+    size_t n_zone_modificate, capacita_zone_modificate;
+    Modifica_zona* modifiche_fotogramma;
+    size_t capacita_modifiche_fotogramma;
+
+    // Stato della riproduzione
+    int divergenza;         // La partita rigiocata non corrisponde al diario
+    int diario_esaurito;    // Diario interrotto prima della fine della partita
+    int round_divergenza;
+    char motivo_divergenza[160];
+    int fine_trovata;       // Evento di fine già letto da verifica_round
+    Risultato_partita fine_registrata;
+    Verbosita verbosita_riproduzione;
+    int round_visibile;     // Primo round con i messaggi
+
+    Stato_passo passo;
+
+    // Politiche ottime calcolate per i giocatori (vedi politica.h), valide
+    // finché la mappa non cambia
+    unsigned long long versione_mappa;
+    Politica_giocatore politiche[4];
+    int mostra_consigli;
+
+    // Ricerca MCTS collegata (vedi mcts.h): suggerimento nel menu di turno e
+    // giocatori (bit 0-3) giocati dalla ricerca
+    Mcts* mcts;
+    int suggerimenti_mcts;
+    unsigned int bot_mcts;
+};
+
+// Statistiche dei nemici: HP, attacco, difesa
+const Statistiche_nemico statistiche_nemici[4] = {
+    [nessun_nemico] = {  0,  0,  0 },
+    [billi]         = { 20,  5,  2 },
+    [democane]      = { 40, 10,  5 },
+    [demotorzone]   = { 80, 15, 10 },
+};
+
+// Albo dei vincitori comune a tutte le sessioni del processo
+static pthread_mutex_t mutex_albo = PTHREAD_MUTEX_INITIALIZER;
+static Albo_condiviso albo_condiviso = { { "-", "-", "-" }, 0 };
+// Classifica persistente dove finiscono anche le vittorie (NULL: nessuna)
+static Classifica* classifica_albo = NULL;
+
+// Round massimi di una partita interattiva giocata solo da bot MCTS
+#define MAX_ROUND_BOT 200
 
 // ============================================================================
 // PROTOTIPI DELLE FUNZIONI INTERNE
 // ============================================================================
 // Dichiarazioni forward per le funzioni statiche usate internamente.
-static void menu_turno_giocatore(struct Giocatore* g);
-static void avanza(struct Giocatore* g, int* azione_eseguita);
+static void avanza(Sessione* s, struct Giocatore* g, int* azione_eseguita);
 static void indietreggia(struct Giocatore* g, int* azione_eseguita);
-static void cambia_mondo(struct Giocatore* g, int* azione_eseguita);
-static void combatti(struct Giocatore* g);
+static void cambia_mondo(Sessione* s, struct Giocatore* g, int* azione_eseguita);
+static int combatti(Sessione* s, struct Giocatore* g);
 static void stampa_giocatore(struct Giocatore* g);
 static void stampa_zona(struct Giocatore* g);
-static void raccogli_oggetto(struct Giocatore* g);
-static void utilizza_oggetto(struct Giocatore* g);
+static void raccogli_oggetto(Sessione* s, struct Giocatore* g);
+static int utilizza_oggetto(Sessione* s, struct Giocatore* g);
 static void passa(struct Giocatore* g);
+static struct Giocatore* crea_giocatore();
+static void verifica_estrazione(Sessione* s, int valore_meno_minimo);
+static void segna_zona_modificata(Sessione* s, struct Zona_mondoreale* z);
+static void modifica_zona(Sessione* s, struct Zona_mondoreale* z, Tipo_nemico nemico_mr, Tipo_oggetto oggetto, Tipo_nemico nemico_ss);
+static Risultato_partita ciclo_partita(Sessione* s, const Agente* agenti[], int round, int max_round);
+static void chiedi(Sessione* s, Tipo_richiesta tipo);
+static const Richiesta* prosegui(Sessione* s);
 
 // ============================================================================
 // FUNZIONI DI UTILITÀ (HELPER)
 // ============================================================================
 
-// Genera un numero casuale compreso tra min e max (inclusi)
-static int casuale(int min, int max) {
-    return rand() % (max - min + 1) + min;
+// Genera un numero casuale compreso tra min e max (inclusi), senza bias.
+// Con un diario attivo l'estrazione viene registrata o confrontata
+static int casuale(Sessione* s, int min, int max) {
+    int v = rng_intervallo(&s->rng_gioco, min, max);
+    CONTA(contatore_estrazioni);
+    if (s->registrazione != NULL) diario_estrazione(s->registrazione, v - min);
+    else if (s->riproduzione != NULL) verifica_estrazione(s, v - min);
+    return v;
+}
+
+// casuale() come dado di regole_mescola_ordine
+static int estrai_casuale(void* s, int min, int max) {
+    return casuale((Sessione*) s, min, max);
 }
 
-// Pulisce il buffer di input (stdin) dopo una scanf per evitare problemi di lettura
+// Pulisce il buffer di input (stdin) dopo una lettura per evitare problemi di lettura
 static void pulisci_buffer() {
-    while (getchar() != '\n');
+    ingresso_scarta_riga();
 }
 
-// Aggiunge un nome all'albo d'oro facendo scorrere i precedenti (FIFO)
-static void aggiungi_vincitore(const char* nome) {
-    strcpy(albo_doro[2], albo_doro[1]);
-    strcpy(albo_doro[1], albo_doro[0]);
-    strcpy(albo_doro[0], nome);
+// Aggiunge un nome all'albo d'oro facendo scorrere i precedenti (FIFO),
+// sia nella sessione sia nell'albo condiviso
+static void aggiungi_vincitore(Sessione* s, const char* nome) {
+    strcpy(s->albo_doro[2], s->albo_doro[1]);
+    strcpy(s->albo_doro[1], s->albo_doro[0]);
+    strcpy(s->albo_doro[0], nome);
+    if (s->fuori_albo) return;
+
+    pthread_mutex_lock(&mutex_albo);
+    strcpy(albo_condiviso.nomi[2], albo_condiviso.nomi[1]);
+    strcpy(albo_condiviso.nomi[1], albo_condiviso.nomi[0]);
+    snprintf(albo_condiviso.nomi[0], sizeof(albo_condiviso.nomi[0]), "%s", nome);
+    albo_condiviso.vittorie++;
+    pthread_mutex_unlock(&mutex_albo);
+
+    // Una partita rigiocata da un diario non è una vittoria nuova
+    if (classifica_albo != NULL && s->riproduzione == NULL)
+        classifica_registra(classifica_albo, nome, s->passo.round - 1, (uint64_t) time(NULL));
 }
 
-// Libera la memoria allocata per tutte le zone della mappa (Mondo Reale e Soprasotto)
-static void dealloca_mappa() {
-    struct Zona_mondoreale* attuale_mr = prima_zona_mondoreale;
-    struct Zona_soprasotto* attuale_ss = prima_zona_soprasotto;
+// Aggiunge (verso 1) o toglie (verso -1) il contenuto di una zona dai conteggi
+static void conta_contenuto(Conteggi_mappa* c, const struct Zona_mondoreale* z, int verso) {
+    size_t* campi[3] = { NULL, NULL, NULL };
+    if ((unsigned int) z->nemico <= demotorzone) campi[0] = &c->nemici_mr[z->nemico];
+    if ((unsigned int) z->link_soprasotto->nemico <= demotorzone) campi[1] = &c->nemici_ss[z->link_soprasotto->nemico];
+    if ((unsigned int) z->oggetto <= schitarrata_metallica) campi[2] = &c->oggetti[z->oggetto];
+    for (int i = 0; i < 3; i++) {
+        size_t* v = campi[i] != NULL ? campi[i] : &c->fuori_range;
+        if (verso > 0) (*v)++; else (*v)--;
+    }
+    if ((unsigned int) z->tipo > stazione_polizia) {
+        if (verso > 0) c->fuori_range++; else c->fuori_range--;
+    }
+}
 
-    // Deallocazione Mondo Reale
-    while (attuale_mr != NULL) {
-        struct Zona_mondoreale* temp = attuale_mr;
-        attuale_mr = attuale_mr->avanti;
-        free(temp);
+#ifdef VERIFICA_MAPPA
+// Confronta i conteggi mantenuti con una scansione completa della mappa
+// (make VERIFICA=1): un errore nell'aggiornamento si ferma dove nasce
+static void verifica_conteggi(const Sessione* s, const char* dopo) {
+    Conteggi_mappa atteso, c;
+    memset(&atteso, 0, sizeof(atteso));
+    for (const struct Zona_mondoreale* z = s->prima_zona_mondoreale; z != NULL; z = z->avanti) {
+        conta_contenuto(&atteso, z, 1);
+        atteso.zone++;
     }
-    
-    // Deallocazione Soprasotto
-    while (attuale_ss != NULL) {
-        struct Zona_soprasotto* temp = attuale_ss;
-        attuale_ss = attuale_ss->avanti;
-        free(temp);
+    mappa_conteggi(s, &c);
+    atteso.da_generare = c.da_generare;
+    if (memcmp(&atteso, &c, sizeof(c)) != 0) {
+        fprintf(stderr, "Conteggi della mappa errati dopo %s (zone %zu, scansione %zu)\n", dopo, c.zone, atteso.zone);
+        abort();
     }
-    prima_zona_mondoreale = NULL;
-    prima_zona_soprasotto = NULL;
+}
+#else
+#define verifica_conteggi(s, dopo) ((void) 0)
+#endif
+
+// Libera tutte le zone della mappa (Mondo Reale e Soprasotto).
+// Le zone vivono nel pool: basta azzerarlo, senza visitare le liste
+static void dealloca_mappa(Sessione* s) {
+    s->versione_mappa++;
+    memset(&s->conteggi, 0, sizeof(s->conteggi));
+    pool_azzera(&s->pool_zone);
+    indice_azzera(&s->indice_zone);
+    s->prima_zona_mondoreale = NULL;
+    s->prima_zona_soprasotto = NULL;
+    s->pigra = 0;
 }
 
-// Resetta completamente il gioco liberando memoria di giocatori e mappa
-static void dealloca_tutto() {
+// Libera i giocatori senza toccare la mappa
+static void dealloca_giocatori(Sessione* s) {
     for (int i = 0; i < 4; i++) {
-        if (giocatori[i] != NULL) {
-            free(giocatori[i]);
-            giocatori[i] = NULL;
+        if (s->giocatori[i] != NULL) {
+            free(s->giocatori[i]);
+            s->giocatori[i] = NULL;
         }
     }
-    numero_giocatori = 0;
-    undici_preso = 0;
-    dealloca_mappa();
-    gioco_pronto = 0;
-    gioco_terminato = 0;
-    printf("Memoria liberata.\n");
+    s->numero_giocatori = 0;
+}
+
+// Resetta completamente il gioco liberando memoria di giocatori e mappa
+static void dealloca_tutto(Sessione* s) {
+    dealloca_giocatori(s);
+    s->undici_preso = 0;
+    dealloca_mappa(s);
+    s->gioco_pronto = 0;
+    s->gioco_terminato = 0;
+    stampa("Memoria liberata.\n");
 }
 
 // Restituisce il puntatore alla zona del Mondo Reale dato il suo indice nella lista
-static struct Zona_mondoreale* ottieni_zona_mr(int indice) {
-    struct Zona_mondoreale* p = prima_zona_mondoreale;
-    int count = 0;
-    while (p != NULL && count < indice) { p = p->avanti; count++; }
-    return p;
+// (ricerca nell'indice posizionale, O(log n))
+static struct Zona_mondoreale* ottieni_zona_mr(const Sessione* s, int indice) {
+    if (indice < 0) return NULL;
+    Slot_zona* slot = indice_ottieni(&s->indice_zone, (size_t) indice);
+    return slot ? &slot->mr : NULL;
 }
 
-// Conta il numero totale di zone presenti nella lista
-static int conta_zone() {
-    int count = 0;
-    struct Zona_mondoreale* p = prima_zona_mondoreale;
-    while (p != NULL) { count++; p = p->avanti; }
-    return count;
+// Zone di una mappa pigra non ancora generate (0 per le altre mappe)
+static size_t zone_da_generare(const Sessione* s) {
+    return s->pigra ? s->parametri_pigra.zone - s->prossima_pigra : 0;
 }
 
-// Funzioni per convertire gli ENUM in stringhe leggibili per la stampa
-static const char* nome_zona(Tipo_zona t) {
-    switch(t) {
-        case bosco: return "Bosco";
-        case scuola: return "Scuola";
-        case laboratorio: return "Laboratorio";
-        case caverna: return "Caverna";
-        case strada: return "Strada";
-        case giardino: return "Giardino";
-        case supermercato: return "Supermercato";
-        case centrale_elettrica: return "Centrale Elettrica";
-        case deposito_abbandonato: return "Deposito";
-        case stazione_polizia: return "Polizia";
-        default: return "Ignoto";
-    }
+// Conta il numero totale di zone della mappa: quelle in lista (mantenute
+// dall'indice) più quelle non ancora generate, O(1)
+static int conta_zone(const Sessione* s) {
+    return (int) (indice_conta(&s->indice_zone) + zone_da_generare(s));
 }
 
-static const char* nome_nemico(Tipo_nemico t) {
-    switch(t) {
-        case nessun_nemico: return "Nessuno";
-        case billi: return "Billi";
-        case democane: return "Democane";
-        case demotorzone: return "Demotorzone";
-        default: return "Ignoto";
-    }
+// Contenuto della zona di una mappa pigra che sta nella posizione data, oltre
+// quelle in lista, senza generarla
+static void zona_da_generare(const Sessione* s, size_t posizione, Tipo_zona* tipo, Tipo_nemico* nemico_mr,
+                             Tipo_oggetto* oggetto, Tipo_nemico* nemico_ss) {
+    size_t i = s->prossima_pigra + (posizione - indice_conta(&s->indice_zone));
+    generatore_zona(&s->parametri_pigra, i, tipo, nemico_mr, oggetto, nemico_ss);
+    if (i == s->boss_pigra) *nemico_ss = demotorzone;
 }
 
-static const char* nome_oggetto(Tipo_oggetto t) {
-    switch(t) {
-        case nessun_oggetto: return "Vuoto";
-        case bicicletta: return "Bicicletta";
-        case maglietta_fuocoinferno: return "Maglietta Hellfire";
-        case bussola: return "Bussola";
-        case schitarrata_metallica: return "Schitarrata Metallica";
-        default: return "Ignoto";
+// Aggiunge in coda alle liste le zone di una mappa pigra finché le zone in
+// lista sono almeno n (o finché ce ne sono). Restituisce 0 se manca memoria
+static int genera_fino(Sessione* s, size_t n) {
+    size_t in_lista = indice_conta(&s->indice_zone);
+    if (!s->pigra || in_lista >= n || zone_da_generare(s) == 0) return 1;
+    struct Zona_mondoreale* ultima = ottieni_zona_mr(s, (int) in_lista - 1);
+    for (; in_lista < n && zone_da_generare(s) > 0; in_lista++) {
+        Slot_zona* slot = pool_alloca(&s->pool_zone);
+        if (slot == NULL) return 0;
+        CONTA(contatore_zone_allocate);
+        struct Zona_mondoreale* mr = &slot->mr;
+        struct Zona_soprasotto* ss = &slot->ss;
+        zona_da_generare(s, in_lista, &mr->tipo, &mr->nemico, &mr->oggetto, &ss->nemico);
+        ss->tipo = mr->tipo;
+        mr->link_soprasotto = ss; ss->link_mondoreale = mr;
+        mr->avanti = NULL; ss->avanti = NULL;
+        mr->indietro = ultima; ss->indietro = ultima ? ultima->link_soprasotto : NULL;
+        if (ultima) { ultima->avanti = mr; ultima->link_soprasotto->avanti = ss; }
+        else { s->prima_zona_mondoreale = mr; s->prima_zona_soprasotto = ss; }
+        indice_inserisci(&s->indice_zone, in_lista, slot);
+        conta_contenuto(&s->conteggi, mr, 1);
+        s->prossima_pigra++;
+        ultima = mr;
     }
+    // Le zone generate c'erano già nella mappa: la versione non cambia
+    verifica_conteggi(s, "la generazione pigra");
+    return 1;
+}
+
+// Una zona con avanti == NULL deve essere l'ultima della mappa, come negli
+// agenti e nel movimento: in una mappa pigra la zona dopo quella di un
+// giocatore è sempre in lista. Se manca memoria la mappa finisce qui
+static void genera_successiva(Sessione* s, const struct Zona_mondoreale* z) {
+    if (s->pigra && z != NULL && z->avanti == NULL) genera_fino(s, indice_conta(&s->indice_zone) + 1);
+}
+
+// Funzioni per convertire gli ENUM in stringhe leggibili per la stampa
+// Tabelle dei nomi indicizzate per valore dell'enum
+static const char* const nomi_zona[] = {
+    "Bosco", "Scuola", "Laboratorio", "Caverna", "Strada", "Giardino",
+    "Supermercato", "Centrale Elettrica", "Deposito", "Polizia"
+};
+static const char* const nomi_nemico[] = { "Nessuno", "Billi", "Democane", "Demotorzone" };
+static const char* const nomi_oggetto[] = {
+    "Vuoto", "Bicicletta", "Maglietta Hellfire", "Bussola", "Schitarrata Metallica"
+};
+
+const char* nome_zona(Tipo_zona t) {
+    return ((unsigned int) t <= stazione_polizia) ? nomi_zona[t] : "Ignoto";
+}
+
+const char* nome_nemico(Tipo_nemico t) {
+    return ((unsigned int) t <= demotorzone) ? nomi_nemico[t] : "Ignoto";
+}
+
+const char* nome_oggetto(Tipo_oggetto t) {
+    return ((unsigned int) t <= schitarrata_metallica) ? nomi_oggetto[t] : "Ignoto";
 }
 
 // ============================================================================
@@ -154,95 +385,118 @@ static const char* nome_oggetto(Tipo_oggetto t) {
 // ============================================================================
 
 // Genera automaticamente 15 zone con nemici e oggetti casuali
-static void genera_mappa() {
-    if (prima_zona_mondoreale != NULL) dealloca_mappa(); // Pulisce mappa precedente
-    
-    struct Zona_mondoreale* coda_mr = NULL;
-    struct Zona_soprasotto* coda_ss = NULL;
+// (seme estratto dal generatore della partita)
+static void genera_mappa(Sessione* s) {
+    Parametri_mappa p = PARAMETRI_MAPPA_DEFAULT;
+    p.seme = rng_prossimo(&s->rng_gioco);
+    mappa_genera(s, &p);
+    stampa("Mappa generata (15 zone). Il Demotorzone si nasconde nell'oscurita'...\n");
+}
 
-    for (int i = 0; i < 15; i++) {
-        // Allocazione memoria per le nuove zone
-        struct Zona_mondoreale* nuova_mr = (struct Zona_mondoreale*) malloc(sizeof(struct Zona_mondoreale));
-        struct Zona_soprasotto* nuova_ss = (struct Zona_soprasotto*) malloc(sizeof(struct Zona_soprasotto));
-        
-        // Tipo zona casuale (identico per entrambi i mondi)
-        Tipo_zona tipo = (Tipo_zona) casuale(0, 9);
-        nuova_mr->tipo = tipo; nuova_ss->tipo = tipo;
-
-        // Generazione nemici Mondo Reale (60% vuoto, 30% democane, 10% billi)
-        int r_nem = casuale(1, 100);
-        if (r_nem <= 60) nuova_mr->nemico = nessun_nemico;
-        else if (r_nem <= 90) nuova_mr->nemico = democane;
-        else nuova_mr->nemico = billi;
-
-        // Generazione nemici Soprasotto (Demotorzone escluso qui, verrà messo dopo)
-        r_nem = casuale(1, 100);
-        if (r_nem <= 60) nuova_ss->nemico = nessun_nemico;
-        else nuova_ss->nemico = democane; 
-
-        // Generazione Oggetti (solo Mondo Reale ha oggetti)
-        if (casuale(0, 1) == 0) nuova_mr->oggetto = nessun_oggetto;
-        else nuova_mr->oggetto = (Tipo_oggetto) casuale(1, 4);
-
-        // Collegamento tra i due mondi
-        nuova_mr->link_soprasotto = nuova_ss; nuova_ss->link_mondoreale = nuova_mr;
-        nuova_mr->avanti = NULL; nuova_ss->avanti = NULL;
-
-        // Inserimento in coda alla lista doppiamente collegata
-        if (prima_zona_mondoreale == NULL) {
-            prima_zona_mondoreale = nuova_mr; prima_zona_soprasotto = nuova_ss;
-            nuova_mr->indietro = NULL; nuova_ss->indietro = NULL;
-        } else {
-            coda_mr->avanti = nuova_mr; nuova_mr->indietro = coda_mr;
-            coda_ss->avanti = nuova_ss; nuova_ss->indietro = coda_ss;
-        }
-        coda_mr = nuova_mr; coda_ss = nuova_ss;
-    }
+// Genera una mappa con dimensione, probabilità e seme scelti dall'utente
+// (pigra: le zone si generano alla prima visita, vedi mappa_genera_pigra)
+static void genera_mappa_personalizzata(Sessione* s, int pigra) {
+    Parametri_mappa p = PARAMETRI_MAPPA_DEFAULT;
+    long long zone = 0;
+    stampa("Numero di zone (min 15): "); ingresso_lungo(&zone);
+    stampa("%% Democane MR: "); ingresso_intero(&p.mr_democane);
+    stampa("%% Billi MR: "); ingresso_intero(&p.mr_billi);
+    stampa("%% Democane SS: "); ingresso_intero(&p.ss_democane);
+    stampa("%% Oggetti MR: "); ingresso_intero(&p.oggetti);
+    stampa("Seme (0 = casuale): "); ingresso_senza_segno(&p.seme);
+    pulisci_buffer();
+    if (zone < 1) { stampa("Parametri non validi.\n"); return; }
+    p.zone = (size_t) zone;
+    if (p.seme == 0) p.seme = rng_prossimo(&s->rng_gioco);
+
+    if (!generatore_parametri_validi(&p)) { stampa("Parametri non validi.\n"); return; }
+    if (!(pigra ? mappa_genera_pigra(s, &p) : mappa_genera(s, &p))) { stampa("Memoria insufficiente.\n"); return; }
+    if (pigra) stampa("Mappa pigra pronta (%zu zone, seme %llu): le zone si generano alla prima visita.\n", p.zone, p.seme);
+    else stampa("Mappa generata (%zu zone, seme %llu).\n", p.zone, p.seme);
+}
 
-    // Posizionamento garantito del DEMOTORZONE (Boss finale)
-    int indice_boss = casuale(0, 14);
-    struct Zona_soprasotto* cursore = prima_zona_soprasotto;
-    for (int k = 0; k < indice_boss; k++) {
-        cursore = cursore->avanti;
-    }
-    cursore->nemico = demotorzone; // Forza il boss in una zona casuale
+// Sostituisce la mappa: tutte le zone in un blocco del pool, generate in parallelo
+int mappa_genera(Sessione* s, const Parametri_mappa* parametri) {
+    if (!generatore_parametri_validi(parametri)) return 0;
+    if (s->prima_zona_mondoreale != NULL) dealloca_mappa(s); // Pulisce mappa precedente
+    s->gioco_pronto = 0;
+    s->pigra = 0; // Una mappa pigra può avere le liste vuote
+
+    CRONOMETRO_AVVIA(inizio);
+    s->prima_zona_mondoreale = generatore_costruisci(&s->pool_zone, &s->indice_zone, parametri, &s->conteggi);
+    CRONOMETRO_FERMA(tempo_genera_mappa, inizio);
+    if (s->prima_zona_mondoreale == NULL) { dealloca_mappa(s); return 0; }
+    CONTA_N(contatore_zone_allocate, parametri->zone);
+    s->prima_zona_soprasotto = s->prima_zona_mondoreale->link_soprasotto;
+    s->versione_mappa++;
+    verifica_conteggi(s, "la generazione");
+    return 1;
+}
 
-    printf("Mappa generata (15 zone). Il Demotorzone si nasconde nell'oscurita'...\n");
+// Le liste partono con le prime due zone (la partenza dei giocatori e la
+// successiva); le altre si aggiungono con genera_fino
+int mappa_genera_pigra(Sessione* s, const Parametri_mappa* parametri) {
+    if (!generatore_parametri_validi(parametri)) return 0;
+    dealloca_mappa(s);
+    s->gioco_pronto = 0;
+    s->pigra = 1;
+    s->parametri_pigra = *parametri;
+    s->prossima_pigra = 0;
+    s->boss_pigra = generatore_indice_boss(parametri);
+    if (!genera_fino(s, 2)) { dealloca_mappa(s); return 0; }
+    return 1;
 }
 
 // Inserisce una nuova zona in una posizione specifica scelta dall'utente
-static void inserisci_zona() {
+static void inserisci_zona(Sessione* s) {
     int posizione;
-    int num_zone = conta_zone();
-    printf("Posizione (0 - %d): ", num_zone);
-    scanf("%d", &posizione); pulisci_buffer();
+    int num_zone = conta_zone(s);
+    stampa("Posizione (0 - %d): ", num_zone);
+    ingresso_intero(&posizione); pulisci_buffer();
     if (posizione < 0 || posizione > num_zone) return;
 
-    struct Zona_mondoreale* nuova_mr = (struct Zona_mondoreale*) malloc(sizeof(struct Zona_mondoreale));
-    struct Zona_soprasotto* nuova_ss = (struct Zona_soprasotto*) malloc(sizeof(struct Zona_soprasotto));
-
     // Input manuale delle caratteristiche della zona
-    printf("Tipo Zona (0-9): "); int t; scanf("%d", &t); nuova_mr->tipo = (Tipo_zona)t; nuova_ss->tipo = (Tipo_zona)t;
+    Tipo_zona tipo; Tipo_nemico nemico_mr, nemico_ss; Tipo_oggetto oggetto;
+    stampa("Tipo Zona (0-9): "); int t; ingresso_intero(&t); tipo = (Tipo_zona)t;
     
-    printf("Nemico MR (0=Nessuno, 1=Billi, 2=Democane): "); scanf("%d", &t); 
-    if(t==1) nuova_mr->nemico = billi; else if(t==2) nuova_mr->nemico = democane; else nuova_mr->nemico = nessun_nemico;
+    stampa("Nemico MR (0=Nessuno, 1=Billi, 2=Democane): "); ingresso_intero(&t); 
+    if(t==1) nemico_mr = billi; else if(t==2) nemico_mr = democane; else nemico_mr = nessun_nemico;
     
-    printf("Oggetto MR (0-4): "); scanf("%d", &t); nuova_mr->oggetto = (Tipo_oggetto)t;
+    stampa("Oggetto MR (0-4): "); ingresso_intero(&t); oggetto = (Tipo_oggetto)t;
     
-    printf("Nemico SS (0=Nessuno, 2=Democane, 3=Demotorzone): "); scanf("%d", &t);
-    if(t==2) nuova_ss->nemico = democane; else if(t==3) nuova_ss->nemico = demotorzone; else nuova_ss->nemico = nessun_nemico;
+    stampa("Nemico SS (0=Nessuno, 2=Democane, 3=Demotorzone): "); ingresso_intero(&t);
+    if(t==2) nemico_ss = democane; else if(t==3) nemico_ss = demotorzone; else nemico_ss = nessun_nemico;
     pulisci_buffer();
 
+    mappa_inserisci_zona(s, posizione, tipo, nemico_mr, oggetto, nemico_ss);
+    stampa("Zona inserita.\n");
+}
+
+// Inserisce una coppia di zone già compilata nella posizione data (O(log n))
+int mappa_inserisci_zona(Sessione* s, int posizione, Tipo_zona tipo, Tipo_nemico nemico_mr, Tipo_oggetto oggetto, Tipo_nemico nemico_ss) {
+    if (posizione < 0 || posizione > conta_zone(s)) return 0;
+    // In una mappa pigra la zona precedente va prima generata
+    if (!genera_fino(s, (size_t) posizione)) return 0;
+
+    Slot_zona* slot = pool_alloca(&s->pool_zone);
+    if (slot == NULL) return 0;
+    CONTA(contatore_zone_allocate);
+    struct Zona_mondoreale* nuova_mr = &slot->mr;
+    struct Zona_soprasotto* nuova_ss = &slot->ss;
+    nuova_mr->tipo = tipo; nuova_ss->tipo = tipo;
+    nuova_mr->nemico = nemico_mr; nuova_mr->oggetto = oggetto;
+    nuova_ss->nemico = nemico_ss;
+
     nuova_mr->link_soprasotto = nuova_ss; nuova_ss->link_mondoreale = nuova_mr;
 
     // Gestione inserimento in lista (Testa o Centro/Coda)
     if (posizione == 0) {
-        nuova_mr->avanti = prima_zona_mondoreale; nuova_ss->avanti = prima_zona_soprasotto;
+        nuova_mr->avanti = s->prima_zona_mondoreale; nuova_ss->avanti = s->prima_zona_soprasotto;
         nuova_mr->indietro = NULL; nuova_ss->indietro = NULL;
-        if (prima_zona_mondoreale) { prima_zona_mondoreale->indietro = nuova_mr; prima_zona_soprasotto->indietro = nuova_ss; }
-        prima_zona_mondoreale = nuova_mr; prima_zona_soprasotto = nuova_ss;
+        if (s->prima_zona_mondoreale) { s->prima_zona_mondoreale->indietro = nuova_mr; s->prima_zona_soprasotto->indietro = nuova_ss; }
+        s->prima_zona_mondoreale = nuova_mr; s->prima_zona_soprasotto = nuova_ss;
     } else {
-        struct Zona_mondoreale* prec_mr = ottieni_zona_mr(posizione - 1);
+        struct Zona_mondoreale* prec_mr = ottieni_zona_mr(s, posizione - 1);
         struct Zona_soprasotto* prec_ss = prec_mr->link_soprasotto;
         
         nuova_mr->avanti = prec_mr->avanti; nuova_ss->avanti = prec_ss->avanti;
@@ -251,65 +505,447 @@ static void inserisci_zona() {
         if (prec_mr->avanti) { prec_mr->avanti->indietro = nuova_mr; prec_ss->avanti->indietro = nuova_ss; }
         prec_mr->avanti = nuova_mr; prec_ss->avanti = nuova_ss;
     }
-    printf("Zona inserita.\n");
+    indice_inserisci(&s->indice_zone, (size_t) posizione, slot);
+    conta_contenuto(&s->conteggi, nuova_mr, 1);
+    s->versione_mappa++;
+    verifica_conteggi(s, "un inserimento");
+    return 1;
 }
 
 // Cancella una zona dalla mappa
-static void cancella_zona() {
+static void cancella_zona(Sessione* s) {
     int posizione;
-    int num_zone = conta_zone();
+    int num_zone = conta_zone(s);
     if (num_zone == 0) return;
-    printf("Posizione da cancellare (0 - %d): ", num_zone - 1);
-    scanf("%d", &posizione); pulisci_buffer();
+    stampa("Posizione da cancellare (0 - %d): ", num_zone - 1);
+    ingresso_intero(&posizione); pulisci_buffer();
     if (posizione < 0 || posizione >= num_zone) return;
 
-    struct Zona_mondoreale* del_mr = ottieni_zona_mr(posizione);
+    mappa_cancella_zona(s, posizione);
+    stampa("Zona cancellata.\n");
+}
+
+// Cancella la coppia di zone nella posizione data (O(log n))
+int mappa_cancella_zona(Sessione* s, int posizione) {
+    if (posizione < 0 || posizione >= conta_zone(s)) return 0;
+    if (!genera_fino(s, (size_t) posizione + 1)) return 0;
+
+    struct Zona_mondoreale* del_mr = &indice_rimuovi(&s->indice_zone, (size_t) posizione)->mr;
     struct Zona_soprasotto* del_ss = del_mr->link_soprasotto;
 
     // Ricollegamento puntatori per escludere la zona cancellata
     if (del_mr->indietro) { del_mr->indietro->avanti = del_mr->avanti; del_ss->indietro->avanti = del_ss->avanti; }
-    else { prima_zona_mondoreale = del_mr->avanti; prima_zona_soprasotto = del_ss->avanti; }
+    else { s->prima_zona_mondoreale = del_mr->avanti; s->prima_zona_soprasotto = del_ss->avanti; }
 
     if (del_mr->avanti) { del_mr->avanti->indietro = del_mr->indietro; del_ss->avanti->indietro = del_ss->indietro; }
 
-    free(del_mr); free(del_ss);
-    printf("Zona cancellata.\n");
+    conta_contenuto(&s->conteggi, del_mr, -1);
+    pool_libera(&s->pool_zone, (Slot_zona*) del_mr); // Libera MR e SS insieme
+    s->versione_mappa++;
+    verifica_conteggi(s, "una cancellazione");
+    return 1;
+}
+
+int mappa_conta_zone(const Sessione* s) {
+    return conta_zone(s);
+}
+
+void mappa_conteggi(const Sessione* s, Conteggi_mappa* c) {
+    *c = s->conteggi;
+    c->zone = indice_conta(&s->indice_zone);
+    c->da_generare = zone_da_generare(s);
+}
+
+// Campo cercato tra le zone non ancora generate
+typedef enum { campo_nemico_mr, campo_nemico_ss, campo_oggetto } Campo_zona;
+
+// 0 se il generatore non mette mai il valore nel campo: la ricerca non scorre le zone
+static int generabile(const Parametri_mappa* p, Campo_zona campo, int valore) {
+    switch (campo) {
+        case campo_nemico_mr:
+            if (valore == nessun_nemico) return p->mr_democane + p->mr_billi < 100;
+            if (valore == billi) return p->mr_billi > 0;
+            return valore == democane && p->mr_democane > 0;
+        case campo_nemico_ss:
+            if (valore == nessun_nemico) return p->ss_democane < 100;
+            return valore == democane && p->ss_democane > 0;
+        default:
+            return valore == nessun_oggetto ? p->oggetti < 100 : p->oggetti > 0;
+    }
+}
+
+// Cerca tra le zone non ancora generate di una mappa pigra, dalla posizione
+// da fino ad a comprese (da > a per cercare all'indietro), la prima con il
+// valore nel campo. -1 se non c'è. Il Demotorzone si trova in O(1), gli
+// altri valori scorrendo le zone con il generatore (senza metterle in lista)
+static int cerca_da_generare(const Sessione* s, int da, int a, Campo_zona campo, int valore) {
+    int in_lista = (int) indice_conta(&s->indice_zone);
+    if (!s->pigra) return -1;
+    if (da < in_lista) da = in_lista;
+    if (a < in_lista) a = in_lista;
+    if (da >= conta_zone(s) || a >= conta_zone(s)) return -1;
+    if (campo == campo_nemico_ss && valore == demotorzone) {
+        if (s->boss_pigra < s->prossima_pigra) return -1;
+        int boss = in_lista + (int) (s->boss_pigra - s->prossima_pigra);
+        return (boss >= da && boss <= a) || (boss <= da && boss >= a) ? boss : -1;
+    }
+    if (!generabile(&s->parametri_pigra, campo, valore)) return -1;
+    int passo = da <= a ? 1 : -1;
+    for (int i = da; ; i += passo) {
+        Tipo_zona tipo; Tipo_nemico nemico_mr, nemico_ss; Tipo_oggetto oggetto;
+        zona_da_generare(s, (size_t) i, &tipo, &nemico_mr, &oggetto, &nemico_ss);
+        int v = campo == campo_nemico_mr ? (int) nemico_mr : campo == campo_nemico_ss ? (int) nemico_ss : (int) oggetto;
+        if (v == valore) return i;
+        if (i == a) return -1;
+    }
+}
+
+// Prima le zone in lista con l'indice, poi quelle non ancora generate
+// (all'indietro nell'ordine opposto)
+static int cerca_zona(const Sessione* s, int posizione, int direzione, unsigned int maschera, Campo_zona campo, int valore) {
+    int in_lista = (int) indice_conta(&s->indice_zone);
+    int ultima = conta_zone(s) - 1;
+    if (direzione > 0) {
+        int r = posizione + 1 < in_lista ? (int) indice_cerca(&s->indice_zone, posizione, direzione, maschera) : -1;
+        return r >= 0 || posizione >= ultima ? r : cerca_da_generare(s, posizione + 1, ultima, campo, valore);
+    }
+    if (posizione > in_lista) {
+        int r = cerca_da_generare(s, posizione - 1, in_lista, campo, valore);
+        if (r >= 0) return r;
+        posizione = in_lista;
+    }
+    return (int) indice_cerca(&s->indice_zone, posizione, direzione, maschera);
+}
+
+int mappa_cerca_nemico(const Sessione* s, int posizione, int direzione, int mondo, Tipo_nemico nemico) {
+    if ((unsigned int) nemico > demotorzone) return -1;
+    unsigned int maschera = mondo == 0 ? PRESENZA_NEMICO_MR(nemico) : PRESENZA_NEMICO_SS(nemico);
+    return cerca_zona(s, posizione, direzione, maschera, mondo == 0 ? campo_nemico_mr : campo_nemico_ss, (int) nemico);
+}
+
+int mappa_cerca_oggetto(const Sessione* s, int posizione, int direzione, Tipo_oggetto oggetto) {
+    if ((unsigned int) oggetto > schitarrata_metallica) return -1;
+    return cerca_zona(s, posizione, direzione, PRESENZA_OGGETTO(oggetto), campo_oggetto, (int) oggetto);
+}
+
+// Copia le due liste in array contigui (una passata sulla lista MR). Le
+// zone di una mappa pigra non ancora generate si calcolano senza metterle in lista
+int mappa_esporta_soa(const Sessione* s, Mappa_soa* m) {
+    if (!soa_crea(m, (size_t) conta_zone(s))) return 0;
+    size_t i = 0;
+    for (struct Zona_mondoreale* p = s->prima_zona_mondoreale; p != NULL; p = p->avanti, i++) {
+        m->tipo[i] = (unsigned char) p->tipo;
+        m->nemico_mr[i] = (unsigned char) p->nemico;
+        m->oggetto_mr[i] = (unsigned char) p->oggetto;
+        m->nemico_ss[i] = (unsigned char) p->link_soprasotto->nemico;
+    }
+    for (; i < m->n; i++) {
+        Tipo_zona tipo; Tipo_nemico nemico_mr, nemico_ss; Tipo_oggetto oggetto;
+        zona_da_generare(s, i, &tipo, &nemico_mr, &oggetto, &nemico_ss);
+        m->tipo[i] = (unsigned char) tipo;
+        m->nemico_mr[i] = (unsigned char) nemico_mr;
+        m->oggetto_mr[i] = (unsigned char) oggetto;
+        m->nemico_ss[i] = (unsigned char) nemico_ss;
+    }
+    return 1;
+}
+
+// Ricostruisce le liste dagli array: tutte le zone in un blocco del pool,
+// collegate per indice, e indice posizionale costruito già bilanciato (O(n))
+int mappa_importa_soa(Sessione* s, const Mappa_soa* m) {
+    dealloca_mappa(s);
+    s->gioco_pronto = 0;
+    if (m->n == 0) return 1;
+
+    Slot_zona* v = pool_alloca_blocco(&s->pool_zone, m->n);
+    if (v == NULL) return 0;
+    CONTA_N(contatore_zone_allocate, m->n);
+    for (size_t i = 0; i < m->n; i++) {
+        struct Zona_mondoreale* mr = &v[i].mr;
+        struct Zona_soprasotto* ss = &v[i].ss;
+        mr->tipo = (Tipo_zona) m->tipo[i]; ss->tipo = (Tipo_zona) m->tipo[i];
+        mr->nemico = (Tipo_nemico) m->nemico_mr[i];
+        mr->oggetto = (Tipo_oggetto) m->oggetto_mr[i];
+        ss->nemico = (Tipo_nemico) m->nemico_ss[i];
+        mr->link_soprasotto = ss; ss->link_mondoreale = mr;
+        conta_contenuto(&s->conteggi, mr, 1);
+        mr->avanti = (i + 1 < m->n) ? &v[i + 1].mr : NULL;
+        ss->avanti = (i + 1 < m->n) ? &v[i + 1].ss : NULL;
+        mr->indietro = (i > 0) ? &v[i - 1].mr : NULL;
+        ss->indietro = (i > 0) ? &v[i - 1].ss : NULL;
+    }
+    s->prima_zona_mondoreale = &v[0].mr;
+    s->prima_zona_soprasotto = &v[0].ss;
+    indice_imposta_radice(&s->indice_zone, indice_costruisci_sottoalbero(v, 0, m->n, 0, NULL));
+    verifica_conteggi(s, "l'importazione");
+    return 1;
+}
+
+int mappa_esporta_compatta(const Sessione* s, Mappa_compatta* m) {
+    if (!compatta_crea(m, (size_t) conta_zone(s))) return 0;
+    size_t i = 0;
+    for (struct Zona_mondoreale* p = s->prima_zona_mondoreale; p != NULL; p = p->avanti, i++) {
+        // Valori che non entrano nei bit del campo: la mappa non è rappresentabile
+        if ((unsigned int) p->tipo > 0xF || (unsigned int) p->nemico > 0x3 || (unsigned int) p->oggetto > 0x7
+            || (unsigned int) p->link_soprasotto->nemico > 0x3) {
+            compatta_distruggi(m);
+            return 0;
+        }
+        m->zone[i] = COMPATTA_CODIFICA(p->tipo, p->nemico, p->oggetto, p->link_soprasotto->nemico);
+    }
+    for (; i < m->n; i++) {
+        Tipo_zona tipo; Tipo_nemico nemico_mr, nemico_ss; Tipo_oggetto oggetto;
+        zona_da_generare(s, i, &tipo, &nemico_mr, &oggetto, &nemico_ss);
+        m->zone[i] = COMPATTA_CODIFICA(tipo, nemico_mr, oggetto, nemico_ss);
+    }
+    return 1;
+}
+
+// Come mappa_importa_soa, decodificando le coppie
+int mappa_importa_compatta(Sessione* s, const Mappa_compatta* m) {
+    dealloca_mappa(s);
+    s->gioco_pronto = 0;
+    if (m->n == 0) return 1;
+
+    Slot_zona* v = pool_alloca_blocco(&s->pool_zone, m->n);
+    if (v == NULL) return 0;
+    CONTA_N(contatore_zone_allocate, m->n);
+    for (size_t i = 0; i < m->n; i++) {
+        struct Zona_mondoreale* mr = &v[i].mr;
+        struct Zona_soprasotto* ss = &v[i].ss;
+        Zona_compatta z = m->zone[i];
+        mr->tipo = COMPATTA_TIPO(z); ss->tipo = COMPATTA_TIPO(z);
+        mr->nemico = COMPATTA_NEMICO_MR(z);
+        mr->oggetto = COMPATTA_OGGETTO(z);
+        ss->nemico = COMPATTA_NEMICO_SS(z);
+        mr->link_soprasotto = ss; ss->link_mondoreale = mr;
+        conta_contenuto(&s->conteggi, mr, 1);
+        mr->avanti = (i + 1 < m->n) ? &v[i + 1].mr : NULL;
+        ss->avanti = (i + 1 < m->n) ? &v[i + 1].ss : NULL;
+        mr->indietro = (i > 0) ? &v[i - 1].mr : NULL;
+        ss->indietro = (i > 0) ? &v[i - 1].ss : NULL;
+    }
+    s->prima_zona_mondoreale = &v[0].mr;
+    s->prima_zona_soprasotto = &v[0].ss;
+    indice_imposta_radice(&s->indice_zone, indice_costruisci_sottoalbero(v, 0, m->n, 0, NULL));
+    verifica_conteggi(s, "l'importazione");
+    return 1;
+}
+
+// Legge una mappa in formato testo e, se rispetta le regole di chiusura,
+// sostituisce quella corrente
+Esito_testo mappa_importa_testo(Sessione* s, const char* percorso, Lettore_mappa* l) {
+    Mappa_soa m;
+    Esito_testo e = testo_leggi_file(percorso, l, &m);
+    if (e != testo_ok) return e;
+    int ok = mappa_importa_soa(s, &m);
+    soa_distruggi(&m);
+    return ok ? testo_ok : testo_errore_memoria;
+}
+
+int mappa_esporta_testo(const Sessione* s, const char* percorso, int commenti) {
+    Mappa_soa m;
+    if (!mappa_esporta_soa(s, &m)) return 0;
+    FILE* f = fopen(percorso, "w");
+    int ok = f != NULL && testo_scrivi(f, &m, commenti);
+    if (f != NULL && fclose(f) != 0) ok = 0;
+    soa_distruggi(&m);
+    return ok;
+}
+
+// Importa le zone da un file di testo (una zona per riga)
+static void importa_mappa(Sessione* s) {
+    char percorso[256];
+    stampa("Nome del file: "); ingresso_parola(percorso, sizeof(percorso)); pulisci_buffer();
+    Lettore_mappa l;
+    Esito_testo e = mappa_importa_testo(s, percorso, &l);
+    if (e == testo_ok) stampa("Mappa importata (%d zone).\n", conta_zone(s));
+    else if (e == testo_mappa_non_valida) {
+        stampa("Errore: %s.\n", testo_messaggio(e));
+        if (l.motivi & SOA_TROPPO_CORTA) stampa("Servono almeno 15 zone.\n");
+        if (l.motivi & SOA_BOSS_NON_UNICO) stampa("Deve esserci esattamente 1 Demotorzone.\n");
+    }
+    else if (e == testo_errore_sintassi || e == testo_errore_valore) stampa("Errore alla riga %zu: %s.\n", l.riga, testo_messaggio(e));
+    else stampa("Errore: %s.\n", testo_messaggio(e));
+}
+
+// Esporta la mappa in formato testo, con i nomi nei commenti
+static void esporta_mappa(Sessione* s) {
+    char percorso[256];
+    stampa("Nome del file: "); ingresso_parola(percorso, sizeof(percorso)); pulisci_buffer();
+    if (mappa_esporta_testo(s, percorso, 1)) stampa("Mappa esportata in %s (%d zone).\n", percorso, conta_zone(s));
+    else stampa("Errore: impossibile scrivere %s.\n", percorso);
+}
+
+// ============================================================================
+// SALVATAGGIO E CARICAMENTO
+// ============================================================================
+
+// Posizione di una zona nella lista, -1 se NULL (gli slot contengono la
+// coppia MR+SS, quindi la zona del Soprasotto si risolve tramite il suo link)
+static int64_t posizione_mr(const struct Zona_mondoreale* z) {
+    return z ? (int64_t) indice_posizione((const Slot_zona*) z) : -1;
+}
+
+static int64_t posizione_ss(const struct Zona_soprasotto* z) {
+    return z ? posizione_mr(z->link_mondoreale) : -1;
+}
+
+// Stato della partita corrente, mappa esclusa
+static void cattura_stato(const Sessione* s, Stato_salvato* st) {
+    memset(st, 0, sizeof(*st));
+    st->flag = (s->undici_preso ? SALVATAGGIO_UNDICI_PRESO : 0) | (s->gioco_pronto ? SALVATAGGIO_GIOCO_PRONTO : 0)
+            | (s->gioco_terminato ? SALVATAGGIO_GIOCO_TERMINATO : 0);
+    st->numero_giocatori = s->numero_giocatori;
+    memcpy(st->albo_doro, s->albo_doro, sizeof(s->albo_doro));
+    memcpy(st->rng, s->rng_gioco.s, sizeof(st->rng));
+
+    for (int i = 0; i < 4; i++) {
+        struct Giocatore* g = s->giocatori[i];
+        Giocatore_salvato* gs = &st->giocatori[i];
+        if (g == NULL) continue;
+        gs->presente = 1;
+        gs->mondo = g->mondo;
+        gs->pos_mr = posizione_mr(g->pos_mondoreale);
+        gs->pos_ss = posizione_ss(g->pos_soprasotto);
+        // Non ancora in partita: all'inizio, dove lo metterebbe prepara_partita
+        if (gs->pos_mr < 0 && s->prima_zona_mondoreale != NULL) { gs->mondo = 0; gs->pos_mr = gs->pos_ss = 0; }
+        gs->attacco = g->attacco_pischico; gs->difesa = g->difesa_pischica; gs->fortuna = g->fortuna;
+        for (int k = 0; k < 3; k++) gs->zaino[k] = (unsigned char) g->zaino[k];
+        memcpy(gs->nome, g->nome, sizeof(gs->nome));
+    }
+}
+
+// Scambia le mappe di due sessioni: liste, pool, indice, conteggi e mappa pigra
+static void scambia_mappa(Sessione* a, Sessione* b) {
+#define SCAMBIA(campo) do { unsigned char t[sizeof(a->campo)]; memcpy(t, &a->campo, sizeof(t)); \
+                              memcpy(&a->campo, &b->campo, sizeof(t)); memcpy(&b->campo, t, sizeof(t)); } while (0)
+    SCAMBIA(prima_zona_mondoreale); SCAMBIA(prima_zona_soprasotto);
+    SCAMBIA(pool_zone); SCAMBIA(indice_zone); SCAMBIA(conteggi);
+    SCAMBIA(pigra); SCAMBIA(parametri_pigra); SCAMBIA(prossima_pigra); SCAMBIA(boss_pigra);
+#undef SCAMBIA
+    a->versione_mappa++;
+    b->versione_mappa++;
+}
+
+// Sostituisce la partita corrente con lo stato (la mappa viene copiata).
+// Mappa e giocatori nuovi si costruiscono in una sessione a parte e passano
+// a s solo se tutto è riuscito: se manca la memoria (restituisce 0) la
+// partita corrente resta intatta. Le posizioni dei giocatori sono già
+// verificate da salvataggio_decodifica
+static int applica_stato(Sessione* s, const Stato_salvato* st) {
+    Sessione* nuova = sessione_crea(1);
+    if (nuova == NULL) return 0;
+    int ok = mappa_importa_soa(nuova, &st->mappa);
+    for (int i = 0; i < 4 && ok; i++) {
+        const Giocatore_salvato* gs = &st->giocatori[i];
+        if (!gs->presente) continue;
+        struct Giocatore* g = crea_giocatore();
+        if (g == NULL) { ok = 0; break; }
+        memcpy(g->nome, gs->nome, sizeof(g->nome));
+        g->mondo = gs->mondo;
+        g->pos_mondoreale = ottieni_zona_mr(nuova, (int) gs->pos_mr);
+        g->pos_soprasotto = g->pos_mondoreale->link_soprasotto;
+        g->attacco_pischico = gs->attacco; g->difesa_pischica = gs->difesa; g->fortuna = gs->fortuna;
+        for (int k = 0; k < 3; k++) g->zaino[k] = (Tipo_oggetto) gs->zaino[k];
+        nuova->giocatori[i] = g;
+    }
+    if (!ok) { sessione_distruggi(nuova); return 0; }
+
+    // Da qui nulla può fallire. La vecchia mappa e i vecchi giocatori
+    // finiscono in nuova e si liberano con lei
+    scambia_mappa(s, nuova);
+    for (int i = 0; i < 4; i++) {
+        struct Giocatore* t = s->giocatori[i];
+        s->giocatori[i] = nuova->giocatori[i];
+        nuova->giocatori[i] = t;
+    }
+    sessione_distruggi(nuova);
+    s->numero_giocatori = st->numero_giocatori;
+    s->undici_preso = (st->flag & SALVATAGGIO_UNDICI_PRESO) != 0;
+    s->gioco_pronto = (st->flag & SALVATAGGIO_GIOCO_PRONTO) != 0;
+    s->gioco_terminato = (st->flag & SALVATAGGIO_GIOCO_TERMINATO) != 0;
+    memcpy(s->albo_doro, st->albo_doro, sizeof(s->albo_doro));
+    memcpy(s->rng_gioco.s, st->rng, sizeof(st->rng));
+    return 1;
+}
+
+Esito_salvataggio partita_salva(const Sessione* s, const char* percorso) {
+    Stato_salvato st;
+    cattura_stato(s, &st);
+    // Giocatori senza mappa (motore_imposta_giocatori prima di generarla): il
+    // file non si potrebbe caricare
+    for (int i = 0; i < 4; i++) if (st.giocatori[i].presente && st.giocatori[i].pos_mr < 0) return salvataggio_errore_valori;
+    if (!mappa_esporta_soa(s, &st.mappa)) return salvataggio_errore_memoria;
+    Esito_salvataggio e = salvataggio_scrivi(percorso, &st);
+    soa_distruggi(&st.mappa);
+    return e;
+}
+
+Esito_salvataggio partita_carica(Sessione* s, const char* percorso) {
+    Stato_salvato st;
+    File_salvato f;
+    Esito_salvataggio e = salvataggio_apri(percorso, &st, &f);
+    if (e != salvataggio_ok) return e; // La partita corrente non è stata toccata
+
+    int ok = applica_stato(s, &st);
+    salvataggio_chiudi(&f);
+    return ok ? salvataggio_ok : salvataggio_errore_memoria;
 }
 
 // Stampa l'intera mappa per debug
-static void stampa_mappa_debug() {
-    if (!prima_zona_mondoreale) { printf("Mappa vuota.\n"); return; }
-    int scelta; printf("1) MR 2) SS: "); scanf("%d", &scelta); pulisci_buffer();
+static void stampa_mappa_debug(Sessione* s) {
+    if (conta_zone(s) == 0) { stampa("Mappa vuota.\n"); return; }
+    int scelta; stampa("1) MR 2) SS: "); ingresso_intero(&scelta); pulisci_buffer();
     if (scelta == 1) {
-        struct Zona_mondoreale* p = prima_zona_mondoreale; int i = 0;
-        while (p) { printf("[%d] %s | N: %s | O: %s\n", i++, nome_zona(p->tipo), nome_nemico(p->nemico), nome_oggetto(p->oggetto)); p = p->avanti; }
+        struct Zona_mondoreale* p = s->prima_zona_mondoreale; int i = 0;
+        while (p) { stampa("[%d] %s | N: %s | O: %s\n", i++, nome_zona(p->tipo), nome_nemico(p->nemico), nome_oggetto(p->oggetto)); p = p->avanti; }
     } else {
-        struct Zona_soprasotto* p = prima_zona_soprasotto; int i = 0;
-        while (p) { printf("[%d] %s | N: %s\n", i++, nome_zona(p->tipo), nome_nemico(p->nemico)); p = p->avanti; }
+        struct Zona_soprasotto* p = s->prima_zona_soprasotto; int i = 0;
+        while (p) { stampa("[%d] %s | N: %s\n", i++, nome_zona(p->tipo), nome_nemico(p->nemico)); p = p->avanti; }
     }
+    if (zone_da_generare(s) > 0) stampa("... e %zu zone non ancora generate\n", zone_da_generare(s));
 }
 
 // Stampa i dettagli di una singola zona (MR e SS)
-static void stampa_dettaglio_zona() {
-    int posizione; printf("Indice: "); scanf("%d", &posizione); pulisci_buffer();
-    struct Zona_mondoreale* p = ottieni_zona_mr(posizione);
-    if (!p) return;
-    printf("Zona %d: %s\nMR: %s, %s\nSS: %s\n", posizione, nome_zona(p->tipo), nome_nemico(p->nemico), nome_oggetto(p->oggetto), nome_nemico(p->link_soprasotto->nemico));
+static void stampa_dettaglio_zona(Sessione* s) {
+    int posizione; stampa("Indice: "); ingresso_intero(&posizione); pulisci_buffer();
+    if (posizione < 0 || posizione >= conta_zone(s)) return;
+    Tipo_zona tipo; Tipo_nemico nemico_mr, nemico_ss; Tipo_oggetto oggetto;
+    struct Zona_mondoreale* p = ottieni_zona_mr(s, posizione);
+    if (p) { tipo = p->tipo; nemico_mr = p->nemico; oggetto = p->oggetto; nemico_ss = p->link_soprasotto->nemico; }
+    else zona_da_generare(s, (size_t) posizione, &tipo, &nemico_mr, &oggetto, &nemico_ss); // Guardarla non la genera
+    stampa("Zona %d: %s\nMR: %s, %s\nSS: %s\n", posizione, nome_zona(tipo), nome_nemico(nemico_mr), nome_oggetto(oggetto), nome_nemico(nemico_ss));
+}
+
+// Stampa le statistiche dell'allocatore delle zone
+static void stampa_statistiche_pool(Sessione* s) {
+    Statistiche_pool st = pool_statistiche(&s->pool_zone);
+    stampa("Blocchi: %zu | Slot: %zu (in uso %zu, liberi %zu)\n", st.blocchi, st.capacita, st.in_uso, st.liberi);
+    stampa("Allocazioni: %zu (riusi %zu) | Memoria: %zu byte\n", st.allocazioni, st.riusi, st.byte);
+    // Confronto con la mappa compatta (2 byte per coppia, vedi mappa_compatta.h)
+    if (st.in_uso > 0)
+        stampa("Byte per coppia di zone: %.1f (mappa compatta: %.1f)\n", (double) st.byte / (double) st.in_uso,
+               (double) (sizeof(Mappa_compatta) + st.in_uso * sizeof(Zona_compatta)) / (double) st.in_uso);
 }
 
 // Convalida la mappa e abilita il gioco
-static void chiudi_mappa() {
-    int n_zone = conta_zone();
-    if (n_zone < 15) { printf("Errore: Servono almeno 15 zone.\n"); return; }
+// (O(1): zone e Demotorzone sono nei conteggi mantenuti a ogni modifica)
+static void chiudi_mappa(Sessione* s) {
+    CRONOMETRO_AVVIA(inizio);
+    verifica_conteggi(s, "le modifiche");
+    int n_zone = conta_zone(s);
+
+    // Verifica presenza univoca del Demotorzone (in una mappa pigra anche
+    // tra le zone non ancora generate)
+    size_t demo = s->conteggi.nemici_ss[demotorzone];
+    if (zone_da_generare(s) > 0 && s->boss_pigra >= s->prossima_pigra) demo++;
+    CRONOMETRO_FERMA(tempo_chiudi_mappa, inizio);
+
+    if (n_zone < 15) { stampa("Errore: Servono almeno 15 zone.\n"); return; }
+    if (demo != 1) { stampa("Errore: Deve esserci esattamente 1 Demotorzone (trovati: %zu).\n", demo); return; }
     
-    // Verifica presenza univoca del Demotorzone
-    int demo = 0;
-    struct Zona_soprasotto* p = prima_zona_soprasotto;
-    while (p) { if (p->nemico == demotorzone) demo++; p = p->avanti; }
-    
-    if (demo != 1) { printf("Errore: Deve esserci esattamente 1 Demotorzone (trovati: %d).\n", demo); return; }
-    
-    gioco_pronto = 1; printf("Mappa chiusa. Gioco pronto!\n");
+    s->gioco_pronto = 1; stampa("Mappa chiusa. Gioco pronto!\n");
 }
 
 // ============================================================================
@@ -317,80 +953,93 @@ static void chiudi_mappa() {
 // ============================================================================
 
 // Gestisce la morte di un giocatore
-static void rimuovi_giocatore(struct Giocatore* g) {
-    printf("\n☠️  %s E' MORTO! ☠️\n", g->nome);
+static void rimuovi_giocatore(Sessione* s, struct Giocatore* g) {
+    CONTA(contatore_morti);
+    stampa("\n☠️  %s E' MORTO! ☠️\n", g->nome);
     
     int giocatori_vivi = 0;
     for (int i = 0; i < 4; i++) {
-        if (giocatori[i] == g) {
-            free(giocatori[i]);
-            giocatori[i] = NULL;
-        } else if (giocatori[i] != NULL) {
+        if (s->giocatori[i] == g) {
+            free(s->giocatori[i]);
+            s->giocatori[i] = NULL;
+        } else if (s->giocatori[i] != NULL) {
             giocatori_vivi++;
         }
     }
 
     if (giocatori_vivi == 0) {
-        printf("Tutti i giocatori sono periti nel Sottosopra. GAME OVER.\n");
-        gioco_terminato = 1;
+        stampa("Tutti i giocatori sono periti nel Sottosopra. GAME OVER.\n");
+        s->gioco_terminato = 1;
     }
 }
 
-// Gestisce l'uso degli oggetti, sia in combattimento che fuori
-static int utilizza_oggetto_logic(struct Giocatore* g, int* bonus_attacco, int* bonus_difesa, int* hp_recupero, int in_combattimento) {
-    printf("\n--- ZAINO ---\n");
+// Mostra lo zaino prima della scelta. Restituisce il numero di oggetti
+static int mostra_zaino(struct Giocatore* g) {
+    stampa("\n--- ZAINO ---\n");
     int count_oggetti = 0;
     for (int i = 0; i < 3; i++) {
-        printf("%d) %s\n", i + 1, nome_oggetto(g->zaino[i]));
+        stampa("%d) %s\n", i + 1, nome_oggetto(g->zaino[i]));
         if (g->zaino[i] != nessun_oggetto) count_oggetti++;
     }
     
-    if (count_oggetti == 0) {
-        printf("Lo zaino è vuoto o contiene solo cianfrusaglie inutili.\n");
-        return 0; 
-    }
-
-    printf("Scegli oggetto da usare (0 per annullare): ");
-    int scelta;
-    scanf("%d", &scelta); pulisci_buffer();
+    if (count_oggetti == 0) stampa("Lo zaino è vuoto o contiene solo cianfrusaglie inutili.\n");
+    return count_oggetti;
+}
 
+// Gestisce l'uso dell'oggetto scelto, sia in combattimento che fuori
+static int utilizza_oggetto_logic(Sessione* s, struct Giocatore* g, int scelta, int* bonus_attacco, int* bonus_difesa, int* hp_recupero, int in_combattimento) {
     if (scelta < 1 || scelta > 3 || g->zaino[scelta-1] == nessun_oggetto) return 0;
 
     Tipo_oggetto obj = g->zaino[scelta-1];
+    CONTA(contatore_oggetti_usati);
 
     switch (obj) {
         case maglietta_fuocoinferno:
             if(in_combattimento) {
-                printf("Indossi la Maglietta Hellfire! (+5 Difesa)\n");
-                *bonus_difesa += 5;
+                stampa("Indossi la Maglietta Hellfire! (+%d Difesa)\n", BONUS_MAGLIETTA);
+                *bonus_difesa += BONUS_MAGLIETTA;
             } else {
-                printf("Indossi la maglietta. Ti senti molto 'metal', ma non succede nulla di pratico.\n");
+                stampa("Indossi la maglietta. Ti senti molto 'metal', ma non succede nulla di pratico.\n");
             }
             break;
         case schitarrata_metallica:
             if(in_combattimento) {
-                printf("SUONI UN ASSOLO LEGGENDARIO! (+10 Attacco)\n");
-                *bonus_attacco += 10;
+                stampa("SUONI UN ASSOLO LEGGENDARIO! (+%d Attacco)\n", BONUS_SCHITARRATA);
+                *bonus_attacco += BONUS_SCHITARRATA;
                 g->zaino[scelta-1] = nessun_oggetto; // Oggetto monouso
                 return 1;
             } else {
-                printf("Suoni un assolo nel nulla. Gli scoiattoli scappano terrorizzati.\n");
+                stampa("Suoni un assolo nel nulla. Gli scoiattoli scappano terrorizzati.\n");
             }
             break;
         case bicicletta:
             if(in_combattimento) {
-                 printf("Usi la bicicletta per schivare e recuperare fiato! (+10 HP)\n");
-                 *hp_recupero += 10;
+                 stampa("Usi la bicicletta per schivare e recuperare fiato! (+%d HP)\n", CURA_BICICLETTA);
+                 *hp_recupero += CURA_BICICLETTA;
                  return 1;
             } else {
-                 printf("Fai un giro in bici. La tua condizione fisica migliora leggermente. (Solo scenico)\n");
+                 stampa("Fai un giro in bici. La tua condizione fisica migliora leggermente. (Solo scenico)\n");
             }
             break;
-        case bussola:
-            printf("La bussola gira impazzita... indica che il Demotorzone è da qualche parte nel Soprasotto.\n");
+        case bussola: {
+            // Il Demotorzone più vicino nel Soprasotto, partendo dalla zona del giocatore
+            const Slot_zona* qui = (g->mondo == 0) ? (const Slot_zona*) g->pos_mondoreale
+                                                   : (const Slot_zona*) g->pos_soprasotto->link_mondoreale;
+            int pos = (int) indice_posizione(qui);
+            int avanti = mappa_cerca_nemico(s, pos - 1, 1, 1, demotorzone);
+            int indietro = mappa_cerca_nemico(s, pos, -1, 1, demotorzone);
+            if (avanti == pos) stampa("La bussola punta in basso: il Demotorzone è proprio sotto di te, nel Soprasotto!\n");
+            else if (avanti >= 0 && (indietro < 0 || avanti - pos <= pos - indietro))
+                stampa("La bussola punta avanti: il Demotorzone è %d zon%s più avanti, nel Soprasotto.\n",
+                       avanti - pos, avanti - pos == 1 ? "a" : "e");
+            else if (indietro >= 0)
+                stampa("La bussola punta indietro: il Demotorzone è %d zon%s più indietro, nel Soprasotto.\n",
+                       pos - indietro, pos - indietro == 1 ? "a" : "e");
+            else stampa("La bussola gira impazzita... il Demotorzone non è più nel Soprasotto.\n");
             break;
+        }
         default:
-            printf("Oggetto non utilizzabile.\n");
+            stampa("Oggetto non utilizzabile.\n");
     }
     return 1; // Ritorna 1 se è stato consumato il turno
 }
@@ -400,8 +1049,8 @@ static int utilizza_oggetto_logic(struct Giocatore* g, int* bonus_attacco, int*
 // ============================================================================
 
 // 1. AVANZA: Muove il giocatore alla zona successiva
-static void avanza(struct Giocatore* g, int* azione_eseguita) {
-    if (*azione_eseguita) { printf("Hai già eseguito un'azione di movimento in questo turno!\n"); return; }
+static void avanza(Sessione* s, struct Giocatore* g, int* azione_eseguita) {
+    if (*azione_eseguita) { stampa("Hai già eseguito un'azione di movimento in questo turno!\n"); return; }
     
     // Controllo presenza nemici che bloccano
     Tipo_nemico nemico_presente;
@@ -409,217 +1058,241 @@ static void avanza(struct Giocatore* g, int* azione_eseguita) {
     else nemico_presente = g->pos_soprasotto->nemico;
 
     if (nemico_presente != nessun_nemico) {
-        printf("Non puoi avanzare! C'è un nemico (%s) che ti blocca.\n", nome_nemico(nemico_presente));
+        stampa("Non puoi avanzare! C'è un nemico (%s) che ti blocca.\n", nome_nemico(nemico_presente));
         return;
     }
 
     // Movimento effettivo (aggiorna entrambi i puntatori pos_mondoreale e pos_soprasotto)
     if (g->mondo == 0) { 
         if (g->pos_mondoreale->avanti == NULL) {
-            printf("Sei all'ultima zona, non puoi avanzare oltre!\n");
+            stampa("Sei all'ultima zona, non puoi avanzare oltre!\n");
         } else {
             g->pos_mondoreale = g->pos_mondoreale->avanti;
             g->pos_soprasotto = g->pos_soprasotto->avanti;
-            printf("%s avanza alla zona successiva (%s).\n", g->nome, nome_zona(g->pos_mondoreale->tipo));
+            genera_successiva(s, g->pos_mondoreale);
+            stampa("%s avanza alla zona successiva (%s).\n", g->nome, nome_zona(g->pos_mondoreale->tipo));
             *azione_eseguita = 1;
+            CONTA(contatore_avanza);
         }
     } else { 
         if (g->pos_soprasotto->avanti == NULL) {
-            printf("Sei all'ultima zona, non puoi avanzare oltre!\n");
+            stampa("Sei all'ultima zona, non puoi avanzare oltre!\n");
         } else {
             g->pos_soprasotto = g->pos_soprasotto->avanti;
             g->pos_mondoreale = g->pos_mondoreale->avanti;
-            printf("%s avanza alla zona successiva (%s).\n", g->nome, nome_zona(g->pos_soprasotto->tipo));
+            genera_successiva(s, g->pos_mondoreale);
+            stampa("%s avanza alla zona successiva (%s).\n", g->nome, nome_zona(g->pos_soprasotto->tipo));
             *azione_eseguita = 1;
+            CONTA(contatore_avanza);
         }
     }
 }
 
 // 2. INDIETREGGIA: Muove il giocatore alla zona precedente
 static void indietreggia(struct Giocatore* g, int* azione_eseguita) {
-    if (*azione_eseguita) { printf("Hai già eseguito un'azione di movimento in questo turno!\n"); return; }
+    if (*azione_eseguita) { stampa("Hai già eseguito un'azione di movimento in questo turno!\n"); return; }
 
     Tipo_nemico nemico_presente;
     if (g->mondo == 0) nemico_presente = g->pos_mondoreale->nemico;
     else nemico_presente = g->pos_soprasotto->nemico;
 
     if (nemico_presente != nessun_nemico) {
-        printf("Non puoi indietreggiare! C'è un nemico (%s) che ti blocca.\n", nome_nemico(nemico_presente));
+        stampa("Non puoi indietreggiare! C'è un nemico (%s) che ti blocca.\n", nome_nemico(nemico_presente));
         return;
     }
 
     if (g->mondo == 0) {
         if (g->pos_mondoreale->indietro == NULL) {
-            printf("Sei all'inizio, non puoi indietreggiare!\n");
+            stampa("Sei all'inizio, non puoi indietreggiare!\n");
         } else {
             g->pos_mondoreale = g->pos_mondoreale->indietro;
             g->pos_soprasotto = g->pos_soprasotto->indietro;
-            printf("%s torna indietro alla zona precedente (%s).\n", g->nome, nome_zona(g->pos_mondoreale->tipo));
+            stampa("%s torna indietro alla zona precedente (%s).\n", g->nome, nome_zona(g->pos_mondoreale->tipo));
             *azione_eseguita = 1;
+            CONTA(contatore_indietreggia);
         }
     } else {
         if (g->pos_soprasotto->indietro == NULL) {
-            printf("Sei all'inizio, non puoi indietreggiare!\n");
+            stampa("Sei all'inizio, non puoi indietreggiare!\n");
         } else {
             g->pos_soprasotto = g->pos_soprasotto->indietro;
             g->pos_mondoreale = g->pos_mondoreale->indietro;
-            printf("%s torna indietro alla zona precedente (%s).\n", g->nome, nome_zona(g->pos_soprasotto->tipo));
+            stampa("%s torna indietro alla zona precedente (%s).\n", g->nome, nome_zona(g->pos_soprasotto->tipo));
             *azione_eseguita = 1;
+            CONTA(contatore_indietreggia);
         }
     }
 }
 
 // 3. CAMBIA MONDO: Passaggio dimensionale
-static void cambia_mondo(struct Giocatore* g, int* azione_eseguita) {
-    if (*azione_eseguita) { printf("Hai già mosso in questo turno!\n"); return; }
+static void cambia_mondo(Sessione* s, struct Giocatore* g, int* azione_eseguita) {
+    if (*azione_eseguita) { stampa("Hai già mosso in questo turno!\n"); return; }
 
     if (g->mondo == 0) { 
         // Dalla Realtà al Soprasotto: possibile solo se stanza libera da nemici
         if (g->pos_mondoreale->nemico != nessun_nemico) {
-            printf("Non puoi cambiare mondo! Devi prima sconfiggere il nemico presente.\n");
+            stampa("Non puoi cambiare mondo! Devi prima sconfiggere il nemico presente.\n");
             return;
         }
         g->mondo = 1;
-        printf("%s viene catapultato nel SOPRASOTTO!\n", g->nome);
+        stampa("%s viene catapultato nel SOPRASOTTO!\n", g->nome);
     } else {
         // Dal Soprasotto alla Realtà: richiede tiro Fortuna
-        printf("Tentativo di fuga dal Soprasotto... (Tiro Fortuna)\n");
-        int tiro = casuale(1, 20);
-        printf("Hai tirato: %d (La tua Fortuna: %d)\n", tiro, g->fortuna);
+        stampa("Tentativo di fuga dal Soprasotto... (Tiro Fortuna)\n");
+        int tiro = casuale(s, TIRO_FUGA_MIN, TIRO_FUGA_MAX);
+        stampa("Hai tirato: %d (La tua Fortuna: %d)\n", tiro, g->fortuna);
         
-        if (tiro < g->fortuna) {
+        if (regole_fuga(tiro, g->fortuna)) {
             g->mondo = 0;
-            printf("Successo! Sei tornato nel Mondo Reale.\n");
+            stampa("Successo! Sei tornato nel Mondo Reale.\n");
         } else {
-            printf("Fallimento! Rimani intrappolato nel Soprasotto per questo turno.\n");
+            stampa("Fallimento! Rimani intrappolato nel Soprasotto per questo turno.\n");
         }
     }
     *azione_eseguita = 1;
+    CONTA(contatore_cambia_mondo); // Anche i tentativi di fuga falliti consumano il movimento
 }
 
-// 4. COMBATTI: Gestisce lo scontro con i nemici
-static void combatti(struct Giocatore* g) {
-    Tipo_nemico nemico;
-    void* zona_ptr; // Puntatore generico per aggiornare la zona post-vittoria
-    int is_mondo_reale = (g->mondo == 0);
-
-    if (is_mondo_reale) {
-        nemico = g->pos_mondoreale->nemico;
-        zona_ptr = g->pos_mondoreale;
-    } else {
-        nemico = g->pos_soprasotto->nemico;
-        zona_ptr = g->pos_soprasotto;
-    }
-
-    if (nemico == nessun_nemico) {
-        printf("Non c'è nessun nemico qui da combattere.\n");
-        return;
+// Inizio di uno scontro: gli scambi di colpi proseguono a passi (vedi
+// prosegui) fino alla morte di uno dei due o alla ritirata, senza toccare la
+// zona né la lista dei giocatori
+static void inizia_scontro(Sessione* s, struct Giocatore* g, Tipo_nemico nemico) {
+    Stato_passo* ps = &s->passo;
+    if (ps->g != g) { // motore_scontro con un giocatore fuori dalla partita
+        ps->g = g;
+        ps->indice = -1;
     }
+    ps->nemico = nemico;
+    ps->hp_nemico = statistiche_nemici[nemico].hp;
+    // Simulazione HP giocatore basata sulla difesa (non presente in struct base)
+    ps->hp_giocatore = regole_hp_giocatore(g->difesa_pischica);
+    ps->bonus_attacco = ps->bonus_difesa = 0;
+    ps->scambi = ps->richieste_vuote = 0;
+    ps->fase = passo_scontro;
+
+    CONTA((Contatore) (contatore_scontri_billi + (nemico - billi)));
+    stampa("\n⚔️  INIZIO COMBATTIMENTO CONTRO %s ⚔️\n", nome_nemico(nemico));
+    stampa("HP Nemico: %d | Tuoi HP: %d\n", ps->hp_nemico, ps->hp_giocatore);
+}
 
-    // Configurazione statistiche nemico
-    int hp_nemico, attacco_nemico, difesa_nemico;
-    const char* nome_n = nome_nemico(nemico);
+// Contrattacco del nemico, se il giocatore ha usato il turno e il nemico è vivo
+static void dopo_scambio(Sessione* s, int turno_usato) {
+    Stato_passo* ps = &s->passo;
+    ps->fase = passo_scontro;
+    if (!turno_usato) { ps->richieste_vuote++; return; }
+    ps->scambi++;
+    if (ps->hp_nemico <= 0) return;
+
+    int variazione = casuale(s, VARIAZIONE_NEMICO_MIN, VARIAZIONE_NEMICO_MAX);
+    int danno_subito = regole_danno_subito(statistiche_nemici[ps->nemico].attacco, ps->g->difesa_pischica + ps->bonus_difesa, variazione);
+    stampa_dettaglio("[Variazione danno nemico %+d]\n", variazione);
+    ps->hp_giocatore -= danno_subito;
+    stampa("%s attacca! Subisci %d danni. (Tuoi HP: %d)\n", nome_nemico(ps->nemico), danno_subito, ps->hp_giocatore);
+}
 
-    switch (nemico) {
-        case billi: hp_nemico = 20; attacco_nemico = 5; difesa_nemico = 2; break;
-        case democane: hp_nemico = 40; attacco_nemico = 10; difesa_nemico = 5; break;
-        case demotorzone: hp_nemico = 80; attacco_nemico = 15; difesa_nemico = 10; break;
-        default: return;
+// Uno scambio di colpi con la scelta del sottomenu di combattimento
+static void scambio(Sessione* s, int sc) {
+    Stato_passo* ps = &s->passo;
+    struct Giocatore* g = ps->g;
+
+    if (sc == 1) {
+        // Attacco del giocatore
+        int tiro_fortuna = casuale(s, TIRO_CRITICO_MIN, TIRO_CRITICO_MAX);
+        int is_critico = regole_critico(tiro_fortuna, g->fortuna);
+        int variazione = casuale(s, VARIAZIONE_ATTACCO_MIN, VARIAZIONE_ATTACCO_MAX);
+        int danno = regole_danno_inflitto(g->attacco_pischico + ps->bonus_attacco, statistiche_nemici[ps->nemico].difesa,
+                                          variazione, is_critico);
+        stampa_dettaglio("[Tiro fortuna %d (critico sotto %d), variazione danno %+d]\n", tiro_fortuna, g->fortuna, variazione);
+        if (is_critico) { CONTA(contatore_critici); stampa("✨ COLPO CRITICO! ✨\n"); }
+        ps->hp_nemico -= danno;
+        stampa("Hai inflitto %d danni a %s!\n", danno, nome_nemico(ps->nemico));
+        dopo_scambio(s, 1);
+    } else if (sc == 2 && mostra_zaino(g) > 0) {
+        // Uso oggetto: si attende lo slot
+        ps->in_combattimento = 1;
+        chiedi(s, richiesta_oggetto);
+    } else {
+        dopo_scambio(s, 0);
     }
+}
 
-    // Simulazione HP giocatore basata sulla difesa (non presente in struct base)
-    int hp_giocatore = (g->difesa_pischica * 2) + 20;
-    int bonus_attacco = 0, bonus_difesa = 0, hp_recupero = 0;
-
-    printf("\n⚔️  INIZIO COMBATTIMENTO CONTRO %s ⚔️\n", nome_n);
-    printf("HP Nemico: %d | Tuoi HP: %d\n", hp_nemico, hp_giocatore);
-
-    // Loop del combattimento
-    while (hp_giocatore > 0 && hp_nemico > 0) {
-        printf("\n--- SOTTOMENU COMBATTIMENTO ---\n");
-        printf("1) Attacco Pischico\n2) Utilizza Oggetto\nScelta: ");
-        int sc; scanf("%d", &sc); pulisci_buffer();
-        int turno_usato = 0;
-
-        if (sc == 1) {
-            // Attacco del giocatore
-            int tiro_fortuna = casuale(0, 20);
-            int is_critico = (tiro_fortuna < g->fortuna);
-            int danno = (g->attacco_pischico + bonus_attacco) - difesa_nemico + casuale(-2, 2);
-            if (danno < 0) danno = 0;
-            if (is_critico) { printf("✨ COLPO CRITICO! ✨\n"); danno *= 2; }
-            hp_nemico -= danno;
-            printf("Hai inflitto %d danni a %s!\n", danno, nome_n);
-            turno_usato = 1;
-        } else if (sc == 2) {
-            // Uso oggetto
-            hp_recupero = 0;
-            turno_usato = utilizza_oggetto_logic(g, &bonus_attacco, &bonus_difesa, &hp_recupero, 1);
-            hp_giocatore += hp_recupero;
-        }
-
-        if (hp_nemico <= 0) break; // Vittoria immediata
+// 4. COMBATTI: Avvia lo scontro con il nemico della zona. Restituisce 1 se è iniziato
+static int combatti(Sessione* s, struct Giocatore* g) {
+    Tipo_nemico nemico = (g->mondo == 0) ? g->pos_mondoreale->nemico : g->pos_soprasotto->nemico;
 
-        // Contrattacco del nemico
-        if (turno_usato) {
-            int danno_subito = attacco_nemico - (g->difesa_pischica + bonus_difesa) + casuale(0, 5);
-            if (danno_subito < 1) danno_subito = 1;
-            hp_giocatore -= danno_subito;
-            printf("%s attacca! Subisci %d danni. (Tuoi HP: %d)\n", nome_n, danno_subito, hp_giocatore);
-        }
+    if (nemico == nessun_nemico) {
+        stampa("Non c'è nessun nemico qui da combattere.\n");
+        return 0;
     }
+    if (nemico < billi || nemico > demotorzone) return 0;
+    inizia_scontro(s, g, nemico);
+    return 1;
+}
 
-    // Risoluzione fine scontro
-    if (hp_giocatore <= 0) {
-        rimuovi_giocatore(g);
+// Risoluzione fine scontro: il giocatore è ancora nella zona del nemico
+static void concludi_combattimento(Sessione* s, Esito_scontro esito) {
+    struct Giocatore* g = s->passo.g;
+    Tipo_nemico nemico = s->passo.nemico;
+
+    if (esito == scontro_ritirata) return;
+    if (esito == scontro_perso) {
+        if (s->passo.indice >= 0) s->ucciso_da[s->passo.indice] = nemico;
+        rimuovi_giocatore(s, g);
     } else {
-        printf("\n🎉 VITTORIA! Hai sconfitto %s! 🎉\n", nome_n);
-        int prob = casuale(1, 100);
+        stampa("\n🎉 VITTORIA! Hai sconfitto %s! 🎉\n", nome_nemico(nemico));
+        int prob = casuale(s, TIRO_SCOMPARSA_MIN, TIRO_SCOMPARSA_MAX);
+        stampa_dettaglio("[Tiro scomparsa %d (svanisce fino a %d)]\n", prob, SOGLIA_SCOMPARSA);
         
         // 50% probabilità che il nemico scompaia
-        if (prob <= 50) { 
-            printf("Il nemico svanisce...\n");
-            if (is_mondo_reale) ((struct Zona_mondoreale*)zona_ptr)->nemico = nessun_nemico;
-            else ((struct Zona_soprasotto*)zona_ptr)->nemico = nessun_nemico;
+        if (regole_svanisce(prob)) { 
+            stampa("Il nemico svanisce...\n");
+            if (g->mondo == 0) {
+                struct Zona_mondoreale* z = g->pos_mondoreale;
+                modifica_zona(s, z, nessun_nemico, z->oggetto, z->link_soprasotto->nemico);
+            } else {
+                struct Zona_mondoreale* z = g->pos_soprasotto->link_mondoreale;
+                modifica_zona(s, z, z->nemico, z->oggetto, nessun_nemico);
+            }
             
             // Condizione di vittoria finale
             if (nemico == demotorzone) {
-                printf("\n🏆 HAI SCONFITTO IL BOSS FINALE! VITTORIA! 🏆\n");
-                aggiungi_vincitore(g->nome);
-                gioco_terminato = 1;
+                stampa("\n🏆 HAI SCONFITTO IL BOSS FINALE! VITTORIA! 🏆\n");
+                aggiungi_vincitore(s, g->nome);
+                for (int i = 0; i < 4; i++) if (s->giocatori[i] == g) s->indice_vincitore = i;
+                s->gioco_terminato = 1;
             }
         } else {
-            printf("Il nemico è a terra ma il corpo rimane lì.\n");
+            stampa("Il nemico è a terra ma il corpo rimane lì.\n");
         }
     }
 }
 
 // 5. STAMPA GIOCATORE: Mostra statistiche e zaino
 static void stampa_giocatore(struct Giocatore* g) {
-    printf("\n--- INFO %s ---\n", g->nome);
-    printf("Mondo: %s\n", (g->mondo == 0) ? "Reale" : "Soprasotto");
-    printf("Zaino: [1]%s [2]%s [3]%s\n", nome_oggetto(g->zaino[0]), nome_oggetto(g->zaino[1]), nome_oggetto(g->zaino[2]));
-    printf("Stats: Atk %d | Def %d | Fortuna %d\n", g->attacco_pischico, g->difesa_pischica, g->fortuna);
+    stampa("\n--- INFO %s ---\n", g->nome);
+    stampa("Mondo: %s\n", (g->mondo == 0) ? "Reale" : "Soprasotto");
+    stampa("Zaino: [1]%s [2]%s [3]%s\n", nome_oggetto(g->zaino[0]), nome_oggetto(g->zaino[1]), nome_oggetto(g->zaino[2]));
+    stampa("Stats: Atk %d | Def %d | Fortuna %d\n", g->attacco_pischico, g->difesa_pischica, g->fortuna);
 }
 
 // 6. STAMPA ZONA: Mostra dettagli zona corrente
 static void stampa_zona(struct Giocatore* g) {
-    printf("\n--- ZONA ATTUALE ---\n");
+    stampa("\n--- ZONA ATTUALE ---\n");
     if (g->mondo == 0) {
-        printf("Luogo: %s (Reale)\n", nome_zona(g->pos_mondoreale->tipo));
-        printf("Nemico: %s\n", nome_nemico(g->pos_mondoreale->nemico));
-        printf("Oggetto: %s\n", nome_oggetto(g->pos_mondoreale->oggetto));
+        stampa("Luogo: %s (Reale)\n", nome_zona(g->pos_mondoreale->tipo));
+        stampa("Nemico: %s\n", nome_nemico(g->pos_mondoreale->nemico));
+        stampa("Oggetto: %s\n", nome_oggetto(g->pos_mondoreale->oggetto));
     } else {
-        printf("Luogo: %s (Soprasotto)\n", nome_zona(g->pos_soprasotto->tipo));
-        printf("Nemico: %s\n", nome_nemico(g->pos_soprasotto->nemico));
+        stampa("Luogo: %s (Soprasotto)\n", nome_zona(g->pos_soprasotto->tipo));
+        stampa("Nemico: %s\n", nome_nemico(g->pos_soprasotto->nemico));
     }
 }
 
 // 7. RACCOGLI OGGETTO: Prende oggetto da terra se possibile
-static void raccogli_oggetto(struct Giocatore* g) {
-    if (g->mondo == 1) { printf("Non ci sono oggetti nel Soprasotto.\n"); return; }
-    if (g->pos_mondoreale->oggetto == nessun_oggetto) { printf("Nessun oggetto qui.\n"); return; }
-    if (g->pos_mondoreale->nemico != nessun_nemico) { printf("Nemico presente! Sconfiggilo prima.\n"); return; }
+static void raccogli_oggetto(Sessione* s, struct Giocatore* g) {
+    if (g->mondo == 1) { stampa("Non ci sono oggetti nel Soprasotto.\n"); return; }
+    if (g->pos_mondoreale->oggetto == nessun_oggetto) { stampa("Nessun oggetto qui.\n"); return; }
+    if (g->pos_mondoreale->nemico != nessun_nemico) { stampa("Nemico presente! Sconfiggilo prima.\n"); return; }
 
     // Cerca slot libero
     int slot = -1;
@@ -627,56 +1300,921 @@ static void raccogli_oggetto(struct Giocatore* g) {
 
     if (slot != -1) {
         g->zaino[slot] = g->pos_mondoreale->oggetto;
-        printf("Hai raccolto: %s!\n", nome_oggetto(g->pos_mondoreale->oggetto));
-        g->pos_mondoreale->oggetto = nessun_oggetto;
+        stampa("Hai raccolto: %s!\n", nome_oggetto(g->pos_mondoreale->oggetto));
+        struct Zona_mondoreale* z = g->pos_mondoreale;
+        modifica_zona(s, z, z->nemico, nessun_oggetto, z->link_soprasotto->nemico);
+        CONTA(contatore_oggetti_raccolti);
     } else {
-        printf("Zaino pieno!\n");
+        stampa("Zaino pieno!\n");
     }
 }
 
-// 8. UTILIZZA OGGETTO: Usa oggetto fuori dal combattimento
-static void utilizza_oggetto(struct Giocatore* g) {
-    int dummy1=0, dummy2=0, dummy3=0;
-    utilizza_oggetto_logic(g, &dummy1, &dummy2, &dummy3, 0); // 0 = fuori combattimento
+// 8. UTILIZZA OGGETTO: Usa oggetto fuori dal combattimento. Restituisce 1 se
+// si attende lo slot
+static int utilizza_oggetto(Sessione* s, struct Giocatore* g) {
+    if (mostra_zaino(g) == 0) return 0;
+    s->passo.in_combattimento = 0;
+    chiedi(s, richiesta_oggetto);
+    return 1;
 }
 
 // 9. PASSA: Cede il turno
 static void passa(struct Giocatore* g) {
-    printf("%s passa il turno.\n", g->nome);
+    stampa("%s passa il turno.\n", g->nome);
 }
 
-// Gestore del menu per il singolo turno
-static void menu_turno_giocatore(struct Giocatore* g) {
-    int scelta;
-    int fine_turno = 0;
-    int movimento_fatto = 0; 
+// ============================================================================
+// AGENTI (SORGENTI DELLE DECISIONI)
+// ============================================================================
 
-    do {
-        // Controllo vitalità (il giocatore potrebbe essere morto nel turno di un altro?)
-        int vivo = 0;
-        for(int i=0; i<4; i++) if(giocatori[i] == g) vivo = 1;
-        if(!vivo) return;
-
-        printf("\n=== TURNO DI %s ===\n", g->nome);
-        printf("1) Avanza\n2) Indietreggia\n3) Cambia Mondo\n4) Combatti\n");
-        printf("5) Stampa Giocatore\n6) Stampa Zona\n7) Raccogli Oggetto\n");
-        printf("8) Utilizza Oggetto\n9) Passa\n");
-        printf("Scelta: ");
-        scanf("%d", &scelta); pulisci_buffer();
-
-        switch(scelta) {
-            case 1: avanza(g, &movimento_fatto); break;
-            case 2: indietreggia(g, &movimento_fatto); break;
-            case 3: cambia_mondo(g, &movimento_fatto); break;
-            case 4: combatti(g); break;
-            case 5: stampa_giocatore(g); break;
-            case 6: stampa_zona(g); break;
-            case 7: raccogli_oggetto(g); break;
-            case 8: utilizza_oggetto(g); break;
-            case 9: passa(g); fine_turno = 1; break;
-            default: printf("Comando non valido.\n");
+// --- Agente da tastiera: stampa i menu e legge la scelta da stdin ---
+// Con s (non NULL) e consigli attivi mostra anche l'azione della politica ottima
+static void menu_azione(Sessione* s, struct Giocatore* g, int movimento_fatto) {
+    stampa("\n=== TURNO DI %s ===\n", g->nome);
+    // Probabilità esatta di vincere lo scontro con il nemico della zona (tabella precalcolata)
+    Tipo_nemico nemico = (g->mondo == 0) ? g->pos_mondoreale->nemico : g->pos_soprasotto->nemico;
+    if (nemico != nessun_nemico && verbosita_uscita >= verbosita_normale) {
+        double p = probabilita_vittoria(g->attacco_pischico, g->difesa_pischica, g->fortuna, nemico);
+        stampa("Probabilita' di vittoria contro %s: %.1f%%\n", nome_nemico(nemico), p * 100.0);
+    }
+    if (s != NULL && s->mostra_consigli && verbosita_uscita >= verbosita_normale) {
+        static const char* const nomi_azione[] = { "", "Avanza", "", "Cambia Mondo", "Combatti", "", "", "", "", "Passa" };
+        double vittoria;
+        int azione = partita_consiglio(s, g, movimento_fatto, &vittoria);
+        if (azione > 0 && vittoria > 0.0) stampa("Consiglio: %s (vittoria %.1f%%)\n", nomi_azione[azione], vittoria * 100.0);
+        else if (azione > 0) stampa("Consiglio: con queste statistiche il Demotorzone non si batte, cerca oggetti\n");
+    }
+    if (s != NULL && s->suggerimenti_mcts && verbosita_uscita >= verbosita_normale) {
+        Decisione_mcts d;
+        if (mcts_decidi(s->mcts, s, &d))
+            stampa("Suggerimento MCTS: %s (vittoria stimata %.1f%%, %llu simulazioni)\n", mcts_nome_azione(d.azione),
+                   d.vittoria * 100.0, d.simulazioni);
+    }
+    stampa("1) Avanza\n2) Indietreggia\n3) Cambia Mondo\n4) Combatti\n");
+    stampa("5) Stampa Giocatore\n6) Stampa Zona\n7) Raccogli Oggetto\n");
+    stampa("8) Utilizza Oggetto\n9) Passa\n");
+    stampa("Scelta: ");
+}
+
+static void menu_combattimento(void) {
+    stampa("\n--- SOTTOMENU COMBATTIMENTO ---\n");
+    stampa("1) Attacco Pischico\n2) Utilizza Oggetto\nScelta: ");
+}
+
+static void menu_oggetto(void) {
+    stampa("Scegli oggetto da usare (0 per annullare): ");
+}
+
+// dati: la Sessione per i consigli, oppure NULL
+static int tastiera_azione(struct Giocatore* g, int movimento_fatto, void* dati) {
+    int scelta = 0;
+    menu_azione((Sessione*) dati, g, movimento_fatto);
+    ingresso_intero(&scelta); pulisci_buffer();
+    return scelta;
+}
+
+static int tastiera_combattimento(struct Giocatore* g, Tipo_nemico nemico, int hp_giocatore, int hp_nemico, void* dati) {
+    (void) g; (void) nemico; (void) hp_giocatore; (void) hp_nemico; (void) dati;
+    int sc = 0;
+    menu_combattimento();
+    ingresso_intero(&sc); pulisci_buffer();
+    return sc;
+}
+
+static int tastiera_oggetto(struct Giocatore* g, int in_combattimento, void* dati) {
+    (void) g; (void) in_combattimento; (void) dati;
+    int scelta = 0;
+    menu_oggetto();
+    ingresso_intero(&scelta); pulisci_buffer();
+    return scelta;
+}
+
+const Agente agente_tastiera = { tastiera_azione, tastiera_combattimento, tastiera_oggetto, NULL };
+
+void partita_stampa_richiesta(const Richiesta* r) {
+    switch (r->tipo) {
+        case richiesta_azione: menu_azione(NULL, r->g, r->movimento_fatto); break;
+        case richiesta_combattimento: menu_combattimento(); break;
+        case richiesta_oggetto: menu_oggetto(); break;
+        default: break;
+    }
+}
+
+int agente_rispondi(const Agente* a, const Richiesta* r) {
+    switch (r->tipo) {
+        case richiesta_azione: return a->scegli_azione(r->g, r->movimento_fatto, a->dati);
+        case richiesta_combattimento: return a->scegli_combattimento(r->g, r->nemico, r->hp_giocatore, r->hp_nemico, a->dati);
+        case richiesta_oggetto: return a->scegli_oggetto(r->g, r->in_combattimento, a->dati);
+        default: return 0;
+    }
+}
+
+// Restituisce lo slot (1-3) che contiene l'oggetto cercato, 0 se assente
+static int slot_oggetto(struct Giocatore* g, Tipo_oggetto obj) {
+    for (int i = 0; i < 3; i++) if (g->zaino[i] == obj) return i + 1;
+    return 0;
+}
+
+// --- Agente esploratore: raccoglie oggetti, passa nel Soprasotto e avanza ---
+static int esploratore_azione(struct Giocatore* g, int movimento_fatto, void* dati) {
+    (void) dati;
+    Tipo_nemico nemico = (g->mondo == 0) ? g->pos_mondoreale->nemico : g->pos_soprasotto->nemico;
+    if (nemico != nessun_nemico) return 4;
+    if (g->mondo == 0 && g->pos_mondoreale->oggetto != nessun_oggetto && slot_oggetto(g, nessun_oggetto)) return 7;
+    if (movimento_fatto) return 9;
+    if (g->mondo == 0) return 3;
+    if (g->pos_soprasotto->avanti == NULL) return 9;
+    return 1;
+}
+
+static int esploratore_combattimento(struct Giocatore* g, Tipo_nemico nemico, int hp_giocatore, int hp_nemico, void* dati) {
+    (void) nemico; (void) hp_giocatore; (void) hp_nemico; (void) dati;
+    // Assolo contro chiunque. La bicicletta non viene usata: curarsi senza
+    // infliggere danni allungherebbe lo scontro all'infinito
+    if (slot_oggetto(g, schitarrata_metallica)) return 2;
+    return 1;
+}
+
+static int esploratore_oggetto(struct Giocatore* g, int in_combattimento, void* dati) {
+    (void) in_combattimento; (void) dati;
+    return slot_oggetto(g, schitarrata_metallica);
+}
+
+const Agente agente_esploratore = { esploratore_azione, esploratore_combattimento, esploratore_oggetto, NULL };
+
+// --- Agente casuale: ogni scelta è estratta da un LCG privato dell'agente ---
+// Non usa casuale() per non consumare le estrazioni del gioco
+static int passo_lcg(unsigned int* seme) {
+    *seme = *seme * 1103515245u + 12345u;
+    return (int) ((*seme >> 16) & 0x7FFF);
+}
+
+static int casuale_azione(struct Giocatore* g, int movimento_fatto, void* dati) {
+    (void) g; (void) movimento_fatto;
+    return passo_lcg((unsigned int*) dati) % 9 + 1;
+}
+
+static int casuale_combattimento(struct Giocatore* g, Tipo_nemico nemico, int hp_giocatore, int hp_nemico, void* dati) {
+    (void) g; (void) nemico; (void) hp_giocatore; (void) hp_nemico;
+    return passo_lcg((unsigned int*) dati) % 2 + 1;
+}
+
+static int casuale_oggetto(struct Giocatore* g, int in_combattimento, void* dati) {
+    (void) g; (void) in_combattimento;
+    return passo_lcg((unsigned int*) dati) % 4;
+}
+
+Agente agente_casuale(unsigned int* seme) {
+    Agente a = { casuale_azione, casuale_combattimento, casuale_oggetto, seme };
+    return a;
+}
+
+// --- Agente corridore: subito nel Soprasotto e sempre avanti, niente oggetti ---
+static int corridore_azione(struct Giocatore* g, int movimento_fatto, void* dati) {
+    (void) dati;
+    Tipo_nemico nemico = (g->mondo == 0) ? g->pos_mondoreale->nemico : g->pos_soprasotto->nemico;
+    if (nemico != nessun_nemico) return 4; // Combatte solo quando è bloccato
+    if (movimento_fatto) return 9;
+    if (g->mondo == 0) return 3;
+    return g->pos_soprasotto->avanti != NULL ? 1 : 9;
+}
+
+static int solo_attacco(struct Giocatore* g, Tipo_nemico nemico, int hp_giocatore, int hp_nemico, void* dati) {
+    (void) g; (void) nemico; (void) hp_giocatore; (void) hp_nemico; (void) dati;
+    return 1;
+}
+
+static int nessun_oggetto_scelto(struct Giocatore* g, int in_combattimento, void* dati) {
+    (void) g; (void) in_combattimento; (void) dati;
+    return 0;
+}
+
+const Agente agente_corridore = { corridore_azione, solo_attacco, nessun_oggetto_scelto, NULL };
+
+// --- Agente combattente: affronta ogni nemico della zona, in tutti e due i mondi ---
+static int combattente_azione(struct Giocatore* g, int movimento_fatto, void* dati) {
+    (void) dati;
+    Tipo_nemico nemico = (g->mondo == 0) ? g->pos_mondoreale->nemico : g->pos_soprasotto->nemico;
+    Tipo_nemico altro = (g->mondo == 0) ? g->pos_soprasotto->nemico : g->pos_mondoreale->nemico;
+    if (nemico != nessun_nemico) return 4;
+    if (movimento_fatto) return 9;
+    // Va a cercarlo nell'altro mondo (dal Soprasotto solo se la fuga è possibile)
+    if (altro != nessun_nemico && (g->mondo == 0 || g->fortuna >= 2)) return 3;
+    if (g->mondo == 0) return g->pos_mondoreale->avanti != NULL ? 1 : 3;
+    return g->pos_soprasotto->avanti != NULL ? 1 : 9;
+}
+
+const Agente agente_combattente = { combattente_azione, esploratore_combattimento, esploratore_oggetto, NULL };
+
+// --- Agente collezionista: riempie lo zaino nel Mondo Reale, poi scende ---
+static int collezionista_azione(struct Giocatore* g, int movimento_fatto, void* dati) {
+    (void) dati;
+    Tipo_nemico nemico = (g->mondo == 0) ? g->pos_mondoreale->nemico : g->pos_soprasotto->nemico;
+    if (nemico != nessun_nemico) return 4;
+    if (g->mondo == 0 && g->pos_mondoreale->oggetto != nessun_oggetto && slot_oggetto(g, nessun_oggetto)) return 7;
+    if (movimento_fatto) return 9;
+    if (g->mondo == 0) {
+        // Resta nel Mondo Reale finché c'è posto nello zaino e strada davanti,
+        // ma scende subito se sotto c'è il Demotorzone
+        if (g->pos_soprasotto->nemico != demotorzone && slot_oggetto(g, nessun_oggetto)
+            && g->pos_mondoreale->avanti != NULL) return 1;
+        return 3;
+    }
+    if (g->pos_soprasotto->avanti != NULL) return 1;
+    return g->fortuna >= 2 ? 3 : 9; // In fondo al Soprasotto: torna a cercare
+}
+
+// Schitarrata appena c'è; la Maglietta al primo scambio (nessuno dei due è
+// ancora stato colpito), perché vale per tutto lo scontro
+static int collezionista_combattimento(struct Giocatore* g, Tipo_nemico nemico, int hp_giocatore, int hp_nemico, void* dati) {
+    (void) dati;
+    if (slot_oggetto(g, schitarrata_metallica)) return 2;
+    if (slot_oggetto(g, maglietta_fuocoinferno) && hp_nemico == statistiche_nemici[nemico].hp
+        && hp_giocatore == regole_hp_giocatore(g->difesa_pischica)) return 2;
+    return 1;
+}
+
+static int collezionista_oggetto(struct Giocatore* g, int in_combattimento, void* dati) {
+    (void) dati;
+    if (!in_combattimento) return 0;
+    int slot = slot_oggetto(g, schitarrata_metallica);
+    return slot ? slot : slot_oggetto(g, maglietta_fuocoinferno);
+}
+
+const Agente agente_collezionista = { collezionista_azione, collezionista_combattimento, collezionista_oggetto, NULL };
+
+// --- Agente saltatore: cambia mondo per scansare i nemici, combatte il boss ---
+static int saltatore_azione(struct Giocatore* g, int movimento_fatto, void* dati) {
+    (void) dati;
+    Tipo_nemico mr = g->pos_mondoreale->nemico, ss = g->pos_soprasotto->nemico;
+    if (g->mondo == 0) {
+        if (mr != nessun_nemico) return 4; // Nel Mondo Reale non si scappa
+        if (movimento_fatto) return 9;
+        if (ss == demotorzone || ss == nessun_nemico) return 3;
+        return g->pos_mondoreale->avanti != NULL ? 1 : 9;
+    }
+    if (ss == demotorzone) return 4;
+    if (ss != nessun_nemico) {
+        // Fuga verso il Mondo Reale se lì la strada è libera, altrimenti si combatte
+        if (!movimento_fatto && mr == nessun_nemico && g->fortuna >= 2) return 3;
+        return 4;
+    }
+    if (movimento_fatto) return 9;
+    return g->pos_soprasotto->avanti != NULL ? 1 : 9;
+}
+
+const Agente agente_saltatore = { saltatore_azione, esploratore_combattimento, esploratore_oggetto, NULL };
+
+// ============================================================================
+// POLITICA OTTIMA (CONSIGLI E BOT)
+// ============================================================================
+// La politica di un giocatore si calcola alla prima richiesta e si riusa
+// finché la mappa e le statistiche non cambiano. Ogni nemico che svanisce
+// cambia la mappa, quindi la politica segue la partita.
+
+static const Politica* politica_giocatore(Sessione* s, const struct Giocatore* g) {
+    int i = 0;
+    while (i < 4 && s->giocatori[i] != g) i++;
+    if (i == 4 || !s->gioco_pronto) return NULL;
+    Politica_giocatore* pg = &s->politiche[i];
+    if (pg->politica != NULL && pg->versione_mappa == s->versione_mappa && pg->attacco == g->attacco_pischico
+        && pg->difesa == g->difesa_pischica && pg->fortuna == g->fortuna)
+        return pg->politica;
+
+    politica_distruggi(pg->politica);
+    pg->politica = NULL;
+    Mappa_soa m;
+    if (!mappa_esporta_soa(s, &m)) return NULL;
+    pg->politica = politica_risolvi(&m, g->attacco_pischico, g->difesa_pischica, g->fortuna, 0);
+    soa_distruggi(&m);
+    pg->versione_mappa = s->versione_mappa;
+    pg->attacco = g->attacco_pischico;
+    pg->difesa = g->difesa_pischica;
+    pg->fortuna = g->fortuna;
+    return pg->politica;
+}
+
+int partita_consiglio(Sessione* s, const struct Giocatore* g, int movimento_fatto, double* vittoria) {
+    const Politica* p = politica_giocatore(s, g);
+    if (p == NULL || g->pos_mondoreale == NULL) return 0;
+    size_t pos = indice_posizione((const Slot_zona*) g->pos_mondoreale);
+    Tipo_nemico mr = g->pos_mondoreale->nemico, ss = g->pos_mondoreale->link_soprasotto->nemico;
+    if (vittoria != NULL) *vittoria = politica_vittoria(p, pos, g->mondo, mr, ss);
+    return politica_azione(p, pos, g->mondo, mr, ss, movimento_fatto);
+}
+
+void partita_mostra_consigli(Sessione* s, int attivo) {
+    s->mostra_consigli = attivo;
+}
+
+// --- Agente ottimo: si muove e combatte secondo partita_consiglio ---
+// Raccogliere oggetti e usare la Schitarrata sono fuori dal modello e non
+// tolgono probabilità di vittoria: li fa come l'esploratore
+static int ottimo_azione(struct Giocatore* g, int movimento_fatto, void* dati) {
+    double vittoria;
+    int azione = partita_consiglio((Sessione*) dati, g, movimento_fatto, &vittoria);
+    // Nessuna speranza per il modello (es. attacco troppo basso contro il
+    // Demotorzone): solo gli oggetti possono cambiare le cose
+    if (azione == 0 || vittoria <= 0.0) return esploratore_azione(g, movimento_fatto, NULL);
+    if (g->mondo == 0 && g->pos_mondoreale->nemico == nessun_nemico && g->pos_mondoreale->oggetto != nessun_oggetto
+        && slot_oggetto(g, nessun_oggetto)) return 7;
+    return azione;
+}
+
+Agente agente_ottimo(Sessione* s) {
+    Agente a = { ottimo_azione, esploratore_combattimento, esploratore_oggetto, s };
+    return a;
+}
+
+// ============================================================================
+// RAMI PER LA RICERCA (vedi ramo.h)
+// ============================================================================
+
+Ramo* partita_ramo(const Sessione* s, Arena_rami* a, const Mappa_compatta* base) {
+    Ramo* r = ramo_radice(a, base);
+    if (r == NULL) return NULL;
+    for (int i = 0; i < 4; i++) {
+        const struct Giocatore* g = s->giocatori[i];
+        Giocatore_ramo* gr = &r->giocatori[i];
+        if (g == NULL || g->pos_mondoreale == NULL) continue;
+        gr->vivo = 1;
+        gr->mondo = g->mondo;
+        gr->posizione = (size_t) posizione_mr(g->pos_mondoreale); // Le due posizioni si muovono insieme
+        gr->attacco = g->attacco_pischico; gr->difesa = g->difesa_pischica; gr->fortuna = g->fortuna;
+        memcpy(gr->zaino, g->zaino, sizeof(gr->zaino));
+    }
+    r->numero_giocatori = s->numero_giocatori;
+    const Stato_passo* ps = &s->passo;
+    if (ps->fase != passo_fermo) {
+        r->round = ps->round;
+        r->max_round = ps->max_round;
+        memcpy(r->ordine, ps->ordine, sizeof(r->ordine));
+        r->prossimo = ps->prossimo;
+        r->di_turno = ps->indice;
+        r->movimento_fatto = ps->movimento_fatto;
+    }
+    r->vincitore = s->indice_vincitore;
+    return r;
+}
+
+void partita_collega_mcts(Sessione* s, Mcts* m, int suggerimenti, unsigned int bot) {
+    s->mcts = m;
+    s->suggerimenti_mcts = m != NULL && suggerimenti;
+    s->bot_mcts = m != NULL ? bot : 0;
+}
+
+// ============================================================================
+// DIARIO DI PARTITA (REGISTRAZIONE E RIPRODUZIONE)
+// ============================================================================
+
+static const char* const descrizioni_evento[] = {
+    "un'estrazione", "una scelta di azione", "una scelta di combattimento",
+    "una scelta di oggetto", "un nuovo round", "la fine della partita"
+};
+
+static void segnala_divergenza(Sessione* s, const char* motivo) {
+    if (s->divergenza) return;
+    s->divergenza = 1;
+    s->round_divergenza = s->riproduzione->round;
+    snprintf(s->motivo_divergenza, sizeof(s->motivo_divergenza), "%s", motivo);
+    s->gioco_terminato = 1; // Ferma la partita al più presto
+}
+
+static void segna_zona_modificata(Sessione* s, struct Zona_mondoreale* z) {
+    s->versione_mappa++; // Le politiche calcolate non valgono più
+    indice_aggiorna_presenza((Slot_zona*) z);
+    if (s->registrazione == NULL && s->riproduzione == NULL) return;
+    if (s->n_zone_modificate == s->capacita_zone_modificate) {
+        size_t capacita = s->capacita_zone_modificate ? 2 * s->capacita_zone_modificate : 64;
+        size_t* v = (size_t*) realloc(s->zone_modificate, capacita * sizeof(size_t));
+        if (v == NULL) {
+            if (s->registrazione != NULL) s->registrazione->ok = 0;
+            else segnala_divergenza(s, "memoria insufficiente");
+            return;
+        }
+        s->zone_modificate = v;
+        s->capacita_zone_modificate = capacita;
+    }
+    s->zone_modificate[s->n_zone_modificate++] = indice_posizione((const Slot_zona*) z);
+}
+
+// Cambia il contenuto di una zona durante la partita: conteggi, indice,
+// politiche e diario restano allineati
+static void modifica_zona(Sessione* s, struct Zona_mondoreale* z, Tipo_nemico nemico_mr, Tipo_oggetto oggetto, Tipo_nemico nemico_ss) {
+    conta_contenuto(&s->conteggi, z, -1);
+    z->nemico = nemico_mr;
+    z->oggetto = oggetto;
+    z->link_soprasotto->nemico = nemico_ss;
+    conta_contenuto(&s->conteggi, z, 1);
+    segna_zona_modificata(s, z);
+    verifica_conteggi(s, "una modifica della zona");
+}
+
+static int confronta_posizioni(const void* a, const void* b) {
+    size_t x = *(const size_t*) a, y = *(const size_t*) b;
+    return (x > y) - (x < y);
+}
+
+// Fotogramma dello stato corrente; 0 se manca la memoria
+static int cattura_fotogramma(Sessione* s, Fotogramma* f, int round) {
+    f->round = round;
+    memcpy(f->rng, s->rng_gioco.s, sizeof(f->rng));
+    for (int i = 0; i < 4; i++) {
+        struct Giocatore* g = s->giocatori[i];
+        Giocatore_fotogramma* gf = &f->giocatori[i];
+        memset(gf, 0, sizeof(*gf));
+        gf->pos_mr = gf->pos_ss = -1;
+        if (g == NULL) continue;
+        gf->presente = 1;
+        gf->mondo = g->mondo;
+        gf->pos_mr = posizione_mr(g->pos_mondoreale);
+        gf->pos_ss = posizione_ss(g->pos_soprasotto);
+        for (int k = 0; k < 3; k++) gf->zaino[k] = (unsigned char) g->zaino[k];
+    }
+
+    // Posizioni ordinate e senza ripetizioni, poi i valori correnti
+    qsort(s->zone_modificate, s->n_zone_modificate, sizeof(size_t), confronta_posizioni);
+    size_t n = 0;
+    for (size_t i = 0; i < s->n_zone_modificate; i++)
+        if (n == 0 || s->zone_modificate[i] != s->zone_modificate[n - 1]) s->zone_modificate[n++] = s->zone_modificate[i];
+    s->n_zone_modificate = n;
+    if (n > s->capacita_modifiche_fotogramma) {
+        Modifica_zona* m = (Modifica_zona*) realloc(s->modifiche_fotogramma, n * sizeof(Modifica_zona));
+        if (m == NULL) return 0;
+        s->modifiche_fotogramma = m;
+        s->capacita_modifiche_fotogramma = n;
+    }
+    for (size_t i = 0; i < n; i++) {
+        struct Zona_mondoreale* z = ottieni_zona_mr(s, (int) s->zone_modificate[i]);
+        Modifica_zona* m = &s->modifiche_fotogramma[i];
+        m->posizione = s->zone_modificate[i];
+        m->nemico_mr = (unsigned char) z->nemico;
+        m->oggetto_mr = (unsigned char) z->oggetto;
+        m->nemico_ss = (unsigned char) z->link_soprasotto->nemico;
+    }
+    f->n_modifiche = n;
+    f->modifiche = s->modifiche_fotogramma;
+    return 1;
+}
+
+// Porta la partita (già nello stato iniziale del diario) allo stato del fotogramma
+static int applica_fotogramma(Sessione* s, const Fotogramma* f) {
+    if ((f->rng[0] | f->rng[1] | f->rng[2] | f->rng[3]) == 0) return 0;
+    for (int i = 0; i < 4; i++) {
+        const Giocatore_fotogramma* gf = &f->giocatori[i];
+        if (!gf->presente) {
+            if (s->giocatori[i] != NULL) { free(s->giocatori[i]); s->giocatori[i] = NULL; } // Morto prima del fotogramma
+            continue;
         }
-    } while (!fine_turno && !gioco_terminato);
+        struct Giocatore* g = s->giocatori[i];
+        if (g == NULL || gf->pos_mr < 0 || gf->pos_ss != gf->pos_mr) return 0;
+        g->mondo = gf->mondo;
+        g->pos_mondoreale = ottieni_zona_mr(s, (int) gf->pos_mr);
+        g->pos_soprasotto = g->pos_mondoreale->link_soprasotto;
+        for (int k = 0; k < 3; k++) g->zaino[k] = (Tipo_oggetto) gf->zaino[k];
+    }
+    memcpy(s->rng_gioco.s, f->rng, sizeof(f->rng));
+
+    s->n_zone_modificate = 0;
+    for (size_t i = 0; i < f->n_modifiche; i++) {
+        const Modifica_zona* m = &f->modifiche[i];
+        modifica_zona(s, ottieni_zona_mr(s, (int) m->posizione),
+                      (Tipo_nemico) m->nemico_mr, (Tipo_oggetto) m->oggetto_mr, (Tipo_nemico) m->nemico_ss);
+    }
+    return !s->divergenza;
+}
+
+// --- Registrazione ---
+
+static int inizia_registrazione(Sessione* s) {
+    Stato_salvato st;
+    cattura_stato(s, &st);
+    if (!mappa_esporta_soa(s, &st.mappa)) return 0;
+    int ok = diario_inizia(&s->diario_corrente, &st, s->intervallo_registrazione);
+    s->diario_corrente.liberi = s->passo.liberi;
+    soa_distruggi(&st.mappa);
+    if (!ok) { diario_libera(&s->diario_corrente); return 0; }
+    s->n_zone_modificate = 0;
+    s->registrazione = &s->diario_corrente;
+    return 1;
+}
+
+// Scrive il diario; r è NULL se la partita è stata interrotta
+static void termina_registrazione(Sessione* s, const Risultato_partita* r) {
+    if (r != NULL) diario_fine(s->registrazione, r);
+    Esito_diario e = diario_scrivi(s->registrazione, s->percorso_registrazione);
+    if (e != diario_ok) stampa("Errore: diario non salvato (%s).\n", diario_messaggio(e));
+    diario_libera(s->registrazione);
+    s->registrazione = NULL;
+}
+
+static void registra_round(Sessione* s, int round) {
+    Fotogramma f;
+    if (!diario_vuole_fotogramma(s->registrazione, round)) diario_round(s->registrazione, NULL);
+    else if (cattura_fotogramma(s, &f, round)) diario_round(s->registrazione, &f);
+    else s->registrazione->ok = 0;
+}
+
+// --- Riproduzione ---
+
+// Legge il prossimo evento qualunque sia il tipo
+static int leggi_evento(Sessione* s, Evento_diario* e, Fotogramma* f) {
+    if (s->divergenza || s->diario_esaurito) return 0;
+    if (diario_prossimo(s->riproduzione, e, f)) return 1;
+    if (s->riproduzione->completo) segnala_divergenza(s, "diario corrotto o troncato");
+    else { s->diario_esaurito = 1; s->gioco_terminato = 1; } // Registrazione interrotta: si finisce qui
+    return 0;
+}
+
+static void evento_inatteso(Sessione* s, Tipo_evento atteso, Tipo_evento trovato) {
+    char motivo[160];
+    snprintf(motivo, sizeof(motivo), "la partita chiede %s, il diario contiene %s",
+             descrizioni_evento[atteso], descrizioni_evento[trovato]);
+    segnala_divergenza(s, motivo);
+}
+
+// Legge il prossimo evento, che deve essere del tipo indicato
+static int prossimo_evento(Sessione* s, Tipo_evento tipo, Evento_diario* e, Fotogramma* f) {
+    if (!leggi_evento(s, e, f)) return 0;
+    if (e->tipo != tipo) { evento_inatteso(s, tipo, e->tipo); return 0; }
+    return 1;
+}
+
+static void verifica_estrazione(Sessione* s, int valore_meno_minimo) {
+    Evento_diario e;
+    Fotogramma f;
+    if (prossimo_evento(s, evento_estrazione, &e, &f) && e.valore != valore_meno_minimo)
+        segnala_divergenza(s, "estrazione diversa da quella registrata");
+}
+
+// Inizio di un round rigiocato: 0 se la partita deve fermarsi
+static int verifica_round(Sessione* s, int round) {
+    Evento_diario e;
+    Fotogramma registrato, attuale;
+    if (!leggi_evento(s, &e, &registrato)) return 0;
+    if (e.tipo == evento_fine) { // La partita registrata si è fermata al limite di round
+        s->fine_trovata = 1;
+        s->fine_registrata = e.risultato;
+        return 0;
+    }
+    if (e.tipo != evento_round) { evento_inatteso(s, evento_round, e.tipo); return 0; }
+    if (e.valore != round) { segnala_divergenza(s, "numero di round diverso"); return 0; }
+    if (e.fotogramma && (!cattura_fotogramma(s, &attuale, round) || !diario_fotogrammi_uguali(&attuale, &registrato))) {
+        segnala_divergenza(s, "stato diverso dal fotogramma registrato");
+        return 0;
+    }
+    if (round == s->round_visibile) uscita_imposta_verbosita(s->verbosita_riproduzione);
+    return 1;
+}
+
+// Agente che legge le scelte dal diario della sessione (in dati); in caso di
+// divergenza passa e attacca
+static int riproduci_azione(struct Giocatore* g, int movimento_fatto, void* dati) {
+    (void) g; (void) movimento_fatto;
+    Evento_diario e; Fotogramma f;
+    return prossimo_evento((Sessione*) dati, evento_azione, &e, &f) ? e.valore : 9;
+}
+
+static int riproduci_combattimento(struct Giocatore* g, Tipo_nemico nemico, int hp_giocatore, int hp_nemico, void* dati) {
+    (void) g; (void) nemico; (void) hp_giocatore; (void) hp_nemico;
+    Evento_diario e; Fotogramma f;
+    return prossimo_evento((Sessione*) dati, evento_combattimento, &e, &f) ? e.valore : 1;
+}
+
+static int riproduci_oggetto(struct Giocatore* g, int in_combattimento, void* dati) {
+    (void) g; (void) in_combattimento;
+    Evento_diario e; Fotogramma f;
+    return prossimo_evento((Sessione*) dati, evento_oggetto, &e, &f) ? e.valore : 0;
+}
+
+
+void partita_registra(Sessione* s, const char* percorso, int intervallo) {
+    free(s->percorso_registrazione);
+    s->percorso_registrazione = NULL;
+    s->intervallo_registrazione = intervallo;
+    if (percorso == NULL) return;
+    size_t n = strlen(percorso) + 1;
+    s->percorso_registrazione = (char*) malloc(n);
+    if (s->percorso_registrazione != NULL) memcpy(s->percorso_registrazione, percorso, n);
+}
+
+Esito_diario partita_riproduci(Sessione* s, const char* percorso, int dal_round, Rapporto_riproduzione* r) {
+    Lettore_diario l;
+    Stato_salvato iniziale;
+    Fotogramma f;
+    Risultato_partita nessuno = { esito_limite_round, -1, 0, { nessun_nemico } };
+    memset(r, 0, sizeof(*r));
+    r->risultato = nessuno;
+
+    Esito_diario e = diario_apri(percorso, &l, &iniziale);
+    if (e != diario_ok) return e;
+    if (!applica_stato(s, &iniziale)) { diario_chiudi(&l); return diario_errore_memoria; }
+
+    s->riproduzione = &l;
+    s->divergenza = s->diario_esaurito = s->fine_trovata = 0;
+    s->gioco_terminato = 0;
+    s->indice_vincitore = -1;
+    memset(s->ucciso_da, 0, sizeof(s->ucciso_da));
+    s->n_zone_modificate = 0;
+
+    // Si riparte dall'ultimo fotogramma prima di dal_round, non dall'inizio
+    int round = 1;
+    if (diario_cerca(&l, dal_round, &f)) {
+        if (!applica_fotogramma(s, &f)) { s->riproduzione = NULL; diario_chiudi(&l); return diario_errore_stato; }
+        round = f.round;
+    }
+    r->round_partenza = round;
+
+    // Le scelte vengono dal diario; fino a dal_round nessun messaggio
+    s->verbosita_riproduzione = verbosita_uscita;
+    s->round_visibile = dal_round;
+    if (round < dal_round) uscita_imposta_verbosita(verbosita_silenziosa);
+    const Agente riproduttore = { riproduci_azione, riproduci_combattimento, riproduci_oggetto, s };
+    const Agente* agenti[4] = { &riproduttore, &riproduttore, &riproduttore, &riproduttore };
+    s->passo.liberi = l.liberi; // I limiti della partita registrata
+    Risultato_partita risultato = ciclo_partita(s, agenti, round, 0);
+
+    // La partita registrata deve finire allo stesso modo
+    Evento_diario ev;
+    if (!s->fine_trovata && !s->divergenza && !s->diario_esaurito && prossimo_evento(s, evento_fine, &ev, &f)) {
+        s->fine_trovata = 1;
+        s->fine_registrata = ev.risultato;
+    }
+    if (s->fine_trovata && (s->fine_registrata.esito != risultato.esito || s->fine_registrata.vincitore != risultato.vincitore
+                         || s->fine_registrata.round != risultato.round))
+        segnala_divergenza(s, "risultato finale diverso da quello registrato");
+
+    uscita_imposta_verbosita(s->verbosita_riproduzione);
+    r->round_finale = risultato.round;
+    r->eventi = l.letti;
+    r->completo = s->fine_trovata;
+    r->risultato = risultato;
+    if (s->divergenza) { r->round_divergenza = s->round_divergenza; r->motivo = s->motivo_divergenza; }
+    s->riproduzione = NULL;
+    diario_chiudi(&l);
+    return s->divergenza ? diario_divergenza : diario_ok;
+}
+
+// ============================================================================
+// CREAZIONE GIOCATORI E CICLO DI PARTITA
+// ============================================================================
+
+// Alloca un giocatore nel Mondo Reale con lo zaino vuoto
+static struct Giocatore* crea_giocatore() {
+    struct Giocatore* g = (struct Giocatore*) malloc(sizeof(struct Giocatore));
+    if (g == NULL) return NULL;
+    g->mondo = 0; // Parte nel mondo reale
+    g->pos_mondoreale = NULL; g->pos_soprasotto = NULL; // Posizionato all'inizio della partita
+    for(int k=0; k<3; k++) g->zaino[k] = nessun_oggetto;
+    g->nome[0] = '\0';
+    return g;
+}
+
+// Tira le tre statistiche (1-20)
+static void tira_statistiche(Sessione* s, struct Giocatore* g) {
+    g->attacco_pischico = casuale(s, 1, 20);
+    g->difesa_pischica = casuale(s, 1, 20);
+    g->fortuna = casuale(s, 1, 20);
+}
+
+// Applica le modifiche statistiche e la classe Undici (una sola volta per partita)
+static void applica_modifica(Sessione* s, struct Giocatore* g, Modifica_statistiche m) {
+    if (m == modifica_attacco) { g->attacco_pischico += 3; g->difesa_pischica -= 3; }
+    else if (m == modifica_difesa) { g->attacco_pischico -= 3; g->difesa_pischica += 3; }
+    else if (m == modifica_undici && !s->undici_preso) {
+        g->attacco_pischico += 4; g->difesa_pischica += 4; g->fortuna -= 7;
+        strcpy(g->nome, "Undici VirgolaCinque"); s->undici_preso = 1;
+    }
+}
+
+// --- Partita a passi ---
+// Il ciclo dei round è una macchina a stati: quando serve una scelta il
+// motore si ferma in passo_attesa con la richiesta e riparte dalla risposta.
+// Gli agenti rispondono subito (ciclo_partita), i giocatori in rete quando
+// arriva la loro riga (server.c).
+
+// Ferma il motore in attesa di una scelta del giocatore di turno
+static void chiedi(Sessione* s, Tipo_richiesta tipo) {
+    Stato_passo* ps = &s->passo;
+    Richiesta* r = &ps->richiesta;
+    r->tipo = tipo;
+    r->giocatore = ps->indice;
+    r->g = ps->g;
+    r->movimento_fatto = ps->movimento_fatto;
+    r->nemico = tipo == richiesta_combattimento ? ps->nemico : nessun_nemico;
+    r->hp_giocatore = tipo == richiesta_combattimento ? ps->hp_giocatore : 0;
+    r->hp_nemico = tipo == richiesta_combattimento ? ps->hp_nemico : 0;
+    r->in_combattimento = ps->in_combattimento;
+    ps->fase = passo_attesa;
+}
+
+// Il giocatore di turno gioca da tastiera: i limiti contro gli agenti che
+// non passano mai non valgono
+static int senza_limiti(const Stato_passo* ps) {
+    return ps->indice >= 0 && (ps->liberi >> ps->indice & 1u);
+}
+
+// Fine di un'azione del menu di turno
+static void fine_azione(Sessione* s) {
+    Stato_passo* ps = &s->passo;
+    // Tempo dell'azione, comprese le scelte chieste durante l'azione
+    if (ps->scelta >= 1 && ps->scelta <= 9) CRONOMETRO_FERMA((Tempo) (tempo_avanza + ps->scelta - 1), ps->inizio_azione);
+    ps->fase = (ps->scelta == 9 || s->gioco_terminato) ? passo_turno : passo_scelta;
+}
+
+static void esegui_azione(Sessione* s, int scelta) {
+    Stato_passo* ps = &s->passo;
+    struct Giocatore* g = ps->g;
+    ps->scelta = scelta;
+    CRONOMETRO_SEGNA(ps->inizio_azione);
+    switch (scelta) {
+        case 1: avanza(s, g, &ps->movimento_fatto); break;
+        case 2: indietreggia(g, &ps->movimento_fatto); break;
+        case 3: cambia_mondo(s, g, &ps->movimento_fatto); break;
+        case 4: if (combatti(s, g)) return; break; // Lo scontro prosegue a passi
+        case 5: stampa_giocatore(g); break;
+        case 6: stampa_zona(g); break;
+        case 7: raccogli_oggetto(s, g); break;
+        case 8: if (utilizza_oggetto(s, g)) return; break;
+        case 9: passa(g); break;
+        default: stampa("Comando non valido.\n");
+    }
+    fine_azione(s);
+}
+
+static void fine_scontro(Sessione* s, Esito_scontro esito) {
+    Stato_passo* ps = &s->passo;
+    ps->esito = esito;
+    if (ps->solo_scontro) { ps->fase = passo_fermo; return; }
+    concludi_combattimento(s, esito);
+    fine_azione(s);
+}
+
+static void oggetto_scelto(Sessione* s, int scelta) {
+    Stato_passo* ps = &s->passo;
+    int bonus_attacco = 0, bonus_difesa = 0, hp_recupero = 0;
+    if (!ps->in_combattimento) {
+        utilizza_oggetto_logic(s, ps->g, scelta, &bonus_attacco, &bonus_difesa, &hp_recupero, 0);
+        fine_azione(s);
+        return;
+    }
+    int turno_usato = utilizza_oggetto_logic(s, ps->g, scelta, &ps->bonus_attacco, &ps->bonus_difesa, &hp_recupero, 1);
+    ps->hp_giocatore += hp_recupero;
+    dopo_scambio(s, turno_usato);
+}
+
+static void termina_passi(Sessione* s) {
+    Stato_passo* ps = &s->passo;
+    Risultato_partita r = { esito_limite_round, -1, ps->round - 1, { nessun_nemico } };
+    if (s->indice_vincitore >= 0) { r.esito = esito_vittoria; r.vincitore = s->indice_vincitore; }
+    else if (s->gioco_terminato) r.esito = esito_sconfitta;
+    memcpy(r.ucciso_da, s->ucciso_da, sizeof(r.ucciso_da));
+    ps->risultato = r;
+    ps->fase = passo_fermo;
+    if (s->registrazione != NULL) termina_registrazione(s, &r);
+}
+
+static const Richiesta nessuna_richiesta = { richiesta_nessuna, -1, NULL, 0, nessun_nemico, 0, 0, 0 };
+
+// Esegue il motore fino alla prossima scelta (o alla fine della partita)
+static const Richiesta* prosegui(Sessione* s) {
+    Stato_passo* ps = &s->passo;
+    for (;;) {
+        switch (ps->fase) {
+            case passo_fermo:
+                return &nessuna_richiesta;
+            case passo_attesa:
+                return &ps->richiesta;
+
+            case passo_round:
+                if (s->gioco_terminato || (ps->max_round > 0 && ps->round > ps->max_round)) { termina_passi(s); break; }
+                if (s->registrazione != NULL) registra_round(s, ps->round);
+                else if (s->riproduzione != NULL && !verifica_round(s, ps->round)) { termina_passi(s); break; }
+                stampa("\n=== ROUND %d ===\n", ps->round);
+                CONTA(contatore_round);
+                ps->round++;
+
+                // Determina ordine casuale dei turni
+                regole_mescola_ordine(ps->ordine, s->numero_giocatori, estrai_casuale, s);
+                ps->prossimo = 0;
+                ps->fase = passo_turno;
+                break;
+
+            case passo_turno:
+                if (ps->prossimo < s->numero_giocatori && !s->gioco_terminato) {
+                    struct Giocatore* g = s->giocatori[ps->ordine[ps->prossimo++]];
+                    if (g == NULL) break;
+                    ps->g = g;
+                    ps->indice = ps->ordine[ps->prossimo - 1];
+                    ps->movimento_fatto = ps->azioni = 0;
+                    CONTA(contatore_turni);
+                    ps->fase = passo_scelta;
+                    break;
+                }
+                // Verifica game over per morte totale
+                int vivi = 0;
+                for (int k = 0; k < s->numero_giocatori; k++) if (s->giocatori[k] != NULL) vivi++;
+                if (vivi == 0 && s->numero_giocatori > 0) {
+                    stampa("Tutti morti. Game Over.\n");
+                    s->gioco_terminato = 1;
+                }
+                ps->fase = passo_round;
+                break;
+
+            case passo_scelta:
+                // Controllo vitalità (il giocatore potrebbe essere morto durante il turno)
+                if (s->giocatori[ps->indice] != ps->g) { ps->fase = passo_turno; break; }
+                // Un agente che non passa mai il turno viene fermato dopo MAX_AZIONI_TURNO
+                if (++ps->azioni <= MAX_AZIONI_TURNO || senza_limiti(ps)) chiedi(s, richiesta_azione);
+                else esegui_azione(s, 9);
+                break;
+
+            case passo_scontro:
+                if (ps->hp_giocatore <= 0 || ps->hp_nemico <= 0) {
+                    fine_scontro(s, ps->hp_giocatore <= 0 ? scontro_perso : scontro_vinto);
+                } else if (!senza_limiti(ps) && (ps->scambi >= MAX_SCAMBI_COMBATTIMENTO
+                                                 || ps->richieste_vuote >= MAX_SCAMBI_COMBATTIMENTO)) {
+                    stampa("Lo scontro si trascina senza fine: %s si ritira.\n", ps->g->nome);
+                    fine_scontro(s, scontro_ritirata);
+                } else {
+                    chiedi(s, richiesta_combattimento);
+                }
+                break;
+        }
+    }
+}
+
+static const Tipo_evento eventi_richiesta[] = {
+    [richiesta_azione] = evento_azione,
+    [richiesta_combattimento] = evento_combattimento,
+    [richiesta_oggetto] = evento_oggetto,
+};
+
+const Richiesta* partita_rispondi(Sessione* s, int scelta) {
+    Stato_passo* ps = &s->passo;
+    if (ps->fase != passo_attesa) return prosegui(s);
+    // Il diario annota le scelte, non ciò che ne consegue
+    if (s->registrazione != NULL) diario_scelta(s->registrazione, eventi_richiesta[ps->richiesta.tipo], scelta);
+    switch (ps->richiesta.tipo) {
+        case richiesta_azione: esegui_azione(s, scelta); break;
+        case richiesta_combattimento: scambio(s, scelta); break;
+        case richiesta_oggetto: oggetto_scelto(s, scelta); break;
+        default: break;
+    }
+    return prosegui(s);
+}
+
+static const Richiesta* avvia_passi(Sessione* s, int round, int max_round) {
+    Stato_passo* ps = &s->passo;
+    ps->round = round;
+    ps->max_round = max_round;
+    ps->solo_scontro = 0;
+    ps->fase = passo_round;
+    return prosegui(s);
+}
+
+// Giocatori (bit) giocati da tastiera, esenti dai limiti di azioni e scambi
+static unsigned int giocatori_tastiera(const Agente* agenti[], int numero) {
+    unsigned int liberi = 0;
+    for (int i = 0; i < numero; i++) if (agenti[i]->scegli_azione == tastiera_azione) liberi |= 1u << i;
+    return liberi;
+}
+
+// Ciclo dei round a partire da 'round', con i giocatori già posizionati:
+// ogni scelta è chiesta subito all'agente del giocatore
+static Risultato_partita ciclo_partita(Sessione* s, const Agente* agenti[], int round, int max_round) {
+    const Richiesta* r = avvia_passi(s, round, max_round);
+    while (r->tipo != richiesta_nessuna) r = partita_rispondi(s, agente_rispondi(agenti[r->giocatore], r));
+    return s->passo.risultato;
+}
+
+// Inizio partita, comune al gioco interattivo, al motore headless e alla partita a passi
+static void prepara_partita(Sessione* s) {
+    s->gioco_terminato = 0;
+    s->indice_vincitore = -1;
+    memset(s->ucciso_da, 0, sizeof(s->ucciso_da));
+    // Mappa pigra: la prima zona e la successiva devono essere in lista
+    genera_fino(s, 2);
+
+    // Posiziona i giocatori all'inizio
+    for(int i=0; i<s->numero_giocatori; i++) {
+        if(s->giocatori[i] != NULL) {
+            s->giocatori[i]->pos_mondoreale = s->prima_zona_mondoreale;
+            s->giocatori[i]->pos_soprasotto = s->prima_zona_soprasotto;
+            s->giocatori[i]->mondo = 0; 
+        }
+    }
+
+    stampa("\n--- INIZIO PARTITA ---\n");
+
+    // Le scelte finiscono nel diario da partita_rispondi
+    if (s->percorso_registrazione != NULL) inizia_registrazione(s);
+}
+
+static Risultato_partita esegui_partita(Sessione* s, const Agente* agenti[], int max_round) {
+    s->passo.liberi = giocatori_tastiera(agenti, s->numero_giocatori); // Prima del diario, che lo registra
+    prepara_partita(s);
+    return ciclo_partita(s, agenti, 1, max_round);
 }
 
 // ============================================================================
@@ -684,121 +2222,335 @@ static void menu_turno_giocatore(struct Giocatore* g) {
 // ============================================================================
 
 // Imposta il gioco (Giocatori e Mappa)
-void imposta_gioco() {
-    if (numero_giocatori > 0 || prima_zona_mondoreale != NULL) dealloca_tutto();
+void imposta_gioco(Sessione* s) {
+    if (s->numero_giocatori > 0 || s->prima_zona_mondoreale != NULL) dealloca_tutto(s);
 
-    printf("\n--- IMPOSTAZIONE GIOCO ---\n");
+    stampa("\n--- IMPOSTAZIONE GIOCO ---\n");
     // Input numero giocatori
     do {
-        printf("Numero giocatori (1-4): ");
-        if (scanf("%d", &numero_giocatori) != 1) { pulisci_buffer(); continue; }
-    } while (numero_giocatori < 1 || numero_giocatori > 4);
+        stampa("Numero giocatori (1-4): ");
+        if (ingresso_intero(&s->numero_giocatori) != 1) { pulisci_buffer(); continue; }
+    } while (s->numero_giocatori < 1 || s->numero_giocatori > 4);
     pulisci_buffer();
 
     // Creazione giocatori
-    for (int i = 0; i < numero_giocatori; i++) {
-        printf("--- Giocatore %d ---\n", i + 1);
-        giocatori[i] = (struct Giocatore*) malloc(sizeof(struct Giocatore));
-        giocatori[i]->mondo = 0; // Parte nel mondo reale
-        for(int k=0; k<3; k++) giocatori[i]->zaino[k] = nessun_oggetto;
+    for (int i = 0; i < s->numero_giocatori; i++) {
+        stampa("--- Giocatore %d ---\n", i + 1);
+        s->giocatori[i] = crea_giocatore();
         
-        printf("Nome: "); fgets(giocatori[i]->nome, 100, stdin); 
-        giocatori[i]->nome[strcspn(giocatori[i]->nome, "\n")] = 0;
+        stampa("Nome: "); ingresso_riga(s->giocatori[i]->nome, sizeof(s->giocatori[i]->nome));
 
-        giocatori[i]->attacco_pischico = casuale(1, 20);
-        giocatori[i]->difesa_pischica = casuale(1, 20);
-        giocatori[i]->fortuna = casuale(1, 20);
+        tira_statistiche(s, s->giocatori[i]);
 
-        printf("Stats: Atk %d, Def %d, Luck %d\n", giocatori[i]->attacco_pischico, giocatori[i]->difesa_pischica, giocatori[i]->fortuna);
+        stampa("Stats: Atk %d, Def %d, Luck %d\n", s->giocatori[i]->attacco_pischico, s->giocatori[i]->difesa_pischica, s->giocatori[i]->fortuna);
         
         // Modifiche statistiche e classe Undici
-        printf("Modifiche: 0) No, 1) +3/-3, 2) -3/+3");
-        if (!undici_preso) printf(", 3) Undici Special");
-        printf("\nScelta: "); int sc; scanf("%d", &sc); pulisci_buffer();
-
-        if (sc == 1) { giocatori[i]->attacco_pischico += 3; giocatori[i]->difesa_pischica -= 3; }
-        else if (sc == 2) { giocatori[i]->attacco_pischico -= 3; giocatori[i]->difesa_pischica += 3; }
-        else if (sc == 3 && !undici_preso) {
-            giocatori[i]->attacco_pischico += 4; giocatori[i]->difesa_pischica += 4; giocatori[i]->fortuna -= 7;
-            strcpy(giocatori[i]->nome, "Undici VirgolaCinque"); undici_preso = 1;
-        }
+        stampa("Modifiche: 0) No, 1) +3/-3, 2) -3/+3");
+        if (!s->undici_preso) stampa(", 3) Undici Special");
+        stampa("\nScelta: "); int sc = 0; ingresso_intero(&sc); pulisci_buffer();
+
+        applica_modifica(s, s->giocatori[i], (Modifica_statistiche) sc);
     }
 
     // Menu gestione mappa
     int sm = 0;
     do {
-        printf("\n--- CREAZIONE MAPPA ---\n");
-        printf("1) Genera Casuale\n2) Inserisci Zona\n3) Cancella Zona\n4) Stampa\n5) Dettaglio\n6) Chiudi Mappa\nScelta: ");
-        scanf("%d", &sm); pulisci_buffer();
+        stampa("\n--- CREAZIONE MAPPA ---\n");
+        stampa("1) Genera Casuale\n2) Inserisci Zona\n3) Cancella Zona\n4) Stampa\n5) Dettaglio\n6) Chiudi Mappa\n7) Statistiche Memoria\n8) Genera Personalizzata\n9) Importa da File\n10) Esporta su File\n11) Genera Pigra\nScelta: ");
+        ingresso_intero(&sm); pulisci_buffer();
         switch(sm) {
-            case 1: genera_mappa(); break;
-            case 2: inserisci_zona(); break;
-            case 3: cancella_zona(); break;
-            case 4: stampa_mappa_debug(); break;
-            case 5: stampa_dettaglio_zona(); break;
-            case 6: chiudi_mappa(); break;
+            case 1: genera_mappa(s); break;
+            case 2: inserisci_zona(s); break;
+            case 3: cancella_zona(s); break;
+            case 4: stampa_mappa_debug(s); break;
+            case 5: stampa_dettaglio_zona(s); break;
+            case 6: chiudi_mappa(s); break;
+            case 7: stampa_statistiche_pool(s); break;
+            case 8: genera_mappa_personalizzata(s, 0); break;
+            case 9: importa_mappa(s); break;
+            case 10: esporta_mappa(s); break;
+            case 11: genera_mappa_personalizzata(s, 1); break;
         }
-    } while (!gioco_pronto);
+    } while (!s->gioco_pronto);
 }
 
 // Avvia la partita vera e propria
-void gioca() {
-    if (!gioco_pronto) { printf("Errore: Gioco non impostato.\n"); return; }
-    gioco_terminato = 0;
+void gioca(Sessione* s) {
+    if (!s->gioco_pronto) { stampa("Errore: Gioco non impostato.\n"); return; }
+
+    // Il gioco interattivo è il motore con gli agenti da tastiera (e i bot MCTS)
+    Agente tastiera = agente_tastiera;
+    tastiera.dati = s;
+    const Agente* agenti[4] = { &tastiera, &tastiera, &tastiera, &tastiera };
+    Agente bot;
+    if (s->mcts != NULL) {
+        bot = agente_mcts(s->mcts, s);
+        for (int i = 0; i < 4; i++) if (s->bot_mcts & (1u << i)) agenti[i] = &bot;
+    }
+    // Senza giocatori da tastiera nessuno può interrompere la partita
+    int umani = 0;
+    for (int i = 0; i < s->numero_giocatori; i++) if (agenti[i] == &tastiera) umani++;
+    esegui_partita(s, agenti, umani > 0 ? 0 : MAX_ROUND_BOT);
+}
 
-    // Posiziona i giocatori all'inizio
-    for(int i=0; i<numero_giocatori; i++) {
-        if(giocatori[i] != NULL) {
-            giocatori[i]->pos_mondoreale = prima_zona_mondoreale;
-            giocatori[i]->pos_soprasotto = prima_zona_soprasotto;
-            giocatori[i]->mondo = 0; 
+// Termina il gioco e pulisce
+void termina_gioco(Sessione* s) {
+    stampa("Arrivederci!\n");
+    if (s->registrazione != NULL) termina_registrazione(s, NULL); // Partita interrotta: il diario resta utilizzabile
+    dealloca_tutto(s);
+    pool_rilascia(&s->pool_zone); // Restituisce al sistema anche i blocchi delle zone
+}
+
+// Mostra i crediti e l'albo d'oro
+// (con una classifica collegata anche i migliori di sempre: interrogazioni
+// sull'indice, il log non viene riletto)
+void crediti(Sessione* s) {
+    stampa("\n--- CREDITI ---\n");
+    stampa("Sviluppato da: Luca Terzino\n");
+    stampa("\n--- ALBO D'ORO (Ultimi 3 Vincitori) ---\n");
+    for(int i=0; i<3; i++) stampa("%d. %s\n", i+1, s->albo_doro[i]);
+    if (classifica_albo == NULL) return;
+
+    Statistiche_vincitore migliori[10];
+    size_t n = classifica_migliori(classifica_albo, migliori, 10);
+    stampa("\n--- CLASSIFICA (%llu vittorie, %zu vincitori) ---\n",
+           (unsigned long long) classifica_vittorie(classifica_albo), classifica_giocatori(classifica_albo));
+    for (size_t i = 0; i < n; i++)
+        stampa("%2zu. %-20s %6llu vittorie | round: migliore %d, media %.1f\n", i + 1, migliori[i].nome,
+               (unsigned long long) migliori[i].vittorie, migliori[i].round_minimo,
+               (double) migliori[i].round_totali / (double) migliori[i].vittorie);
+    Vittoria_registrata recenti[5];
+    n = classifica_recenti(classifica_albo, recenti, 5);
+    if (n > 0) stampa("Ultime vittorie:");
+    for (size_t i = 0; i < n; i++) stampa("%s %s (%d round)", i ? "," : "", recenti[i].nome, recenti[i].round);
+    if (n > 0) stampa("\n");
+}
+
+// Destinazioni dell'esportazione dei contatori
+static void scrivi_schermo(const char* testo, size_t n, void* dati) {
+    (void) dati;
+    if (verbosita_uscita >= verbosita_normale) uscita_scrivi(testo, n);
+}
+
+static void scrivi_file(const char* testo, size_t n, void* dati) {
+    fwrite(testo, 1, n, (FILE*) dati);
+}
+
+// Mostra, esporta o azzera i contatori e i tempi di esecuzione (vedi contatori.h)
+void statistiche_esecuzione() {
+    if (!contatori_attivi()) { contatori_esporta(formato_testo, scrivi_schermo, NULL); return; }
+    stampa("\n--- STATISTICHE DI ESECUZIONE ---\n");
+    stampa("1) Mostra\n2) Mostra in JSON\n3) Esporta su file\n4) Azzera\n");
+    stampa("Scelta: ");
+    int scelta = 0;
+    ingresso_intero(&scelta); pulisci_buffer();
+    switch (scelta) {
+        case 1: contatori_esporta(formato_testo, scrivi_schermo, NULL); break;
+        case 2: contatori_esporta(formato_json, scrivi_schermo, NULL); break;
+        case 3: {
+            char percorso[256];
+            int json = 0;
+            stampa("Nome del file: "); ingresso_parola(percorso, sizeof(percorso));
+            stampa("Formato (0 = testo, 1 = JSON): "); ingresso_intero(&json); pulisci_buffer();
+            FILE* f = fopen(percorso, "w");
+            if (f == NULL) { stampa("Errore: impossibile aprire %s.\n", percorso); break; }
+            contatori_esporta(json ? formato_json : formato_testo, scrivi_file, f);
+            if (fclose(f) != 0) stampa("Errore: scrittura di %s non riuscita.\n", percorso);
+            else stampa("Statistiche esportate in %s.\n", percorso);
+            break;
         }
+        case 4: contatori_azzera(); stampa("Statistiche azzerate.\n"); break;
+        default: stampa("Scelta non valida.\n");
     }
+}
 
-    printf("\n--- INIZIO PARTITA ---\n");
+// Salva la partita corrente in un file scelto dall'utente
+void salva_gioco(Sessione* s) {
+    char percorso[256];
+    stampa("Nome del file: "); ingresso_parola(percorso, sizeof(percorso)); pulisci_buffer();
+    Esito_salvataggio e = partita_salva(s, percorso);
+    if (e == salvataggio_ok) stampa("Partita salvata in %s.\n", percorso);
+    else stampa("Errore: %s.\n", salvataggio_messaggio(e));
+}
 
-    int round = 1;
-    // Ciclo principale dei round
-    while (!gioco_terminato) {
-        printf("\n=== ROUND %d ===\n", round++);
-        
-        // Determina ordine casuale dei turni
-        int ordine[4] = {0, 1, 2, 3};
-        for (int i = 0; i < numero_giocatori; i++) {
-            int j = casuale(i, numero_giocatori - 1);
-            int temp = ordine[i];
-            ordine[i] = ordine[j];
-            ordine[j] = temp;
-        }
+// Sostituisce la partita corrente con quella salvata nel file
+void carica_gioco(Sessione* s) {
+    char percorso[256];
+    stampa("Nome del file: "); ingresso_parola(percorso, sizeof(percorso)); pulisci_buffer();
+    Esito_salvataggio e = partita_carica(s, percorso);
+    if (e == salvataggio_ok) stampa("Partita caricata (%d zone, %s).\n", conta_zone(s), s->gioco_pronto ? "pronta" : "mappa da chiudere");
+    else stampa("Errore: %s.\n", salvataggio_messaggio(e));
+}
 
-        // Esegui turni
-        for (int i = 0; i < numero_giocatori; i++) {
-            int idx = ordine[i];
-            if (giocatori[idx] == NULL) continue;
-            menu_turno_giocatore(giocatori[idx]);
-            if (gioco_terminato) break;
-        }
-        
-        // Verifica game over per morte totale
-        int vivi = 0;
-        for(int k=0; k<numero_giocatori; k++) if(giocatori[k] != NULL) vivi++;
-        if(vivi == 0 && numero_giocatori > 0) {
-            printf("Tutti morti. Game Over.\n");
-            gioco_terminato = 1;
-        }
+// ============================================================================
+// SESSIONI
+// ============================================================================
+
+Sessione* sessione_crea(unsigned long long seme) {
+    Sessione* s = (Sessione*) calloc(1, sizeof(Sessione));
+    if (s == NULL) return NULL;
+    Pool_zone pool = POOL_ZONE_INIT;
+    Indice_zone indice = INDICE_ZONE_INIT;
+    s->pool_zone = pool;
+    s->indice_zone = indice;
+    for (int i = 0; i < 3; i++) strcpy(s->albo_doro[i], "-");
+    rng_semina(&s->rng_gioco, seme);
+    s->indice_vincitore = -1;
+    s->round_visibile = 1;
+    return s;
+}
+
+void sessione_distruggi(Sessione* s) {
+    if (s == NULL) return;
+    if (s->registrazione != NULL) termina_registrazione(s, NULL);
+    dealloca_giocatori(s);
+    dealloca_mappa(s);
+    pool_rilascia(&s->pool_zone);
+    free(s->percorso_registrazione);
+    free(s->zone_modificate);
+    free(s->modifiche_fotogramma);
+    for (int i = 0; i < 4; i++) politica_distruggi(s->politiche[i].politica);
+    free(s);
+}
+
+// ============================================================================
+// MOTORE HEADLESS (API PUBBLICA)
+// ============================================================================
+
+void gioco_semina(Sessione* s, unsigned long long seme) {
+    rng_semina(&s->rng_gioco, seme);
+}
+
+void motore_silenzioso(int attivo) {
+    uscita_imposta_verbosita(attivo ? verbosita_silenziosa : verbosita_normale);
+}
+
+void motore_albo_condiviso(Sessione* s, int attivo) {
+    s->fuori_albo = !attivo;
+}
+
+// Equivalente di imposta_gioco senza input: stessi tiri e stesse modifiche
+void motore_imposta_giocatori(Sessione* s, int numero, const char* nomi[], const Modifica_statistiche modifiche[]) {
+    if (s->numero_giocatori > 0 || s->prima_zona_mondoreale != NULL) dealloca_tutto(s);
+    if (numero < 1) numero = 1;
+    if (numero > 4) numero = 4;
+    s->numero_giocatori = numero;
+
+    for (int i = 0; i < s->numero_giocatori; i++) {
+        s->giocatori[i] = crea_giocatore();
+        snprintf(s->giocatori[i]->nome, sizeof(s->giocatori[i]->nome), "%s", nomi ? nomi[i] : "Bot");
+        tira_statistiche(s, s->giocatori[i]);
+        applica_modifica(s, s->giocatori[i], modifiche ? modifiche[i] : modifica_nessuna);
     }
 }
 
-// Termina il gioco e pulisce
-void termina_gioco() {
-    printf("Arrivederci!\n");
-    dealloca_tutto();
+int mappa_chiudi(Sessione* s) {
+    s->gioco_pronto = 0;
+    chiudi_mappa(s);
+    return s->gioco_pronto;
 }
 
-// Mostra i crediti e l'albo d'oro
-void crediti() {
-    printf("\n--- CREDITI ---\n");
-    printf("Sviluppato da: Luca Terzino\n");
-    printf("\n--- ALBO D'ORO (Ultimi 3 Vincitori) ---\n");
-    for(int i=0; i<3; i++) printf("%d. %s\n", i+1, albo_doro[i]);
+void mappa_libera(Sessione* s) {
+    dealloca_mappa(s);
+    s->gioco_pronto = 0;
+}
+
+Esito_scontro motore_scontro(Sessione* s, struct Giocatore* g, Tipo_nemico nemico, const Agente* a) {
+    if (nemico < billi || nemico > demotorzone) return scontro_vinto;
+    // Lo scontro passa dalla macchina a passi: lo stato della partita si conserva
+    Stato_passo salvato = s->passo;
+    s->passo.solo_scontro = 1;
+    s->passo.liberi = 0;
+    inizia_scontro(s, g, nemico);
+    const Richiesta* r = prosegui(s);
+    while (r->tipo != richiesta_nessuna) r = partita_rispondi(s, agente_rispondi(a, r));
+    Esito_scontro esito = s->passo.esito;
+    s->passo = salvato;
+    return esito;
+}
+
+int motore_genera_mappa(Sessione* s) {
+    genera_mappa(s);
+    chiudi_mappa(s);
+    return s->gioco_pronto;
+}
+
+Risultato_partita motore_gioca(Sessione* s, const Agente* agenti[], int max_round) {
+    if (!s->gioco_pronto) {
+        Risultato_partita r = { esito_limite_round, -1, 0, { nessun_nemico } };
+        return r;
+    }
+    return esegui_partita(s, agenti, max_round);
+}
+
+const Richiesta* partita_inizia(Sessione* s, int max_round) {
+    if (!s->gioco_pronto) {
+        Risultato_partita nessuno = { esito_limite_round, -1, 0, { nessun_nemico } };
+        s->passo.risultato = nessuno;
+        s->passo.fase = passo_fermo;
+        return prosegui(s);
+    }
+    s->passo.liberi = 0; // Giocatori in rete o bot: i limiti valgono per tutti
+    prepara_partita(s);
+    return avvia_passi(s, 1, max_round);
+}
+
+Risultato_partita partita_risultato(const Sessione* s) {
+    return s->passo.risultato;
+}
+
+// ============================================================================
+// SESSIONI IN PARALLELO
+// ============================================================================
+
+void albo_collega_classifica(Classifica* c) {
+    classifica_albo = c;
+}
+
+Albo_condiviso albo_condiviso_leggi(void) {
+    pthread_mutex_lock(&mutex_albo);
+    Albo_condiviso copia = albo_condiviso;
+    pthread_mutex_unlock(&mutex_albo);
+    return copia;
+}
+
+// Compito del pianificatore: una partita dall'inizio alla fine in una sessione propria
+static void gioca_partita_parallela(void* dati) {
+    Partita_parallela* pp = (Partita_parallela*) dati;
+    Risultato_partita nessuno = { esito_limite_round, -1, 0, { nessun_nemico } };
+    pp->risultato = nessuno;
+    pp->ok = 0;
+
+    // Il buffer di uscita è unico: le partite in parallelo non stampano
+    Verbosita verbosita = verbosita_uscita;
+    uscita_imposta_verbosita(verbosita_silenziosa);
+    Sessione* s = sessione_crea(pp->seme);
+    if (s != NULL) {
+        const char* nomi[4];
+        for (int i = 0; i < 4; i++) nomi[i] = pp->nomi[i] ? pp->nomi[i] : "Bot";
+        motore_imposta_giocatori(s, pp->numero_giocatori, nomi, NULL);
+
+        // Come genera_mappa, ma un thread per mappa: il parallelismo è tra le partite
+        Parametri_mappa p = PARAMETRI_MAPPA_DEFAULT;
+        if (pp->zone > 0) p.zone = pp->zone;
+        p.seme = rng_prossimo(&s->rng_gioco);
+        p.thread = 1;
+        if (mappa_genera(s, &p) && mappa_chiudi(s)) {
+            pp->risultato = motore_gioca(s, pp->agenti, pp->max_round);
+            pp->ok = 1;
+        }
+        sessione_distruggi(s);
+    }
+    uscita_imposta_verbosita(verbosita);
+}
+
+size_t sessioni_gioca(Pianificatore* p, Partita_parallela* partite, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        // Senza pianificatore (o senza memoria per accodare) si gioca qui
+        if (p == NULL || !pianificatore_invia(p, gioca_partita_parallela, &partite[i])) gioca_partita_parallela(&partite[i]);
+    }
+    if (p != NULL) pianificatore_attendi(p);
+    size_t giocate = 0;
+    for (size_t i = 0; i < n; i++) giocate += partite[i].ok ? 1 : 0;
+    return giocate;
 }
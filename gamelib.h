@@ -56,10 +56,244 @@ typedef struct Giocatore {
     Tipo_oggetto zaino[3]; // Array di 3 oggetti 
 } Giocatore;
 
+// Stato completo di una partita (definito in gamelib.c). Ogni funzione del
+// gioco lavora sulla sessione ricevuta: sessioni diverse sono indipendenti e
+// possono essere usate in parallelo, ciascuna da un thread alla volta
+typedef struct Sessione Sessione;
+
+// Statistiche di combattimento dei nemici
+typedef struct Statistiche_nemico {
+    int hp;
+    int attacco;
+    int difesa;
+} Statistiche_nemico;
+
+// Indicizzata per Tipo_nemico (nessun_nemico ha tutto a zero)
+extern const Statistiche_nemico statistiche_nemici[4];
+
+// Nomi leggibili dei valori degli enum ("Ignoto" se fuori intervallo)
+const char* nome_zona(Tipo_zona t);
+const char* nome_nemico(Tipo_nemico t);
+const char* nome_oggetto(Tipo_oggetto t);
+
+// Crea una sessione vuota con il generatore inizializzato dal seme (NULL se
+// manca la memoria) e la distrugge liberando tutto
+Sessione* sessione_crea(unsigned long long seme);
+void sessione_distruggi(Sessione* s);
+
 // Prototipi delle funzioni pubbliche 
-void imposta_gioco();
-void gioca();
-void termina_gioco();
-void crediti();
+void imposta_gioco(Sessione* s);
+void gioca(Sessione* s);
+void termina_gioco(Sessione* s);
+void crediti(Sessione* s);
+void statistiche_esecuzione(); // Contatori e tempi del processo (vedi contatori.h)
+void salva_gioco(Sessione* s);
+void carica_gioco(Sessione* s);
+
+// ============================================================================
+// MOTORE HEADLESS (AGENTI)
+// ============================================================================
+// Le regole di gioco sono indipendenti da chi prende le decisioni: ogni scelta
+// (azione di turno, sottomenu di combattimento, oggetto dello zaino) viene
+// chiesta a un Agente. Il gioco interattivo usa l'agente da tastiera, le
+// simulazioni usano bot senza alcun I/O su terminale.
+
+typedef struct Agente {
+    // Azione del menu di turno (1-9, stessa numerazione del menu interattivo)
+    int (*scegli_azione)(struct Giocatore* g, int movimento_fatto, void* dati);
+    // Sottomenu di combattimento: 1 = Attacco Pischico, 2 = Utilizza Oggetto
+    int (*scegli_combattimento)(struct Giocatore* g, Tipo_nemico nemico, int hp_giocatore, int hp_nemico, void* dati);
+    // Slot dello zaino da usare (1-3), 0 per annullare
+    int (*scegli_oggetto)(struct Giocatore* g, int in_combattimento, void* dati);
+    void* dati; // Stato privato dell'agente, passato a ogni callback
+} Agente;
+
+// Modifiche alle statistiche offerte da imposta_gioco
+typedef enum {
+    modifica_nessuna, modifica_attacco, modifica_difesa, modifica_undici
+} Modifica_statistiche;
+
+typedef enum {
+    esito_vittoria,     // Un giocatore ha sconfitto il Demotorzone
+    esito_sconfitta,    // Tutti i giocatori sono morti
+    esito_limite_round  // Raggiunto il numero massimo di round
+} Esito_partita;
+
+typedef struct Risultato_partita {
+    Esito_partita esito;
+    int vincitore; // Indice del giocatore vincitore (-1 se nessuno)
+    int round;     // Round giocati
+    Tipo_nemico ucciso_da[4]; // Nemico che ha ucciso il giocatore i (nessun_nemico se non è morto)
+} Risultato_partita;
+
+typedef enum {
+    scontro_vinto,
+    scontro_perso,    // Il giocatore è morto
+    scontro_ritirata  // Raggiunto il limite di scambi
+} Esito_scontro;
+
+// Parametri per generare una mappa casuale di dimensione arbitraria.
+// Le percentuali sono 0-100; nel Mondo Reale Democane + Billi <= 100
+typedef struct Parametri_mappa {
+    size_t zone;             // Numero di zone (1 - INT_MAX)
+    int mr_democane;         // % zone MR con un Democane
+    int mr_billi;            // % zone MR con un Billi
+    int ss_democane;         // % zone SS con un Democane (il Demotorzone è a parte)
+    int oggetti;             // % zone MR con un oggetto
+    unsigned long long seme; // Stesso seme e parametri -> stessa mappa
+    int thread;              // Thread da usare, 0 = tutti i core
+} Parametri_mappa;
+
+// Valori di genera_mappa: 15 zone, MR 60/30/10, SS 60/40, oggetti al 50%
+#define PARAMETRI_MAPPA_DEFAULT { 15, 30, 10, 40, 50, 0, 0 }
+
+// Agenti predefiniti
+extern const Agente agente_tastiera;  // Legge le scelte da stdin (gioco interattivo)
+extern const Agente agente_esploratore; // Bot: va nel Soprasotto e avanza combattendo
+Agente agente_casuale(unsigned int* seme); // Bot: scelte casuali (stato in *seme)
+Agente agente_ottimo(Sessione* s); // Bot: segue partita_consiglio nella sessione s
+extern const Agente agente_corridore;    // Bot: subito nel Soprasotto, avanza e combatte solo se bloccato
+extern const Agente agente_combattente;  // Bot: combatte ogni nemico della zona, in tutti e due i mondi
+extern const Agente agente_collezionista; // Bot: riempie lo zaino nel Mondo Reale e usa gli oggetti negli scontri
+extern const Agente agente_saltatore;    // Bot: cambia mondo per evitare i nemici, combatte solo il Demotorzone
+
+// Imposta il seme del generatore della partita: stesso seme, stessa partita
+void gioco_semina(Sessione* s, unsigned long long seme);
+// Disattiva (1) o riattiva (0) tutte le stampe del gioco nel thread corrente
+void motore_silenzioso(int attivo);
+// Registra (1, predefinito) o no (0) le vittorie della sessione nell'albo
+// condiviso e nella classifica: le simulazioni di massa non vanno nell'albo
+void motore_albo_condiviso(Sessione* s, int attivo);
+// Crea i giocatori senza input: nomi e modifiche sono scelti dal chiamante
+void motore_imposta_giocatori(Sessione* s, int numero, const char* nomi[], const Modifica_statistiche modifiche[]);
+// Genera la mappa casuale e la chiude. Restituisce 1 se il gioco è pronto
+int motore_genera_mappa(Sessione* s);
+// Modifica della mappa senza input (posizioni 0-based come nel menu).
+// Restituiscono 1 se l'operazione è riuscita, 0 se la posizione non è valida
+int mappa_inserisci_zona(Sessione* s, int posizione, Tipo_zona tipo, Tipo_nemico nemico_mr, Tipo_oggetto oggetto, Tipo_nemico nemico_ss);
+int mappa_cancella_zona(Sessione* s, int posizione);
+int mappa_conta_zone(const Sessione* s);
+// Posizione della zona più vicina dopo (direzione > 0) o prima (direzione < 0)
+// di posizione con quel nemico nel mondo dato (0 MR, 1 SS) o quell'oggetto,
+// -1 se non c'è. posizione può valere -1 o il numero di zone per cercare
+// dall'inizio o dalla fine. O(log n) con l'indice posizionale; nelle zone
+// di una mappa pigra non ancora generate O(1) per il Demotorzone, altrimenti
+// proporzionale alla distanza
+int mappa_cerca_nemico(const Sessione* s, int posizione, int direzione, int mondo, Tipo_nemico nemico);
+int mappa_cerca_oggetto(const Sessione* s, int posizione, int direzione, Tipo_oggetto oggetto);
+// Conteggi del contenuto della mappa, aggiornati a ogni modifica: leggerli
+// (e chiudere la mappa) costa O(1) a qualunque dimensione
+typedef struct Conteggi_mappa {
+    size_t zone;         // Zone in memoria (gli altri campi contano solo queste)
+    size_t nemici_mr[4]; // Indicizzato per Tipo_nemico
+    size_t nemici_ss[4];
+    size_t oggetti[5];   // Indicizzato per Tipo_oggetto
+    size_t fuori_range;  // Campi con valori fuori dai loro enum
+    size_t da_generare;  // Zone di una mappa pigra non ancora generate
+} Conteggi_mappa;
+void mappa_conteggi(const Sessione* s, Conteggi_mappa* c);
+// Convalida la mappa come "Chiudi Mappa". Restituisce 1 se il gioco è pronto
+int mappa_chiudi(Sessione* s);
+// Libera tutte le zone (i blocchi del pool restano per le mappe successive)
+void mappa_libera(Sessione* s);
+// Sostituisce la mappa con una generata dai parametri (la mappa va richiusa).
+// Restituisce 1 se riuscita, 0 se i parametri non sono validi o manca memoria
+int mappa_genera(Sessione* s, const Parametri_mappa* parametri);
+// Come mappa_genera, ma la mappa è pigra: il contenuto della zona i dipende
+// solo da (seme, i) e una zona entra in memoria solo quando un giocatore la
+// raggiunge (o quando la si modifica). Generarla costa O(1) e la memoria è
+// proporzionale alle zone visitate; esportarla la calcola tutta
+int mappa_genera_pigra(Sessione* s, const Parametri_mappa* parametri);
+// Un solo scontro di g contro il nemico, senza effetti su mappa e giocatori
+// della partita (il giocatore sconfitto non viene rimosso)
+Esito_scontro motore_scontro(Sessione* s, struct Giocatore* g, Tipo_nemico nemico, const Agente* a);
+// Gioca una partita completa: agenti[i] decide per il giocatore i.
+// max_round <= 0 significa nessun limite
+Risultato_partita motore_gioca(Sessione* s, const Agente* agenti[], int max_round);
+
+// ============================================================================
+// PARTITA A PASSI
+// ============================================================================
+// La stessa partita di motore_gioca, ma senza agenti: il motore si ferma a
+// ogni scelta e restituisce la richiesta, la risposta lo fa ripartire. Chi
+// gioca in rete non tiene occupato un thread mentre decide.
+
+typedef enum {
+    richiesta_nessuna,       // Partita finita: vedi partita_risultato
+    richiesta_azione,        // Menu di turno (1-9)
+    richiesta_combattimento, // Sottomenu di combattimento (1-2)
+    richiesta_oggetto        // Slot dello zaino (1-3, 0 per annullare)
+} Tipo_richiesta;
+
+typedef struct Richiesta {
+    Tipo_richiesta tipo;
+    int giocatore;           // Indice del giocatore che deve scegliere
+    struct Giocatore* g;
+    int movimento_fatto;     // Azione: movimento già fatto nel turno
+    Tipo_nemico nemico;      // Combattimento: nemico e HP correnti
+    int hp_giocatore, hp_nemico;
+    int in_combattimento;    // Oggetto: scelto durante uno scontro
+} Richiesta;
+
+// Inizia la partita con la mappa chiusa (max_round come motore_gioca) e
+// restituisce la prima richiesta. La richiesta sta nella sessione e vale
+// fino alla prossima chiamata
+const Richiesta* partita_inizia(Sessione* s, int max_round);
+// Risponde alla richiesta in sospeso e restituisce la prossima
+const Richiesta* partita_rispondi(Sessione* s, int scelta);
+Risultato_partita partita_risultato(const Sessione* s);
+// Chiede la risposta all'agente (la callback che corrisponde al tipo)
+int agente_rispondi(const Agente* a, const Richiesta* r);
+// Stampa il menu che l'agente da tastiera mostra prima della scelta
+void partita_stampa_richiesta(const Richiesta* r);
+
+// ============================================================================
+// POLITICA OTTIMA
+// ============================================================================
+// Azione del menu di turno che massimizza la probabilità di vittoria del
+// giocatore g dalla sua posizione, come se fosse solo sulla mappa (vedi
+// politica.h). In *vittoria (se non NULL) la probabilità seguendo la
+// politica. Restituisce 0 se la mappa non è pronta o g non è in partita
+int partita_consiglio(Sessione* s, const struct Giocatore* g, int movimento_fatto, double* vittoria);
+// Mostra (1) o nasconde (0) il consiglio nel menu di turno del gioco interattivo
+void partita_mostra_consigli(Sessione* s, int attivo);
+
+// ============================================================================
+// SESSIONI IN PARALLELO
+// ============================================================================
+
+// Albo dei vincitori condiviso da tutte le sessioni del processo
+typedef struct Albo_condiviso {
+    char nomi[3][100];            // Ultimi 3 vincitori, il più recente per primo
+    unsigned long long vittorie;  // Vittorie totali
+} Albo_condiviso;
+
+// Copia coerente dell'albo (sicura con sessioni in corso su altri thread)
+Albo_condiviso albo_condiviso_leggi(void);
+
+typedef struct Classifica Classifica; // Vedi classifica.h
+// Registra d'ora in poi ogni vittoria anche nella classifica persistente e
+// la mostra nei crediti (NULL per scollegarla). Da chiamare prima di avviare
+// le sessioni
+void albo_collega_classifica(Classifica* c);
+
+typedef struct Pianificatore Pianificatore; // Vedi pianificatore.h
+
+// Una partita headless da giocare in una sessione propria
+typedef struct Partita_parallela {
+    unsigned long long seme;     // Stesso seme e agenti -> stesso risultato
+    int numero_giocatori;        // 1-4
+    const char* nomi[4];         // NULL per "Bot"
+    const Agente* agenti[4];     // Gli agenti con stato non vanno condivisi tra partite
+    size_t zone;                 // Zone della mappa (0 = 15 come genera_mappa)
+    int max_round;               // <= 0 per nessun limite
+    Risultato_partita risultato; // Compilato da sessioni_gioca
+    int ok;                      // 0 se la partita non è partita (memoria, mappa)
+} Partita_parallela;
+
+// Gioca le n partite sui thread del pianificatore (NULL: nel thread corrente)
+// e attende che finiscano. I risultati non dipendono dal numero di thread.
+// Restituisce le partite giocate
+size_t sessioni_gioca(Pianificatore* p, Partita_parallela* partite, size_t n);
 
 #endif
@@ -0,0 +1,194 @@
+#define _POSIX_C_SOURCE 200809L
+#include "generatore.h"
+#include "rng.h"
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
+
+// Flussi del generatore a contatore: uno per campo, così aggiungere o
+// togliere un campo non cambia gli altri
+enum {
+    FLUSSO_TIPO = 1, FLUSSO_NEMICO_MR, FLUSSO_NEMICO_SS, FLUSSO_PRESENZA_OGGETTO, FLUSSO_OGGETTO, FLUSSO_BOSS
+};
+
+// Sotto questa soglia di zone per thread non conviene creare thread
+#define ZONE_PER_THREAD_MIN 65536
+#define MAX_THREAD 256
+// L'indice viene diviso in 2^PROFONDITA_PARALLELA sottoalberi indipendenti,
+// almeno uno per thread
+#define PROFONDITA_PARALLELA 8
+#define MAX_SOTTOALBERI (1 << PROFONDITA_PARALLELA)
+
+// ============================================================================
+// CONTENUTO DELLE ZONE
+// ============================================================================
+
+int generatore_parametri_validi(const Parametri_mappa* p) {
+    if (p->zone < 1 || p->zone > (size_t) INT_MAX) return 0; // Le posizioni della mappa sono int
+    if (p->mr_democane < 0 || p->mr_billi < 0 || p->ss_democane < 0 || p->oggetti < 0) return 0;
+    if (p->mr_democane + p->mr_billi > 100 || p->ss_democane > 100 || p->oggetti > 100) return 0;
+    return 1;
+}
+
+void generatore_zona(const Parametri_mappa* p, size_t i, Tipo_zona* tipo,
+                     Tipo_nemico* nemico_mr, Tipo_oggetto* oggetto, Tipo_nemico* nemico_ss) {
+    uint64_t seme = p->seme;
+    *tipo = (Tipo_zona) rng_contatore_limitato(seme, FLUSSO_TIPO, i, 10);
+
+    int r = (int) rng_contatore_limitato(seme, FLUSSO_NEMICO_MR, i, 100);
+    if (r < p->mr_democane) *nemico_mr = democane;
+    else if (r < p->mr_democane + p->mr_billi) *nemico_mr = billi;
+    else *nemico_mr = nessun_nemico;
+
+    r = (int) rng_contatore_limitato(seme, FLUSSO_NEMICO_SS, i, 100);
+    *nemico_ss = (r < p->ss_democane) ? democane : nessun_nemico;
+
+    if ((int) rng_contatore_limitato(seme, FLUSSO_PRESENZA_OGGETTO, i, 100) < p->oggetti)
+        *oggetto = (Tipo_oggetto) (1 + rng_contatore_limitato(seme, FLUSSO_OGGETTO, i, 4));
+    else
+        *oggetto = nessun_oggetto;
+}
+
+size_t generatore_indice_boss(const Parametri_mappa* p) {
+    return rng_contatore_limitato(p->seme, FLUSSO_BOSS, 0, (uint32_t) p->zone);
+}
+
+// ============================================================================
+// COSTRUZIONE PARALLELA
+// ============================================================================
+
+// Sottoalbero dell'indice lasciato da costruire a un thread
+typedef struct Sottoalbero {
+    size_t lo, hi;
+    unsigned int profondita;
+    Slot_zona* padre;
+    Slot_zona** aggancio; // Dove scrivere la radice del sottoalbero
+} Sottoalbero;
+
+typedef struct Lavoro_generazione {
+    const Parametri_mappa* p;
+    Slot_zona* v;
+    size_t n, boss;
+    Sottoalbero* sottoalberi;   // Tutti i sottoalberi...
+    size_t n_sottoalberi;
+    size_t primo, passo;        // ...di cui questo thread prende primo, primo + passo, ...
+    Conteggi_mappa conteggi;    // Delle zone generate da questo thread
+} Lavoro_generazione;
+
+// Contenuto e collegamenti della zona i
+static void genera_zona(Lavoro_generazione* l, size_t i) {
+    Slot_zona* v = l->v;
+    Slot_zona* z = &v[i];
+    Tipo_zona tipo;
+    generatore_zona(l->p, i, &tipo, &z->mr.nemico, &z->mr.oggetto, &z->ss.nemico);
+    z->mr.tipo = tipo; z->ss.tipo = tipo;
+    if (i == l->boss) z->ss.nemico = demotorzone; // Il boss nasce insieme alla sua zona
+    // Il generatore produce solo valori validi
+    l->conteggi.nemici_mr[z->mr.nemico]++;
+    l->conteggi.nemici_ss[z->ss.nemico]++;
+    l->conteggi.oggetti[z->mr.oggetto]++;
+
+    z->mr.link_soprasotto = &z->ss; z->ss.link_mondoreale = &z->mr;
+    z->mr.avanti = (i + 1 < l->n) ? &v[i + 1].mr : NULL;
+    z->ss.avanti = (i + 1 < l->n) ? &v[i + 1].ss : NULL;
+    z->mr.indietro = (i > 0) ? &v[i - 1].mr : NULL;
+    z->ss.indietro = (i > 0) ? &v[i - 1].ss : NULL;
+}
+
+// Genera le zone dei livelli alti dell'indice (nel thread chiamante, in
+// anticipo) e raccoglie i sottoalberi sotto PROFONDITA_PARALLELA come lavori
+// indipendenti. nodi riceve i nodi dei livelli alti in preordine
+static void dividi_indice(Lavoro_generazione* l, size_t lo, size_t hi, unsigned int profondita, Slot_zona* padre,
+                          Slot_zona** aggancio, Sottoalbero* out, size_t* n_out, Slot_zona** nodi, size_t* n_nodi) {
+    if (lo >= hi) { *aggancio = NULL; return; }
+    if (profondita == PROFONDITA_PARALLELA) {
+        Sottoalbero s = { lo, hi, profondita, padre, aggancio };
+        out[(*n_out)++] = s;
+        return;
+    }
+    size_t medio = lo + (hi - lo) / 2;
+    Slot_zona* t = &l->v[medio];
+    genera_zona(l, medio);
+    t->padre = padre;
+    t->priorita = indice_priorita_profondita(profondita);
+    t->dimensione = (unsigned int) (hi - lo);
+    *aggancio = t;
+    nodi[(*n_nodi)++] = t;
+    dividi_indice(l, lo, medio, profondita + 1, t, &t->sx, out, n_out, nodi, n_nodi);
+    dividi_indice(l, medio + 1, hi, profondita + 1, t, &t->dx, out, n_out, nodi, n_nodi);
+}
+
+// Ogni thread genera le zone dei propri sottoalberi e poi li costruisce: le
+// maschere di presenza dell'indice leggono solo zone già scritte dallo
+// stesso thread
+static void* genera_sottoalberi(void* arg) {
+    Lavoro_generazione* l = (Lavoro_generazione*) arg;
+    for (size_t k = l->primo; k < l->n_sottoalberi; k += l->passo) {
+        Sottoalbero* s = &l->sottoalberi[k];
+        for (size_t i = s->lo; i < s->hi; i++) genera_zona(l, i);
+        *s->aggancio = indice_costruisci_sottoalbero(l->v, s->lo, s->hi, s->profondita, s->padre);
+    }
+    return NULL;
+}
+
+static int thread_da_usare(const Parametri_mappa* p) {
+    long core = p->thread > 0 ? p->thread : sysconf(_SC_NPROCESSORS_ONLN);
+    if (core < 1) core = 1;
+    long utili = (long) (p->zone / ZONE_PER_THREAD_MIN);
+    if (utili < 1) utili = 1;
+    if (core > utili) core = utili;
+    if (core > MAX_THREAD) core = MAX_THREAD;
+    return (int) core;
+}
+
+Zona_mondoreale* generatore_costruisci(Pool_zone* pool, Indice_zone* indice, const Parametri_mappa* p,
+                                       Conteggi_mappa* conteggi) {
+    size_t n = p->zone;
+    Slot_zona* v = pool_alloca_blocco(pool, n);
+    if (v == NULL) return NULL;
+
+    Sottoalbero sottoalberi[MAX_SOTTOALBERI];
+    size_t n_sottoalberi = 0;
+    Slot_zona* nodi[MAX_SOTTOALBERI]; // Livelli alti: meno di 2^PROFONDITA_PARALLELA
+    size_t n_nodi = 0;
+    Slot_zona* radice = NULL;
+    Lavoro_generazione base = { p, v, n, generatore_indice_boss(p), sottoalberi, 0, 0, 1, { 0, { 0 }, { 0 }, { 0 }, 0, 0 } };
+    dividi_indice(&base, 0, n, 0, NULL, &radice, sottoalberi, &n_sottoalberi, nodi, &n_nodi);
+
+    int t = thread_da_usare(p);
+    Lavoro_generazione lavori[MAX_THREAD];
+    pthread_t thread[MAX_THREAD];
+    for (int k = 0; k < t; k++) {
+        lavori[k] = base;
+        memset(&lavori[k].conteggi, 0, sizeof(lavori[k].conteggi));
+        lavori[k].n_sottoalberi = n_sottoalberi;
+        lavori[k].primo = (size_t) k;
+        lavori[k].passo = (size_t) t;
+    }
+
+    // Il thread chiamante prende la prima parte; se un thread non parte,
+    // il suo lavoro viene svolto qui
+    int avviati[MAX_THREAD] = {0};
+    for (int k = 1; k < t; k++)
+        avviati[k] = (pthread_create(&thread[k], NULL, genera_sottoalberi, &lavori[k]) == 0);
+    genera_sottoalberi(&lavori[0]);
+    for (int k = 1; k < t; k++) {
+        if (avviati[k]) pthread_join(thread[k], NULL);
+        else genera_sottoalberi(&lavori[k]);
+    }
+
+    // Presenza dei livelli alti: in preordine rovesciato i figli vengono prima
+    for (size_t k = n_nodi; k-- > 0; ) indice_aggiorna_presenza(nodi[k]);
+
+    *conteggi = base.conteggi;
+    for (int k = 0; k < t; k++) {
+        for (int e = 0; e < 4; e++) {
+            conteggi->nemici_mr[e] += lavori[k].conteggi.nemici_mr[e];
+            conteggi->nemici_ss[e] += lavori[k].conteggi.nemici_ss[e];
+        }
+        for (int o = 0; o < 5; o++) conteggi->oggetti[o] += lavori[k].conteggi.oggetti[o];
+    }
+    conteggi->zone = n;
+    indice_imposta_radice(indice, radice);
+    return &v[0].mr;
+}
@@ -0,0 +1,30 @@
+#ifndef GENERATORE_H
+#define GENERATORE_H
+
+#include "indice_zone.h"
+
+// ============================================================================
+// GENERAZIONE PARALLELA E DETERMINISTICA DELLA MAPPA
+// ============================================================================
+// Il contenuto della zona i dipende solo da (seme, i): ogni campo è estratto
+// dal generatore a contatore di rng.h. Le zone si possono quindi calcolare in
+// qualunque ordine e su qualunque numero di thread ottenendo sempre la stessa
+// mappa. Anche la posizione del Demotorzone è una funzione del seme, quindi
+// viene messa mentre si genera la sua zona, senza una seconda passata.
+
+// Contenuto della zona i (senza Demotorzone: vedi generatore_indice_boss)
+void generatore_zona(const Parametri_mappa* p, size_t i, Tipo_zona* tipo,
+                     Tipo_nemico* nemico_mr, Tipo_oggetto* oggetto, Tipo_nemico* nemico_ss);
+// Indice della zona del Soprasotto che ospita il Demotorzone
+size_t generatore_indice_boss(const Parametri_mappa* p);
+// 1 se i parametri sono accettabili
+int generatore_parametri_validi(const Parametri_mappa* p);
+
+// Genera p->zone coppie in un unico blocco del pool, le collega nelle due
+// liste e costruisce l'indice posizionale bilanciato. Restituisce la prima
+// zona del Mondo Reale (NULL se manca memoria); la prima del Soprasotto è
+// il suo link_soprasotto. In *conteggi i nemici e gli oggetti generati
+Zona_mondoreale* generatore_costruisci(Pool_zone* pool, Indice_zone* indice, const Parametri_mappa* p,
+                                       Conteggi_mappa* conteggi);
+
+#endif
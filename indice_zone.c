@@ -0,0 +1,175 @@
+#include "indice_zone.h"
+
+// Xorshift32: priorità casuali indipendenti dal generatore del gioco
+static unsigned int nuova_priorita(Indice_zone* indice) {
+    unsigned int x = indice->seme;
+    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+    indice->seme = x;
+    return x;
+}
+
+static size_t dim(const Slot_zona* t) {
+    return t ? t->dimensione : 0;
+}
+
+static unsigned int presenza(const Slot_zona* t) {
+    return t ? t->presenza : 0;
+}
+
+unsigned int indice_presenza_zona(const Slot_zona* slot) {
+    unsigned int m = 0;
+    // Valori fuori intervallo (file scritti a mano) non compaiono in nessun bit
+    if ((unsigned int) slot->mr.nemico <= demotorzone) m |= PRESENZA_NEMICO_MR(slot->mr.nemico);
+    if ((unsigned int) slot->ss.nemico <= demotorzone) m |= PRESENZA_NEMICO_SS(slot->ss.nemico);
+    if ((unsigned int) slot->mr.oggetto <= schitarrata_metallica) m |= PRESENZA_OGGETTO(slot->mr.oggetto);
+    return m;
+}
+
+static void ricalcola_presenza(Slot_zona* t) {
+    t->presenza = (unsigned short) (indice_presenza_zona(t) | presenza(t->sx) | presenza(t->dx));
+}
+
+// Ricalcola dimensione e presenza del nodo e ricollega i figli al padre
+static void aggiorna(Slot_zona* t) {
+    t->dimensione = (unsigned int) (1 + dim(t->sx) + dim(t->dx));
+    ricalcola_presenza(t);
+    if (t->sx) t->sx->padre = t;
+    if (t->dx) t->dx->padre = t;
+}
+
+// Divide t in a (prime k zone) e b (le restanti)
+static void dividi(Slot_zona* t, size_t k, Slot_zona** a, Slot_zona** b) {
+    if (t == NULL) { *a = NULL; *b = NULL; return; }
+    if (dim(t->sx) >= k) {
+        dividi(t->sx, k, a, &t->sx);
+        *b = t;
+    } else {
+        dividi(t->dx, k - dim(t->sx) - 1, &t->dx, b);
+        *a = t;
+    }
+    aggiorna(t);
+}
+
+// Concatena a e b (tutte le zone di a precedono quelle di b)
+static Slot_zona* unisci(Slot_zona* a, Slot_zona* b) {
+    if (a == NULL) return b;
+    if (b == NULL) return a;
+    if (a->priorita > b->priorita) {
+        a->dx = unisci(a->dx, b);
+        aggiorna(a);
+        return a;
+    }
+    b->sx = unisci(a, b->sx);
+    aggiorna(b);
+    return b;
+}
+
+static void imposta_radice(Indice_zone* indice, Slot_zona* radice) {
+    indice->radice = radice;
+    if (radice) radice->padre = NULL;
+}
+
+size_t indice_conta(const Indice_zone* indice) {
+    return dim(indice->radice);
+}
+
+Slot_zona* indice_ottieni(const Indice_zone* indice, size_t pos) {
+    Slot_zona* t = indice->radice;
+    if (pos >= dim(t)) return NULL;
+    while (t != NULL) {
+        size_t sinistra = dim(t->sx);
+        if (pos < sinistra) t = t->sx;
+        else if (pos == sinistra) return t;
+        else { pos -= sinistra + 1; t = t->dx; }
+    }
+    return NULL;
+}
+
+void indice_inserisci(Indice_zone* indice, size_t pos, Slot_zona* slot) {
+    slot->sx = NULL; slot->dx = NULL; slot->padre = NULL;
+    slot->dimensione = 1;
+    slot->priorita = nuova_priorita(indice);
+    ricalcola_presenza(slot);
+
+    Slot_zona *a, *b;
+    dividi(indice->radice, pos, &a, &b);
+    imposta_radice(indice, unisci(unisci(a, slot), b));
+}
+
+Slot_zona* indice_rimuovi(Indice_zone* indice, size_t pos) {
+    if (pos >= indice_conta(indice)) return NULL;
+    Slot_zona *a, *b, *tolto;
+    dividi(indice->radice, pos, &a, &b);
+    dividi(b, 1, &tolto, &b);
+    imposta_radice(indice, unisci(a, b));
+    return tolto;
+}
+
+size_t indice_posizione(const Slot_zona* slot) {
+    size_t pos = dim(slot->sx);
+    for (const Slot_zona* n = slot; n->padre != NULL; n = n->padre)
+        if (n == n->padre->dx) pos += dim(n->padre->sx) + 1;
+    return pos;
+}
+
+void indice_aggiorna_presenza(Slot_zona* slot) {
+    for (Slot_zona* n = slot; n != NULL; n = n->padre) {
+        unsigned short prima = n->presenza;
+        ricalcola_presenza(n);
+        if (n != slot && n->presenza == prima) break; // Gli antenati non cambiano
+    }
+}
+
+// Prima zona dopo pos nel sottoalbero t, le cui posizioni partono da base
+static long long cerca_avanti(const Slot_zona* t, long long base, long long pos, unsigned int maschera) {
+    if (t == NULL || !(t->presenza & maschera) || base + (long long) t->dimensione - 1 <= pos) return -1;
+    long long qui = base + (long long) dim(t->sx);
+    if (qui > pos) {
+        long long r = cerca_avanti(t->sx, base, pos, maschera);
+        if (r >= 0) return r;
+        if (indice_presenza_zona(t) & maschera) return qui;
+    }
+    return cerca_avanti(t->dx, qui + 1, pos, maschera);
+}
+
+// Ultima zona prima di pos nel sottoalbero t
+static long long cerca_indietro(const Slot_zona* t, long long base, long long pos, unsigned int maschera) {
+    if (t == NULL || !(t->presenza & maschera) || base >= pos) return -1;
+    long long qui = base + (long long) dim(t->sx);
+    if (qui < pos) {
+        long long r = cerca_indietro(t->dx, qui + 1, pos, maschera);
+        if (r >= 0) return r;
+        if (indice_presenza_zona(t) & maschera) return qui;
+    }
+    return cerca_indietro(t->sx, base, pos, maschera);
+}
+
+long long indice_cerca(const Indice_zone* indice, long long pos, int direzione, unsigned int maschera) {
+    return direzione > 0 ? cerca_avanti(indice->radice, 0, pos, maschera)
+                         : cerca_indietro(indice->radice, 0, pos, maschera);
+}
+
+unsigned int indice_priorita_profondita(unsigned int profondita) {
+    return 0xFFFFFFFFu - profondita;
+}
+
+Slot_zona* indice_costruisci_sottoalbero(Slot_zona* v, size_t lo, size_t hi, unsigned int profondita, Slot_zona* padre) {
+    if (lo >= hi) return NULL;
+    size_t medio = lo + (hi - lo) / 2;
+    Slot_zona* t = &v[medio];
+    t->padre = padre;
+    t->priorita = indice_priorita_profondita(profondita);
+    t->dimensione = (unsigned int) (hi - lo);
+    t->sx = indice_costruisci_sottoalbero(v, lo, medio, profondita + 1, t);
+    t->dx = indice_costruisci_sottoalbero(v, medio + 1, hi, profondita + 1, t);
+    ricalcola_presenza(t);
+    return t;
+}
+
+void indice_imposta_radice(Indice_zone* indice, Slot_zona* radice) {
+    imposta_radice(indice, radice);
+}
+
+void indice_azzera(Indice_zone* indice) {
+    indice->radice = NULL;
+}
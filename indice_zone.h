@@ -0,0 +1,68 @@
+#ifndef INDICE_ZONE_H
+#define INDICE_ZONE_H
+
+#include "pool_zone.h"
+
+// ============================================================================
+// INDICE POSIZIONALE DELLE ZONE
+// ============================================================================
+// Le liste doppiamente collegate restano la rappresentazione del gioco, ma
+// trovare la zona in posizione i richiederebbe di scorrerle dall'inizio.
+// L'indice è un treap implicito (albero bilanciato con priorità casuali,
+// ordinato per posizione) costruito sugli stessi slot del pool: ogni nodo
+// conosce la dimensione del proprio sottoalbero, quindi accesso, inserimento
+// e cancellazione per posizione costano O(log n) e il conteggio costa O(1).
+//
+// Ogni nodo riassume anche quali nemici e oggetti compaiono nel proprio
+// sottoalbero, in una maschera di bit per tipo e mondo. Le maschere si
+// aggiornano con le dimensioni, quindi inserimenti e cancellazioni restano
+// O(log n), e la zona più vicina con un certo contenuto si trova in O(log n)
+// scendendo solo nei sottoalberi che lo contengono.
+
+typedef struct Indice_zone {
+    Slot_zona* radice;
+    unsigned int seme; // Generatore privato delle priorità (non tocca casuale())
+} Indice_zone;
+
+#define INDICE_ZONE_INIT { NULL, 2463534242u }
+
+// Bit della maschera di presenza: nemici del Mondo Reale, nemici del
+// Soprasotto e oggetti (anche "nessuno", per cercare le zone libere)
+#define PRESENZA_NEMICO_MR(t) (1u << (t))
+#define PRESENZA_NEMICO_SS(t) (1u << (4 + (t)))
+#define PRESENZA_OGGETTO(t)   (1u << (8 + (t)))
+
+// Numero di zone indicizzate, O(1)
+size_t indice_conta(const Indice_zone* indice);
+// Slot in posizione pos (0-based), NULL se fuori intervallo
+Slot_zona* indice_ottieni(const Indice_zone* indice, size_t pos);
+// Inserisce lo slot in modo che occupi la posizione pos (0 <= pos <= conta)
+void indice_inserisci(Indice_zone* indice, size_t pos, Slot_zona* slot);
+// Toglie dall'indice lo slot in posizione pos e lo restituisce
+Slot_zona* indice_rimuovi(Indice_zone* indice, size_t pos);
+// Posizione di uno slot indicizzato (risale fino alla radice)
+size_t indice_posizione(const Slot_zona* slot);
+// Collega gli slot v[lo..hi-1] in un sottoalbero perfettamente bilanciato e
+// ne restituisce la radice. Le priorità dipendono dalla profondità (più alte
+// vicino alla radice), quindi l'albero è un treap valido e gli inserimenti
+// successivi lo mantengono bilanciato. Il contenuto degli slot deve essere
+// già scritto (maschere di presenza). Sottoalberi disgiunti si possono
+// costruire in parallelo
+Slot_zona* indice_costruisci_sottoalbero(Slot_zona* v, size_t lo, size_t hi, unsigned int profondita, Slot_zona* padre);
+// Priorità assegnata ai nodi costruiti a una data profondità
+unsigned int indice_priorita_profondita(unsigned int profondita);
+// Maschera di presenza del solo contenuto dello slot
+unsigned int indice_presenza_zona(const Slot_zona* slot);
+// Da chiamare dopo aver cambiato nemici o oggetto di uno slot indicizzato:
+// aggiorna le maschere fino alla radice
+void indice_aggiorna_presenza(Slot_zona* slot);
+// Posizione della prima zona dopo pos (direzione > 0) o dell'ultima prima di
+// pos (direzione < 0) con almeno uno dei bit di maschera, -1 se non c'è. pos
+// può valere -1 o conta per cercare dall'inizio o dalla fine
+long long indice_cerca(const Indice_zone* indice, long long pos, int direzione, unsigned int maschera);
+// Sostituisce la radice (l'indice precedente viene dimenticato)
+void indice_imposta_radice(Indice_zone* indice, Slot_zona* radice);
+// Svuota l'indice (gli slot appartengono al pool, non vengono liberati)
+void indice_azzera(Indice_zone* indice);
+
+#endif
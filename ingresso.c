@@ -0,0 +1,164 @@
+#define _POSIX_C_SOURCE 200809L
+#include "ingresso.h"
+#include "uscita.h"
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define DIM_BLOCCO (1 << 16)
+
+static const char* pos = NULL;  // Prossimo byte da leggere
+static const char* fine = NULL; // Fine dei byte disponibili
+static char* blocco = NULL;     // Buffer di lettura (NULL se stdin è mappato)
+static int pronto = 0;
+static int mappato = 0;
+static int finito = 0;
+static void (*gestore_fine)(void) = NULL;
+
+// Alla prima lettura: mappa stdin se è un file regolare, altrimenti prepara il buffer
+static void prepara() {
+    pronto = 1;
+    struct stat st;
+    off_t inizio = lseek(STDIN_FILENO, 0, SEEK_CUR);
+    if (fstat(STDIN_FILENO, &st) == 0 && S_ISREG(st.st_mode) && inizio >= 0 && st.st_size > inizio) {
+        size_t dimensione = (size_t) st.st_size;
+        void* dati = mmap(NULL, dimensione, PROT_READ, MAP_PRIVATE, STDIN_FILENO, 0);
+        if (dati != MAP_FAILED) {
+            posix_madvise(dati, dimensione, POSIX_MADV_SEQUENTIAL);
+            pos = (const char*) dati + inizio;
+            fine = (const char*) dati + dimensione;
+            mappato = 1;
+            return;
+        }
+    }
+    blocco = (char*) malloc(DIM_BLOCCO);
+    pos = fine = blocco;
+}
+
+// Legge il blocco successivo; 0 se l'input è finito
+static int riempi() {
+    if (!pronto) { prepara(); if (pos < fine) return 1; }
+    if (mappato || finito || blocco == NULL) { finito = 1; return 0; }
+    uscita_svuota(); // Chi scrive deve vedere il prompt prima che si aspetti
+    ssize_t n;
+    do n = read(STDIN_FILENO, blocco, DIM_BLOCCO); while (n < 0 && errno == EINTR);
+    if (n <= 0) { finito = 1; return 0; }
+    pos = blocco;
+    fine = blocco + n;
+    return 1;
+}
+
+static inline int guarda() {
+    if (pos == fine && !riempi()) return EOF;
+    return (unsigned char) *pos;
+}
+
+static inline int spazio(int c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// Salta gli spazi; EOF (dopo aver chiamato il gestore) se l'input è finito
+static int salta_spazi() {
+    for (;;) {
+        const char* p = pos;
+        while (p < fine && spazio((unsigned char) *p)) p++;
+        pos = p;
+        if (p < fine) return (unsigned char) *p;
+        if (!riempi()) break;
+    }
+    if (gestore_fine != NULL) gestore_fine();
+    return EOF;
+}
+
+// Cifre decimali con segno opzionale, saturate a +-ULLONG_MAX
+static int leggi_numero(unsigned long long* modulo, int* negativo) {
+    int c = salta_spazi();
+    if (c == EOF) return EOF;
+    *negativo = 0;
+    if (c == '-' || c == '+') { *negativo = (c == '-'); pos++; c = guarda(); }
+    if (c < '0' || c > '9') return 0;
+    unsigned long long v = 0;
+    do {
+        // Cifre contigue nel blocco corrente senza passare da guarda()
+        const char* p = pos;
+        while (p < fine && *p >= '0' && *p <= '9') {
+            unsigned int cifra = (unsigned int) (*p++ - '0');
+            v = (v > (ULLONG_MAX - cifra) / 10) ? ULLONG_MAX : v * 10 + cifra;
+        }
+        pos = p;
+    } while ((c = guarda()) >= '0' && c <= '9'); // Il numero continua nel blocco successivo
+    *modulo = v;
+    return 1;
+}
+
+int ingresso_lungo(long long* v) {
+    unsigned long long m; int neg;
+    int r = leggi_numero(&m, &neg);
+    if (r != 1) return r;
+    if (neg) *v = (m > (unsigned long long) LLONG_MAX + 1) ? LLONG_MIN : (long long) (0ull - m);
+    else *v = (m > (unsigned long long) LLONG_MAX) ? LLONG_MAX : (long long) m;
+    return 1;
+}
+
+int ingresso_intero(int* v) {
+    long long x;
+    int r = ingresso_lungo(&x);
+    if (r != 1) return r;
+    *v = (x > INT_MAX) ? INT_MAX : (x < INT_MIN) ? INT_MIN : (int) x;
+    return 1;
+}
+
+int ingresso_senza_segno(unsigned long long* v) {
+    unsigned long long m; int neg;
+    int r = leggi_numero(&m, &neg);
+    if (r != 1) return r;
+    *v = neg ? 0ull - m : m; // Come strtoull
+    return 1;
+}
+
+int ingresso_parola(char* buf, size_t dim) {
+    int c = salta_spazi();
+    if (c == EOF) return EOF;
+    size_t n = 0;
+    while (n + 1 < dim && (c = guarda()) != EOF && !spazio(c)) { buf[n++] = (char) c; pos++; }
+    buf[n] = '\0';
+    return 1;
+}
+
+int ingresso_riga(char* buf, size_t dim) {
+    int c = guarda();
+    if (c == EOF) {
+        if (gestore_fine != NULL) gestore_fine();
+        return EOF;
+    }
+    // Come fgets: al massimo dim - 1 byte, l'a capo è consumato ma non copiato
+    size_t n = 0, letti = 0;
+    while (letti + 1 < dim && (c = guarda()) != EOF) {
+        pos++; letti++;
+        if (c == '\n') break;
+        buf[n++] = (char) c;
+    }
+    buf[n] = '\0';
+    return 1;
+}
+
+void ingresso_scarta_riga(void) {
+    while (guarda() != EOF) {
+        // Salto a blocchi fino all'a capo
+        const char* a_capo = (const char*) memchr(pos, '\n', (size_t) (fine - pos));
+        if (a_capo != NULL) { pos = a_capo + 1; return; }
+        pos = fine;
+    }
+}
+
+int ingresso_finito(void) {
+    return guarda() == EOF;
+}
+
+void ingresso_a_fine_input(void (*gestore)(void)) {
+    gestore_fine = gestore;
+}
@@ -0,0 +1,41 @@
+#ifndef INGRESSO_H
+#define INGRESSO_H
+
+#include <stddef.h>
+
+// ============================================================================
+// INGRESSO BUFFERIZZATO DEI COMANDI
+// ============================================================================
+// Sostituisce scanf, fgets e getchar su stdin. Se stdin è un file regolare
+// (uno script registrato passato con '<') viene mappato in memoria e letto
+// direttamente dalle sue pagine; altrimenti (terminale, pipe) viene letto a
+// blocchi di 64 KiB. I token si estraggono scorrendo il buffer, senza una
+// chiamata di libreria per carattere.
+//
+// Le funzioni si comportano come le chiamate che sostituiscono: ad esempio
+// ingresso_intero salta gli spazi e gli a capo come scanf("%d") e non consuma
+// nulla se il prossimo token non è un numero. Prima di bloccarsi in attesa di
+// dati l'uscita bufferizzata viene svuotata, così i prompt sono visibili.
+//
+// A fine input le letture restituiscono EOF; se è registrato un gestore di
+// fine input viene chiamato al suo posto (il gioco lo usa per terminare in
+// modo pulito invece di ripetere per sempre l'ultima domanda).
+
+// Come scanf("%d"): 1 se letto, 0 se il token non è un numero, EOF a fine input
+int ingresso_intero(int* v);
+// Come scanf("%lld") e scanf("%llu")
+int ingresso_lungo(long long* v);
+int ingresso_senza_segno(unsigned long long* v);
+// Come scanf("%Ns") con N = dim - 1: una parola senza spazi
+int ingresso_parola(char* buf, size_t dim);
+// Come fgets seguita dalla rimozione dell'a capo: 1 se letta, EOF a fine input
+int ingresso_riga(char* buf, size_t dim);
+// Scarta il resto della riga corrente, a capo compreso
+void ingresso_scarta_riga(void);
+// 1 se l'input è finito
+int ingresso_finito(void);
+
+// Gestore chiamato quando una lettura trova l'input finito (NULL per nessuno)
+void ingresso_a_fine_input(void (*gestore)(void));
+
+#endif
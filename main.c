@@ -1,53 +1,194 @@
 #include "gamelib.h"
+#include "probabilita.h"
+#include "uscita.h"
+#include "ingresso.h"
+#include "diario.h"
+#include "server.h"
+#include "classifica.h"
+#include "torneo.h"
+#include "mcts.h"
 #include <time.h> // Necessario per time()
 
-int main() {
+// Sessione del gioco interattivo
+static Sessione* sessione = NULL;
+// Classifica persistente (-l), scritta anche a fine input
+static Classifica* classifica = NULL;
+// Ricerca MCTS per i suggerimenti (-M) e i bot (-b)
+static Mcts* mcts = NULL;
+
+// A fine input (script finito o stdin chiuso) si esce come con "Termina gioco"
+static void fine_input() {
+    termina_gioco(sessione);
+    sessione_distruggi(sessione);
+    mcts_distruggi(mcts);
+    classifica_chiudi(classifica);
+    exit(0);
+}
+
+// Rigioca un diario e ne stampa l'esito (anche con -q). Codice di uscita:
+// 0 partita identica, 1 divergenza, 2 diario non leggibile
+static int riproduci(const char* percorso, int dal_round) {
+    Rapporto_riproduzione r;
+    Esito_diario e = partita_riproduci(sessione, percorso, dal_round, &r);
+    if (e != diario_ok && e != diario_divergenza) {
+        uscita_formatta("Errore: %s.\n", diario_messaggio(e));
+        return 2;
+    }
+    uscita_formatta("Riprodotti i round %d-%d (%llu eventi)", r.round_partenza, r.round_finale, (unsigned long long) r.eventi);
+    if (e == diario_divergenza) uscita_formatta(": DIVERGENZA al round %d, %s.\n", r.round_divergenza, r.motivo);
+    else if (!r.completo) uscita_formatta(": nessuna divergenza, il diario si interrompe qui.\n");
+    else uscita_formatta(": nessuna divergenza.\n");
+    termina_gioco(sessione);
+    return e == diario_divergenza ? 1 : 0;
+}
+
+int main(int argc, char* argv[]) {
+    // -q: nessun messaggio (riproduzione veloce di script), -v: anche i tiri di dado
+    // -d FILE: registra le partite nel diario, -f N: un fotogramma ogni N round
+    // -r FILE: rigioca il diario e termina, -s N: parte dal round N
+    // -c: consiglio della politica ottima nel menu di turno
+    // -S INDIRIZZO: server di gioco ("porta", "host:porta" o socket Unix) con
+    // -g N giocatori per tavolo, -t N thread (0: uno per core), -m N round massimi,
+    // -a S secondi per ogni scelta (0: nessun limite)
+    // -l FILE: classifica persistente dei vincitori (creata se manca)
+    // -T N: torneo fra le strategie dei bot, N semi per strategia e profilo
+    // (con -t e -m), stampa il rapporto e termina
+    // -M MS: mossa suggerita dalla ricerca MCTS nel menu di turno, MS ms per
+    // decisione su -t thread; -b N: il giocatore N (1-4) è un bot MCTS
+    const char* diario = NULL;
+    const char* da_riprodurre = NULL;
+    const char* server = NULL;
+    const char* percorso_classifica = NULL;
+    unsigned long long semi_torneo = 0;
+    int intervallo = 0, dal_round = 1, consigli = 0, millisecondi_mcts = 0;
+    unsigned int bot_mcts = 0;
+    int giocatori_tavolo = 2, thread = 0, max_round = 200, attesa_scelta = 120;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-q") == 0) uscita_imposta_verbosita(verbosita_silenziosa);
+        else if (strcmp(argv[i], "-v") == 0) uscita_imposta_verbosita(verbosita_dettagliata);
+        else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) diario = argv[++i];
+        else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) intervallo = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) da_riprodurre = argv[++i];
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) dal_round = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-c") == 0) consigli = 1;
+        else if (strcmp(argv[i], "-S") == 0 && i + 1 < argc) server = argv[++i];
+        else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) giocatori_tavolo = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) thread = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) max_round = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) attesa_scelta = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) percorso_classifica = argv[++i];
+        else if (strcmp(argv[i], "-T") == 0 && i + 1 < argc) semi_torneo = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "-M") == 0 && i + 1 < argc) millisecondi_mcts = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            int n = atoi(argv[++i]);
+            if (n >= 1 && n <= 4) bot_mcts |= 1u << (n - 1);
+        }
+    }
+    if (semi_torneo > 0) {
+        probabilita_inizializza(); // Per l'agente ottimo
+        Opzioni_torneo o = { semi_torneo, 1, thread, max_round, 0, NULL, 0 };
+        return torneo_esegui(&o);
+    }
+    if (percorso_classifica != NULL) {
+        classifica = classifica_apri(percorso_classifica);
+        if (classifica == NULL) {
+            uscita_formatta("Errore: classifica %s non leggibile.\n", percorso_classifica);
+            return 2;
+        }
+        albo_collega_classifica(classifica);
+    }
+    if (server != NULL) {
+        probabilita_inizializza();
+        Opzioni_server o = { server, giocatori_tavolo, thread, max_round, verbosita_uscita, attesa_scelta };
+        int codice = server_avvia(&o);
+        classifica_chiudi(classifica);
+        return codice;
+    }
     // Inizializza il generatore di numeri casuali una sola volta all'avvio del programma
-    srand((unsigned) time(NULL)); 
+    sessione = sessione_crea((unsigned long long) time(NULL));
+    if (sessione == NULL) { uscita_formatta("Errore: memoria insufficiente.\n"); return 2; }
+
+    if (da_riprodurre != NULL) {
+        int codice = riproduci(da_riprodurre, dal_round);
+        sessione_distruggi(sessione);
+        classifica_chiudi(classifica);
+        return codice;
+    }
+    if (diario != NULL) partita_registra(sessione, diario, intervallo);
+    partita_mostra_consigli(sessione, consigli);
+    if (millisecondi_mcts > 0 || bot_mcts != 0) {
+        Opzioni_mcts o = OPZIONI_MCTS_DEFAULT;
+        if (millisecondi_mcts > 0) o.millisecondi = millisecondi_mcts;
+        o.thread = thread;
+        o.seme = (unsigned long long) time(NULL);
+        mcts = mcts_crea(&o);
+        if (mcts == NULL) uscita_formatta("Errore: ricerca MCTS non disponibile.\n");
+        partita_collega_mcts(sessione, mcts, millisecondi_mcts > 0, bot_mcts);
+    }
+
+    // Tabella delle probabilita' di vittoria per il menu di turno
+    probabilita_inizializza();
+
+    ingresso_a_fine_input(fine_input);
 
     int scelta = 0;
 
     do {
         // Stampa del menu principale
-        printf("\n--- COSE STRANE: MENU PRINCIPALE ---\n");
-        printf("1) Imposta gioco\n");
-        printf("2) Gioca\n");
-        printf("3) Termina gioco\n");
-        printf("4) Visualizza crediti\n");
-        printf("------------------------------------\n");
-        printf("Inserisci la tua scelta: ");
+        stampa("\n--- COSE STRANE: MENU PRINCIPALE ---\n");
+        stampa("1) Imposta gioco\n");
+        stampa("2) Gioca\n");
+        stampa("3) Termina gioco\n");
+        stampa("4) Visualizza crediti\n");
+        stampa("5) Salva partita\n");
+        stampa("6) Carica partita\n");
+        stampa("7) Statistiche di esecuzione\n");
+        stampa("------------------------------------\n");
+        stampa("Inserisci la tua scelta: ");
 
         // Lettura dell'input con controllo di validità
-        // scanf restituisce il numero di elementi letti correttamente.
-        if (scanf("%d", &scelta) != 1) {
+        // ingresso_intero restituisce il numero di elementi letti correttamente.
+        if (ingresso_intero(&scelta) != 1) {
             // Se l'utente non inserisce un numero (es. lettere), puliamo il buffer
-            printf("Errore: Inserisci un numero valido!\n");
-            while (getchar() != '\n'); // Svuota il buffer di input
+            stampa("Errore: Inserisci un numero valido!\n");
+            ingresso_scarta_riga(); // Svuota il buffer di input
             continue; // Ricomincia il ciclo
         }
 
         // Switch per eseguire i comandi 
         switch (scelta) {
             case 1:
-                imposta_gioco();
+                imposta_gioco(sessione);
                 break;
             case 2:
-                gioca();
+                gioca(sessione);
                 break;
             case 3:
-                termina_gioco();
+                termina_gioco(sessione);
                 // Il ciclo terminerà se verra selezionato 3
                 break;
             case 4:
-                crediti();
+                crediti(sessione);
+                break;
+            case 5:
+                salva_gioco(sessione);
+                break;
+            case 6:
+                carica_gioco(sessione);
+                break;
+            case 7:
+                statistiche_esecuzione();
                 break;
             default:
                 // Gestione comando sbagliato 
-                printf("Comando sbagliato (deve essere 1-4). Riprova.\n");
+                stampa("Comando sbagliato (deve essere 1-7). Riprova.\n");
                 break;
         }
 
     } while (scelta != 3); // Condizione di uscita 
 
+    sessione_distruggi(sessione);
+    mcts_distruggi(mcts);
+    classifica_chiudi(classifica);
     return 0;
 }
@@ -0,0 +1,176 @@
+#define _POSIX_C_SOURCE 200809L
+#include "mappa_compatta.h"
+#include "generatore.h"
+#include <pthread.h>
+#include <unistd.h>
+
+// Sotto questa soglia di zone per thread non conviene creare thread
+#define ZONE_PER_THREAD_MIN 65536
+#define MAX_THREAD 256
+
+// Codici possibili: 11 bit
+#define CODICI (1 << 11)
+
+// ============================================================================
+// CREAZIONE E CONVERSIONI
+// ============================================================================
+
+int compatta_crea(Mappa_compatta* m, size_t n) {
+    m->zone = (Zona_compatta*) calloc(n ? n : 1, sizeof(Zona_compatta));
+    m->n = m->zone != NULL ? n : 0;
+    return m->zone != NULL;
+}
+
+void compatta_distruggi(Mappa_compatta* m) {
+    free(m->zone);
+    m->zone = NULL;
+    m->n = 0;
+}
+
+int compatta_da_soa(Mappa_compatta* m, const Mappa_soa* soa) {
+    for (size_t i = 0; i < soa->n; i++)
+        if (soa->tipo[i] > 0xF || soa->nemico_mr[i] > 0x3 || soa->oggetto_mr[i] > 0x7 || soa->nemico_ss[i] > 0x3) {
+            m->zone = NULL;
+            m->n = 0;
+            return 0;
+        }
+    if (!compatta_crea(m, soa->n)) return 0;
+    for (size_t i = 0; i < soa->n; i++)
+        m->zone[i] = COMPATTA_CODIFICA(soa->tipo[i], soa->nemico_mr[i], soa->oggetto_mr[i], soa->nemico_ss[i]);
+    return 1;
+}
+
+int compatta_in_soa(const Mappa_compatta* m, Mappa_soa* soa) {
+    if (!soa_crea(soa, m->n)) return 0;
+    for (size_t i = 0; i < m->n; i++) {
+        Zona_compatta z = m->zone[i];
+        soa->tipo[i] = (unsigned char) COMPATTA_TIPO(z);
+        soa->nemico_mr[i] = (unsigned char) COMPATTA_NEMICO_MR(z);
+        soa->oggetto_mr[i] = (unsigned char) COMPATTA_OGGETTO(z);
+        soa->nemico_ss[i] = (unsigned char) COMPATTA_NEMICO_SS(z);
+    }
+    return 1;
+}
+
+size_t compatta_byte(const Mappa_compatta* m) {
+    return sizeof(*m) + m->n * sizeof(Zona_compatta);
+}
+
+// ============================================================================
+// GENERAZIONE PARALLELA
+// ============================================================================
+// Stesso contenuto di generatore_costruisci (generatore_zona è una funzione
+// pura di seme e indice): ogni thread riempie un intervallo contiguo.
+
+typedef struct Blocco_compatto {
+    const Parametri_mappa* p;
+    Zona_compatta* zone;
+    size_t lo, hi, boss;
+} Blocco_compatto;
+
+static void* genera_blocco(void* arg) {
+    Blocco_compatto* b = (Blocco_compatto*) arg;
+    for (size_t i = b->lo; i < b->hi; i++) {
+        Tipo_zona tipo;
+        Tipo_nemico nemico_mr, nemico_ss;
+        Tipo_oggetto oggetto;
+        generatore_zona(b->p, i, &tipo, &nemico_mr, &oggetto, &nemico_ss);
+        if (i == b->boss) nemico_ss = demotorzone;
+        b->zone[i] = COMPATTA_CODIFICA(tipo, nemico_mr, oggetto, nemico_ss);
+    }
+    return NULL;
+}
+
+static int thread_da_usare(const Parametri_mappa* p) {
+    long core = p->thread > 0 ? p->thread : sysconf(_SC_NPROCESSORS_ONLN);
+    if (core < 1) core = 1;
+    long utili = (long) (p->zone / ZONE_PER_THREAD_MIN);
+    if (utili < 1) utili = 1;
+    if (core > utili) core = utili;
+    if (core > MAX_THREAD) core = MAX_THREAD;
+    return (int) core;
+}
+
+int compatta_genera(Mappa_compatta* m, const Parametri_mappa* p) {
+    if (!generatore_parametri_validi(p)) return 0;
+    // calloc non serve: ogni zona viene scritta
+    m->zone = (Zona_compatta*) malloc(p->zone * sizeof(Zona_compatta));
+    if (m->zone == NULL) { m->n = 0; return 0; }
+    m->n = p->zone;
+
+    int t = thread_da_usare(p);
+    size_t boss = generatore_indice_boss(p);
+    Blocco_compatto blocchi[MAX_THREAD];
+    pthread_t thread[MAX_THREAD];
+    int avviati[MAX_THREAD] = {0};
+    for (int k = 0; k < t; k++) {
+        Blocco_compatto b = { p, m->zone, m->n * (size_t) k / (size_t) t, m->n * (size_t) (k + 1) / (size_t) t, boss };
+        blocchi[k] = b;
+    }
+    // Il thread chiamante prende il primo blocco; se un thread non parte, il
+    // suo blocco viene svolto qui
+    for (int k = 1; k < t; k++) avviati[k] = (pthread_create(&thread[k], NULL, genera_blocco, &blocchi[k]) == 0);
+    genera_blocco(&blocchi[0]);
+    for (int k = 1; k < t; k++) {
+        if (avviati[k]) pthread_join(thread[k], NULL);
+        else genera_blocco(&blocchi[k]);
+    }
+    return 1;
+}
+
+// ============================================================================
+// INTERROGAZIONI
+// ============================================================================
+// Una passata conta le occorrenze di ogni codice (2048 contatori, 16 KB che
+// restano in cache L1); i conteggi per campo si ricavano poi dai codici.
+
+void compatta_istogramma(const Mappa_compatta* m, Istogramma_mappa* h) {
+    static const int mr_valido[4] = { 1, 1, 1, 0 }; // Il Demotorzone sta nel Soprasotto
+    static const int ss_valido[4] = { 1, 0, 1, 1 }; // Billi sta nel Mondo Reale
+    size_t codici[CODICI] = {0};
+    memset(h, 0, sizeof(*h));
+    h->tipo_massimo = -1;
+    for (size_t i = 0; i < m->n; i++) codici[m->zone[i] & (CODICI - 1)]++;
+    for (unsigned c = 0; c < CODICI; c++) {
+        size_t k = codici[c];
+        if (k == 0) continue;
+        Zona_compatta z = (Zona_compatta) c;
+        h->nemici_mr[COMPATTA_NEMICO_MR(z)] += k;
+        h->nemici_ss[COMPATTA_NEMICO_SS(z)] += k;
+        if (COMPATTA_OGGETTO(z) <= schitarrata_metallica) h->oggetti[COMPATTA_OGGETTO(z)] += k;
+        else h->fuori_range += k;
+        h->fuori_range += k * (size_t) (!mr_valido[COMPATTA_NEMICO_MR(z)] + !ss_valido[COMPATTA_NEMICO_SS(z)]
+                                        + (COMPATTA_TIPO(z) > stazione_polizia));
+        if ((int) COMPATTA_TIPO(z) > h->tipo_massimo) h->tipo_massimo = (int) COMPATTA_TIPO(z);
+    }
+}
+
+int compatta_valida(const Mappa_compatta* m) {
+    Istogramma_mappa h;
+    compatta_istogramma(m, &h);
+    int motivi = SOA_VALIDA;
+    if (m->n < 15) motivi |= SOA_TROPPO_CORTA;
+    if (h.nemici_ss[demotorzone] != 1) motivi |= SOA_BOSS_NON_UNICO;
+    if (h.fuori_range > 0) motivi |= SOA_VALORI_INVALIDI;
+    return motivi;
+}
+
+// ============================================================================
+// MOVIMENTO
+// ============================================================================
+
+static Tipo_nemico nemico_in(const Mappa_compatta* m, size_t pos, int mondo) {
+    return mondo == 0 ? COMPATTA_NEMICO_MR(m->zone[pos]) : COMPATTA_NEMICO_SS(m->zone[pos]);
+}
+
+int compatta_avanza(const Mappa_compatta* m, size_t* pos, int mondo) {
+    if (nemico_in(m, *pos, mondo) != nessun_nemico || *pos + 1 >= m->n) return 0;
+    (*pos)++;
+    return 1;
+}
+
+int compatta_indietreggia(const Mappa_compatta* m, size_t* pos, int mondo) {
+    if (nemico_in(m, *pos, mondo) != nessun_nemico || *pos == 0) return 0;
+    (*pos)--;
+    return 1;
+}
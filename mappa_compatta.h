@@ -0,0 +1,67 @@
+#ifndef MAPPA_COMPATTA_H
+#define MAPPA_COMPATTA_H
+
+#include "gamelib.h"
+#include "mappa_soa.h"
+#include <stdint.h>
+
+// ============================================================================
+// MAPPA COMPATTA (2 BYTE PER COPPIA DI ZONE)
+// ============================================================================
+// Nelle liste del gioco una coppia di zone costa più di 100 byte (tre enum e
+// tre puntatori per mondo, più il nodo dell'indice), ma il suo contenuto sta
+// in 11 bit: tipo 0-9, nemico MR 0-3, oggetto 0-4, nemico SS 0-3. Qui ogni
+// coppia è un intero a 16 bit e la sua posizione nell'array sostituisce
+// avanti, indietro e i due link tra i mondi.
+//
+// È il formato per le mappe molto grandi (decine di milioni di zone): si
+// genera direttamente, senza passare dalle liste, con lo stesso contenuto
+// di mappa_genera, e si interroga e percorre per indice come Mappa_soa.
+// Non si modifica per posizione: per giocarci la si importa nelle liste.
+//
+//   bit 0-3  tipo     bit 4-5  nemico MR     bit 6-8  oggetto     bit 9-10  nemico SS
+
+typedef uint16_t Zona_compatta;
+
+typedef struct Mappa_compatta {
+    size_t n;            // Numero di coppie di zone
+    Zona_compatta* zone;
+} Mappa_compatta;
+
+#define COMPATTA_TIPO(z)      ((Tipo_zona) ((z) & 0xF))
+#define COMPATTA_NEMICO_MR(z) ((Tipo_nemico) (((z) >> 4) & 0x3))
+#define COMPATTA_OGGETTO(z)   ((Tipo_oggetto) (((z) >> 6) & 0x7))
+#define COMPATTA_NEMICO_SS(z) ((Tipo_nemico) (((z) >> 9) & 0x3))
+#define COMPATTA_CODIFICA(tipo, nemico_mr, oggetto, nemico_ss) \
+    ((Zona_compatta) ((unsigned) (tipo) | (unsigned) (nemico_mr) << 4 | (unsigned) (oggetto) << 6 | (unsigned) (nemico_ss) << 9))
+
+// Alloca n coppie vuote (tutti i campi a 0). Restituisce 1 se riuscita
+int compatta_crea(Mappa_compatta* m, size_t n);
+void compatta_distruggi(Mappa_compatta* m);
+
+// Genera la mappa dei parametri (la stessa di mappa_genera) su p->thread
+// thread. Restituisce 1 se riuscita, 0 se i parametri non sono validi o
+// manca memoria
+int compatta_genera(Mappa_compatta* m, const Parametri_mappa* p);
+
+// Conversioni con Mappa_soa. compatta_da_soa fallisce (0) anche se un valore
+// non entra nei bit del suo campo (file di testo scritti a mano)
+int compatta_da_soa(Mappa_compatta* m, const Mappa_soa* soa);
+int compatta_in_soa(const Mappa_compatta* m, Mappa_soa* soa);
+
+// Stesse interrogazioni di Mappa_soa, in una sola passata sull'array
+void compatta_istogramma(const Mappa_compatta* m, Istogramma_mappa* h);
+int compatta_valida(const Mappa_compatta* m); // SOA_VALIDA o i motivi SOA_*
+
+// Movimento per indice, come soa_avanza e soa_indietreggia
+int compatta_avanza(const Mappa_compatta* m, size_t* pos, int mondo);
+int compatta_indietreggia(const Mappa_compatta* m, size_t* pos, int mondo);
+
+// Memoria occupata dalla mappa, struttura compresa
+size_t compatta_byte(const Mappa_compatta* m);
+
+// Conversioni con le liste del gioco (implementate in gamelib.c)
+int mappa_esporta_compatta(const Sessione* s, Mappa_compatta* m); // 1 se riuscita
+int mappa_importa_compatta(Sessione* s, const Mappa_compatta* m); // Sostituisce la mappa, 1 se riuscita
+
+#endif
@@ -0,0 +1,229 @@
+#include "mappa_soa.h"
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SOA_X86 1
+#endif
+
+// ============================================================================
+// KERNEL DI CONTEGGIO
+// ============================================================================
+// Ogni kernel conta in un solo passaggio quante volte compaiono i valori 0-4
+// in un array di byte e ne calcola il massimo. Le versioni SIMD confrontano
+// 16/32 byte alla volta e accumulano i risultati (-1 per ogni corrispondenza)
+// in contatori a 8 bit, riversati in contatori a 64 bit con SAD ogni 255
+// iterazioni, prima che possano traboccare.
+
+#define VALORI_CONTATI 5
+
+typedef void (*Kernel_conta)(const unsigned char* a, size_t n, size_t conta[VALORI_CONTATI], unsigned char* massimo);
+
+static void conta_scalare(const unsigned char* a, size_t n, size_t conta[VALORI_CONTATI], unsigned char* massimo) {
+    unsigned char m = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (a[i] < VALORI_CONTATI) conta[a[i]]++;
+        if (a[i] > m) m = a[i];
+    }
+    if (m > *massimo) *massimo = m;
+}
+
+#if defined(SOA_X86) && defined(__SSE2__)
+static size_t somma_sad_sse2(__m128i contatori) {
+    __m128i s = _mm_sad_epu8(contatori, _mm_setzero_si128());
+    return (size_t) _mm_cvtsi128_si32(s) + (size_t) _mm_cvtsi128_si32(_mm_unpackhi_epi64(s, s));
+}
+
+static void conta_sse2(const unsigned char* a, size_t n, size_t conta[VALORI_CONTATI], unsigned char* massimo) {
+    const __m128i v0 = _mm_set1_epi8(0), v1 = _mm_set1_epi8(1), v2 = _mm_set1_epi8(2);
+    const __m128i v3 = _mm_set1_epi8(3), v4 = _mm_set1_epi8(4);
+    __m128i vmax = _mm_setzero_si128();
+    size_t i = 0;
+
+    while (n - i >= 16) {
+        size_t blocchi = (n - i) / 16;
+        if (blocchi > 255) blocchi = 255;
+        __m128i c0 = _mm_setzero_si128(), c1 = c0, c2 = c0, c3 = c0, c4 = c0;
+        for (size_t b = 0; b < blocchi; b++, i += 16) {
+            __m128i x = _mm_loadu_si128((const __m128i*) (a + i));
+            c0 = _mm_sub_epi8(c0, _mm_cmpeq_epi8(x, v0));
+            c1 = _mm_sub_epi8(c1, _mm_cmpeq_epi8(x, v1));
+            c2 = _mm_sub_epi8(c2, _mm_cmpeq_epi8(x, v2));
+            c3 = _mm_sub_epi8(c3, _mm_cmpeq_epi8(x, v3));
+            c4 = _mm_sub_epi8(c4, _mm_cmpeq_epi8(x, v4));
+            vmax = _mm_max_epu8(vmax, x);
+        }
+        conta[0] += somma_sad_sse2(c0); conta[1] += somma_sad_sse2(c1);
+        conta[2] += somma_sad_sse2(c2); conta[3] += somma_sad_sse2(c3);
+        conta[4] += somma_sad_sse2(c4);
+    }
+
+    unsigned char byte[16];
+    _mm_storeu_si128((__m128i*) byte, vmax);
+    for (int k = 0; k < 16; k++) if (byte[k] > *massimo) *massimo = byte[k];
+    conta_scalare(a + i, n - i, conta, massimo);
+}
+
+__attribute__((target("avx2")))
+static size_t somma_sad_avx2(__m256i contatori) {
+    __m256i s = _mm256_sad_epu8(contatori, _mm256_setzero_si256());
+    __m128i meta = _mm_add_epi64(_mm256_castsi256_si128(s), _mm256_extracti128_si256(s, 1));
+    return (size_t) _mm_cvtsi128_si32(meta) + (size_t) _mm_cvtsi128_si32(_mm_unpackhi_epi64(meta, meta));
+}
+
+__attribute__((target("avx2")))
+static void conta_avx2(const unsigned char* a, size_t n, size_t conta[VALORI_CONTATI], unsigned char* massimo) {
+    const __m256i v0 = _mm256_set1_epi8(0), v1 = _mm256_set1_epi8(1), v2 = _mm256_set1_epi8(2);
+    const __m256i v3 = _mm256_set1_epi8(3), v4 = _mm256_set1_epi8(4);
+    __m256i vmax = _mm256_setzero_si256();
+    size_t i = 0;
+
+    while (n - i >= 32) {
+        size_t blocchi = (n - i) / 32;
+        if (blocchi > 255) blocchi = 255;
+        __m256i c0 = _mm256_setzero_si256(), c1 = c0, c2 = c0, c3 = c0, c4 = c0;
+        for (size_t b = 0; b < blocchi; b++, i += 32) {
+            __m256i x = _mm256_loadu_si256((const __m256i*) (a + i));
+            c0 = _mm256_sub_epi8(c0, _mm256_cmpeq_epi8(x, v0));
+            c1 = _mm256_sub_epi8(c1, _mm256_cmpeq_epi8(x, v1));
+            c2 = _mm256_sub_epi8(c2, _mm256_cmpeq_epi8(x, v2));
+            c3 = _mm256_sub_epi8(c3, _mm256_cmpeq_epi8(x, v3));
+            c4 = _mm256_sub_epi8(c4, _mm256_cmpeq_epi8(x, v4));
+            vmax = _mm256_max_epu8(vmax, x);
+        }
+        conta[0] += somma_sad_avx2(c0); conta[1] += somma_sad_avx2(c1);
+        conta[2] += somma_sad_avx2(c2); conta[3] += somma_sad_avx2(c3);
+        conta[4] += somma_sad_avx2(c4);
+    }
+
+    unsigned char byte[32];
+    _mm256_storeu_si256((__m256i*) byte, vmax);
+    for (int k = 0; k < 32; k++) if (byte[k] > *massimo) *massimo = byte[k];
+    conta_scalare(a + i, n - i, conta, massimo);
+}
+#endif
+
+static Kernel_conta kernel_conta = conta_scalare;
+static const char* nome_isa = "scalare";
+static pthread_once_t kernel_scelto = PTHREAD_ONCE_INIT;
+
+static void scegli_kernel(void) {
+#if defined(SOA_X86) && defined(__SSE2__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) { kernel_conta = conta_avx2; nome_isa = "avx2"; }
+    else { kernel_conta = conta_sse2; nome_isa = "sse2"; }
+#endif
+}
+
+// Sceglie il kernel migliore per la CPU al primo utilizzo (una volta sola
+// anche se la generazione parallela lo chiede da più thread)
+static Kernel_conta kernel() {
+    pthread_once(&kernel_scelto, scegli_kernel);
+    return kernel_conta;
+}
+
+const char* soa_isa() {
+    kernel();
+    return nome_isa;
+}
+
+int soa_forza_isa(const char* isa) {
+    kernel(); // La scelta automatica non deve sovrascrivere quella forzata
+    if (strcmp(isa, "scalare") == 0) { kernel_conta = conta_scalare; nome_isa = "scalare"; return 1; }
+#if defined(SOA_X86) && defined(__SSE2__)
+    if (strcmp(isa, "sse2") == 0) { kernel_conta = conta_sse2; nome_isa = "sse2"; return 1; }
+    if (strcmp(isa, "avx2") == 0 && __builtin_cpu_supports("avx2")) { kernel_conta = conta_avx2; nome_isa = "avx2"; return 1; }
+#endif
+    return 0;
+}
+
+// ============================================================================
+// CREAZIONE E INTERROGAZIONI
+// ============================================================================
+
+int soa_crea(Mappa_soa* m, size_t n) {
+    // Un solo blocco per i quattro array: una malloc e campi vicini tra loro
+    unsigned char* blocco = (unsigned char*) calloc(n ? 4 * n : 1, 1);
+    if (blocco == NULL) { m->n = 0; m->tipo = m->nemico_mr = m->oggetto_mr = m->nemico_ss = NULL; return 0; }
+    m->n = n;
+    m->tipo = blocco;
+    m->nemico_mr = blocco + n;
+    m->oggetto_mr = blocco + 2 * n;
+    m->nemico_ss = blocco + 3 * n;
+    return 1;
+}
+
+void soa_distruggi(Mappa_soa* m) {
+    free(m->tipo);
+    m->n = 0;
+    m->tipo = m->nemico_mr = m->oggetto_mr = m->nemico_ss = NULL;
+}
+
+void soa_istogramma(const Mappa_soa* m, Istogramma_mappa* h) {
+    Kernel_conta k = kernel();
+    size_t conta[VALORI_CONTATI];
+    unsigned char massimo;
+    memset(h, 0, sizeof(*h));
+
+    memset(conta, 0, sizeof(conta)); massimo = 0;
+    k(m->nemico_mr, m->n, conta, &massimo);
+    for (int v = 0; v < 4; v++) h->nemici_mr[v] = conta[v];
+    // Nel Mondo Reale sono ammessi solo nessuno, Billi e Democane
+    h->fuori_range += m->n - (conta[nessun_nemico] + conta[billi] + conta[democane]);
+
+    memset(conta, 0, sizeof(conta)); massimo = 0;
+    k(m->nemico_ss, m->n, conta, &massimo);
+    for (int v = 0; v < 4; v++) h->nemici_ss[v] = conta[v];
+    // Nel Soprasotto sono ammessi solo nessuno, Democane e Demotorzone
+    h->fuori_range += m->n - (conta[nessun_nemico] + conta[democane] + conta[demotorzone]);
+
+    memset(conta, 0, sizeof(conta)); massimo = 0;
+    k(m->oggetto_mr, m->n, conta, &massimo);
+    for (int v = 0; v < 5; v++) h->oggetti[v] = conta[v];
+    h->fuori_range += m->n - (conta[0] + conta[1] + conta[2] + conta[3] + conta[4]);
+
+    // Per il tipo basta il massimo; i valori oltre stazione_polizia si
+    // contano solo se esistono
+    memset(conta, 0, sizeof(conta)); massimo = 0;
+    k(m->tipo, m->n, conta, &massimo);
+    h->tipo_massimo = m->n ? massimo : -1;
+    if (massimo > stazione_polizia)
+        for (size_t i = 0; i < m->n; i++) if (m->tipo[i] > stazione_polizia) h->fuori_range++;
+}
+
+size_t soa_conta_boss(const Mappa_soa* m) {
+    size_t conta[VALORI_CONTATI] = {0};
+    unsigned char massimo = 0;
+    kernel()(m->nemico_ss, m->n, conta, &massimo);
+    return conta[demotorzone];
+}
+
+int soa_valida(const Mappa_soa* m) {
+    Istogramma_mappa h;
+    soa_istogramma(m, &h);
+    int motivi = SOA_VALIDA;
+    if (m->n < 15) motivi |= SOA_TROPPO_CORTA;
+    if (h.nemici_ss[demotorzone] != 1) motivi |= SOA_BOSS_NON_UNICO;
+    if (h.fuori_range > 0) motivi |= SOA_VALORI_INVALIDI;
+    return motivi;
+}
+
+// ============================================================================
+// MOVIMENTO
+// ============================================================================
+
+static Tipo_nemico nemico_in(const Mappa_soa* m, size_t pos, int mondo) {
+    return (Tipo_nemico) (mondo == 0 ? m->nemico_mr[pos] : m->nemico_ss[pos]);
+}
+
+int soa_avanza(const Mappa_soa* m, size_t* pos, int mondo) {
+    if (nemico_in(m, *pos, mondo) != nessun_nemico || *pos + 1 >= m->n) return 0;
+    (*pos)++;
+    return 1;
+}
+
+int soa_indietreggia(const Mappa_soa* m, size_t* pos, int mondo) {
+    if (nemico_in(m, *pos, mondo) != nessun_nemico || *pos == 0) return 0;
+    (*pos)--;
+    return 1;
+}
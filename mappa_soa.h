@@ -0,0 +1,68 @@
+#ifndef MAPPA_SOA_H
+#define MAPPA_SOA_H
+
+#include "gamelib.h"
+
+// ============================================================================
+// MAPPA IN FORMATO STRUCTURE-OF-ARRAYS
+// ============================================================================
+// Rappresentazione alternativa alle liste collegate: le zone sono posizioni
+// in array contigui di byte, uno per campo. Il collegamento tra i due mondi e
+// tra zone vicine è implicito nell'indice, quindi muoversi è aritmetica e le
+// interrogazioni su tutta la mappa sono scansioni lineari eseguite con
+// istruzioni SIMD (AVX2 o SSE2 scelte a runtime, altrimenti codice scalare).
+//
+// Il tipo di zona è lo stesso nei due mondi (genera_mappa e inserisci_zona lo
+// impostano sempre uguale), quindi è memorizzato una volta sola.
+
+typedef struct Mappa_soa {
+    size_t n;                  // Numero di zone
+    unsigned char* tipo;       // Tipo_zona, comune ai due mondi
+    unsigned char* nemico_mr;  // Tipo_nemico nel Mondo Reale
+    unsigned char* oggetto_mr; // Tipo_oggetto nel Mondo Reale
+    unsigned char* nemico_ss;  // Tipo_nemico nel Soprasotto
+} Mappa_soa;
+
+typedef struct Istogramma_mappa {
+    size_t nemici_mr[4]; // Indicizzato per Tipo_nemico
+    size_t nemici_ss[4];
+    size_t oggetti[5];   // Indicizzato per Tipo_oggetto
+    size_t fuori_range;  // Byte con valori non validi per il loro campo
+    int tipo_massimo;    // Tipo di zona più alto presente (-1 se mappa vuota)
+} Istogramma_mappa;
+
+// Motivi per cui una mappa non può essere chiusa (bit combinabili)
+#define SOA_VALIDA           0
+#define SOA_TROPPO_CORTA     1 // Meno di 15 zone
+#define SOA_BOSS_NON_UNICO   2 // Demotorzone assente o ripetuto
+#define SOA_VALORI_INVALIDI  4 // Valori fuori dagli enum o nemici nel mondo sbagliato
+
+// Alloca n zone vuote (tutti i campi a 0). Restituisce 1 se riuscita
+int soa_crea(Mappa_soa* m, size_t n);
+void soa_distruggi(Mappa_soa* m);
+
+// Conteggi per valore su tutta la mappa in una scansione per campo
+void soa_istogramma(const Mappa_soa* m, Istogramma_mappa* h);
+// Numero di Demotorzone nel Soprasotto
+size_t soa_conta_boss(const Mappa_soa* m);
+// Stesse regole di chiudi_mappa più i vincoli sui valori di inserisci_zona.
+// Restituisce SOA_VALIDA oppure una combinazione dei motivi sopra
+int soa_valida(const Mappa_soa* m);
+
+// Movimento per indice: mondo 0 = Mondo Reale, 1 = Soprasotto.
+// Restituiscono 1 se il giocatore si è spostato (nessun nemico e non ai bordi)
+int soa_avanza(const Mappa_soa* m, size_t* pos, int mondo);
+int soa_indietreggia(const Mappa_soa* m, size_t* pos, int mondo);
+
+// Nome dell'insieme di istruzioni usato dalle scansioni ("avx2", "sse2", "scalare")
+const char* soa_isa();
+// Usa il kernel indicato (stessi nomi) invece di quello scelto per la CPU,
+// per confrontarli nei test. Restituisce 0, senza cambiare nulla, se la CPU
+// o la compilazione non lo permettono. Non va chiamata durante una scansione
+int soa_forza_isa(const char* isa);
+
+// Conversioni con le liste del gioco (implementate in gamelib.c)
+int mappa_esporta_soa(const Sessione* s, Mappa_soa* m); // Copia la mappa della sessione, 1 se riuscita
+int mappa_importa_soa(Sessione* s, const Mappa_soa* m); // Sostituisce la mappa della sessione, 1 se riuscita
+
+#endif
@@ -0,0 +1,230 @@
+#define _POSIX_C_SOURCE 200809L
+#include "mappa_testo.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CAPACITA_INIZIALE 4096
+#define DIM_BLOCCO (1 << 16) // Lettura dei flussi e buffer di scrittura
+
+// ============================================================================
+// LETTURA
+// ============================================================================
+
+static int errore(Lettore_mappa* l, Esito_testo e) {
+    l->esito = e;
+    return 0;
+}
+
+// Raddoppia la capacità spostando i quattro array in un blocco nuovo
+static int cresci(Lettore_mappa* l) {
+    size_t capacita = l->capacita ? 2 * l->capacita : CAPACITA_INIZIALE;
+    Mappa_soa nuova;
+    if (!soa_crea(&nuova, capacita)) return 0;
+    size_t n = l->mappa.n;
+    if (n > 0) {
+        memcpy(nuova.tipo, l->mappa.tipo, n);
+        memcpy(nuova.nemico_mr, l->mappa.nemico_mr, n);
+        memcpy(nuova.oggetto_mr, l->mappa.oggetto_mr, n);
+        memcpy(nuova.nemico_ss, l->mappa.nemico_ss, n);
+    }
+    soa_distruggi(&l->mappa);
+    nuova.n = n;
+    l->mappa = nuova;
+    l->capacita = capacita;
+    return 1;
+}
+
+static void chiudi_numero(Lettore_mappa* l) {
+    if (l->valore < 0) return;
+    l->campi[l->campo++] = (unsigned char) l->valore;
+    l->valore = -1;
+}
+
+// Fine di una riga: vuota (solo spazi o commento) oppure una zona completa
+static int fine_riga(Lettore_mappa* l) {
+    chiudi_numero(l);
+    if (l->campo == 0) { l->riga++; return 1; }
+    if (l->campo != 4) return errore(l, testo_errore_sintassi);
+
+    const unsigned char* c = l->campi;
+    if (c[0] > stazione_polizia || c[1] > democane || c[2] > schitarrata_metallica
+        || c[3] == billi || c[3] > demotorzone)
+        return errore(l, testo_errore_valore);
+
+    if (l->mappa.n == l->capacita && !cresci(l)) return errore(l, testo_errore_memoria);
+    size_t i = l->mappa.n++;
+    l->mappa.tipo[i] = c[0];
+    l->mappa.nemico_mr[i] = c[1];
+    l->mappa.oggetto_mr[i] = c[2];
+    l->mappa.nemico_ss[i] = c[3];
+    l->campo = 0;
+    l->riga++;
+    return 1;
+}
+
+void testo_inizia(Lettore_mappa* l) {
+    memset(l, 0, sizeof(*l));
+    l->riga = 1;
+    l->valore = -1;
+    l->esito = testo_ok;
+}
+
+int testo_consuma(Lettore_mappa* l, const char* dati, size_t n) {
+    if (l->esito != testo_ok) return 0;
+    const char* p = dati;
+    const char* fine = dati + n;
+
+    while (p < fine) {
+        // I commenti si saltano in blocco fino all'a capo
+        if (l->commento) {
+            const char* a_capo = (const char*) memchr(p, '\n', (size_t) (fine - p));
+            if (a_capo == NULL) return 1; // Il commento continua nel blocco successivo
+            l->commento = 0;
+            p = a_capo;
+        }
+
+        char c = *p++;
+        if (c >= '0' && c <= '9') {
+            if (l->valore < 0) {
+                if (l->campo == 4) return errore(l, testo_errore_sintassi);
+                l->valore = c - '0';
+            } else {
+                l->valore = l->valore * 10 + (c - '0');
+                if (l->valore > 255) return errore(l, testo_errore_valore);
+            }
+        } else if (c == ' ' || c == '\t' || c == '\r') {
+            chiudi_numero(l);
+        } else if (c == '\n') {
+            if (!fine_riga(l)) return 0;
+        } else if (c == '#') {
+            chiudi_numero(l);
+            l->commento = 1;
+        } else {
+            return errore(l, testo_errore_sintassi);
+        }
+    }
+    return 1;
+}
+
+Esito_testo testo_finisci(Lettore_mappa* l, Mappa_soa* m) {
+    // L'ultima riga può non avere l'a capo
+    if (l->esito == testo_ok && (l->campo > 0 || l->valore >= 0)) fine_riga(l);
+
+    if (l->esito == testo_ok) {
+        l->motivi = soa_valida(&l->mappa);
+        if (l->motivi != SOA_VALIDA) l->esito = testo_mappa_non_valida;
+    }
+    if (l->esito != testo_ok) {
+        soa_distruggi(&l->mappa);
+        return l->esito;
+    }
+    *m = l->mappa;
+    l->mappa.tipo = l->mappa.nemico_mr = l->mappa.oggetto_mr = l->mappa.nemico_ss = NULL;
+    l->mappa.n = 0;
+    l->capacita = 0;
+    return testo_ok;
+}
+
+Esito_testo testo_leggi_file(const char* percorso, Lettore_mappa* l, Mappa_soa* m) {
+    testo_inizia(l);
+    int fd = open(percorso, O_RDONLY);
+    if (fd < 0) return l->esito = testo_errore_file;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        // File regolare: un solo blocco direttamente dalle pagine del file
+        size_t dimensione = (size_t) st.st_size;
+        void* dati = mmap(NULL, dimensione, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (dati != MAP_FAILED) {
+            close(fd);
+            posix_madvise(dati, dimensione, POSIX_MADV_SEQUENTIAL);
+            testo_consuma(l, (const char*) dati, dimensione);
+            munmap(dati, dimensione);
+            return testo_finisci(l, m);
+        }
+    }
+
+    // Pipe, terminali o mmap non disponibile: lettura a blocchi
+    char* blocco = (char*) malloc(DIM_BLOCCO);
+    if (blocco == NULL) { close(fd); return l->esito = testo_errore_memoria; }
+    ssize_t letti;
+    while ((letti = read(fd, blocco, DIM_BLOCCO)) > 0)
+        if (!testo_consuma(l, blocco, (size_t) letti)) break;
+    if (letti < 0 && l->esito == testo_ok) l->esito = testo_errore_file;
+    free(blocco);
+    close(fd);
+    return testo_finisci(l, m);
+}
+
+// ============================================================================
+// SCRITTURA
+// ============================================================================
+
+typedef struct Uscita {
+    FILE* f;
+    char* buf;
+    size_t usati;
+    int ok;
+} Uscita;
+
+static void svuota(Uscita* u) {
+    if (u->usati > 0 && fwrite(u->buf, 1, u->usati, u->f) != u->usati) u->ok = 0;
+    u->usati = 0;
+}
+
+static void scrivi_testo(Uscita* u, const char* s) {
+    size_t n = strlen(s);
+    memcpy(u->buf + u->usati, s, n);
+    u->usati += n;
+}
+
+static void scrivi_numero(Uscita* u, size_t v) {
+    char cifre[24];
+    int k = 0;
+    do { cifre[k++] = (char) ('0' + v % 10); v /= 10; } while (v > 0);
+    while (k > 0) u->buf[u->usati++] = cifre[--k];
+}
+
+int testo_scrivi(FILE* f, const Mappa_soa* m, int commenti) {
+    Uscita u = { f, (char*) malloc(DIM_BLOCCO), 0, 1 };
+    if (u.buf == NULL) return 0;
+
+    if (commenti) {
+        scrivi_testo(&u, "# tipo nemico_mr oggetto_mr nemico_ss (");
+        scrivi_numero(&u, m->n);
+        scrivi_testo(&u, " zone)\n");
+    }
+    for (size_t i = 0; i < m->n && u.ok; i++) {
+        // Una riga con commento occupa meno di 256 byte
+        if (DIM_BLOCCO - u.usati < 256) svuota(&u);
+        scrivi_numero(&u, m->tipo[i]); u.buf[u.usati++] = ' ';
+        scrivi_numero(&u, m->nemico_mr[i]); u.buf[u.usati++] = ' ';
+        scrivi_numero(&u, m->oggetto_mr[i]); u.buf[u.usati++] = ' ';
+        scrivi_numero(&u, m->nemico_ss[i]);
+        if (commenti) {
+            scrivi_testo(&u, " # ["); scrivi_numero(&u, i); scrivi_testo(&u, "] ");
+            scrivi_testo(&u, nome_zona((Tipo_zona) m->tipo[i]));
+            scrivi_testo(&u, " | MR N: "); scrivi_testo(&u, nome_nemico((Tipo_nemico) m->nemico_mr[i]));
+            scrivi_testo(&u, " | O: "); scrivi_testo(&u, nome_oggetto((Tipo_oggetto) m->oggetto_mr[i]));
+            scrivi_testo(&u, " | SS N: "); scrivi_testo(&u, nome_nemico((Tipo_nemico) m->nemico_ss[i]));
+        }
+        u.buf[u.usati++] = '\n';
+    }
+    svuota(&u);
+    free(u.buf);
+    return u.ok;
+}
+
+const char* testo_messaggio(Esito_testo e) {
+    switch (e) {
+        case testo_ok: return "ok";
+        case testo_errore_file: return "impossibile leggere il file";
+        case testo_errore_sintassi: return "sintassi non valida (servono 4 numeri per riga)";
+        case testo_errore_valore: return "valore fuori intervallo";
+        case testo_errore_memoria: return "memoria insufficiente";
+        case testo_mappa_non_valida: return "la mappa non rispetta le regole di chiusura";
+    }
+    return "errore sconosciuto";
+}
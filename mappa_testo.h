@@ -0,0 +1,65 @@
+#ifndef MAPPA_TESTO_H
+#define MAPPA_TESTO_H
+
+#include "mappa_soa.h"
+
+// ============================================================================
+// MAPPA IN FORMATO TESTO
+// ============================================================================
+// Una zona per riga, quattro numeri separati da spazi o tabulazioni:
+//
+//   <tipo 0-9> <nemico MR 0-2> <oggetto MR 0-4> <nemico SS 0,2,3>
+//
+// con i valori degli enum di gamelib.h e le stesse restrizioni di
+// inserisci_zona (Billi solo nel Mondo Reale, Demotorzone solo nel
+// Soprasotto). Righe vuote e tutto ciò che segue '#' vengono ignorati;
+// l'esportatore usa i commenti per scrivere i nomi come stampa_mappa_debug.
+//
+// Il lettore è un automa a stati che consuma byte in blocchi di qualunque
+// dimensione: un file mappato in memoria viene letto in un solo blocco senza
+// copie, un flusso (pipe, stdin) a pezzi, con lo stesso risultato.
+
+typedef enum {
+    testo_ok,
+    testo_errore_file,     // Apertura o lettura fallita
+    testo_errore_sintassi, // Carattere inatteso o numero di campi diverso da 4
+    testo_errore_valore,   // Valore fuori intervallo per il suo campo
+    testo_errore_memoria,
+    testo_mappa_non_valida // Letta correttamente ma chiudi_mappa la rifiuterebbe
+} Esito_testo;
+
+typedef struct Lettore_mappa {
+    Mappa_soa mappa;      // Zone lette finora (array con capacità 'capacita')
+    size_t capacita;
+    size_t riga;          // Riga corrente (1-based), in errore è quella colpevole
+    int campo;            // Campi completi nella riga corrente
+    int valore;           // Numero in lettura, -1 se nessuno
+    int commento;         // 1 se si sta saltando un commento
+    unsigned char campi[4];
+    Esito_testo esito;    // Primo errore incontrato
+    int motivi;           // Motivi SOA_* se la mappa non è valida
+} Lettore_mappa;
+
+void testo_inizia(Lettore_mappa* l);
+// Consuma n byte. Restituisce 0 dopo il primo errore (i byte successivi sono ignorati)
+int testo_consuma(Lettore_mappa* l, const char* dati, size_t n);
+// Chiude l'ultima riga e convalida la mappa. Se l'esito è testo_ok la
+// mappa passa a *m (da liberare con soa_distruggi), altrimenti viene liberata
+Esito_testo testo_finisci(Lettore_mappa* l, Mappa_soa* m);
+
+// Legge un file intero: mappato in memoria se possibile, altrimenti a blocchi.
+// In caso di errore *l contiene riga e motivi
+Esito_testo testo_leggi_file(const char* percorso, Lettore_mappa* l, Mappa_soa* m);
+
+// Scrive la mappa nel formato sopra; con commenti != 0 ogni riga riporta
+// anche indice e nomi come stampa_mappa_debug. Restituisce 1 se riuscita
+int testo_scrivi(FILE* f, const Mappa_soa* m, int commenti);
+
+// Descrizione leggibile dell'esito
+const char* testo_messaggio(Esito_testo e);
+
+// Conversioni con le liste del gioco (implementate in gamelib.c)
+Esito_testo mappa_importa_testo(Sessione* s, const char* percorso, Lettore_mappa* l); // Sostituisce la mappa della sessione
+int mappa_esporta_testo(const Sessione* s, const char* percorso, int commenti);      // 1 se riuscita
+
+#endif
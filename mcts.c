@@ -0,0 +1,437 @@
+#define _POSIX_C_SOURCE 200809L
+#include "mcts.h"
+#include "ramo.h"
+#include "mappa_compatta.h"
+#include "pianificatore.h"
+#include "regole.h"
+#include "rng.h"
+#include "uscita.h"
+#include <limits.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <time.h>
+
+// Azioni che cambiano la partita: fuori dagli scontri 5, 6 e 8 stampano soltanto
+#define AZIONI 6
+static const int azioni_albero[AZIONI] = { 1, 2, 3, 4, 7, 9 };
+
+#define NODI_DEFAULT ((size_t) 1 << 18)
+#define ORIZZONTE_DEFAULT 200
+#define ESPLORAZIONE 0.7              // Costante di UCT (ricompense 0-1)
+#define MAX_PROFONDITA 256            // Nodi di un percorso dalla radice
+
+typedef struct Nodo_mcts {
+    _Atomic(struct Nodo_mcts*) figli[AZIONI]; // NULL finché l'azione non è provata
+    atomic_uint visite;                        // Comprese le simulazioni ancora in corso
+    atomic_uint vittorie;
+} Nodo_mcts;
+
+struct Mcts;
+
+// Stato privato di un thread della ricerca, riusato tra le decisioni
+typedef struct Lavoro_mcts {
+    struct Mcts* m;
+    Arena_rami arena;
+    Rng rng;
+    unsigned long long simulazioni;
+} Lavoro_mcts;
+
+struct Mcts {
+    Opzioni_mcts o;
+    Pianificatore* p;
+    int thread;
+    Lavoro_mcts* lavori;
+    Nodo_mcts* nodi;    // Nodo 0: radice
+    atomic_size_t usati;
+    atomic_ullong avviate; // Simulazioni avviate (limite o.simulazioni)
+    unsigned long long decisioni;
+
+    // Decisione in corso, in sola lettura per i thread
+    Mappa_compatta base;
+    Arena_rami arena_radice;
+    const Ramo* radice;
+    int decisore;
+    int ultimo_round;
+    double scadenza;
+
+    Sessione* sessione; // Di agente_mcts
+};
+
+static double ora_secondi(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+// ============================================================================
+// REGOLE SUL RAMO
+// ============================================================================
+// Le azioni del motore (gamelib.c) senza messaggi, con le formule e i dadi di
+// regole.h tirati nello stesso ordine
+
+static Tipo_nemico nemico_qui(const Ramo* r, const Giocatore_ramo* g) {
+    Zona_compatta z = ramo_zona(r, g->posizione);
+    return g->mondo == 0 ? COMPATTA_NEMICO_MR(z) : COMPATTA_NEMICO_SS(z);
+}
+
+// Indice (0-2) dello slot che contiene l'oggetto, -1 se assente
+static int slot_di(const Giocatore_ramo* g, Tipo_oggetto o) {
+    for (int i = 0; i < 3; i++) if (g->zaino[i] == o) return i;
+    return -1;
+}
+
+// Azione che nel gioco cambierebbe qualcosa per il giocatore di turno
+static int azione_valida(const Ramo* r, int azione) {
+    const Giocatore_ramo* g = &r->giocatori[r->di_turno];
+    Zona_compatta z = ramo_zona(r, g->posizione);
+    Tipo_nemico nemico = g->mondo == 0 ? COMPATTA_NEMICO_MR(z) : COMPATTA_NEMICO_SS(z);
+    switch (azione) {
+        case 1: return !r->movimento_fatto && nemico == nessun_nemico && g->posizione + 1 < r->base->n;
+        case 2: return !r->movimento_fatto && nemico == nessun_nemico && g->posizione > 0;
+        case 3: return !r->movimento_fatto && (g->mondo == 1 || nemico == nessun_nemico);
+        case 4: return nemico != nessun_nemico;
+        case 7: return g->mondo == 0 && COMPATTA_OGGETTO(z) != nessun_oggetto && nemico == nessun_nemico
+                       && slot_di(g, nessun_oggetto) >= 0;
+        default: return azione == 9;
+    }
+}
+
+// Politica delle simulazioni: l'esploratore di gamelib.c
+static int azione_esploratore(const Ramo* r) {
+    const Giocatore_ramo* g = &r->giocatori[r->di_turno];
+    Zona_compatta z = ramo_zona(r, g->posizione);
+    if (nemico_qui(r, g) != nessun_nemico) return 4;
+    if (g->mondo == 0 && COMPATTA_OGGETTO(z) != nessun_oggetto && slot_di(g, nessun_oggetto) >= 0) return 7;
+    if (r->movimento_fatto) return 9;
+    if (g->mondo == 0) return 3;
+    if (g->posizione + 1 >= r->base->n) return 9;
+    return 1;
+}
+
+// Scontro del giocatore di turno con il nemico della sua zona, giocato come
+// l'esploratore: Schitarrata finché c'è, poi Attacco Pischico. Restituisce 0
+// se manca memoria
+static int scontro(Arena_rami* a, Rng* rng, Ramo* r) {
+    Giocatore_ramo* g = &r->giocatori[r->di_turno];
+    Tipo_nemico nemico = nemico_qui(r, g);
+    const Statistiche_nemico* sn = &statistiche_nemici[nemico];
+    int hp_giocatore = regole_hp_giocatore(g->difesa), hp_nemico = sn->hp, bonus_attacco = 0;
+
+    for (int scambi = 1; hp_giocatore > 0 && hp_nemico > 0; scambi++) {
+        if (scambi > MAX_SCAMBI_COMBATTIMENTO) return 1; // Ritirata
+        int slot = slot_di(g, schitarrata_metallica);
+        if (slot >= 0) {
+            bonus_attacco += BONUS_SCHITARRATA;
+            g->zaino[slot] = nessun_oggetto;
+        } else {
+            int critico = regole_critico(rng_intervallo(rng, TIRO_CRITICO_MIN, TIRO_CRITICO_MAX), g->fortuna);
+            int variazione = rng_intervallo(rng, VARIAZIONE_ATTACCO_MIN, VARIAZIONE_ATTACCO_MAX);
+            hp_nemico -= regole_danno_inflitto(g->attacco + bonus_attacco, sn->difesa, variazione, critico);
+        }
+        if (hp_nemico > 0)
+            hp_giocatore -= regole_danno_subito(sn->attacco, g->difesa,
+                                                rng_intervallo(rng, VARIAZIONE_NEMICO_MIN, VARIAZIONE_NEMICO_MAX));
+    }
+    if (hp_giocatore <= 0) {
+        g->vivo = 0;
+        return 1;
+    }
+    if (regole_svanisce(rng_intervallo(rng, TIRO_SCOMPARSA_MIN, TIRO_SCOMPARSA_MAX))) {
+        if (!ramo_togli_nemico(a, r, g->posizione, g->mondo)) return 0;
+        if (nemico == demotorzone) r->vincitore = r->di_turno;
+    }
+    return 1;
+}
+
+// Esegue un'azione valida del giocatore di turno. Restituisce 0 se manca memoria
+static int esegui(Arena_rami* a, Rng* rng, Ramo* r, int azione) {
+    Giocatore_ramo* g = &r->giocatori[r->di_turno];
+    switch (azione) {
+        case 1: g->posizione++; r->movimento_fatto = 1; break;
+        case 2: g->posizione--; r->movimento_fatto = 1; break;
+        case 3:
+            // Fuga dal Soprasotto con il tiro Fortuna; anche quella fallita consuma il movimento
+            if (g->mondo == 0) g->mondo = 1;
+            else if (regole_fuga(rng_intervallo(rng, TIRO_FUGA_MIN, TIRO_FUGA_MAX), g->fortuna)) g->mondo = 0;
+            r->movimento_fatto = 1;
+            break;
+        case 4: return scontro(a, rng, r);
+        case 7:
+            g->zaino[slot_di(g, nessun_oggetto)] = COMPATTA_OGGETTO(ramo_zona(r, g->posizione));
+            return ramo_togli_oggetto(a, r, g->posizione);
+        default: break;
+    }
+    return 1;
+}
+
+static int finita(const Ramo* r) {
+    if (r->vincitore >= 0) return 1;
+    for (int i = 0; i < r->numero_giocatori; i++) if (r->giocatori[i].vivo) return 0;
+    return 1;
+}
+
+// rng_intervallo come dado di regole_mescola_ordine
+static int estrai_rng(void* rng, int min, int max) {
+    return rng_intervallo((Rng*) rng, min, max);
+}
+
+// Passa al prossimo giocatore vivo, rimescolando l'ordine a ogni round.
+// Restituisce 0 a partita finita o dopo ultimo_round
+static int prossimo_turno(Rng* rng, Ramo* r, int ultimo_round) {
+    for (;;) {
+        if (finita(r)) return 0;
+        if (r->prossimo >= r->numero_giocatori) {
+            if (r->round > ultimo_round) return 0;
+            r->round++;
+            regole_mescola_ordine(r->ordine, r->numero_giocatori, estrai_rng, rng);
+            r->prossimo = 0;
+        }
+        int i = r->ordine[r->prossimo++];
+        if (!r->giocatori[i].vivo) continue;
+        r->di_turno = i;
+        r->movimento_fatto = 0;
+        return 1;
+    }
+}
+
+// Esegue l'azione del giocatore di turno e, se il turno finisce (passa,
+// troppe azioni, morte), passa al prossimo. *azioni conta quelle del turno.
+// Restituisce 1 se la partita continua, 0 se è finita o oltre ultimo_round,
+// -1 se manca memoria
+static int passo(Arena_rami* a, Rng* rng, Ramo* r, int azione, int* azioni, int ultimo_round) {
+    if (!esegui(a, rng, r, azione)) return -1;
+    if (finita(r)) return 0;
+    if (azione == 9 || ++*azioni >= MAX_AZIONI_TURNO || !r->giocatori[r->di_turno].vivo) {
+        *azioni = 0;
+        if (!prossimo_turno(rng, r, ultimo_round)) return 0;
+    }
+    return 1;
+}
+
+int mcts_gioca_esploratore(Arena_rami* a, Ramo* r, Rng* rng) {
+    if (r->di_turno < 0 || finita(r)) return 1;
+    int ultimo_round = r->max_round > 0 ? r->max_round : INT_MAX;
+    int azioni = 0, esito;
+    while ((esito = passo(a, rng, r, azione_esploratore(r), &azioni, ultimo_round)) > 0) {}
+    return esito == 0;
+}
+
+// ============================================================================
+// ALBERO CONDIVISO
+// ============================================================================
+
+static void azzera_nodo(Nodo_mcts* n) {
+    for (int k = 0; k < AZIONI; k++) atomic_init(&n->figli[k], NULL);
+    atomic_init(&n->visite, 0);
+    atomic_init(&n->vittorie, 0);
+}
+
+// Figlio da visitare tra le azioni valide nel ramo: la prima mai provata
+// (espansione, *nuovo = 1), altrimenti il migliore per UCT. Con l'albero
+// pieno si sceglie solo tra i figli esistenti; NULL se non ce ne sono
+static Nodo_mcts* scegli_figlio(Mcts* m, Nodo_mcts* nodo, const Ramo* r, int* azione, int* nuovo) {
+    int pieno = atomic_load_explicit(&m->usati, memory_order_relaxed) >= m->o.nodi;
+    double log_visite = log((double) atomic_load_explicit(&nodo->visite, memory_order_relaxed) + 1.0);
+    Nodo_mcts* migliore = NULL;
+    double punteggio_migliore = -1.0;
+    *nuovo = 0;
+
+    for (int k = 0; k < AZIONI; k++) {
+        if (!azione_valida(r, azioni_albero[k])) continue;
+        Nodo_mcts* figlio = atomic_load_explicit(&nodo->figli[k], memory_order_acquire);
+        if (figlio == NULL) {
+            if (pieno) continue;
+            size_t i = atomic_fetch_add_explicit(&m->usati, 1, memory_order_relaxed);
+            if (i >= m->o.nodi) { pieno = 1; continue; }
+            Nodo_mcts* creato = &m->nodi[i];
+            azzera_nodo(creato);
+            // Se un altro thread l'ha aggiunto prima si usa il suo (il nodo preso va perso)
+            Nodo_mcts* atteso = NULL;
+            if (atomic_compare_exchange_strong_explicit(&nodo->figli[k], &atteso, creato,
+                                                        memory_order_acq_rel, memory_order_acquire)) {
+                *nuovo = 1;
+                figlio = creato;
+            } else {
+                figlio = atteso;
+            }
+            *azione = azioni_albero[k];
+            return figlio;
+        }
+        unsigned visite = atomic_load_explicit(&figlio->visite, memory_order_relaxed);
+        unsigned vittorie = atomic_load_explicit(&figlio->vittorie, memory_order_relaxed);
+        double punteggio = visite == 0 ? INFINITY
+            : (double) vittorie / visite + ESPLORAZIONE * sqrt(log_visite / visite);
+        if (punteggio > punteggio_migliore) {
+            punteggio_migliore = punteggio;
+            migliore = figlio;
+            *azione = azioni_albero[k];
+        }
+    }
+    return migliore;
+}
+
+// Una simulazione: discesa nell'albero finché decide il giocatore della
+// radice, un nodo nuovo, poi l'esploratore per tutti fino alla fine della
+// partita o dell'orizzonte. Restituisce 0 se manca memoria
+static int simula(Lavoro_mcts* l) {
+    Mcts* m = l->m;
+    Segno_arena segno = ramo_arena_segna(&l->arena);
+    Ramo* r = ramo_biforca(&l->arena, m->radice);
+    if (r == NULL) return 0;
+
+    Nodo_mcts* percorso[MAX_PROFONDITA];
+    int profondita = 0, azioni = 0, ok = 1;
+    Nodo_mcts* nodo = &m->nodi[0];
+    // Perdita virtuale: la visita conta da subito, la vittoria solo al ritorno
+    atomic_fetch_add_explicit(&nodo->visite, 1, memory_order_relaxed);
+    percorso[profondita++] = nodo;
+
+    for (;;) {
+        int azione = 0, nuovo = 0;
+        Nodo_mcts* figlio = NULL;
+        if (nodo != NULL && r->di_turno == m->decisore && profondita < MAX_PROFONDITA)
+            figlio = scegli_figlio(m, nodo, r, &azione, &nuovo);
+        if (figlio != NULL) {
+            atomic_fetch_add_explicit(&figlio->visite, 1, memory_order_relaxed);
+            percorso[profondita++] = figlio;
+            nodo = nuovo ? NULL : figlio;
+        } else {
+            nodo = r->di_turno == m->decisore ? NULL : nodo; // Fuori dall'albero non si rientra
+            azione = azione_esploratore(r);
+        }
+
+        int esito = passo(&l->arena, &l->rng, r, azione, &azioni, m->ultimo_round);
+        if (esito < 0) ok = 0;
+        if (esito <= 0) break;
+    }
+
+    unsigned vinta = r->vincitore == m->decisore;
+    if (vinta)
+        for (int i = 0; i < profondita; i++) atomic_fetch_add_explicit(&percorso[i]->vittorie, 1, memory_order_relaxed);
+    ramo_arena_torna(&l->arena, segno);
+    return ok;
+}
+
+// Compito di un thread: simulazioni fino alla scadenza o al limite
+static void cerca(void* dati) {
+    Lavoro_mcts* l = (Lavoro_mcts*) dati;
+    Mcts* m = l->m;
+    for (;;) {
+        if (m->o.simulazioni > 0
+            && atomic_fetch_add_explicit(&m->avviate, 1, memory_order_relaxed) >= m->o.simulazioni) break;
+        if (m->o.millisecondi > 0 && ora_secondi() >= m->scadenza) break;
+        if (!simula(l)) break;
+        l->simulazioni++;
+    }
+}
+
+// ============================================================================
+// DECISIONI
+// ============================================================================
+
+Mcts* mcts_crea(const Opzioni_mcts* o) {
+    Mcts* m = (Mcts*) calloc(1, sizeof(Mcts));
+    if (m == NULL) return NULL;
+    m->o = *o;
+    if (m->o.millisecondi <= 0 && m->o.simulazioni == 0) m->o.millisecondi = 50; // Senza limiti non finirebbe
+    if (m->o.orizzonte <= 0) m->o.orizzonte = ORIZZONTE_DEFAULT;
+    if (m->o.nodi == 0) m->o.nodi = NODI_DEFAULT;
+    ramo_arena_azzera(&m->arena_radice);
+
+    m->p = pianificatore_crea(o->thread);
+    m->nodi = (Nodo_mcts*) malloc(m->o.nodi * sizeof(Nodo_mcts));
+    if (m->p != NULL) {
+        m->thread = pianificatore_thread(m->p);
+        m->lavori = (Lavoro_mcts*) calloc((size_t) m->thread, sizeof(Lavoro_mcts));
+    }
+    if (m->p == NULL || m->nodi == NULL || m->lavori == NULL) { mcts_distruggi(m); return NULL; }
+    for (int k = 0; k < m->thread; k++) m->lavori[k].m = m;
+    return m;
+}
+
+void mcts_distruggi(Mcts* m) {
+    if (m == NULL) return;
+    if (m->p != NULL) pianificatore_distruggi(m->p);
+    if (m->lavori != NULL)
+        for (int k = 0; k < m->thread; k++) ramo_arena_distruggi(&m->lavori[k].arena);
+    ramo_arena_distruggi(&m->arena_radice);
+    compatta_distruggi(&m->base);
+    free(m->lavori);
+    free(m->nodi);
+    free(m);
+}
+
+int mcts_decidi(Mcts* m, const Sessione* s, Decisione_mcts* d) {
+    memset(d, 0, sizeof(*d));
+    compatta_distruggi(&m->base);
+    ramo_arena_azzera(&m->arena_radice);
+    if (!mappa_esporta_compatta(s, &m->base)) return 0;
+    Ramo* radice = partita_ramo(s, &m->arena_radice, &m->base);
+    if (radice == NULL || radice->di_turno < 0 || !radice->giocatori[radice->di_turno].vivo || finita(radice)) return 0;
+
+    m->radice = radice;
+    m->decisore = radice->di_turno;
+    // radice->round è il round dopo quello in corso. Il limite della partita
+    // conta: con il solo orizzonte, che si sposta a ogni decisione, passare
+    // sembrerebbe sempre gratis
+    m->ultimo_round = radice->round - 1 + m->o.orizzonte;
+    if (radice->max_round > 0 && radice->max_round < m->ultimo_round) m->ultimo_round = radice->max_round;
+    azzera_nodo(&m->nodi[0]);
+    atomic_store(&m->usati, 1);
+    atomic_store(&m->avviate, 0);
+    // Dadi diversi a ogni decisione, ripetibili a parità di seme e thread
+    for (int k = 0; k < m->thread; k++) {
+        Lavoro_mcts* l = &m->lavori[k];
+        rng_flusso(&l->rng, m->o.seme, m->decisioni * (unsigned long long) m->thread + (unsigned long long) k);
+        ramo_arena_azzera(&l->arena);
+        l->simulazioni = 0;
+    }
+    m->decisioni++;
+    m->scadenza = ora_secondi() + m->o.millisecondi / 1000.0;
+
+    for (int k = 0; k < m->thread; k++)
+        if (!pianificatore_invia(m->p, cerca, &m->lavori[k])) cerca(&m->lavori[k]);
+    pianificatore_attendi(m->p);
+
+    // Si gioca il figlio più visitato della radice (a pari visite il più vincente)
+    const Nodo_mcts* nodo = &m->nodi[0];
+    for (int k = 0; k < AZIONI; k++) {
+        const Nodo_mcts* figlio = atomic_load(&nodo->figli[k]);
+        if (figlio == NULL) continue;
+        int a = azioni_albero[k];
+        unsigned visite = atomic_load(&figlio->visite);
+        d->visite[a] = visite;
+        d->vittorie[a] = visite > 0 ? (double) atomic_load(&figlio->vittorie) / visite : 0.0;
+        if (d->azione == 0 || visite > d->visite[d->azione]
+            || (visite == d->visite[d->azione] && d->vittorie[a] > d->vittorie[d->azione])) d->azione = a;
+    }
+    for (int k = 0; k < m->thread; k++) d->simulazioni += m->lavori[k].simulazioni;
+    size_t usati = atomic_load(&m->usati);
+    d->nodi = usati < m->o.nodi ? usati : m->o.nodi;
+    if (d->azione == 0) d->azione = azione_esploratore(radice); // Nessuna simulazione nel tempo dato
+    d->vittoria = d->vittorie[d->azione];
+    return 1;
+}
+
+const char* mcts_nome_azione(int azione) {
+    static const char* const nomi[] = { "", "Avanza", "Indietreggia", "Cambia Mondo", "Combatti", "Stampa Giocatore",
+                                        "Stampa Zona", "Raccogli Oggetto", "Utilizza Oggetto", "Passa" };
+    return (azione >= 1 && azione <= 9) ? nomi[azione] : "";
+}
+
+// --- Agente MCTS: azioni di turno dalla ricerca, scontri e oggetti come l'esploratore ---
+static int mcts_azione(struct Giocatore* g, int movimento_fatto, void* dati) {
+    Mcts* m = (Mcts*) dati;
+    Decisione_mcts d;
+    if (!mcts_decidi(m, m->sessione, &d)) return agente_esploratore.scegli_azione(g, movimento_fatto, NULL);
+    stampa("%s (MCTS) sceglie: %s (vittoria stimata %.1f%%)\n", g->nome, mcts_nome_azione(d.azione), d.vittoria * 100.0);
+    return d.azione;
+}
+
+Agente agente_mcts(Mcts* m, Sessione* s) {
+    m->sessione = s;
+    Agente a = agente_esploratore;
+    a.scegli_azione = mcts_azione;
+    a.dati = m;
+    return a;
+}
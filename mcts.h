@@ -0,0 +1,81 @@
+#ifndef MCTS_H
+#define MCTS_H
+
+#include "gamelib.h"
+#include "ramo.h"
+#include "rng.h"
+
+// ============================================================================
+// RICERCA AD ALBERO MONTE CARLO PER LE DECISIONI DI TURNO
+// ============================================================================
+// Sceglie l'azione del menu di turno simulando molte continuazioni della
+// partita su tutti i core, entro un tempo per decisione. L'albero è "a ciclo
+// aperto": un nodo è una sequenza di azioni del giocatore che decide, e ogni
+// simulazione ritira i dadi su un ramo biforcato dallo stato attuale (vedi
+// ramo.h). Fughe dal Soprasotto, critici e nemici che svaniscono pesano
+// quindi quanto nel gioco, senza nodi di caso.
+//
+// Tutti i thread lavorano sullo stesso albero senza lock: visite e vittorie
+// dei nodi sono contatori atomici e un figlio si aggiunge con un
+// compare-and-swap. Una visita conta già mentre il thread scende (perdita
+// virtuale): finché la simulazione non torna su il nodo sembra peggiore, e
+// gli altri thread provano altre strade.
+//
+// Le simulazioni seguono le regole del motore (regole.h). Oltre l'albero
+// tutti i giocatori giocano come l'esploratore, anche negli scontri
+// (Schitarrata subito, poi Attacco Pischico). Una simulazione vale 1 se chi decide
+// sconfigge il Demotorzone entro l'orizzonte, altrimenti 0.
+
+typedef struct Mcts Mcts;
+
+typedef struct Opzioni_mcts {
+    int millisecondi;              // Tempo per decisione (<= 0: solo il limite di simulazioni)
+    unsigned long long simulazioni; // Simulazioni per decisione (0: solo il tempo)
+    int thread;                    // <= 0: uno per core
+    int orizzonte;                 // Round simulati oltre quello in corso (<= 0: 200)
+    size_t nodi;                   // Nodi massimi dell'albero (0: 2^18)
+    unsigned long long seme;       // Dadi delle simulazioni
+} Opzioni_mcts;
+
+// 50 ms per decisione su tutti i core
+#define OPZIONI_MCTS_DEFAULT { 50, 0, 0, 200, 0, 1 }
+
+typedef struct Decisione_mcts {
+    int azione;                     // Azione del menu di turno (1-9), 0 se nessuna
+    double vittoria;                // Vittorie / visite dell'azione scelta
+    unsigned long long simulazioni; // Totali, su tutti i thread
+    size_t nodi;                    // Nodi dell'albero
+    unsigned long long visite[10];  // Per azione del menu
+    double vittorie[10];            // Per azione del menu, vittorie / visite
+} Decisione_mcts;
+
+// NULL se mancano memoria o thread
+Mcts* mcts_crea(const Opzioni_mcts* o);
+void mcts_distruggi(Mcts* m);
+
+// Decide per il giocatore di turno della partita di s, ferma su una
+// richiesta d'azione (la partita non viene toccata). Una decisione alla
+// volta per Mcts. Restituisce 0 se non c'è una decisione da prendere o
+// manca memoria
+int mcts_decidi(Mcts* m, const Sessione* s, Decisione_mcts* d);
+
+// Bot che sceglie le azioni con mcts_decidi sulla partita di s (un Mcts
+// serve una sessione alla volta); scontri e oggetti come l'esploratore
+Agente agente_mcts(Mcts* m, Sessione* s);
+
+// Collega m (NULL per scollegare) al gioco interattivo di s: con
+// suggerimenti il menu di turno mostra la mossa della ricerca, e i giocatori
+// con il bit i di bot acceso (0-3) sono giocati da agente_mcts.
+// Implementata in gamelib.c
+void partita_collega_mcts(Sessione* s, Mcts* m, int suggerimenti, unsigned int bot);
+
+// Gioca la partita del ramo fino alla fine (o a r->max_round) con tutti i
+// giocatori come l'esploratore e i dadi di rng: è la parte delle simulazioni
+// oltre l'albero. Con gli stessi dadi finisce come il motore con
+// agente_esploratore. Restituisce 0 se manca memoria
+int mcts_gioca_esploratore(Arena_rami* a, Ramo* r, Rng* rng);
+
+// Nome dell'azione del menu di turno ("Avanza", ...)
+const char* mcts_nome_azione(int azione);
+
+#endif
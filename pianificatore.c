@@ -0,0 +1,244 @@
+#define _POSIX_C_SOURCE 200809L
+#include "pianificatore.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define MAX_THREAD 256
+#define CAPACITA_INIZIALE 64
+
+typedef struct Voce {
+    Compito compito;
+    void* dati;
+} Voce;
+
+// Coda circolare a due estremità: il proprietario lavora sul fondo, i ladri
+// sulla cima. Il lock è per coda, quindi conteso solo durante un furto
+typedef struct Coda {
+    pthread_mutex_t mutex;
+    Voce* voci;
+    size_t capacita;  // Potenza di 2
+    size_t cima, fondo; // Contatori crescenti, indici modulo capacita
+} Coda;
+
+typedef struct Lavoratore {
+    Pianificatore* p;
+    int indice;
+    unsigned int seme; // Scelta della vittima dei furti
+    pthread_t thread;
+} Lavoratore;
+
+struct Pianificatore {
+    int n;                     // Thread avviati
+    int n_code;                // Code inizializzate
+    Coda* code;
+    Lavoratore* lavoratori;
+    atomic_size_t prossima;    // Coda per il prossimo compito inviato da fuori
+    atomic_size_t disponibili; // Compiti accodati non ancora presi
+    atomic_size_t in_sospeso;  // Compiti inviati non ancora finiti
+    atomic_int dormienti;
+    atomic_int fermo;
+    pthread_mutex_t mutex;     // Solo per dormire e per attendere la fine
+    pthread_cond_t lavoro;
+    pthread_cond_t finito;
+};
+
+// Lavoratore del thread corrente (NULL fuori dai pianificatori)
+static _Thread_local Lavoratore* lavoratore_corrente = NULL;
+
+// ============================================================================
+// CODE
+// ============================================================================
+
+static int coda_inizia(Coda* c) {
+    c->voci = (Voce*) malloc(CAPACITA_INIZIALE * sizeof(Voce));
+    if (c->voci == NULL) return 0;
+    c->capacita = CAPACITA_INIZIALE;
+    c->cima = c->fondo = 0;
+    pthread_mutex_init(&c->mutex, NULL);
+    return 1;
+}
+
+static void coda_distruggi(Coda* c) {
+    pthread_mutex_destroy(&c->mutex);
+    free(c->voci);
+}
+
+static int coda_inserisci(Coda* c, Voce v) {
+    pthread_mutex_lock(&c->mutex);
+    if (c->fondo - c->cima == c->capacita) {
+        Voce* voci = (Voce*) malloc(2 * c->capacita * sizeof(Voce));
+        if (voci == NULL) { pthread_mutex_unlock(&c->mutex); return 0; }
+        for (size_t i = c->cima; i < c->fondo; i++) voci[i & (2 * c->capacita - 1)] = c->voci[i & (c->capacita - 1)];
+        free(c->voci);
+        c->voci = voci;
+        c->capacita *= 2;
+    }
+    c->voci[c->fondo & (c->capacita - 1)] = v;
+    c->fondo++;
+    pthread_mutex_unlock(&c->mutex);
+    return 1;
+}
+
+// Il proprietario prende l'ultimo inserito
+static int coda_prendi(Coda* c, Voce* v) {
+    pthread_mutex_lock(&c->mutex);
+    int ok = c->fondo != c->cima;
+    if (ok) *v = c->voci[--c->fondo & (c->capacita - 1)];
+    pthread_mutex_unlock(&c->mutex);
+    return ok;
+}
+
+// Un altro thread ruba il più vecchio
+static int coda_ruba(Coda* c, Voce* v) {
+    if (pthread_mutex_trylock(&c->mutex) != 0) return 0; // Contesa: si prova un'altra coda
+    int ok = c->fondo != c->cima;
+    if (ok) *v = c->voci[c->cima++ & (c->capacita - 1)];
+    pthread_mutex_unlock(&c->mutex);
+    return ok;
+}
+
+// ============================================================================
+// THREAD
+// ============================================================================
+
+static int cerca_compito(Lavoratore* w, Voce* v) {
+    Pianificatore* p = w->p;
+    if (atomic_load(&p->disponibili) == 0) return 0;
+    if (coda_prendi(&p->code[w->indice], v)) return 1;
+    // Furto a partire da una vittima casuale
+    w->seme = w->seme * 1103515245u + 12345u;
+    int inizio = (int) ((w->seme >> 16) % (unsigned int) p->n);
+    for (int k = 0; k < p->n; k++) {
+        int vittima = (inizio + k) % p->n;
+        if (vittima != w->indice && coda_ruba(&p->code[vittima], v)) return 1;
+    }
+    return 0;
+}
+
+static void esegui(Pianificatore* p, Voce v) {
+    atomic_fetch_sub(&p->disponibili, 1);
+    v.compito(v.dati);
+    if (atomic_fetch_sub(&p->in_sospeso, 1) == 1) {
+        pthread_mutex_lock(&p->mutex);
+        pthread_cond_broadcast(&p->finito);
+        pthread_mutex_unlock(&p->mutex);
+    }
+}
+
+static void* ciclo_lavoratore(void* arg) {
+    Lavoratore* w = (Lavoratore*) arg;
+    Pianificatore* p = w->p;
+    lavoratore_corrente = w;
+    for (;;) {
+        Voce v;
+        if (cerca_compito(w, &v)) { esegui(p, v); continue; }
+        // Un compito accodato mentre si cercava (o rubato a metà da un
+        // altro) si vede da 'disponibili', controllato sotto mutex prima di dormire
+        pthread_mutex_lock(&p->mutex);
+        atomic_fetch_add(&p->dormienti, 1);
+        while (atomic_load(&p->disponibili) == 0 && !atomic_load(&p->fermo)) pthread_cond_wait(&p->lavoro, &p->mutex);
+        atomic_fetch_sub(&p->dormienti, 1);
+        pthread_mutex_unlock(&p->mutex);
+        if (atomic_load(&p->fermo) && atomic_load(&p->disponibili) == 0) break;
+    }
+    lavoratore_corrente = NULL;
+    return NULL;
+}
+
+// ============================================================================
+// API
+// ============================================================================
+
+Pianificatore* pianificatore_crea(int thread) {
+    if (thread <= 0) {
+        long core = sysconf(_SC_NPROCESSORS_ONLN);
+        thread = core > 0 ? (int) core : 1;
+    }
+    if (thread > MAX_THREAD) thread = MAX_THREAD;
+
+    Pianificatore* p = (Pianificatore*) calloc(1, sizeof(Pianificatore));
+    if (p == NULL) return NULL;
+    p->code = (Coda*) calloc((size_t) thread, sizeof(Coda));
+    p->lavoratori = (Lavoratore*) calloc((size_t) thread, sizeof(Lavoratore));
+    if (p->code == NULL || p->lavoratori == NULL) { free(p->code); free(p->lavoratori); free(p); return NULL; }
+    pthread_mutex_init(&p->mutex, NULL);
+    pthread_cond_init(&p->lavoro, NULL);
+    pthread_cond_init(&p->finito, NULL);
+
+    for (; p->n_code < thread; p->n_code++) {
+        if (!coda_inizia(&p->code[p->n_code])) { pianificatore_distruggi(p); return NULL; }
+    }
+    // Se il sistema non concede tutti i thread si lavora con quelli avviati.
+    // I thread leggono n solo dopo il primo compito, quindi lo si scrive alla fine
+    int avviati = 0;
+    for (; avviati < thread; avviati++) {
+        Lavoratore* w = &p->lavoratori[avviati];
+        w->p = p;
+        w->indice = avviati;
+        w->seme = (unsigned int) avviati * 2654435761u + 1u;
+        if (pthread_create(&w->thread, NULL, ciclo_lavoratore, w) != 0) break;
+    }
+    p->n = avviati;
+    if (p->n == 0) { pianificatore_distruggi(p); return NULL; }
+    return p;
+}
+
+int pianificatore_invia(Pianificatore* p, Compito compito, void* dati) {
+    Voce v = { compito, dati };
+    Lavoratore* w = lavoratore_corrente;
+    size_t i = (w != NULL && w->p == p) ? (size_t) w->indice : atomic_fetch_add(&p->prossima, 1) % (size_t) p->n;
+    atomic_fetch_add(&p->in_sospeso, 1);
+    if (!coda_inserisci(&p->code[i], v)) { atomic_fetch_sub(&p->in_sospeso, 1); return 0; }
+    atomic_fetch_add(&p->disponibili, 1);
+    if (atomic_load(&p->dormienti) > 0) {
+        pthread_mutex_lock(&p->mutex);
+        pthread_cond_signal(&p->lavoro);
+        pthread_mutex_unlock(&p->mutex);
+    }
+    return 1;
+}
+
+void pianificatore_attendi(Pianificatore* p) {
+    Lavoratore* w = lavoratore_corrente;
+    if (w != NULL && w->p == p) {
+        // Dentro un compito: bloccarsi potrebbe lasciare il pianificatore senza thread
+        Voce v;
+        while (atomic_load(&p->in_sospeso) > 1) {
+            if (cerca_compito(w, &v)) esegui(p, v);
+            else sched_yield();
+        }
+        return;
+    }
+    pthread_mutex_lock(&p->mutex);
+    while (atomic_load(&p->in_sospeso) > 0) pthread_cond_wait(&p->finito, &p->mutex);
+    pthread_mutex_unlock(&p->mutex);
+}
+
+void pianificatore_distruggi(Pianificatore* p) {
+    if (p == NULL) return;
+    if (p->n > 0) pianificatore_attendi(p);
+    pthread_mutex_lock(&p->mutex);
+    atomic_store(&p->fermo, 1);
+    pthread_cond_broadcast(&p->lavoro);
+    pthread_mutex_unlock(&p->mutex);
+    for (int i = 0; i < p->n; i++) pthread_join(p->lavoratori[i].thread, NULL);
+    for (int i = 0; i < p->n_code; i++) coda_distruggi(&p->code[i]);
+    pthread_mutex_destroy(&p->mutex);
+    pthread_cond_destroy(&p->lavoro);
+    pthread_cond_destroy(&p->finito);
+    free(p->code);
+    free(p->lavoratori);
+    free(p);
+}
+
+int pianificatore_thread(const Pianificatore* p) {
+    return p->n;
+}
+
+int pianificatore_indice_thread(const Pianificatore* p) {
+    Lavoratore* w = lavoratore_corrente;
+    return (w != NULL && w->p == p) ? w->indice : -1;
+}
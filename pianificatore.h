@@ -0,0 +1,37 @@
+#ifndef PIANIFICATORE_H
+#define PIANIFICATORE_H
+
+// ============================================================================
+// PIANIFICATORE A THREAD CON FURTO DI LAVORO
+// ============================================================================
+// Un gruppo fisso di thread esegue compiti indipendenti (es. una partita in
+// una sessione propria). Ogni thread ha la propria coda: prende i compiti
+// dal fondo (gli ultimi inseriti, ancora in cache) e quando la sua coda è
+// vuota ne ruba dalla cima della coda di un altro thread, così il carico si
+// bilancia anche con compiti di durata molto diversa. Un compito inviato da
+// un thread del pianificatore finisce nella sua coda; quelli inviati da
+// fuori sono distribuiti a turno tra le code.
+//
+// I thread senza lavoro dormono su una variabile di condizione e vengono
+// svegliati solo quando arriva un compito.
+
+typedef void (*Compito)(void* dati);
+
+typedef struct Pianificatore Pianificatore;
+
+// Crea il pianificatore con 'thread' thread (<= 0: uno per core). NULL se
+// mancano memoria o thread
+Pianificatore* pianificatore_crea(int thread);
+// Attende i compiti in sospeso, ferma i thread e libera tutto
+void pianificatore_distruggi(Pianificatore* p);
+// Accoda un compito. Restituisce 0 se manca la memoria (il compito non parte)
+int pianificatore_invia(Pianificatore* p, Compito compito, void* dati);
+// Attende che tutti i compiti inviati siano finiti. Chiamata da un thread del
+// pianificatore esegue compiti invece di bloccarsi
+void pianificatore_attendi(Pianificatore* p);
+int pianificatore_thread(const Pianificatore* p);
+// Indice (0 .. pianificatore_thread - 1) del thread di p che chiama, -1 se
+// chiamata da fuori: per dati privati di ogni thread senza lock
+int pianificatore_indice_thread(const Pianificatore* p);
+
+#endif
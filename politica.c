@@ -0,0 +1,245 @@
+#define _POSIX_C_SOURCE 200809L
+#include "politica.h"
+#include "probabilita.h"
+#include <math.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+// Sotto questa soglia di zone per thread non conviene creare thread
+#define ZONE_PER_THREAD_MIN 65536
+#define MAX_THREAD 256
+
+// Valori in scala logaritmica: log(probabilità di vittoria), -inf se nulla.
+// Così il prodotto delle probabilità lungo una mappa di milioni di zone non
+// va in underflow e l'iterazione dei valori è fatta solo di somme e massimi
+#define NULLO (-INFINITY)
+
+// Il vettore (ingresso MR, ingresso SS, 0) di una zona è la matrice della
+// zona per quello della successiva, nel semianello (max, +). La terza riga
+// è sempre (-inf, -inf, 0) e non viene memorizzata.
+typedef double Matrice[2][3];
+
+struct Politica {
+    size_t n;
+    double scontro[4];  // log della probabilità di liberare la zona, per Tipo_nemico
+    int fuga;           // Dal Soprasotto si può tornare (Fortuna >= 2)
+    Matrice zona[4][4]; // Per nemico MR e nemico SS: le zone sono solo 16 casi
+    double (*ingresso)[2]; // ingresso[i][mondo]: valore arrivando nella zona i (n + 1 voci)
+};
+
+// Valori di una zona: W[mondo][nemico MR presente][nemico SS presente]
+typedef double Valori_zona[2][2][2];
+
+static inline double massimo(double a, double b) {
+    return a > b ? a : b;
+}
+
+// ============================================================================
+// ITERAZIONE DEI VALORI IN UNA ZONA
+// ============================================================================
+// x[0], x[1]: valori d'ingresso della zona successiva nei due mondi; x[2]:
+// valore della vittoria (0 = log 1). Gli stati con meno nemici non dipendono
+// da quelli con più nemici, quindi si risolvono per primi; nello stesso
+// gruppo i due mondi si richiamano (cambio di mondo e fuga) e due passate
+// bastano a chiudere il ciclo.
+
+static void risolvi_zona(const Politica* p, Tipo_nemico nemico_mr, Tipo_nemico nemico_ss,
+                         const double x[3], Valori_zona w) {
+    int presente_mr = nemico_mr != nessun_nemico, presente_ss = nemico_ss != nessun_nemico;
+    for (int a = 0; a <= presente_mr; a++) {
+        for (int b = 0; b <= presente_ss; b++) {
+            w[0][a][b] = w[1][a][b] = NULLO;
+            for (int passata = 0; passata < 2; passata++) {
+                // Mondo Reale: un nemico blocca tutto, si può solo combattere
+                if (a) w[0][a][b] = p->scontro[nemico_mr] + (nemico_mr == demotorzone ? x[2] : w[0][0][b]);
+                else w[0][a][b] = massimo(x[0], w[1][0][b]);
+                // Soprasotto: il nemico blocca l'avanzata ma non la fuga
+                double v = b ? p->scontro[nemico_ss] + (nemico_ss == demotorzone ? x[2] : w[1][a][0]) : x[1];
+                if (p->fuga) v = massimo(v, w[0][a][b]);
+                w[1][a][b] = v;
+            }
+        }
+    }
+}
+
+// ============================================================================
+// RIDUZIONE IN PARALLELO
+// ============================================================================
+// Risolta una volta la matrice di ogni combinazione di nemici, una mappa si
+// riduce con soli prodotti di matrici: ogni blocco calcola il prodotto delle
+// sue zone, i confini si propagano dall'ultimo blocco al primo e infine ogni
+// blocco applica le matrici all'indietro dal proprio confine.
+
+static void matrice_zona(const Politica* p, Tipo_nemico nemico_mr, Tipo_nemico nemico_ss, Matrice m) {
+    int a = nemico_mr != nessun_nemico, b = nemico_ss != nessun_nemico;
+    for (int j = 0; j < 3; j++) {
+        // Colonna j: la zona risolta con 0 nella coordinata j e -inf nelle altre
+        double x[3] = { NULLO, NULLO, NULLO };
+        x[j] = 0.0;
+        Valori_zona w;
+        risolvi_zona(p, nemico_mr, nemico_ss, x, w);
+        m[0][j] = w[0][a][b];
+        m[1][j] = w[1][a][b];
+    }
+}
+
+// r = a * b
+static void moltiplica(const Matrice a, const Matrice b, Matrice r) {
+    for (int i = 0; i < 2; i++) {
+        double c0 = massimo(a[i][0] + b[0][0], a[i][1] + b[1][0]);
+        double c1 = massimo(a[i][0] + b[0][1], a[i][1] + b[1][1]);
+        double c2 = massimo(massimo(a[i][0] + b[0][2], a[i][1] + b[1][2]), a[i][2]);
+        r[i][0] = c0; r[i][1] = c1; r[i][2] = c2;
+    }
+}
+
+typedef struct Blocco {
+    Politica* p;
+    const Mappa_soa* m;
+    size_t lo, hi;
+    Matrice prodotto; // Fase 1: matrici delle zone lo..hi-1 moltiplicate
+} Blocco;
+
+// Valori oltre 3 (file di testo scritti a mano) valgono come nessun nemico
+static const Matrice* matrice_di(const Politica* p, const Mappa_soa* m, size_t i) {
+    unsigned mr = m->nemico_mr[i], ss = m->nemico_ss[i];
+    return &p->zona[mr < 4 ? mr : 0][ss < 4 ? ss : 0];
+}
+
+static void* riduci_blocco(void* arg) {
+    Blocco* b = (Blocco*) arg;
+    if (b->lo == 0) return NULL; // Il primo blocco non serve a nessun confine
+    Matrice r = { { 0.0, NULLO, NULLO }, { NULLO, 0.0, NULLO } }, t;
+    for (size_t i = b->hi; i-- > b->lo; ) {
+        moltiplica(*matrice_di(b->p, b->m, i), r, t);
+        memcpy(r, t, sizeof(r));
+    }
+    memcpy(b->prodotto, r, sizeof(r));
+    return NULL;
+}
+
+// Valori d'ingresso delle zone lo..hi-1, all'indietro da quelli in hi
+static void* risolvi_blocco(void* arg) {
+    Blocco* b = (Blocco*) arg;
+    double (*ingresso)[2] = b->p->ingresso;
+    for (size_t i = b->hi; i-- > b->lo; ) {
+        const Matrice* z = matrice_di(b->p, b->m, i);
+        for (int k = 0; k < 2; k++)
+            ingresso[i][k] = massimo(massimo((*z)[k][0] + ingresso[i + 1][0], (*z)[k][1] + ingresso[i + 1][1]), (*z)[k][2]);
+    }
+    return NULL;
+}
+
+static int thread_da_usare(size_t zone, int thread) {
+    long core = thread > 0 ? thread : sysconf(_SC_NPROCESSORS_ONLN);
+    if (core < 1) core = 1;
+    long utili = (long) (zone / ZONE_PER_THREAD_MIN);
+    if (utili < 1) utili = 1;
+    if (core > utili) core = utili;
+    if (core > MAX_THREAD) core = MAX_THREAD;
+    return (int) core;
+}
+
+// Il thread chiamante prende il primo blocco; se un thread non parte, il suo
+// blocco viene svolto qui
+static void esegui_blocchi(void* (*lavoro)(void*), Blocco* blocchi, int t) {
+    pthread_t thread[MAX_THREAD];
+    int avviati[MAX_THREAD] = {0};
+    for (int k = 1; k < t; k++) avviati[k] = (pthread_create(&thread[k], NULL, lavoro, &blocchi[k]) == 0);
+    lavoro(&blocchi[0]);
+    for (int k = 1; k < t; k++) {
+        if (avviati[k]) pthread_join(thread[k], NULL);
+        else lavoro(&blocchi[k]);
+    }
+}
+
+// ============================================================================
+// FUNZIONI PUBBLICHE
+// ============================================================================
+
+Politica* politica_risolvi(const Mappa_soa* m, int attacco, int difesa, int fortuna, int thread) {
+    Politica* p = (Politica*) malloc(sizeof(Politica));
+    if (p == NULL) return NULL;
+    p->ingresso = (double (*)[2]) malloc((m->n + 1) * sizeof(*p->ingresso));
+    if (p->ingresso == NULL) { free(p); return NULL; }
+    p->n = m->n;
+    p->fuga = fortuna >= 2; // Fuga riuscita con un tiro 1-20 minore della Fortuna
+    p->scontro[nessun_nemico] = 0.0;
+    for (int e = billi; e <= demotorzone; e++) {
+        double v = probabilita_vittoria(attacco, difesa, fortuna, (Tipo_nemico) e);
+        p->scontro[e] = v > 0.0 ? log(v / (2.0 - v)) : NULLO;
+    }
+    for (int mr = 0; mr < 4; mr++)
+        for (int ss = 0; ss < 4; ss++) matrice_zona(p, (Tipo_nemico) mr, (Tipo_nemico) ss, p->zona[mr][ss]);
+    // Oltre l'ultima zona non si avanza
+    p->ingresso[m->n][0] = p->ingresso[m->n][1] = NULLO;
+
+    int t = thread_da_usare(m->n, thread);
+    Blocco blocchi[MAX_THREAD];
+    for (int k = 0; k < t; k++) {
+        Blocco b = { p, m, m->n * (size_t) k / (size_t) t, m->n * (size_t) (k + 1) / (size_t) t, { { 0 } } };
+        blocchi[k] = b;
+    }
+    if (t > 1) {
+        esegui_blocchi(riduci_blocco, blocchi, t);
+        // Ingressi ai confini dei blocchi, dall'ultimo al primo
+        for (int k = t - 1; k > 0; k--) {
+            Blocco* b = &blocchi[k];
+            for (int i = 0; i < 2; i++)
+                p->ingresso[b->lo][i] = massimo(massimo(b->prodotto[i][0] + p->ingresso[b->hi][0],
+                                                        b->prodotto[i][1] + p->ingresso[b->hi][1]), b->prodotto[i][2]);
+        }
+    }
+    esegui_blocchi(risolvi_blocco, blocchi, t);
+    return p;
+}
+
+void politica_distruggi(Politica* p) {
+    if (p == NULL) return;
+    free(p->ingresso);
+    free(p);
+}
+
+size_t politica_zone(const Politica* p) {
+    return p->n;
+}
+
+// Valori della zona pos con i nemici dati e ingressi della successiva
+static void valori_in(const Politica* p, size_t pos, Tipo_nemico nemico_mr, Tipo_nemico nemico_ss, Valori_zona w) {
+    double x[3] = { p->ingresso[pos + 1][0], p->ingresso[pos + 1][1], 0.0 };
+    risolvi_zona(p, nemico_mr, nemico_ss, x, w);
+}
+
+int politica_azione(const Politica* p, size_t pos, int mondo, Tipo_nemico nemico_mr, Tipo_nemico nemico_ss, int movimento_fatto) {
+    if (pos >= p->n) return 9;
+    Valori_zona w;
+    valori_in(p, pos, nemico_mr, nemico_ss, w);
+    int a = nemico_mr != nessun_nemico, b = nemico_ss != nessun_nemico;
+    Tipo_nemico nemico = mondo == 0 ? nemico_mr : nemico_ss;
+    int ultima = pos + 1 == p->n;
+
+    // Opzioni in ordine di preferenza a parità di valore: avanzare prima di
+    // cambiare mondo, combattere prima di fuggire (un cambio di mondo che
+    // vale quanto restare non deve ripetersi all'infinito)
+    double migliore = NULLO;
+    int azione = 0;
+    if (nemico == nessun_nemico && !ultima) { migliore = p->ingresso[pos + 1][mondo]; azione = 1; }
+    if (nemico != nessun_nemico) {
+        double v = p->scontro[nemico] + (nemico == demotorzone ? 0.0 : w[mondo][mondo == 0 ? 0 : a][mondo == 0 ? b : 0]);
+        if (azione == 0 || v > migliore) { migliore = v; azione = 4; }
+    }
+    if (mondo == 0 ? !a : p->fuga) {
+        double v = w[1 - mondo][a][b];
+        if (azione == 0 || v > migliore) { migliore = v; azione = 3; }
+    }
+    if (azione == 0 || (movimento_fatto && azione != 4)) return 9;
+    return azione;
+}
+
+double politica_vittoria(const Politica* p, size_t pos, int mondo, Tipo_nemico nemico_mr, Tipo_nemico nemico_ss) {
+    if (pos >= p->n) return 0.0;
+    Valori_zona w;
+    valori_in(p, pos, nemico_mr, nemico_ss, w);
+    return exp(w[mondo != 0][nemico_mr != nessun_nemico][nemico_ss != nessun_nemico]);
+}
@@ -0,0 +1,45 @@
+#ifndef POLITICA_H
+#define POLITICA_H
+
+#include "gamelib.h"
+#include "mappa_soa.h"
+
+// ============================================================================
+// POLITICA OTTIMA DI UN GIOCATORE (PROCESSO DECISIONALE DI MARKOV)
+// ============================================================================
+// Un giocatore da solo su una mappa chiusa è un MDP finito: i movimenti sono
+// deterministici, il caso sta nella fuga dal Soprasotto (tiro Fortuna), negli
+// scontri e nel 50% con cui un nemico sconfitto svanisce. Lo stato è
+// (posizione, mondo, nemici ancora presenti nella zona nei due mondi); le
+// zone più avanti sono come sulla mappa. L'obiettivo è la probabilità di
+// sconfiggere il Demotorzone.
+//
+// Semplificazioni, come in probabilita.h: scontri sempre con l'Attacco
+// Pischico (vittoria dalla tabella esatta), oggetti fuori dal modello, nessun
+// limite di round e nessun altro giocatore. Gli scontri non consumano il
+// movimento, quindi un nemico si combatte finché non svanisce: riuscirci
+// vale p / (2 - p). Tornare indietro non serve mai (la zona precedente non
+// offre nulla che quella attuale non abbia già).
+//
+// Senza limite di round l'iterazione dei valori su una zona dipende solo dai
+// valori d'ingresso della zona successiva, e in scala logaritmica è lineare
+// nel semianello (max, +): ogni zona è una matrice 3x3 e la mappa intera è
+// il loro prodotto. Con mappe grandi i blocchi di zone si riducono in
+// parallelo alle loro matrici, poi ogni thread risolve il proprio blocco.
+
+typedef struct Politica Politica;
+
+// Risolve la mappa per un giocatore con queste statistiche. thread <= 0:
+// tutti i core (solo con mappe abbastanza grandi). NULL se manca memoria
+Politica* politica_risolvi(const Mappa_soa* m, int attacco, int difesa, int fortuna, int thread);
+void politica_distruggi(Politica* p);
+
+// Azione ottima del menu di turno (1 Avanza, 3 Cambia Mondo, 4 Combatti,
+// 9 Passa) nella zona pos, nel mondo dato, con i nemici presenti ora nella
+// zona. Con il movimento già fatto resta solo combattere o passare
+int politica_azione(const Politica* p, size_t pos, int mondo, Tipo_nemico nemico_mr, Tipo_nemico nemico_ss, int movimento_fatto);
+// Probabilità (0-1) di vittoria dallo stesso stato seguendo la politica
+double politica_vittoria(const Politica* p, size_t pos, int mondo, Tipo_nemico nemico_mr, Tipo_nemico nemico_ss);
+size_t politica_zone(const Politica* p);
+
+#endif
@@ -0,0 +1,127 @@
+#include "pool_zone.h"
+
+// Il primo blocco contiene 64 slot, ogni blocco successivo il doppio del
+// precedente fino a un massimo: poche malloc anche per mappe enormi
+#define SLOT_PRIMO_BLOCCO 64
+#define SLOT_MAX_BLOCCO (1 << 16)
+
+typedef struct Slab_zone {
+    struct Slab_zone* successivo;
+    size_t capacita;
+    Slot_zona slot[]; // Slot contigui
+} Slab_zone;
+
+// Nella free list il collegamento al successivo è scritto all'inizio dello
+// slot libero (lo slot non contiene zone valide finché non viene riusato)
+static Slot_zona* prossimo_libero(Slot_zona* slot) {
+    return *(Slot_zona**) slot;
+}
+
+static Slab_zone* nuovo_blocco(size_t capacita) {
+    Slab_zone* b = (Slab_zone*) malloc(sizeof(Slab_zone) + capacita * sizeof(Slot_zona));
+    if (b == NULL) return NULL;
+    b->successivo = NULL;
+    b->capacita = capacita;
+    return b;
+}
+
+Slot_zona* pool_alloca(Pool_zone* pool) {
+    pool->allocazioni++;
+
+    // Prima gli slot restituiti
+    if (pool->liberi != NULL) {
+        Slot_zona* s = pool->liberi;
+        pool->liberi = prossimo_libero(s);
+        pool->liberi_count--;
+        pool->riusi++;
+        pool->in_uso++;
+        return s;
+    }
+
+    // Blocco corrente esaurito: si passa al successivo (già allocato dopo un
+    // azzeramento) oppure se ne alloca uno nuovo grande il doppio
+    if (pool->corrente == NULL || pool->usati_corrente == pool->corrente->capacita) {
+        Slab_zone* prossimo = pool->corrente ? pool->corrente->successivo : pool->primo;
+        if (prossimo == NULL) {
+            size_t capacita = pool->corrente ? pool->corrente->capacita * 2 : SLOT_PRIMO_BLOCCO;
+            if (capacita > SLOT_MAX_BLOCCO) capacita = SLOT_MAX_BLOCCO;
+            prossimo = nuovo_blocco(capacita);
+            if (prossimo == NULL) { pool->allocazioni--; return NULL; }
+            if (pool->corrente) pool->corrente->successivo = prossimo;
+            else pool->primo = prossimo;
+        }
+        pool->corrente = prossimo;
+        pool->usati_corrente = 0;
+    }
+
+    pool->in_uso++;
+    return &pool->corrente->slot[pool->usati_corrente++];
+}
+
+Slot_zona* pool_alloca_blocco(Pool_zone* pool, size_t n) {
+    if (n == 0) return NULL;
+
+    // Il primo blocco (da quello corrente in poi) con n slot ancora liberi;
+    // i blocchi saltati restano inutilizzati fino al prossimo azzeramento
+    Slab_zone* ultimo = NULL;
+    for (Slab_zone* b = pool->corrente ? pool->corrente : pool->primo; b != NULL; b = b->successivo) {
+        size_t usati = (b == pool->corrente) ? pool->usati_corrente : 0;
+        if (b->capacita - usati >= n) {
+            pool->corrente = b;
+            pool->usati_corrente = usati + n;
+            pool->allocazioni += n;
+            pool->in_uso += n;
+            return &b->slot[usati];
+        }
+        ultimo = b;
+    }
+
+    // Nessun blocco abbastanza grande: se ne aggiunge uno dedicato in coda
+    if (ultimo == NULL) ultimo = pool->corrente;
+    Slab_zone* nuovo = nuovo_blocco(n);
+    if (nuovo == NULL) return NULL;
+    if (ultimo) ultimo->successivo = nuovo;
+    else pool->primo = nuovo;
+    pool->corrente = nuovo;
+    pool->usati_corrente = n;
+    pool->allocazioni += n;
+    pool->in_uso += n;
+    return nuovo->slot;
+}
+
+void pool_libera(Pool_zone* pool, Slot_zona* slot) {
+    *(Slot_zona**) slot = pool->liberi;
+    pool->liberi = slot;
+    pool->liberi_count++;
+    pool->in_uso--;
+}
+
+void pool_azzera(Pool_zone* pool) {
+    // Non serve visitare gli slot: si riparte dal primo blocco
+    pool->corrente = NULL;
+    pool->usati_corrente = 0;
+    pool->liberi = NULL;
+    pool->liberi_count = 0;
+    pool->in_uso = 0;
+}
+
+void pool_rilascia(Pool_zone* pool) {
+    Slab_zone* b = pool->primo;
+    while (b != NULL) {
+        Slab_zone* temp = b;
+        b = b->successivo;
+        free(temp);
+    }
+    Pool_zone vuoto = POOL_ZONE_INIT;
+    *pool = vuoto;
+}
+
+Statistiche_pool pool_statistiche(const Pool_zone* pool) {
+    Statistiche_pool st = { 0, 0, pool->in_uso, pool->liberi_count, pool->allocazioni, pool->riusi, 0 };
+    for (const Slab_zone* b = pool->primo; b != NULL; b = b->successivo) {
+        st.blocchi++;
+        st.capacita += b->capacita;
+        st.byte += sizeof(Slab_zone) + b->capacita * sizeof(Slot_zona);
+    }
+    return st;
+}
@@ -0,0 +1,67 @@
+#ifndef POOL_ZONE_H
+#define POOL_ZONE_H
+
+#include "gamelib.h"
+
+// ============================================================================
+// ALLOCATORE A BLOCCHI PER LE ZONE
+// ============================================================================
+// Ogni zona esiste in coppia (Mondo Reale + Soprasotto): le due struct sono
+// allocate insieme nello stesso slot, così restano adiacenti in memoria.
+// Gli slot vengono presi da blocchi (slab) grandi; quelli liberati da
+// cancella_zona tornano in una free list e vengono riusati per primi.
+// Azzerare o rilasciare l'intera mappa costa un'operazione sola (per blocco),
+// invece di 2 free per ogni zona.
+
+// Coppia di zone allocate insieme
+typedef struct Slot_zona {
+    Zona_mondoreale mr; // Primo campo: un Zona_mondoreale* del pool è anche uno Slot_zona*
+    Zona_soprasotto ss;
+    // Nodo dell'indice posizionale (vedi indice_zone.h)
+    struct Slot_zona* sx;
+    struct Slot_zona* dx;
+    struct Slot_zona* padre;
+    unsigned int dimensione; // Zone nel sottoalbero, nodo compreso
+    unsigned int priorita;
+    unsigned short presenza; // Nemici e oggetti presenti nel sottoalbero (PRESENZA_*)
+} Slot_zona;
+
+struct Slab_zone; // Blocco di slot contigui (definito in pool_zone.c)
+
+typedef struct Pool_zone {
+    struct Slab_zone* primo;    // Blocchi in ordine di allocazione
+    struct Slab_zone* corrente; // Blocco da cui si prendono gli slot nuovi
+    size_t usati_corrente;      // Slot già distribuiti dal blocco corrente
+    Slot_zona* liberi;          // Free list degli slot restituiti
+    size_t in_uso;              // Slot attualmente assegnati a zone
+    size_t liberi_count;        // Lunghezza della free list
+    size_t allocazioni;         // Richieste totali (dall'ultimo rilascio)
+    size_t riusi;               // Richieste servite dalla free list
+} Pool_zone;
+
+typedef struct Statistiche_pool {
+    size_t blocchi;      // Slab allocati con malloc
+    size_t capacita;     // Slot totali disponibili nei blocchi
+    size_t in_uso;       // Slot assegnati a zone
+    size_t liberi;       // Slot nella free list
+    size_t allocazioni;  // Richieste totali
+    size_t riusi;        // Richieste servite dalla free list
+    size_t byte;         // Memoria riservata dai blocchi
+} Statistiche_pool;
+
+#define POOL_ZONE_INIT { NULL, NULL, 0, NULL, 0, 0, 0, 0 }
+
+// Restituisce una coppia di zone non inizializzata (NULL se la memoria è finita)
+Slot_zona* pool_alloca(Pool_zone* pool);
+// Restituisce n coppie contigue (slot[0..n-1]) non inizializzate, NULL se la
+// memoria è finita. Non usa la free list: serve a generare mappe intere
+Slot_zona* pool_alloca_blocco(Pool_zone* pool, size_t n);
+// Restituisce uno slot al pool (finisce nella free list)
+void pool_libera(Pool_zone* pool, Slot_zona* slot);
+// Tutti gli slot tornano disponibili, i blocchi restano allocati per il riuso
+void pool_azzera(Pool_zone* pool);
+// Libera tutti i blocchi
+void pool_rilascia(Pool_zone* pool);
+Statistiche_pool pool_statistiche(const Pool_zone* pool);
+
+#endif
@@ -0,0 +1,171 @@
+#include "probabilita.h"
+#include "regole.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+// ============================================================================
+// TABELLA PRECALCOLATA
+// ============================================================================
+// Una voce a 16 bit (probabilità * 65535) per nemico, attacco, difesa e
+// tiri di critico. Attacco e difesa coprono i valori che un giocatore può
+// avere: 1-20 tirati, poi -3/+3 con la modifica delle statistiche o +4 per
+// Undici. La fortuna conta solo per quanti tiri danno il critico (0-21),
+// quindi ogni fortuna ha la sua voce: 3 * 27 * 27 * 22 * 2 byte = 94 KB.
+//
+// probabilita_inizializza calcola le statistiche tirate (1-20); le altre
+// si calcolano alla prima richiesta, tutte le fortune insieme, e restano.
+
+#define STAT_MIN (1 - 3)
+#define STAT_MAX (20 + 4)
+#define VALORI_STAT (STAT_MAX - STAT_MIN + 1)
+#define SCALA 65535.0
+
+// Facce dei dadi di regole.h
+#define ESITI_CRITICO (TIRO_CRITICO_MAX - TIRO_CRITICO_MIN + 1)
+#define ESITI_ATTACCO (VARIAZIONE_ATTACCO_MAX - VARIAZIONE_ATTACCO_MIN + 1)
+#define ESITI_NEMICO  (VARIAZIONE_NEMICO_MAX - VARIAZIONE_NEMICO_MIN + 1)
+#define FORTUNE (ESITI_CRITICO + 1) // Tiri critici possibili: 0 - ESITI_CRITICO
+
+static unsigned short tabella[3][VALORI_STAT][VALORI_STAT][FORTUNE];
+// 1 quando le voci di (nemico, attacco, difesa) sono scritte
+static atomic_uchar pronta[3][VALORI_STAT][VALORI_STAT];
+static pthread_mutex_t mutex_tabella = PTHREAD_MUTEX_INITIALIZER;
+
+// Tiri (su ESITI_CRITICO) che danno il critico con questa fortuna
+static int tiri_critici(int fortuna) {
+    int sotto = fortuna - TIRO_CRITICO_MIN;
+    if (sotto < 0) sotto = 0;
+    if (sotto > ESITI_CRITICO) sotto = ESITI_CRITICO;
+    return sotto;
+}
+
+// ============================================================================
+// PROGRAMMAZIONE DINAMICA
+// ============================================================================
+// Regole di combatti() per un Attacco Pischico:
+//  - critico se casuale(0, 20) < fortuna          -> p = fortuna / 21
+//  - danno = max(0, attacco - difesa_nemico + casuale(-2, 2)), doppio se critico
+//  - se il nemico non è a terra: danno subito = max(1, attacco_nemico - difesa + casuale(0, 5))
+// Il danno subito è sempre almeno 1, quindi gli HP del giocatore scendono a
+// ogni scambio e la ricorrenza si risolve per HP crescenti senza iterare.
+//
+// P(h, e) = probabilità di vincere con h HP contro un nemico con e HP
+// Q(h, e) = media di P(h - k, e) sul contrattacco k (0 se h - k <= 0)
+// P(h, e) = media su tiro e critico di [e - d <= 0 ? 1 : Q(h, e - d)]
+//
+// Ogni "corsia" è lo stesso scontro con una fortuna diversa: la fortuna cambia
+// solo il peso del critico, quindi le 22 fortune si calcolano insieme e il
+// ciclo interno sulle corsie viene vettorizzato dal compilatore.
+
+#define CORSIE ((FORTUNE + 7) / 8 * 8) // Multiplo della larghezza dei vettori
+
+static float prob_critico(int fortuna) {
+    return (float) tiri_critici(fortuna) / (float) ESITI_CRITICO;
+}
+
+// Scrive in esito[c] la probabilità di vittoria partendo da (h_inizio, e_inizio)
+// per ciascuna delle n_corsie probabilità di critico in critico[c]
+static void calcola_corsie(int attacco, int difesa, Tipo_nemico nemico, int h_inizio, int e_inizio,
+                           const float critico[], int n_corsie, float esito[]) {
+    if (h_inizio <= 0) { for (int c = 0; c < n_corsie; c++) esito[c] = 0.0f; return; }
+    if (e_inizio <= 0) { for (int c = 0; c < n_corsie; c++) esito[c] = 1.0f; return; }
+
+    const Statistiche_nemico* sn = &statistiche_nemici[nemico];
+    int danno[ESITI_ATTACCO], contrattacco[ESITI_NEMICO];
+    for (int j = 0; j < ESITI_ATTACCO; j++) danno[j] = regole_danno_inflitto(attacco, sn->difesa, VARIAZIONE_ATTACCO_MIN + j, 0);
+    for (int u = 0; u < ESITI_NEMICO; u++) contrattacco[u] = regole_danno_subito(sn->attacco, difesa, VARIAZIONE_NEMICO_MIN + u);
+
+    // Nessun tiro fa danno: lo scontro è perso in partenza
+    if (danno[ESITI_ATTACCO - 1] == 0) { for (int c = 0; c < n_corsie; c++) esito[c] = 0.0f; return; }
+
+    int larghezza = e_inizio + 1;
+    size_t celle = (size_t) (h_inizio + 1) * larghezza * CORSIE;
+    float* P = (float*) calloc(celle, sizeof(float));
+    float* Q = (float*) calloc(celle, sizeof(float));
+    if (!P || !Q) { free(P); free(Q); for (int c = 0; c < n_corsie; c++) esito[c] = 0.0f; return; }
+
+    float non_critico[CORSIE], crit[CORSIE], uno[CORSIE];
+    for (int c = 0; c < CORSIE; c++) {
+        crit[c] = (c < n_corsie) ? critico[c] : 0.0f;
+        non_critico[c] = 1.0f - crit[c];
+        uno[c] = 1.0f; // Nemico a terra: vittoria certa
+    }
+
+    for (int h = 1; h <= h_inizio; h++) {
+        // Q(h, e): il nemico contrattacca, riga calcolata solo da HP più bassi
+        for (int e = 1; e <= e_inizio; e++) {
+            float* q = &Q[((size_t) h * larghezza + e) * CORSIE];
+            for (int u = 0; u < ESITI_NEMICO; u++) {
+                int hk = h - contrattacco[u];
+                if (hk <= 0) continue;
+                const float* p = &P[((size_t) hk * larghezza + e) * CORSIE];
+                for (int c = 0; c < CORSIE; c++) q[c] += p[c] * (1.0f / ESITI_NEMICO);
+            }
+        }
+        // P(h, e): attacco del giocatore, con o senza critico
+        for (int e = 1; e <= e_inizio; e++) {
+            float* p = &P[((size_t) h * larghezza + e) * CORSIE];
+            for (int j = 0; j < ESITI_ATTACCO; j++) {
+                int resto = e - danno[j];
+                int resto_critico = e - 2 * danno[j];
+                const float* qn = (resto > 0) ? &Q[((size_t) h * larghezza + resto) * CORSIE] : uno;
+                const float* qc = (resto_critico > 0) ? &Q[((size_t) h * larghezza + resto_critico) * CORSIE] : uno;
+                for (int c = 0; c < CORSIE; c++)
+                    p[c] += (non_critico[c] * qn[c] + crit[c] * qc[c]) * (1.0f / ESITI_ATTACCO);
+            }
+        }
+    }
+
+    const float* finale = &P[((size_t) h_inizio * larghezza + e_inizio) * CORSIE];
+    for (int c = 0; c < n_corsie; c++) esito[c] = finale[c];
+    free(P);
+    free(Q);
+}
+
+// ============================================================================
+// FUNZIONI PUBBLICHE
+// ============================================================================
+
+// Voci di tutte le fortune per (nemico, attacco, difesa), se non ci sono già
+static void calcola_voci(Tipo_nemico n, int a, int d) {
+    atomic_uchar* p = &pronta[n - billi][a - STAT_MIN][d - STAT_MIN];
+    if (atomic_load_explicit(p, memory_order_acquire)) return;
+    pthread_mutex_lock(&mutex_tabella);
+    if (!atomic_load_explicit(p, memory_order_relaxed)) {
+        float critico[FORTUNE], esito[FORTUNE];
+        for (int c = 0; c < FORTUNE; c++) critico[c] = (float) c / (float) ESITI_CRITICO;
+        calcola_corsie(a, d, n, regole_hp_giocatore(d), statistiche_nemici[n].hp, critico, FORTUNE, esito);
+        for (int c = 0; c < FORTUNE; c++)
+            tabella[n - billi][a - STAT_MIN][d - STAT_MIN][c] = (unsigned short) (esito[c] * SCALA + 0.5);
+        atomic_store_explicit(p, 1, memory_order_release);
+    }
+    pthread_mutex_unlock(&mutex_tabella);
+}
+
+void probabilita_inizializza() {
+    for (int n = billi; n <= demotorzone; n++)
+        for (int a = 1; a <= 20; a++)
+            for (int d = 1; d <= 20; d++) calcola_voci((Tipo_nemico) n, a, d);
+}
+
+double probabilita_vittoria(int attacco, int difesa, int fortuna, Tipo_nemico nemico) {
+    if (nemico < billi || nemico > demotorzone) return 1.0;
+
+    if (attacco >= STAT_MIN && attacco <= STAT_MAX && difesa >= STAT_MIN && difesa <= STAT_MAX) {
+        calcola_voci(nemico, attacco, difesa);
+        return tabella[nemico - billi][attacco - STAT_MIN][difesa - STAT_MIN][tiri_critici(fortuna)] / SCALA;
+    }
+
+    // Fuori tabella (statistiche che il gioco non produce, es. da un salvataggio
+    // scritto a mano): HP iniziali come in combatti()
+    return probabilita_vittoria_scontro(attacco, difesa, fortuna, nemico,
+                                        regole_hp_giocatore(difesa), statistiche_nemici[nemico].hp, 0, 0);
+}
+
+double probabilita_vittoria_scontro(int attacco, int difesa, int fortuna, Tipo_nemico nemico,
+                                    int hp_giocatore, int hp_nemico, int bonus_attacco, int bonus_difesa) {
+    if (nemico < billi || nemico > demotorzone) return 1.0;
+    float critico = prob_critico(fortuna), esito;
+    calcola_corsie(attacco + bonus_attacco, difesa + bonus_difesa, nemico, hp_giocatore, hp_nemico, &critico, 1, &esito);
+    return esito;
+}
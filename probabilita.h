@@ -0,0 +1,36 @@
+#ifndef PROBABILITA_H
+#define PROBABILITA_H
+
+#include "gamelib.h"
+
+// ============================================================================
+// PROBABILITÀ ESATTE DI VITTORIA NEI COMBATTIMENTI
+// ============================================================================
+// Le probabilità sono calcolate con programmazione dinamica sugli stati
+// (HP giocatore, HP nemico) di combatti(), assumendo che il giocatore scelga
+// sempre l'Attacco Pischico. Nessuna simulazione Monte Carlo.
+//
+// Gli oggetti non entrano nella politica: la bicicletta è riusabile senza
+// limiti e cura più di quanto molti nemici tolgano, quindi con gli oggetti lo
+// spazio degli stati non sarebbe finito. I bonus già ottenuti in uno scontro
+// (Schitarrata, Maglietta) si passano a probabilita_vittoria_scontro.
+
+// Precalcola la tabella per attacco, difesa e fortuna da 1 a 20 contro
+// Billi, Democane e Demotorzone. Da chiamare all'avvio, così che il primo
+// menu di turno non paghi il calcolo.
+void probabilita_inizializza();
+
+// Probabilità (0-1) di vincere uno scontro appena iniziato. Per ogni
+// statistica che il gioco produce (attacco e difesa tra -2 e 24 dopo le
+// modifiche, qualunque fortuna) è una lettura della tabella, che calcola la
+// voce alla prima richiesta. Fuori da quegli intervalli (salvataggi scritti
+// a mano) ogni chiamata rifà tutto il calcolo, fino a circa un millisecondo.
+// Si può chiamare da più thread.
+double probabilita_vittoria(int attacco, int difesa, int fortuna, Tipo_nemico nemico);
+
+// Probabilità (0-1) di vincere uno scontro già in corso, dati gli HP attuali
+// e i bonus accumulati con gli oggetti
+double probabilita_vittoria_scontro(int attacco, int difesa, int fortuna, Tipo_nemico nemico,
+                                    int hp_giocatore, int hp_nemico, int bonus_attacco, int bonus_difesa);
+
+#endif
@@ -0,0 +1,135 @@
+#include "ramo.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Blocchi di dimensione fissa: un ramo e una modifica sono piccoli, e le
+// richieste più grandi di un blocco non esistono
+#define BYTE_BLOCCO (64 * 1024)
+#define ALLINEAMENTO _Alignof(max_align_t)
+
+typedef struct Blocco_arena {
+    struct Blocco_arena* successivo;
+    _Alignas(max_align_t) unsigned char dati[BYTE_BLOCCO];
+} Blocco_arena;
+
+// ============================================================================
+// ARENA
+// ============================================================================
+
+static void* arena_alloca(Arena_rami* a, size_t byte) {
+    byte = (byte + ALLINEAMENTO - 1) / ALLINEAMENTO * ALLINEAMENTO;
+    // Blocco corrente esaurito: si passa al successivo (già allocato prima di
+    // un ritorno a un segno) oppure se ne alloca uno nuovo in coda
+    if (a->corrente == NULL || a->usati + byte > BYTE_BLOCCO) {
+        Blocco_arena* prossimo = a->corrente ? a->corrente->successivo : a->primo;
+        if (prossimo == NULL) {
+            prossimo = (Blocco_arena*) malloc(sizeof(Blocco_arena));
+            if (prossimo == NULL) return NULL;
+            prossimo->successivo = NULL;
+            if (a->corrente) a->corrente->successivo = prossimo;
+            else a->primo = prossimo;
+        }
+        a->corrente = prossimo;
+        a->usati = 0;
+    }
+    void* p = &a->corrente->dati[a->usati];
+    a->usati += byte;
+    return p;
+}
+
+void ramo_arena_distruggi(Arena_rami* a) {
+    Blocco_arena* b = a->primo;
+    while (b != NULL) {
+        Blocco_arena* successivo = b->successivo;
+        free(b);
+        b = successivo;
+    }
+    a->primo = a->corrente = NULL;
+    a->usati = 0;
+}
+
+Segno_arena ramo_arena_segna(const Arena_rami* a) {
+    Segno_arena s = { a->corrente, a->usati };
+    return s;
+}
+
+void ramo_arena_torna(Arena_rami* a, Segno_arena s) {
+    a->corrente = s.blocco;
+    a->usati = s.usati;
+}
+
+void ramo_arena_azzera(Arena_rami* a) {
+    a->corrente = NULL;
+    a->usati = 0;
+}
+
+size_t ramo_arena_byte(const Arena_rami* a) {
+    size_t byte = 0;
+    for (const Blocco_arena* b = a->primo; b != NULL; b = b->successivo) byte += sizeof(Blocco_arena);
+    return byte;
+}
+
+// ============================================================================
+// RAMI
+// ============================================================================
+
+Ramo* ramo_radice(Arena_rami* a, const Mappa_compatta* base) {
+    Ramo* r = (Ramo*) arena_alloca(a, sizeof(Ramo));
+    if (r == NULL) return NULL;
+    memset(r, 0, sizeof(*r));
+    r->base = base;
+    r->round = 1;
+    for (int i = 0; i < 4; i++) r->ordine[i] = i;
+    r->di_turno = -1;
+    r->vincitore = -1;
+    return r;
+}
+
+Ramo* ramo_biforca(Arena_rami* a, const Ramo* r) {
+    Ramo* figlio = (Ramo*) arena_alloca(a, sizeof(Ramo));
+    if (figlio != NULL) *figlio = *r;
+    return figlio;
+}
+
+static uint64_t bit_filtro(size_t pos) {
+    return (uint64_t) 1 << (pos & 63);
+}
+
+// Parola del filtro per pos
+#define PAROLA_FILTRO(pos) (((pos) >> 6) & 3)
+
+Zona_compatta ramo_zona(const Ramo* r, size_t pos) {
+    if (r->filtro[PAROLA_FILTRO(pos)] & bit_filtro(pos))
+        for (const Modifica_ramo* m = r->modifiche; m != NULL; m = m->precedente)
+            if (m->posizione == pos) return m->zona;
+    return r->base->zone[pos];
+}
+
+static int scrivi_zona(Arena_rami* a, Ramo* r, size_t pos, Zona_compatta z) {
+    Modifica_ramo* m = (Modifica_ramo*) arena_alloca(a, sizeof(Modifica_ramo));
+    if (m == NULL) return 0;
+    m->precedente = r->modifiche;
+    m->posizione = pos;
+    m->zona = z;
+    r->modifiche = m;
+    r->filtro[PAROLA_FILTRO(pos)] |= bit_filtro(pos);
+    r->n_modifiche++;
+    return 1;
+}
+
+int ramo_modifica_zona(Arena_rami* a, Ramo* r, size_t pos, Tipo_nemico nemico_mr, Tipo_oggetto oggetto, Tipo_nemico nemico_ss) {
+    Zona_compatta z = ramo_zona(r, pos);
+    return scrivi_zona(a, r, pos, COMPATTA_CODIFICA(COMPATTA_TIPO(z), nemico_mr, oggetto, nemico_ss));
+}
+
+int ramo_togli_nemico(Arena_rami* a, Ramo* r, size_t pos, int mondo) {
+    Zona_compatta z = ramo_zona(r, pos);
+    return ramo_modifica_zona(a, r, pos, mondo == 0 ? nessun_nemico : COMPATTA_NEMICO_MR(z), COMPATTA_OGGETTO(z),
+                              mondo == 0 ? COMPATTA_NEMICO_SS(z) : nessun_nemico);
+}
+
+int ramo_togli_oggetto(Arena_rami* a, Ramo* r, size_t pos) {
+    Zona_compatta z = ramo_zona(r, pos);
+    return ramo_modifica_zona(a, r, pos, COMPATTA_NEMICO_MR(z), nessun_oggetto, COMPATTA_NEMICO_SS(z));
+}
@@ -0,0 +1,114 @@
+#ifndef RAMO_H
+#define RAMO_H
+
+#include "gamelib.h"
+#include "mappa_compatta.h"
+#include <stdint.h>
+
+// ============================================================================
+// STATO DI GIOCO BIFORCABILE (RAMI PER LA RICERCA)
+// ============================================================================
+// Per valutare una mossa un'analisi prova molte continuazioni della stessa
+// partita. Copiare la Sessione per ognuna costa quanto la mappa; un Ramo
+// invece è lo stato della partita (giocatori e turno) sopra una mappa base
+// immutabile, condivisa da tutti i rami. Le zone cambiate (nemico
+// sconfitto, oggetto raccolto) stanno in una catena persistente di modifiche
+// che un ramo condivide con i suoi antenati:
+//
+//   - biforcare copia solo la struttura del ramo, giocatori compresi: O(1);
+//   - una modifica aggiunge un anello in testa alla catena: O(1);
+//   - leggere una zona che il ramo non ha toccato costa O(1) (un filtro a
+//     256 bit, posizione % 256, delle zone modificate), altrimenti scorre le
+//     sue modifiche: O(n_modifiche).
+//
+// Il filtro è esatto sulle mappe fino a 256 zone. Su mappe più grandi zone
+// diverse condividono un bit, e un ramo che ha modificato 256 o più residui
+// diversi ha il filtro pieno: da lì ogni lettura scorre tutta la catena.
+// Le ricerche ne fanno poche decine per ramo, ben sotto il limite.
+//
+// I rami e le modifiche vivono in un'arena: si liberano tutti insieme, o
+// tutti quelli creati dopo un segno, senza visitarli. Un'arena va usata da
+// un thread alla volta; la mappa base si può leggere da più thread.
+
+// Blocco di memoria dell'arena (definito in ramo.c)
+struct Blocco_arena;
+
+typedef struct Arena_rami {
+    struct Blocco_arena* primo;    // Blocchi in ordine di allocazione
+    struct Blocco_arena* corrente; // Blocco da cui si prende la memoria nuova
+    size_t usati;                  // Byte già distribuiti dal blocco corrente
+} Arena_rami;
+
+#define ARENA_RAMI_INIT { NULL, NULL, 0 }
+
+// Punto dell'arena a cui tornare con ramo_arena_torna
+typedef struct Segno_arena {
+    struct Blocco_arena* blocco;
+    size_t usati;
+} Segno_arena;
+
+// Modifica di una zona, in testa alla catena del ramo che l'ha fatta
+typedef struct Modifica_ramo {
+    const struct Modifica_ramo* precedente;
+    size_t posizione;
+    Zona_compatta zona; // Contenuto nuovo della coppia di zone
+} Modifica_ramo;
+
+typedef struct Giocatore_ramo {
+    int vivo;
+    int mondo;          // 0 Mondo Reale, 1 Soprasotto
+    size_t posizione;
+    int attacco, difesa, fortuna;
+    Tipo_oggetto zaino[3];
+} Giocatore_ramo;
+
+typedef struct Ramo {
+    const Mappa_compatta* base;
+    const Modifica_ramo* modifiche; // La più recente per prima
+    uint64_t filtro[4];             // Bit (posizione % 256) delle zone modificate
+    size_t n_modifiche;
+    Giocatore_ramo giocatori[4];
+    int numero_giocatori;
+    // Turno, come nel motore: round da giocare dopo quello in corso, ordine
+    // del round e prossimo turno, giocatore di turno e suo movimento
+    int round;
+    int max_round;                  // Ultimo round della partita, 0 senza limite
+    int ordine[4], prossimo;
+    int di_turno;                   // -1 fuori dai turni
+    int movimento_fatto;
+    int vincitore;                  // -1 finché il Demotorzone è vivo
+} Ramo;
+
+// Libera tutti i blocchi dell'arena
+void ramo_arena_distruggi(Arena_rami* a);
+Segno_arena ramo_arena_segna(const Arena_rami* a);
+// Libera in blocco tutto ciò che è stato allocato dopo il segno (i rami
+// creati prima restano validi). I blocchi restano per il riuso
+void ramo_arena_torna(Arena_rami* a, Segno_arena s);
+// Libera tutto (come tornare a un segno preso sull'arena vuota)
+void ramo_arena_azzera(Arena_rami* a);
+// Memoria riservata dai blocchi
+size_t ramo_arena_byte(const Arena_rami* a);
+
+// Ramo senza giocatori né modifiche sopra la mappa base (che deve restare
+// valida e immutata finché esistono rami). NULL se manca memoria
+Ramo* ramo_radice(Arena_rami* a, const Mappa_compatta* base);
+// Copia del ramo che ne condivide le modifiche: O(1). NULL se manca memoria
+Ramo* ramo_biforca(Arena_rami* a, const Ramo* r);
+
+// Contenuto corrente della coppia di zone in posizione pos (< base->n)
+Zona_compatta ramo_zona(const Ramo* r, size_t pos);
+// Cambia il contenuto della zona nel ramo (gli antenati non la vedono).
+// Restituisce 0 se manca memoria
+int ramo_modifica_zona(Arena_rami* a, Ramo* r, size_t pos, Tipo_nemico nemico_mr, Tipo_oggetto oggetto, Tipo_nemico nemico_ss);
+// Le due modifiche del gioco: il nemico del mondo dato sconfitto e svanito
+// (combatti), l'oggetto raccolto (raccogli_oggetto)
+int ramo_togli_nemico(Arena_rami* a, Ramo* r, size_t pos, int mondo);
+int ramo_togli_oggetto(Arena_rami* a, Ramo* r, size_t pos);
+
+// Ramo con lo stato della partita della sessione sopra base, che deve essere
+// la sua mappa esportata (mappa_esporta_compatta: una volta per tutti i rami
+// della stessa decisione). Implementata in gamelib.c. NULL se manca memoria
+Ramo* partita_ramo(const Sessione* s, Arena_rami* a, const Mappa_compatta* base);
+
+#endif
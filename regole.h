@@ -0,0 +1,80 @@
+#ifndef REGOLE_H
+#define REGOLE_H
+
+// ============================================================================
+// REGOLE DEL GIOCO
+// ============================================================================
+// Limiti, dadi e formule dei combattimenti e dei turni, in un solo posto per
+// il motore (gamelib.c) e per chi gioca la partita senza Sessione: la
+// ricerca MCTS sui rami e il calcolo esatto delle probabilità. Le funzioni
+// sono pure: i dadi li tira il chiamante negli intervalli qui sotto, il
+// motore con casuale() (che li registra nel diario), la ricerca con il suo Rng.
+
+// Limite di azioni in un singolo turno, protegge da agenti che non passano mai
+#define MAX_AZIONI_TURNO 64
+// Limite di scambi in un combattimento: con danno nullo e bicicletta (riusabile)
+// lo scontro potrebbe non finire mai. Vale anche per le scelte che non usano
+// il turno, contate a parte. Nessuno dei due limiti vale per chi gioca da
+// tastiera, come nel gioco originale
+#define MAX_SCAMBI_COMBATTIMENTO 1000
+
+// Dadi (estremi inclusi), nell'ordine in cui il motore li tira
+#define TIRO_CRITICO_MIN 0          // Attacco Pischico: critico sotto la fortuna
+#define TIRO_CRITICO_MAX 20
+#define VARIAZIONE_ATTACCO_MIN (-2) // Poi la variazione del danno inflitto
+#define VARIAZIONE_ATTACCO_MAX 2
+#define VARIAZIONE_NEMICO_MIN 0     // Contrattacco del nemico
+#define VARIAZIONE_NEMICO_MAX 5
+#define TIRO_SCOMPARSA_MIN 1        // Nemico sconfitto: svanisce fino a SOGLIA_SCOMPARSA
+#define TIRO_SCOMPARSA_MAX 100
+#define SOGLIA_SCOMPARSA 50
+#define TIRO_FUGA_MIN 1             // Fuga dal Soprasotto: riesce sotto la fortuna
+#define TIRO_FUGA_MAX 20
+
+#define BONUS_SCHITARRATA 10        // Attacco per il resto dello scontro (monouso)
+#define BONUS_MAGLIETTA 5           // Difesa per il resto dello scontro
+#define CURA_BICICLETTA 10          // HP recuperati (riusabile)
+
+// HP del giocatore a inizio scontro
+static inline int regole_hp_giocatore(int difesa) {
+    return difesa * 2 + 20;
+}
+
+static inline int regole_critico(int tiro, int fortuna) {
+    return tiro < fortuna;
+}
+
+// Danno dell'Attacco Pischico (attacco già con i bonus), doppio se critico
+static inline int regole_danno_inflitto(int attacco, int difesa_nemico, int variazione, int critico) {
+    int danno = attacco - difesa_nemico + variazione;
+    if (danno < 0) danno = 0;
+    return critico ? danno * 2 : danno;
+}
+
+// Danno del contrattacco (difesa già con i bonus): almeno 1
+static inline int regole_danno_subito(int attacco_nemico, int difesa, int variazione) {
+    int danno = attacco_nemico - difesa + variazione;
+    return danno < 1 ? 1 : danno;
+}
+
+static inline int regole_svanisce(int tiro) {
+    return tiro <= SOGLIA_SCOMPARSA;
+}
+
+static inline int regole_fuga(int tiro, int fortuna) {
+    return tiro < fortuna;
+}
+
+// Ordine dei turni di un round: Fisher-Yates sui primi numero posti, con
+// estrai(dati, min, max) come dado (estremi inclusi)
+static inline void regole_mescola_ordine(int ordine[4], int numero, int (*estrai)(void* dati, int min, int max), void* dati) {
+    for (int i = 0; i < 4; i++) ordine[i] = i;
+    for (int i = 0; i < numero; i++) {
+        int j = estrai(dati, i, numero - 1);
+        int temp = ordine[i];
+        ordine[i] = ordine[j];
+        ordine[j] = temp;
+    }
+}
+
+#endif
@@ -0,0 +1,136 @@
+#include "rng.h"
+
+// ============================================================================
+// SPLITMIX64 (espansione del seme e funzione di mescolamento)
+// ============================================================================
+
+#define RAPPORTO_AUREO 0x9e3779b97f4a7c15ULL
+
+static uint64_t mescola(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static uint64_t splitmix64(uint64_t* stato) {
+    *stato += RAPPORTO_AUREO;
+    return mescola(*stato);
+}
+
+// ============================================================================
+// XOSHIRO256**
+// ============================================================================
+
+static uint64_t ruota(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+void rng_semina(Rng* r, uint64_t seme) {
+    uint64_t stato = seme;
+    for (int i = 0; i < 4; i++) r->s[i] = splitmix64(&stato);
+}
+
+void rng_flusso(Rng* r, uint64_t seme, uint64_t flusso) {
+    // Il flusso viene mescolato nel seme: flussi vicini danno stati scorrelati
+    rng_semina(r, mescola(seme ^ mescola(flusso + RAPPORTO_AUREO)));
+}
+
+uint64_t rng_prossimo(Rng* r) {
+    uint64_t* s = r->s;
+    const uint64_t risultato = ruota(s[1] * 5, 7) * 9;
+    const uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = ruota(s[3], 45);
+    return risultato;
+}
+
+void rng_salta(Rng* r) {
+    static const uint64_t SALTO[4] = {
+        0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL
+    };
+    uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    for (int i = 0; i < 4; i++) {
+        for (int b = 0; b < 64; b++) {
+            if (SALTO[i] & (1ULL << b)) {
+                s0 ^= r->s[0]; s1 ^= r->s[1]; s2 ^= r->s[2]; s3 ^= r->s[3];
+            }
+            rng_prossimo(r);
+        }
+    }
+    r->s[0] = s0; r->s[1] = s1; r->s[2] = s2; r->s[3] = s3;
+}
+
+uint32_t rng_u32(Rng* r) {
+    return (uint32_t) (rng_prossimo(r) >> 32);
+}
+
+// Metodo di Lemire: moltiplicazione 32x32 -> 64 e rifiuto dei pochi valori
+// che introdurrebbero bias; la divisione serve solo nel caso raro
+uint32_t rng_limitato(Rng* r, uint32_t limite) {
+    uint64_t m = (uint64_t) rng_u32(r) * limite;
+    uint32_t basso = (uint32_t) m;
+    if (basso < limite) {
+        uint32_t soglia = (uint32_t) -limite % limite;
+        while (basso < soglia) {
+            m = (uint64_t) rng_u32(r) * limite;
+            basso = (uint32_t) m;
+        }
+    }
+    return (uint32_t) (m >> 32);
+}
+
+int rng_intervallo(Rng* r, int min, int max) {
+    if (max <= min) return min;
+    uint32_t ampiezza = (uint32_t) ((int64_t) max - min + 1);
+    if (ampiezza == 0) return (int) rng_u32(r); // Intervallo di tutti gli int (2^32 valori)
+    return (int) ((int64_t) min + rng_limitato(r, ampiezza));
+}
+
+void rng_riempi_intervallo(Rng* r, int* buf, size_t n, int min, int max) {
+    if (max <= min) { for (size_t i = 0; i < n; i++) buf[i] = min; return; }
+    uint32_t ampiezza = (uint32_t) ((int64_t) max - min + 1);
+    if (ampiezza == 0) { for (size_t i = 0; i < n; i++) buf[i] = (int) rng_u32(r); return; }
+    for (size_t i = 0; i < n; i++) buf[i] = (int) ((int64_t) min + rng_limitato(r, ampiezza));
+}
+
+void rng_riempi_u32(Rng* r, uint32_t* buf, size_t n) {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        uint64_t x = rng_prossimo(r);
+        buf[i] = (uint32_t) (x >> 32);
+        buf[i + 1] = (uint32_t) x;
+    }
+    if (i < n) buf[i] = rng_u32(r);
+}
+
+// ============================================================================
+// GENERATORE A CONTATORE
+// ============================================================================
+// Ogni (seme, flusso) individua una sequenza SplitMix64 con punto di partenza
+// proprio; il contatore è la posizione nella sequenza. Nessuno stato: i
+// thread possono calcolare qualunque elemento in qualunque ordine.
+
+uint64_t rng_contatore(uint64_t seme, uint64_t flusso, uint64_t contatore) {
+    uint64_t base = mescola(seme ^ mescola(flusso + RAPPORTO_AUREO));
+    return mescola(base + (contatore + 1) * RAPPORTO_AUREO);
+}
+
+uint32_t rng_contatore_limitato(uint64_t seme, uint64_t flusso, uint64_t contatore, uint32_t limite) {
+    // I tentativi rifiutati usano le metà successive dello stesso valore e poi
+    // contatori "ombra" nel flusso complementare, così il risultato dipende
+    // solo da (seme, flusso, contatore)
+    if (limite == 0) return 0; // Come rng_limitato, senza dividere per zero
+    uint64_t x = rng_contatore(seme, flusso, contatore);
+    uint32_t soglia = (uint32_t) -limite % limite;
+    for (uint64_t tentativo = 1;; tentativo++) {
+        for (int meta = 0; meta < 2; meta++) {
+            uint64_t m = (uint64_t) (uint32_t) (meta ? x : x >> 32) * limite;
+            if ((uint32_t) m >= soglia) return (uint32_t) (m >> 32);
+        }
+        x = rng_contatore(seme, ~flusso, contatore * 64 + tentativo);
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ============================================================================
+// GENERATORE DI NUMERI CASUALI
+// ============================================================================
+// Sostituisce rand(): nessuno stato globale nascosto, ogni partita o thread
+// usa il proprio Rng con un seme esplicito, quindi le simulazioni parallele
+// danno gli stessi risultati qualunque sia il numero di thread.
+//
+// - Rng: xoshiro256** (256 bit di stato, periodo 2^256 - 1), sequenziale
+// - rng_contatore: generatore a contatore, valore puro di (seme, flusso,
+//   contatore) senza stato; serve quando l'elemento i deve avere sempre lo
+//   stesso valore indipendentemente da chi lo calcola e in che ordine
+// - gli intervalli limitati sono senza bias (metodo di Lemire con rifiuto),
+//   a differenza di rand() % n
+
+typedef struct Rng {
+    uint64_t s[4];
+} Rng;
+
+// Stato di rng_semina(r, 0): un Rng tutto a zero produrrebbe solo zeri
+#define RNG_INIT { { 0xe220a8397b1dcdafull, 0x6e789e6aa1b965f4ull, 0x06c45d188009454full, 0xf88bb8a8724c81ecull } }
+
+// Inizializza lo stato espandendo il seme con SplitMix64
+void rng_semina(Rng* r, uint64_t seme);
+// Flusso indipendente: stesso seme, identificativo di flusso diverso
+// (es. numero della partita in una simulazione)
+void rng_flusso(Rng* r, uint64_t seme, uint64_t flusso);
+// Avanza di 2^128 passi: sequenze che non si sovrappongono
+void rng_salta(Rng* r);
+
+uint64_t rng_prossimo(Rng* r);
+uint32_t rng_u32(Rng* r);
+// Intero uniforme in [0, limite); 0 se limite è 0
+uint32_t rng_limitato(Rng* r, uint32_t limite);
+// Intero uniforme in [min, max] inclusi (stessa firma di casuale())
+int rng_intervallo(Rng* r, int min, int max);
+// Riempie buf con n interi uniformi in [min, max]
+void rng_riempi_intervallo(Rng* r, int* buf, size_t n, int min, int max);
+// Riempie buf con n valori a 32 bit (due per ogni uscita a 64 bit)
+void rng_riempi_u32(Rng* r, uint32_t* buf, size_t n);
+
+// Generatore a contatore: stesso (seme, flusso, contatore) -> stesso valore
+uint64_t rng_contatore(uint64_t seme, uint64_t flusso, uint64_t contatore);
+// Intero uniforme senza bias in [0, limite) dal contatore; 0 se limite è 0
+uint32_t rng_contatore_limitato(uint64_t seme, uint64_t flusso, uint64_t contatore, uint32_t limite);
+
+#endif
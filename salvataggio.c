@@ -0,0 +1,260 @@
+#define _POSIX_C_SOURCE 200809L
+#include "salvataggio.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define MAGIC "CSTRSALV"
+#define DIM_INTESTAZIONE 72
+#define DIM_ALBO (3 * 100)
+#define DIM_GIOCATORE 140
+#define DIM_FISSA (DIM_INTESTAZIONE + DIM_ALBO + 4 * DIM_GIOCATORE)
+
+// Posizioni dei campi nell'intestazione
+#define OFF_VERSIONE   8
+#define OFF_FLAG       12
+#define OFF_GIOCATORI  16
+#define OFF_ZONE       24
+#define OFF_RNG        32
+#define OFF_CRC_CORPO  64
+#define OFF_CRC_INTEST 68
+
+// ============================================================================
+// CODIFICA LITTLE-ENDIAN E CRC-32
+// ============================================================================
+
+static void scrivi_u32(unsigned char* p, uint32_t v) {
+    p[0] = (unsigned char) v; p[1] = (unsigned char) (v >> 8);
+    p[2] = (unsigned char) (v >> 16); p[3] = (unsigned char) (v >> 24);
+}
+
+static void scrivi_u64(unsigned char* p, uint64_t v) {
+    scrivi_u32(p, (uint32_t) v);
+    scrivi_u32(p + 4, (uint32_t) (v >> 32));
+}
+
+static uint32_t leggi_u32(const unsigned char* p) {
+    return (uint32_t) p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+static uint64_t leggi_u64(const unsigned char* p) {
+    return (uint64_t) leggi_u32(p) | (uint64_t) leggi_u32(p + 4) << 32;
+}
+
+// CRC-32 IEEE (stesso polinomio di zip e png), tabella calcolata al primo
+// uso (una volta sola anche con più thread: la usa anche la classifica)
+static uint32_t tabella_crc[256];
+static pthread_once_t tabella_crc_pronta = PTHREAD_ONCE_INIT;
+
+static void prepara_tabella_crc(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        tabella_crc[i] = c;
+    }
+}
+
+uint32_t crc32_aggiorna(uint32_t crc, const unsigned char* p, size_t n) {
+    pthread_once(&tabella_crc_pronta, prepara_tabella_crc);
+    crc = ~crc;
+    for (size_t i = 0; i < n; i++) crc = tabella_crc[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+// ============================================================================
+// SCRITTURA
+// ============================================================================
+
+static void codifica_giocatore(unsigned char* p, const Giocatore_salvato* g) {
+    memset(p, 0, DIM_GIOCATORE);
+    if (!g->presente) return;
+    p[0] = 1;
+    p[1] = (unsigned char) g->mondo;
+    memcpy(p + 2, g->zaino, 3);
+    scrivi_u32(p + 8, (uint32_t) g->attacco);
+    scrivi_u32(p + 12, (uint32_t) g->difesa);
+    scrivi_u32(p + 16, (uint32_t) g->fortuna);
+    scrivi_u64(p + 24, (uint64_t) g->pos_mr);
+    scrivi_u64(p + 32, (uint64_t) g->pos_ss);
+    memcpy(p + 40, g->nome, 100);
+    p[40 + 99] = '\0';
+}
+
+// Intestazione (con i CRC) e parte fissa dell'immagine
+static void prepara(const Stato_salvato* s, unsigned char* intestazione, unsigned char* fissa) {
+    const Mappa_soa* m = &s->mappa;
+    for (int i = 0; i < 3; i++) {
+        memcpy(fissa + 100 * i, s->albo_doro[i], 100);
+        fissa[100 * i + 99] = '\0';
+    }
+    for (int i = 0; i < 4; i++) codifica_giocatore(fissa + DIM_ALBO + DIM_GIOCATORE * i, &s->giocatori[i]);
+
+    // Il corpo è tutto in memoria: il CRC si calcola prima di scrivere
+    uint32_t crc = crc32_aggiorna(0, fissa, DIM_ALBO + 4 * DIM_GIOCATORE);
+    const unsigned char* campi[4] = { m->tipo, m->nemico_mr, m->oggetto_mr, m->nemico_ss };
+    for (int c = 0; c < 4; c++) crc = crc32_aggiorna(crc, campi[c], m->n);
+
+    memset(intestazione, 0, DIM_INTESTAZIONE);
+    memcpy(intestazione, MAGIC, 8);
+    scrivi_u32(intestazione + OFF_VERSIONE, SALVATAGGIO_VERSIONE);
+    scrivi_u32(intestazione + OFF_FLAG, s->flag);
+    scrivi_u32(intestazione + OFF_GIOCATORI, (uint32_t) s->numero_giocatori);
+    scrivi_u64(intestazione + OFF_ZONE, (uint64_t) m->n);
+    for (int i = 0; i < 4; i++) scrivi_u64(intestazione + OFF_RNG + 8 * i, s->rng[i]);
+    scrivi_u32(intestazione + OFF_CRC_CORPO, crc);
+    scrivi_u32(intestazione + OFF_CRC_INTEST, crc32_aggiorna(0, intestazione, OFF_CRC_INTEST));
+}
+
+size_t salvataggio_dimensione(const Stato_salvato* s) {
+    return DIM_FISSA + 4 * s->mappa.n;
+}
+
+void salvataggio_codifica(const Stato_salvato* s, unsigned char* buf) {
+    const Mappa_soa* m = &s->mappa;
+    prepara(s, buf, buf + DIM_INTESTAZIONE);
+    if (m->n == 0) return;
+    unsigned char* p = buf + DIM_FISSA;
+    memcpy(p, m->tipo, m->n); p += m->n;
+    memcpy(p, m->nemico_mr, m->n); p += m->n;
+    memcpy(p, m->oggetto_mr, m->n); p += m->n;
+    memcpy(p, m->nemico_ss, m->n);
+}
+
+Esito_salvataggio salvataggio_scrivi(const char* percorso, const Stato_salvato* s) {
+    const Mappa_soa* m = &s->mappa;
+    unsigned char intestazione[DIM_INTESTAZIONE];
+    unsigned char fissa[DIM_ALBO + 4 * DIM_GIOCATORE];
+    prepara(s, intestazione, fissa);
+    const unsigned char* campi[4] = { m->tipo, m->nemico_mr, m->oggetto_mr, m->nemico_ss };
+
+    size_t lunghezza = strlen(percorso);
+    char* temporaneo = (char*) malloc(lunghezza + 5);
+    if (temporaneo == NULL) return salvataggio_errore_file;
+    memcpy(temporaneo, percorso, lunghezza);
+    memcpy(temporaneo + lunghezza, ".tmp", 5);
+
+    FILE* f = fopen(temporaneo, "wb");
+    if (f == NULL) { free(temporaneo); return salvataggio_errore_file; }
+    int ok = fwrite(intestazione, 1, sizeof(intestazione), f) == sizeof(intestazione)
+          && fwrite(fissa, 1, sizeof(fissa), f) == sizeof(fissa);
+    for (int c = 0; c < 4 && ok; c++) ok = fwrite(campi[c], 1, m->n, f) == m->n;
+    if (fclose(f) != 0) ok = 0;
+    if (ok) ok = rename(temporaneo, percorso) == 0;
+    if (!ok) remove(temporaneo);
+    free(temporaneo);
+    return ok ? salvataggio_ok : salvataggio_errore_file;
+}
+
+// ============================================================================
+// LETTURA
+// ============================================================================
+
+static int decodifica_giocatore(const unsigned char* p, Giocatore_salvato* g, size_t n_zone) {
+    memset(g, 0, sizeof(*g));
+    g->pos_mr = -1; g->pos_ss = -1;
+    if (p[0] == 0) return 1;
+    if (p[0] != 1 || p[1] > 1) return 0;
+    g->presente = 1;
+    g->mondo = p[1];
+    for (int i = 0; i < 3; i++) {
+        if (p[2 + i] > schitarrata_metallica) return 0;
+        g->zaino[i] = p[2 + i];
+    }
+    g->attacco = (int) (int32_t) leggi_u32(p + 8);
+    g->difesa = (int) (int32_t) leggi_u32(p + 12);
+    g->fortuna = (int) (int32_t) leggi_u32(p + 16);
+    g->pos_mr = (int64_t) leggi_u64(p + 24);
+    g->pos_ss = (int64_t) leggi_u64(p + 32);
+    // Un giocatore presente sta su una zona, la stessa nei due mondi
+    if (g->pos_mr < 0 || g->pos_mr >= (int64_t) n_zone || g->pos_ss != g->pos_mr) return 0;
+    if (memchr(p + 40, '\0', 100) == NULL) return 0;
+    memcpy(g->nome, p + 40, 100);
+    return 1;
+}
+
+Esito_salvataggio salvataggio_decodifica(const void* dati, size_t dimensione, Stato_salvato* s) {
+    const unsigned char* d = (const unsigned char*) dati;
+    if (dimensione < DIM_FISSA || memcmp(d, MAGIC, 8) != 0) return salvataggio_errore_formato;
+    if (leggi_u32(d + OFF_VERSIONE) != SALVATAGGIO_VERSIONE) return salvataggio_errore_versione;
+    if (crc32_aggiorna(0, d, OFF_CRC_INTEST) != leggi_u32(d + OFF_CRC_INTEST)) return salvataggio_errore_checksum;
+
+    // L'intestazione è integra: il numero di zone determina la dimensione esatta
+    uint64_t n = leggi_u64(d + OFF_ZONE);
+    if (n > 0x7FFFFFFFu || (uint64_t) (dimensione - DIM_FISSA) != 4 * n) return salvataggio_errore_formato;
+    if (crc32_aggiorna(0, d + DIM_INTESTAZIONE, dimensione - DIM_INTESTAZIONE) != leggi_u32(d + OFF_CRC_CORPO))
+        return salvataggio_errore_checksum;
+
+    s->flag = leggi_u32(d + OFF_FLAG);
+    s->numero_giocatori = (int) leggi_u32(d + OFF_GIOCATORI);
+    if (s->flag > 7 || s->numero_giocatori < 0 || s->numero_giocatori > 4) return salvataggio_errore_valori;
+    for (int i = 0; i < 4; i++) s->rng[i] = leggi_u64(d + OFF_RNG + 8 * i);
+    if ((s->rng[0] | s->rng[1] | s->rng[2] | s->rng[3]) == 0) return salvataggio_errore_valori; // Genererebbe solo zeri
+
+    const unsigned char* p = d + DIM_INTESTAZIONE;
+    for (int i = 0; i < 3; i++) {
+        if (memchr(p + 100 * i, '\0', 100) == NULL) return salvataggio_errore_valori;
+        memcpy(s->albo_doro[i], p + 100 * i, 100);
+    }
+    p += DIM_ALBO;
+    for (int i = 0; i < 4; i++)
+        if (!decodifica_giocatore(p + DIM_GIOCATORE * i, &s->giocatori[i], (size_t) n)) return salvataggio_errore_valori;
+
+    // Le zone restano nel file: la mappa punta direttamente nella mappatura
+    unsigned char* zone = (unsigned char*) (d + DIM_FISSA);
+    s->mappa.n = (size_t) n;
+    s->mappa.tipo = zone;
+    s->mappa.nemico_mr = zone + n;
+    s->mappa.oggetto_mr = zone + 2 * n;
+    s->mappa.nemico_ss = zone + 3 * n;
+
+    int motivi = soa_valida(&s->mappa);
+    if (motivi & SOA_VALORI_INVALIDI) return salvataggio_errore_valori;
+    // Il Demotorzone manca solo se è già stato sconfitto, cioè a partita finita
+    if ((s->flag & (SALVATAGGIO_GIOCO_PRONTO | SALVATAGGIO_GIOCO_TERMINATO)) == SALVATAGGIO_GIOCO_PRONTO
+            && motivi != SOA_VALIDA) return salvataggio_errore_valori;
+    if ((s->flag & SALVATAGGIO_GIOCO_PRONTO) && (motivi & SOA_TROPPO_CORTA)) return salvataggio_errore_valori;
+    return salvataggio_ok;
+}
+
+Esito_salvataggio salvataggio_apri(const char* percorso, Stato_salvato* s, File_salvato* f) {
+    f->dati = NULL; f->dimensione = 0;
+    int fd = open(percorso, O_RDONLY);
+    if (fd < 0) return salvataggio_errore_file;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) { close(fd); return salvataggio_errore_file; }
+    if (st.st_size < DIM_FISSA) { close(fd); return salvataggio_errore_formato; }
+
+    size_t dimensione = (size_t) st.st_size;
+    void* dati = mmap(NULL, dimensione, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // La mappatura resta valida anche a descrittore chiuso
+    if (dati == MAP_FAILED) return salvataggio_errore_file;
+    posix_madvise(dati, dimensione, POSIX_MADV_SEQUENTIAL); // Checksum e ricostruzione leggono in ordine
+
+    Esito_salvataggio e = salvataggio_decodifica(dati, dimensione, s);
+    if (e != salvataggio_ok) { munmap(dati, dimensione); return e; }
+    f->dati = dati;
+    f->dimensione = dimensione;
+    return salvataggio_ok;
+}
+
+void salvataggio_chiudi(File_salvato* f) {
+    if (f->dati != NULL) munmap(f->dati, f->dimensione);
+    f->dati = NULL;
+    f->dimensione = 0;
+}
+
+const char* salvataggio_messaggio(Esito_salvataggio e) {
+    switch (e) {
+        case salvataggio_ok: return "ok";
+        case salvataggio_errore_file: return "impossibile accedere al file";
+        case salvataggio_errore_formato: return "il file non e' un salvataggio valido";
+        case salvataggio_errore_versione: return "versione del salvataggio non supportata";
+        case salvataggio_errore_checksum: return "salvataggio corrotto (checksum errato)";
+        case salvataggio_errore_valori: return "salvataggio con valori non validi";
+        case salvataggio_errore_memoria: return "memoria insufficiente";
+    }
+    return "errore sconosciuto";
+}
@@ -0,0 +1,94 @@
+#ifndef SALVATAGGIO_H
+#define SALVATAGGIO_H
+
+#include "mappa_soa.h"
+#include <stdint.h>
+
+// ============================================================================
+// SALVATAGGIO BINARIO DELLA PARTITA
+// ============================================================================
+// Formato versionato, little-endian, senza puntatori: le zone sono i quattro
+// array della Mappa_soa scritti uno dopo l'altro (i collegamenti avanti,
+// indietro e tra i mondi sono impliciti nell'indice) e le posizioni dei
+// giocatori sono indici di zona.
+//
+//   intestazione  72 byte   magic, versione, flag, contatori, stato Rng,
+//                           CRC-32 del corpo e CRC-32 dell'intestazione
+//   albo d'oro    3 x 100   nomi terminati da '\0'
+//   giocatori     4 x 140   presente, mondo, zaino, statistiche, posizioni, nome
+//   zone          4 x n     tipo[n], nemico_mr[n], oggetto_mr[n], nemico_ss[n]
+//
+// Il caricamento mappa il file in memoria e lo legge in ordine: la mappa
+// restituita punta nelle pagine del file (in sola lettura), senza buffer
+// intermedi. Non è pigro: il CRC del corpo, il controllo dei valori e la
+// ricostruzione delle liste toccano tutte le zone, quindi costa O(n).
+
+#define SALVATAGGIO_VERSIONE 1
+
+// Flag della partita
+#define SALVATAGGIO_UNDICI_PRESO    1
+#define SALVATAGGIO_GIOCO_PRONTO    2
+#define SALVATAGGIO_GIOCO_TERMINATO 4
+
+typedef struct Giocatore_salvato {
+    int presente;         // 0 se lo slot è vuoto (giocatore morto o mai creato)
+    int mondo;            // 0 = Mondo Reale, 1 = Soprasotto
+    int64_t pos_mr;       // Indice della zona (presente: in [0, n)), -1 se assente
+    int64_t pos_ss;       // Uguale a pos_mr: i due mondi si muovono insieme
+    int attacco, difesa, fortuna;
+    unsigned char zaino[3];
+    char nome[100];
+} Giocatore_salvato;
+
+typedef struct Stato_salvato {
+    unsigned int flag;    // Combinazione di SALVATAGGIO_*
+    int numero_giocatori;
+    Giocatore_salvato giocatori[4];
+    char albo_doro[3][100];
+    uint64_t rng[4];      // Stato del generatore della partita
+    Mappa_soa mappa;      // Dopo salvataggio_apri punta nel file mappato
+} Stato_salvato;
+
+// File mappato in memoria (da chiudere con salvataggio_chiudi)
+typedef struct File_salvato {
+    void* dati;
+    size_t dimensione;
+} File_salvato;
+
+typedef enum {
+    salvataggio_ok,
+    salvataggio_errore_file,      // Apertura, scrittura o mappatura fallita
+    salvataggio_errore_formato,   // Non è un salvataggio o è troncato
+    salvataggio_errore_versione,  // Versione non supportata
+    salvataggio_errore_checksum,  // Contenuto corrotto
+    salvataggio_errore_valori,    // Valori fuori dagli intervalli ammessi
+    salvataggio_errore_memoria    // Memoria insufficiente per ricostruire la partita
+} Esito_salvataggio;
+
+// Scrive lo stato su un file temporaneo e lo rinomina: un salvataggio
+// interrotto non sovrascrive mai quello precedente
+Esito_salvataggio salvataggio_scrivi(const char* percorso, const Stato_salvato* s);
+// Mappa il file, verifica checksum e valori e compila *s. In caso di
+// successo la mappa di *s resta valida fino a salvataggio_chiudi
+Esito_salvataggio salvataggio_apri(const char* percorso, Stato_salvato* s, File_salvato* f);
+void salvataggio_chiudi(File_salvato* f);
+
+// Stessa immagine del file, in memoria (usata dal diario di partita)
+size_t salvataggio_dimensione(const Stato_salvato* s);
+void salvataggio_codifica(const Stato_salvato* s, unsigned char* buf);
+// Come salvataggio_apri su un'immagine già in memoria: la mappa punta in dati
+Esito_salvataggio salvataggio_decodifica(const void* dati, size_t dimensione, Stato_salvato* s);
+
+// CRC-32 IEEE di n byte, continuando da crc (0 all'inizio). Usato anche
+// dalla classifica
+uint32_t crc32_aggiorna(uint32_t crc, const unsigned char* p, size_t n);
+
+// Descrizione leggibile dell'esito
+const char* salvataggio_messaggio(Esito_salvataggio e);
+
+// Conversioni con lo stato del gioco (implementate in gamelib.c)
+Esito_salvataggio partita_salva(const Sessione* s, const char* percorso);
+// Se il file non è valido la partita corrente resta intatta
+Esito_salvataggio partita_carica(Sessione* s, const char* percorso);
+
+#endif
@@ -0,0 +1,601 @@
+#define _GNU_SOURCE
+#include "server.h"
+#include "gamelib.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_EVENTI 256
+#define MAX_THREAD 64
+#define DIM_RIGA 128                  // Oltre, la riga viene troncata
+#define MAX_USCITA (1 << 20)          // Un client che non legge più viene scollegato
+#define CAPACITA_TENUTA 4096          // Buffer più grandi si liberano una volta svuotati
+#define MAX_SCELTE_AUTOMATICHE 100000 // Tavolo di soli agenti che non finisce: si chiude
+#define PERIODO_SCADENZE 1000         // Millisecondi fra due controlli delle scelte scadute
+
+typedef struct Tavolo Tavolo;
+
+typedef struct Connessione {
+    int fd;
+    int chiusa;       // fd chiuso, la memoria si libera a fine giro
+    int errore;       // Invio fallito o client troppo lento: va chiusa
+    int da_chiudere;  // Partita finita: si chiude appena inviato tutto
+    Tavolo* tavolo;
+    int posto;        // Indice del giocatore al tavolo
+    long long scadenza; // Millisecondi (CLOCK_MONOTONIC) entro cui rispondere alla richiesta
+    char nome[100];   // Vuoto finché non arriva la prima riga
+    char riga[DIM_RIGA];
+    size_t n_riga;
+    char* uscita;     // Da inviare: [inviati, n_uscita)
+    size_t n_uscita, inviati, capacita;
+    int attende_scrittura;
+    struct Connessione* prec;
+    struct Connessione* succ; // Connessioni aperte, poi da liberare
+} Connessione;
+
+struct Tavolo {
+    Sessione* s;
+    Connessione* posti[4]; // NULL: posto lasciato all'agente esploratore
+    int giocatori;         // Posti del tavolo
+    int seduti;
+    int collegati;         // Connessioni ancora al tavolo (partita in corso)
+    int in_corso;
+    int chiuso;            // Si libera a fine giro
+    const Richiesta* richiesta; // In attesa di posti[richiesta->giocatore]
+    Tavolo* succ;          // Tavoli da liberare
+};
+
+typedef struct Ciclo {
+    const Opzioni_server* o;
+    int epoll;
+    int fermo;              // Si sta chiudendo: niente più partite
+    Tavolo* in_attesa;      // Tavolo che si sta riempiendo
+    Connessione* aperte;
+    Connessione* da_liberare;
+    Tavolo* tavoli_da_liberare;
+    long long prossimo_controllo; // Delle scelte scadute
+    unsigned long long semi;
+    unsigned long long connessioni, partite;
+    pthread_t thread;
+} Ciclo;
+
+static int ascolto = -1;
+static int fermo[2] = { -1, -1 }; // SIGINT/SIGTERM scrivono qui e svegliano tutti i cicli
+static char segno_ascolto, segno_fermo; // Identificano i due fd in epoll_event.data.ptr
+
+static void avanza_tavolo(Ciclo* c, Tavolo* t, const Richiesta* r);
+static void svuota_tavolo(Ciclo* c, Tavolo* t);
+
+static long long adesso_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// ============================================================================
+// CONNESSIONI
+// ============================================================================
+
+static void imposta_eventi(Ciclo* c, Connessione* k, int scrittura) {
+    if (k->attende_scrittura == scrittura) return;
+    struct epoll_event e;
+    e.events = EPOLLIN | (scrittura ? EPOLLOUT : 0);
+    e.data.ptr = k;
+    epoll_ctl(c->epoll, EPOLL_CTL_MOD, k->fd, &e);
+    k->attende_scrittura = scrittura;
+}
+
+static void accoda(Connessione* k, const char* s, size_t n) {
+    if (k->chiusa || k->errore) return;
+    if (k->n_uscita + n > MAX_USCITA) { k->errore = 1; return; }
+    if (k->n_uscita + n > k->capacita) {
+        size_t capacita = k->capacita > 0 ? k->capacita : 256;
+        while (capacita < k->n_uscita + n) capacita *= 2;
+        char* nuova = (char*) realloc(k->uscita, capacita);
+        if (nuova == NULL) { k->errore = 1; return; }
+        k->uscita = nuova;
+        k->capacita = capacita;
+    }
+    memcpy(k->uscita + k->n_uscita, s, n);
+    k->n_uscita += n;
+}
+
+static void accoda_formato(Connessione* k, const char* formato, ...)
+#if defined(__GNUC__)
+    __attribute__((format(printf, 2, 3)))
+#endif
+    ;
+
+static void accoda_formato(Connessione* k, const char* formato, ...) {
+    char buf[256];
+    va_list ap;
+    va_start(ap, formato);
+    int n = vsnprintf(buf, sizeof(buf), formato, ap);
+    va_end(ap);
+    if (n > 0) accoda(k, buf, (size_t) n < sizeof(buf) ? (size_t) n : sizeof(buf) - 1);
+}
+
+// Destinazioni di uscita_devia: un giocatore o tutto il tavolo
+static void scrivi_connessione(const char* s, size_t n, void* dati) {
+    accoda((Connessione*) dati, s, n);
+}
+
+static void scrivi_tavolo(const char* s, size_t n, void* dati) {
+    Tavolo* t = (Tavolo*) dati;
+    for (int i = 0; i < t->giocatori; i++) if (t->posti[i] != NULL) accoda(t->posti[i], s, n);
+}
+
+// Invia quanto possibile; il resto parte quando il socket torna scrivibile
+static void invia(Ciclo* c, Connessione* k) {
+    while (!k->errore && k->inviati < k->n_uscita) {
+        ssize_t n = send(k->fd, k->uscita + k->inviati, k->n_uscita - k->inviati, MSG_NOSIGNAL);
+        if (n > 0) { k->inviati += (size_t) n; continue; }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) { imposta_eventi(c, k, 1); return; }
+        k->errore = 1;
+    }
+    if (k->errore) return;
+    k->n_uscita = k->inviati = 0;
+    if (k->capacita > CAPACITA_TENUTA) { free(k->uscita); k->uscita = NULL; k->capacita = 0; }
+    imposta_eventi(c, k, 0);
+}
+
+// Toglie k da un tavolo che si sta ancora riempiendo
+static void lascia_posto(Tavolo* t, Connessione* k) {
+    for (int i = k->posto; i + 1 < t->seduti; i++) {
+        t->posti[i] = t->posti[i + 1];
+        t->posti[i]->posto = i;
+    }
+    t->posti[--t->seduti] = NULL;
+}
+
+static void chiudi_tavolo(Ciclo* c, Tavolo* t) {
+    if (t->chiuso) return;
+    t->chiuso = 1;
+    t->richiesta = NULL;
+    t->succ = c->tavoli_da_liberare;
+    c->tavoli_da_liberare = t;
+}
+
+static void chiudi(Ciclo* c, Connessione* k) {
+    if (k->chiusa) return;
+    k->chiusa = 1;
+    epoll_ctl(c->epoll, EPOLL_CTL_DEL, k->fd, NULL);
+    close(k->fd);
+    if (k->prec != NULL) k->prec->succ = k->succ;
+    else c->aperte = k->succ;
+    if (k->succ != NULL) k->succ->prec = k->prec;
+    k->succ = c->da_liberare;
+    c->da_liberare = k;
+
+    Tavolo* t = k->tavolo;
+    k->tavolo = NULL;
+    if (t == NULL || t->chiuso) return;
+    if (!t->in_corso) { lascia_posto(t, k); return; }
+    t->posti[k->posto] = NULL;
+    if (--t->collegati == 0) { chiudi_tavolo(c, t); return; }
+    // Se toccava a lui, da qui in poi sceglie l'agente
+    if (!c->fermo && t->richiesta != NULL && t->richiesta->giocatore == k->posto) avanza_tavolo(c, t, t->richiesta);
+}
+
+// Dopo un invio: chiude chi ha avuto un errore o ha finito
+static void dopo_invio(Ciclo* c, Connessione* k) {
+    if (k->errore || (k->da_chiudere && k->inviati == k->n_uscita)) chiudi(c, k);
+}
+
+static void libera_rimandati(Ciclo* c) {
+    while (c->da_liberare != NULL) {
+        Connessione* k = c->da_liberare;
+        c->da_liberare = k->succ;
+        free(k->uscita);
+        free(k);
+    }
+    while (c->tavoli_da_liberare != NULL) {
+        Tavolo* t = c->tavoli_da_liberare;
+        c->tavoli_da_liberare = t->succ;
+        if (t->s != NULL) sessione_distruggi(t->s);
+        free(t);
+    }
+}
+
+// ============================================================================
+// TAVOLI
+// ============================================================================
+
+static void manda_richiesta(Ciclo* c, Connessione* k, const Richiesta* r) {
+    const struct Giocatore* g = r->g;
+    switch (r->tipo) {
+        case richiesta_azione: {
+            Tipo_nemico nemico = g->mondo == 0 ? g->pos_mondoreale->nemico : g->pos_soprasotto->nemico;
+            int ultima = g->mondo == 0 ? g->pos_mondoreale->avanti == NULL : g->pos_soprasotto->avanti == NULL;
+            accoda_formato(k, "?azione %d %d %d %d\n", r->movimento_fatto, g->mondo, (int) nemico, ultima);
+            break;
+        }
+        case richiesta_combattimento:
+            accoda_formato(k, "?combattimento %d %d %d\n", (int) r->nemico, r->hp_giocatore, r->hp_nemico);
+            break;
+        case richiesta_oggetto:
+            accoda_formato(k, "?oggetto %d\n", r->in_combattimento);
+            break;
+        default:
+            return;
+    }
+    uscita_devia(scrivi_connessione, k);
+    partita_stampa_richiesta(r);
+    uscita_devia(NULL, NULL);
+    if (c->o->attesa_scelta > 0) k->scadenza = adesso_ms() + (long long) c->o->attesa_scelta * 1000;
+}
+
+// Fine partita: risultato a tutti, connessioni chiuse dopo l'invio.
+// Se interrotta non c'è un risultato: si manda il limite di round
+static void finisci_tavolo(Ciclo* c, Tavolo* t, int interrotta) {
+    Risultato_partita r = { esito_limite_round, -1, 0, { nessun_nemico } };
+    if (!interrotta) r = partita_risultato(t->s);
+    Connessione* posti[4];
+    for (int i = 0; i < t->giocatori; i++) {
+        posti[i] = t->posti[i];
+        t->posti[i] = NULL;
+        if (posti[i] == NULL) continue;
+        posti[i]->tavolo = NULL;
+        posti[i]->da_chiudere = 1;
+        accoda_formato(posti[i], "#fine %d %d %d\n", (int) r.esito, r.vincitore, r.round);
+    }
+    chiudi_tavolo(c, t);
+    c->partite++;
+    for (int i = 0; i < t->giocatori; i++) {
+        if (posti[i] == NULL) continue;
+        invia(c, posti[i]);
+        dopo_invio(c, posti[i]);
+    }
+}
+
+// Fa avanzare la partita dalla richiesta r fino a una scelta di un giocatore
+// collegato (o alla fine). I messaggi vanno a tutto il tavolo
+static void avanza_tavolo(Ciclo* c, Tavolo* t, const Richiesta* r) {
+    if (t->chiuso) return;
+    uscita_devia(scrivi_tavolo, t);
+    int automatiche = 0;
+    while (r->tipo != richiesta_nessuna && t->posti[r->giocatore] == NULL && automatiche++ < MAX_SCELTE_AUTOMATICHE)
+        r = partita_rispondi(t->s, agente_rispondi(&agente_esploratore, r));
+    uscita_devia(NULL, NULL);
+
+    if (r->tipo == richiesta_nessuna || t->posti[r->giocatore] == NULL) {
+        finisci_tavolo(c, t, r->tipo != richiesta_nessuna);
+        return;
+    }
+    t->richiesta = r;
+    manda_richiesta(c, t->posti[r->giocatore], r);
+    svuota_tavolo(c, t);
+}
+
+static void svuota_tavolo(Ciclo* c, Tavolo* t) {
+    for (int i = 0; i < t->giocatori; i++) if (t->posti[i] != NULL) invia(c, t->posti[i]);
+    // Chi non riceve più lascia il posto (e l'eventuale scelta) all'agente
+    for (int i = 0; i < t->giocatori; i++) if (t->posti[i] != NULL) dopo_invio(c, t->posti[i]);
+}
+
+static void inizia_tavolo(Ciclo* c, Tavolo* t) {
+    const char* nomi[4];
+    for (int i = 0; i < t->seduti; i++) {
+        nomi[i] = t->posti[i]->nome;
+        accoda_formato(t->posti[i], "#inizio %d %d\n", t->giocatori, i);
+    }
+    t->in_corso = 1;
+    t->collegati = t->seduti;
+    t->s = sessione_crea(c->semi++);
+    if (t->s == NULL) { finisci_tavolo(c, t, 1); return; }
+
+    uscita_devia(scrivi_tavolo, t);
+    motore_imposta_giocatori(t->s, t->giocatori, nomi, NULL);
+    const Richiesta* r = motore_genera_mappa(t->s) ? partita_inizia(t->s, c->o->max_round) : NULL;
+    uscita_devia(NULL, NULL);
+    if (r == NULL) finisci_tavolo(c, t, 1);
+    else avanza_tavolo(c, t, r);
+}
+
+static void siedi(Ciclo* c, Connessione* k) {
+    Tavolo* t = c->in_attesa;
+    if (t == NULL) {
+        t = (Tavolo*) calloc(1, sizeof(Tavolo));
+        if (t == NULL) { k->errore = 1; return; }
+        t->giocatori = c->o->giocatori;
+        c->in_attesa = t;
+    }
+    k->tavolo = t;
+    k->posto = t->seduti;
+    t->posti[t->seduti++] = k;
+    if (t->seduti == t->giocatori) {
+        c->in_attesa = NULL;
+        inizia_tavolo(c, t);
+        return;
+    }
+    for (int i = 0; i < t->seduti; i++) accoda_formato(t->posti[i], "#attesa %d\n", t->giocatori - t->seduti);
+    svuota_tavolo(c, t);
+}
+
+static void riga_ricevuta(Ciclo* c, Connessione* k, const char* riga) {
+    if (k->da_chiudere) return;
+    if (k->nome[0] == '\0') {
+        snprintf(k->nome, sizeof(k->nome), "%.99s", riga[0] != '\0' ? riga : "Giocatore");
+        siedi(c, k);
+        return;
+    }
+    Tavolo* t = k->tavolo;
+    if (t == NULL || t->richiesta == NULL || t->richiesta->giocatore != k->posto) {
+        accoda(k, "#attendi\n", 9);
+        return;
+    }
+    // Come nel gioco da terminale, ciò che non è un numero vale 0 (comando non valido)
+    int scelta = (int) strtol(riga, NULL, 10);
+    t->richiesta = NULL;
+    uscita_devia(scrivi_tavolo, t);
+    const Richiesta* r = partita_rispondi(t->s, scelta);
+    uscita_devia(NULL, NULL);
+    avanza_tavolo(c, t, r);
+}
+
+static void leggi(Ciclo* c, Connessione* k) {
+    char buf[4096];
+    for (;;) {
+        ssize_t n = recv(k->fd, buf, sizeof(buf), 0);
+        if (n == 0) { chiudi(c, k); return; }
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) chiudi(c, k);
+            break;
+        }
+        for (ssize_t i = 0; i < n && !k->chiusa; i++) {
+            if (buf[i] == '\n') {
+                k->riga[k->n_riga] = '\0';
+                k->n_riga = 0;
+                riga_ricevuta(c, k, k->riga);
+            } else if (buf[i] != '\r' && k->n_riga < DIM_RIGA - 1) {
+                k->riga[k->n_riga++] = buf[i];
+            }
+        }
+        if (k->chiusa || (size_t) n < sizeof(buf)) break;
+    }
+    if (k->chiusa) return;
+    invia(c, k);
+    dopo_invio(c, k);
+}
+
+static void accetta(Ciclo* c) {
+    for (;;) {
+        int fd = accept4(ascolto, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            return; // EAGAIN, o fd finiti: si riprova al prossimo evento
+        }
+        Connessione* k = (Connessione*) calloc(1, sizeof(Connessione));
+        if (k == NULL) { close(fd); continue; }
+        int uno = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &uno, sizeof(uno)); // Fallisce (innocuo) sui socket Unix
+        k->fd = fd;
+        struct epoll_event e;
+        e.events = EPOLLIN;
+        e.data.ptr = k;
+        if (epoll_ctl(c->epoll, EPOLL_CTL_ADD, fd, &e) != 0) { close(fd); free(k); continue; }
+        k->succ = c->aperte;
+        if (c->aperte != NULL) c->aperte->prec = k;
+        c->aperte = k;
+        c->connessioni++;
+        accoda(k, "#nome\n", 6);
+        uscita_devia(scrivi_connessione, k);
+        stampa("Benvenuto a Cose Strane! Come ti chiami? ");
+        uscita_devia(NULL, NULL);
+        invia(c, k);
+        dopo_invio(c, k);
+    }
+}
+
+// Chi non ha risposto in tempo viene scollegato e la scelta passa all'agente
+// (come per chi si scollega da solo). Dopo ogni chiusura la lista si
+// riscorre: chiudi può far finire il tavolo e chiudere altre connessioni
+static void controlla_scadenze(Ciclo* c) {
+    long long ora = adesso_ms();
+    if (ora < c->prossimo_controllo) return;
+    c->prossimo_controllo = ora + PERIODO_SCADENZE;
+    Connessione* k = c->aperte;
+    while (k != NULL) {
+        Tavolo* t = k->tavolo;
+        if (t == NULL || t->richiesta == NULL || t->richiesta->giocatore != k->posto || ora < k->scadenza) {
+            k = k->succ;
+            continue;
+        }
+        accoda(k, "\n#scaduto\n", 10); // Il menu finisce con "Scelta: " senza a capo
+        invia(c, k);
+        chiudi(c, k);
+        k = c->aperte;
+    }
+}
+
+// ============================================================================
+// CICLO DI EVENTI
+// ============================================================================
+
+static void* ciclo_eventi(void* arg) {
+    Ciclo* c = (Ciclo*) arg;
+    uscita_imposta_verbosita(c->o->verbosita);
+    struct epoll_event eventi[MAX_EVENTI];
+    int attesa = c->o->attesa_scelta > 0 ? PERIODO_SCADENZE : -1;
+    while (!c->fermo) {
+        int n = epoll_wait(c->epoll, eventi, MAX_EVENTI, attesa);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            void* p = eventi[i].data.ptr;
+            if (p == &segno_fermo) { c->fermo = 1; continue; }
+            if (p == &segno_ascolto) { accetta(c); continue; }
+            Connessione* k = (Connessione*) p;
+            if (k->chiusa) continue; // Chiusa da un evento precedente dello stesso giro
+            if (eventi[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) leggi(c, k);
+            if (!k->chiusa && (eventi[i].events & EPOLLOUT)) {
+                invia(c, k);
+                dopo_invio(c, k);
+            }
+        }
+        if (attesa > 0) controlla_scadenze(c);
+        libera_rimandati(c);
+    }
+
+    while (c->aperte != NULL) chiudi(c, c->aperte);
+    if (c->in_attesa != NULL) chiudi_tavolo(c, c->in_attesa);
+    libera_rimandati(c);
+    return NULL;
+}
+
+// ============================================================================
+// AVVIO
+// ============================================================================
+
+static void gestore_fermo(int segnale) {
+    (void) segnale;
+    int errno_salvato = errno;
+    if (write(fermo[1], "x", 1) < 0) { /* Già segnalato: la pipe non si svuota */ }
+    errno = errno_salvato;
+}
+
+static int apri_ascolto(const char* indirizzo) {
+    if (strchr(indirizzo, '/') != NULL) {
+        struct sockaddr_un a;
+        memset(&a, 0, sizeof(a));
+        a.sun_family = AF_UNIX;
+        if (strlen(indirizzo) >= sizeof(a.sun_path)) return -1;
+        strcpy(a.sun_path, indirizzo);
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) return -1;
+        unlink(indirizzo); // Socket rimasto da un server precedente
+        if (bind(fd, (struct sockaddr*) &a, sizeof(a)) != 0 || listen(fd, SOMAXCONN) != 0) { close(fd); return -1; }
+        return fd;
+    }
+
+    // "porta" oppure "host:porta"
+    char host[256] = "";
+    const char* porta = indirizzo;
+    const char* due_punti = strrchr(indirizzo, ':');
+    if (due_punti != NULL) {
+        size_t n = (size_t) (due_punti - indirizzo);
+        if (n >= sizeof(host)) return -1;
+        memcpy(host, indirizzo, n);
+        host[n] = '\0';
+        porta = due_punti + 1;
+    }
+    struct addrinfo suggerimenti, *elenco;
+    memset(&suggerimenti, 0, sizeof(suggerimenti));
+    suggerimenti.ai_family = AF_UNSPEC;
+    suggerimenti.ai_socktype = SOCK_STREAM;
+    suggerimenti.ai_flags = AI_PASSIVE;
+    if (getaddrinfo(host[0] != '\0' ? host : NULL, porta, &suggerimenti, &elenco) != 0) return -1;
+    int fd = -1;
+    for (struct addrinfo* a = elenco; a != NULL && fd < 0; a = a->ai_next) {
+        fd = socket(a->ai_family, a->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, a->ai_protocol);
+        if (fd < 0) continue;
+        int uno = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &uno, sizeof(uno));
+        if (bind(fd, a->ai_addr, a->ai_addrlen) != 0 || listen(fd, SOMAXCONN) != 0) { close(fd); fd = -1; }
+    }
+    freeaddrinfo(elenco);
+    return fd;
+}
+
+// Migliaia di giocatori collegati: si usa tutto il limite di fd concesso
+static void alza_limite_fd(void) {
+    struct rlimit l;
+    if (getrlimit(RLIMIT_NOFILE, &l) == 0 && l.rlim_cur < l.rlim_max) {
+        l.rlim_cur = l.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &l);
+    }
+}
+
+static int crea_ciclo(Ciclo* c, const Opzioni_server* o, int indice) {
+    memset(c, 0, sizeof(*c));
+    c->o = o;
+    c->semi = (unsigned long long) time(NULL) * 1000003ull + (unsigned long long) indice * 0x9E3779B97F4A7C15ull;
+    c->epoll = epoll_create1(EPOLL_CLOEXEC);
+    if (c->epoll < 0) return 0;
+    struct epoll_event e;
+    // EPOLLEXCLUSIVE: una nuova connessione sveglia un solo ciclo
+    e.events = EPOLLIN | EPOLLEXCLUSIVE;
+    e.data.ptr = &segno_ascolto;
+    if (epoll_ctl(c->epoll, EPOLL_CTL_ADD, ascolto, &e) != 0) { close(c->epoll); return 0; }
+    e.events = EPOLLIN;
+    e.data.ptr = &segno_fermo;
+    if (epoll_ctl(c->epoll, EPOLL_CTL_ADD, fermo[0], &e) != 0) { close(c->epoll); return 0; }
+    return 1;
+}
+
+int server_avvia(const Opzioni_server* opzioni) {
+    Opzioni_server o = *opzioni;
+    if (o.giocatori < 1) o.giocatori = 1;
+    if (o.giocatori > 4) o.giocatori = 4;
+    if (o.thread <= 0) {
+        long core = sysconf(_SC_NPROCESSORS_ONLN);
+        o.thread = core > 0 ? (int) core : 1;
+    }
+    if (o.thread > MAX_THREAD) o.thread = MAX_THREAD;
+
+    alza_limite_fd();
+    ascolto = apri_ascolto(o.indirizzo);
+    if (ascolto < 0) {
+        uscita_formatta("Errore: impossibile ascoltare su %s (%s).\n", o.indirizzo, strerror(errno));
+        return 1;
+    }
+    if (pipe2(fermo, O_CLOEXEC | O_NONBLOCK) != 0) { close(ascolto); return 1; }
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = gestore_fermo;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    Ciclo* cicli = (Ciclo*) calloc((size_t) o.thread, sizeof(Ciclo));
+    int avviati = 0;
+    if (cicli != NULL) {
+        // Il thread chiamante fa da primo ciclo
+        for (; avviati < o.thread; avviati++) {
+            if (!crea_ciclo(&cicli[avviati], &o, avviati)) break;
+            if (avviati > 0 && pthread_create(&cicli[avviati].thread, NULL, ciclo_eventi, &cicli[avviati]) != 0) {
+                close(cicli[avviati].epoll);
+                break;
+            }
+        }
+    }
+    if (avviati > 0) {
+        uscita_formatta("Server in ascolto su %s: %d thread, tavoli da %d giocatori.\n", o.indirizzo, avviati, o.giocatori);
+        uscita_svuota();
+        ciclo_eventi(&cicli[0]);
+    }
+
+    unsigned long long connessioni = 0, partite = 0;
+    for (int i = 0; i < avviati; i++) {
+        if (i > 0) pthread_join(cicli[i].thread, NULL);
+        close(cicli[i].epoll);
+        connessioni += cicli[i].connessioni;
+        partite += cicli[i].partite;
+    }
+    free(cicli);
+    close(ascolto);
+    close(fermo[0]);
+    close(fermo[1]);
+    if (strchr(o.indirizzo, '/') != NULL) unlink(o.indirizzo);
+    uscita_formatta("Server chiuso: %llu connessioni, %llu partite concluse.\n", connessioni, partite);
+    return avviati > 0 ? 0 : 1;
+}
@@ -0,0 +1,44 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "uscita.h"
+
+// ============================================================================
+// SERVER DI GIOCO IN RETE
+// ============================================================================
+// Un processo ospita molti tavoli su TCP o su socket Unix. Ogni thread ha un
+// ciclo di eventi epoll con le sue connessioni e i suoi tavoli; una partita
+// avanza a passi (partita_inizia/partita_rispondi) e mentre un giocatore
+// decide il tavolo è solo memoria, senza thread bloccati. Un tavolo parte
+// quando ha tutti i giocatori; chi si scollega, o non sceglie entro il tempo
+// concesso, lascia il posto all'agente esploratore e il tavolo chiude quando
+// non resta nessuno.
+//
+// Protocollo a righe (si gioca anche con nc). Il client manda il nome come
+// prima riga, poi una scelta per riga, solo quando gli viene chiesta. Il
+// server manda i messaggi della partita a tutto il tavolo e il menu a chi
+// deve scegliere (nulla con verbosità silenziosa), più le righe di controllo:
+//   #nome                         si attende il nome
+//   #attesa N                     tavolo in attesa di N giocatori
+//   #inizio GIOCATORI POSTO       partita iniziata, POSTO è l'indice del client
+//   ?azione MOSSO MONDO NEMICO ULTIMA  menu di turno (zona del giocatore)
+//   ?combattimento NEMICO HP_GIOCATORE HP_NEMICO
+//   ?oggetto IN_COMBATTIMENTO
+//   #attendi                      riga arrivata quando non era richiesta (scartata)
+//   #scaduto                      tempo per la scelta finito, poi la connessione chiude
+//   #fine ESITO VINCITORE ROUND   fine partita (Esito_partita), poi la connessione chiude
+
+typedef struct Opzioni_server {
+    const char* indirizzo; // "porta", "host:porta" o percorso di un socket Unix (contiene '/')
+    int giocatori;         // Giocatori per tavolo (1-4)
+    int thread;            // Cicli di eventi (<= 0: uno per core)
+    int max_round;         // Limite di round per partita (<= 0: nessuno)
+    Verbosita verbosita;   // Dei messaggi mandati ai tavoli
+    int attesa_scelta;     // Secondi per rispondere a una richiesta (<= 0: nessun limite)
+} Opzioni_server;
+
+// Serve finché non arriva SIGINT o SIGTERM. Restituisce 0, oppure 1 se non
+// riesce ad ascoltare sull'indirizzo
+int server_avvia(const Opzioni_server* o);
+
+#endif
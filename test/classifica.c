@@ -0,0 +1,217 @@
+#define _POSIX_C_SOURCE 200809L
+#include "verifica.h"
+#include "classifica.h"
+
+#define GIOCATORI 25
+#define DIM_INTESTAZIONE 16
+#define DIM_RECORD 128
+
+// Quello che la classifica deve sapere, tenuto a parte dal test
+typedef struct Atteso {
+    uint64_t vittorie, round_totali, ultima;
+    int round_minimo;
+} Atteso;
+
+static Atteso attesi[GIOCATORI];
+static Vittoria_registrata storia[4096];
+static size_t registrate = 0;
+
+static void nome_giocatore(int i, char nome[100]) {
+    snprintf(nome, 100, "Giocatore %02d", i);
+}
+
+// Vittorie con distribuzione sbilanciata, così che la classifica cambi spesso
+static void registra(Classifica* c, int quante, unsigned seme) {
+    for (int k = 0; k < quante; k++) {
+        seme = seme * 1103515245u + 12345u;
+        int i = (int) ((seme >> 16) % GIOCATORI);
+        if (i > GIOCATORI / 2) i = (int) ((seme >> 8) % 4);
+        int round = 1 + (int) ((seme >> 4) % 200);
+        Vittoria_registrata* v = &storia[registrate++];
+        v->istante = 1700000000u + registrate;
+        v->round = round;
+        nome_giocatore(i, v->nome);
+        CONTROLLA(classifica_registra(c, v->nome, round, v->istante));
+        Atteso* a = &attesi[i];
+        if (a->vittorie == 0 || round < a->round_minimo) a->round_minimo = round;
+        a->vittorie++;
+        a->round_totali += (uint64_t) round;
+        a->ultima = v->istante;
+    }
+}
+
+static void togli_ultima(void) {
+    Vittoria_registrata* v = &storia[--registrate];
+    int i = atoi(v->nome + strlen("Giocatore "));
+    Atteso* a = &attesi[i];
+    a->vittorie--;
+    a->round_totali -= (uint64_t) v->round;
+    a->round_minimo = 0;
+    a->ultima = 0;
+    for (size_t k = 0; k < registrate; k++) {
+        if (strcmp(storia[k].nome, v->nome) != 0) continue;
+        if (a->round_minimo == 0 || storia[k].round < a->round_minimo) a->round_minimo = storia[k].round;
+        a->ultima = storia[k].istante;
+    }
+}
+
+static int come_atteso(const Statistiche_vincitore* s, int i) {
+    const Atteso* a = &attesi[i];
+    return s->vittorie == a->vittorie && s->round_totali == a->round_totali
+        && s->round_minimo == a->round_minimo && s->ultima == a->ultima;
+}
+
+// Tutte le interrogazioni contro i valori attesi
+static void controlla(Classifica* c) {
+    char nome[100];
+    Statistiche_vincitore s, migliori[GIOCATORI + 1];
+    Vittoria_registrata recenti[64];
+    size_t giocatori = 0;
+
+    CONTROLLA(classifica_vittorie(c) == registrate);
+    for (int i = 0; i < GIOCATORI; i++) {
+        nome_giocatore(i, nome);
+        int trovato = classifica_giocatore(c, nome, &s);
+        CONTROLLA(trovato == (attesi[i].vittorie > 0));
+        if (trovato) { CONTROLLA(come_atteso(&s, i)); giocatori++; }
+    }
+    CONTROLLA(classifica_giocatori(c) == giocatori);
+    CONTROLLA(!classifica_giocatore(c, "Nessuno", &s));
+
+    size_t k = classifica_migliori(c, migliori, GIOCATORI + 1);
+    CONTROLLA(k == giocatori);
+    for (size_t j = 0; j < k; j++) {
+        CONTROLLA(j == 0 || migliori[j].vittorie <= migliori[j - 1].vittorie);
+        CONTROLLA(come_atteso(&migliori[j], atoi(migliori[j].nome + strlen("Giocatore "))));
+    }
+    CONTROLLA(classifica_migliori(c, migliori, 3) == (giocatori < 3 ? giocatori : 3));
+
+    size_t n = classifica_recenti(c, recenti, 64);
+    CONTROLLA(n == (registrate < 64 ? registrate : 64));
+    for (size_t j = 0; j < n; j++) {
+        const Vittoria_registrata* v = &storia[registrate - 1 - j];
+        CONTROLLA(recenti[j].istante == v->istante && recenti[j].round == v->round && strcmp(recenti[j].nome, v->nome) == 0);
+    }
+}
+
+static Classifica* riapri(Classifica* c, const char* percorso) {
+    classifica_chiudi(c);
+    c = classifica_apri(percorso);
+    CONTROLLA(c != NULL);
+    if (c == NULL) exit(fine_test("classifica"));
+    return c;
+}
+
+static void copia_file(const char* da, const char* a) {
+    size_t n;
+    unsigned char* dati = leggi_file(da, &n);
+    CONTROLLA(dati != NULL && scrivi_file(a, dati, n));
+    free(dati);
+}
+
+static void test_andata_ritorno(const char* log, const char* indice) {
+    Classifica* c = classifica_apri(log);
+    CONTROLLA(c != NULL);
+    if (c == NULL) return;
+    controlla(c);                       // Vuota
+    registra(c, 700, 1);
+    controlla(c);
+
+    // Con l'indice, senza e con un indice corrotto si ottiene la stessa classifica
+    c = riapri(c, log);
+    controlla(c);
+    classifica_chiudi(c);
+    CONTROLLA(remove(indice) == 0);
+    c = classifica_apri(log);
+    CONTROLLA(c != NULL);
+    controlla(c);
+    classifica_chiudi(c);
+    size_t n;
+    unsigned char* dati = leggi_file(indice, &n);
+    CONTROLLA(dati != NULL && n > 40);
+    dati[40 + 20] ^= 1;
+    CONTROLLA(scrivi_file(indice, dati, n));
+    free(dati);
+    c = classifica_apri(log);
+    CONTROLLA(c != NULL);
+    controlla(c);
+
+    // Un indice vecchio copre solo i primi record: gli altri si rileggono
+    c = riapri(c, log);
+    copia_file(indice, file_test("vecchio.indice"));
+    registra(c, 300, 2);
+    classifica_chiudi(c);
+    copia_file(file_test("vecchio.indice"), indice);
+    c = classifica_apri(log);
+    CONTROLLA(c != NULL);
+    controlla(c);
+    classifica_chiudi(c);
+}
+
+static void test_coda_corrotta(const char* log) {
+    size_t n;
+    unsigned char* dati = leggi_file(log, &n);
+    CONTROLLA(dati != NULL && n == DIM_INTESTAZIONE + registrate * DIM_RECORD);
+
+    // Ultimo record scritto a metà: scartato e log accorciato (l'indice copre
+    // un record che non c'è più e non vale)
+    CONTROLLA(scrivi_file(log, dati, n - DIM_RECORD / 2));
+    togli_ultima();
+    Classifica* c = classifica_apri(log);
+    CONTROLLA(c != NULL);
+    if (c == NULL) { free(dati); return; }
+    controlla(c);
+    classifica_chiudi(c);
+    free(dati);
+    dati = leggi_file(log, &n);
+    CONTROLLA(dati != NULL && n == DIM_INTESTAZIONE + registrate * DIM_RECORD);
+
+    // Ultimo record con un byte cambiato: il CRC non torna
+    dati[n - 1] ^= 1;
+    CONTROLLA(scrivi_file(log, dati, n));
+    togli_ultima();
+    c = classifica_apri(log);
+    CONTROLLA(c != NULL);
+    if (c == NULL) { free(dati); return; }
+    controlla(c);
+
+    // Dopo lo scarto si continua a registrare
+    registra(c, 50, 3);
+    c = riapri(c, log);
+    controlla(c);
+    classifica_chiudi(c);
+    free(dati);
+}
+
+static void test_file_estranei(const char* log) {
+    // Non è un log della classifica: non lo si tocca
+    const char* estraneo = file_test("estraneo");
+    const char* testo = file_test("testo");
+    CONTROLLA(scrivi_file(testo, "non sono una classifica, solo testo\n", 36));
+    copia_file(testo, estraneo);
+    CONTROLLA(classifica_apri(estraneo) == NULL);
+    CONTROLLA(file_uguali(estraneo, testo));
+    size_t n;
+    unsigned char* dati = leggi_file(log, &n);
+    dati[0] ^= 1;                       // Magic
+    CONTROLLA(scrivi_file(estraneo, dati, n));
+    CONTROLLA(classifica_apri(estraneo) == NULL);
+    dati[0] ^= 1;
+    dati[8] += 1;                       // Versione
+    CONTROLLA(scrivi_file(estraneo, dati, n));
+    CONTROLLA(classifica_apri(estraneo) == NULL);
+    CONTROLLA(scrivi_file(estraneo, dati, DIM_INTESTAZIONE / 2));
+    CONTROLLA(classifica_apri(estraneo) == NULL);
+    free(dati);
+    CONTROLLA(classifica_apri(file_test("cartella_mancante/log")) == NULL);
+}
+
+int main(void) {
+    char log[128], indice[160];
+    snprintf(log, sizeof(log), "%s", file_test("vittorie.log"));
+    snprintf(indice, sizeof(indice), "%s.indice", log);
+    test_andata_ritorno(log, indice);
+    test_coda_corrotta(log);
+    test_file_estranei(log);
+    return fine_test("classifica");
+}
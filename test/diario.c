@@ -0,0 +1,145 @@
+#define _POSIX_C_SOURCE 200809L
+#include "verifica.h"
+#include "diario.h"
+#include "gamelib.h"
+#include "uscita.h"
+
+// Campi dell'intestazione usati per corrompere un file (come in diario.c)
+#define DIM_INTESTAZIONE 40
+#define OFF_VERSIONE     8
+#define BIT_VALORE       5
+
+static const char* nomi[3] = { "Undici", "Mike", "Dustin" };
+
+// Il diario registra esito, vincitore e round: ucciso_da lo ricostruisce
+// solo chi rigioca dal primo round
+static int stessa_fine(const Risultato_partita* a, const Risultato_partita* b) {
+    return a->esito == b->esito && a->vincitore == b->vincitore && a->round == b->round;
+}
+
+static int risultati_uguali(const Risultato_partita* a, const Risultato_partita* b) {
+    return stessa_fine(a, b) && memcmp(a->ucciso_da, b->ucciso_da, sizeof(a->ucciso_da)) == 0;
+}
+
+// Registra in percorso una partita dell'esploratore a n giocatori
+static Risultato_partita registra_partita(unsigned long long seme, int n, const char* percorso, int intervallo) {
+    Sessione* s = sessione_crea(seme);
+    const Agente* agenti[4] = { &agente_esploratore, &agente_esploratore, &agente_esploratore, &agente_esploratore };
+    motore_imposta_giocatori(s, n, nomi, NULL);
+    motore_genera_mappa(s);
+    partita_registra(s, percorso, intervallo);
+    Risultato_partita r = motore_gioca(s, agenti, 200);
+    sessione_distruggi(s);
+    return r;
+}
+
+static Esito_diario riproduci(const char* percorso, int dal_round, Rapporto_riproduzione* r) {
+    Sessione* s = sessione_crea(99);
+    Esito_diario e = partita_riproduci(s, percorso, dal_round, r);
+    sessione_distruggi(s);
+    return e;
+}
+
+static void test_andata_ritorno(void) {
+    const char* percorso = file_test("partita.dj");
+    for (unsigned long long seme = 1; seme <= 20; seme++) {
+        Risultato_partita atteso = registra_partita(seme, 1 + (int) (seme % 3), percorso, 8);
+        Rapporto_riproduzione r;
+
+        // Dall'inizio
+        CONTROLLA(riproduci(percorso, 1, &r) == diario_ok);
+        CONTROLLA(r.completo && r.round_partenza == 1);
+        CONTROLLA(risultati_uguali(&r.risultato, &atteso));
+
+        // Dall'ultimo round, ripartendo da un fotogramma
+        CONTROLLA(riproduci(percorso, atteso.round, &r) == diario_ok);
+        CONTROLLA(r.round_partenza == (atteso.round > 8 ? (atteso.round - 1) / 8 * 8 + 1 : 1));
+        CONTROLLA(stessa_fine(&r.risultato, &atteso));
+
+        // Il lettore arriva all'evento di fine con lo stesso risultato
+        Lettore_diario l;
+        Stato_salvato iniziale;
+        Evento_diario e;
+        Fotogramma f;
+        CONTROLLA(diario_apri(percorso, &l, &iniziale) == diario_ok);
+        CONTROLLA(l.completo && iniziale.numero_giocatori == 1 + (int) (seme % 3));
+        int fine = 0;
+        while (diario_prossimo(&l, &e, &f)) fine = e.tipo == evento_fine;
+        CONTROLLA(fine && stessa_fine(&e.risultato, &atteso));
+        diario_chiudi(&l);
+    }
+}
+
+// Posizione nel file di un'estrazione con valore tra 1 e 29, da cambiare
+// senza toccarne la lunghezza
+static size_t trova_estrazione(const char* percorso) {
+    Lettore_diario l;
+    Stato_salvato iniziale;
+    Evento_diario e;
+    Fotogramma f;
+    size_t trovata = 0;
+    if (diario_apri(percorso, &l, &iniziale) != diario_ok) return 0;
+    const unsigned char* inizio = (const unsigned char*) l.dati;
+    for (int k = 0; trovata == 0; k++) {
+        const unsigned char* pos = l.pos;
+        if (!diario_prossimo(&l, &e, &f)) break;
+        if (k > 100 && e.tipo == evento_estrazione && e.valore >= 1 && e.valore <= 29) trovata = (size_t) (pos - inizio);
+    }
+    diario_chiudi(&l);
+    return trovata;
+}
+
+static void controlla_esito(const unsigned char* dati, size_t n, Esito_diario atteso) {
+    const char* percorso = file_test("cattivo.dj");
+    Rapporto_riproduzione r;
+    CONTROLLA(scrivi_file(percorso, dati, n));
+    CONTROLLA(riproduci(percorso, 1, &r) == atteso);
+}
+
+static void scrivi_u32(unsigned char* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (unsigned char) (v >> (8 * i));
+}
+
+static void test_file_corrotti(void) {
+    char buono[128];
+    snprintf(buono, sizeof(buono), "%s", file_test("buono.dj"));
+    Risultato_partita atteso = registra_partita(5, 2, buono, 8);
+    size_t n;
+    unsigned char* dati = leggi_file(buono, &n);
+    unsigned char* copia = (unsigned char*) malloc(n);
+    Rapporto_riproduzione r;
+
+    CONTROLLA(riproduci(file_test("non_esiste.dj"), 1, &r) == diario_errore_file);
+    controlla_esito(dati, DIM_INTESTAZIONE - 1, diario_errore_formato);   // Intestazione incompleta
+    controlla_esito(dati, n - 1, diario_errore_formato);                  // Indice troncato
+    memcpy(copia, dati, n);
+    copia[0] ^= 1;
+    controlla_esito(copia, n, diario_errore_formato);                     // Magic
+    memcpy(copia, dati, n);
+    scrivi_u32(copia + OFF_VERSIONE, DIARIO_VERSIONE + 1);
+    controlla_esito(copia, n, diario_errore_versione);
+    memcpy(copia, dati, n);
+    copia[DIM_INTESTAZIONE] ^= 1;                                         // Magic dello stato iniziale
+    controlla_esito(copia, n, diario_errore_stato);
+
+    // Un'estrazione diversa da quella che il gioco ritira fuori
+    size_t pos = trova_estrazione(buono);
+    memcpy(copia, dati, n);
+    CONTROLLA(pos > DIM_INTESTAZIONE && (copia[pos] >> BIT_VALORE) == evento_estrazione);
+    copia[pos] ^= 1;
+    controlla_esito(copia, n, diario_divergenza);
+    CONTROLLA(riproduci(file_test("cattivo.dj"), 1, &r) == diario_divergenza);
+    CONTROLLA(r.round_divergenza >= 1 && r.round_divergenza <= atteso.round && r.motivo != NULL);
+
+    // Il file originale non è cambiato e si riproduce ancora
+    CONTROLLA(riproduci(buono, 1, &r) == diario_ok && risultati_uguali(&r.risultato, &atteso));
+    free(copia);
+    free(dati);
+}
+
+int main(void) {
+    uscita_imposta_verbosita(verbosita_silenziosa);
+    test_andata_ritorno();
+    test_file_corrotti();
+    return fine_test("diario");
+}
@@ -0,0 +1,127 @@
+#define _POSIX_C_SOURCE 200809L
+#include "verifica.h"
+#include "gamelib.h"
+#include "mappa_soa.h"
+#include "mappa_compatta.h"
+#include "uscita.h"
+
+static const char* nomi[3] = { "Undici", "Mike", "Dustin" };
+
+static int mappe_uguali(const Mappa_soa* a, const Mappa_soa* b) {
+    return a->n == b->n && memcmp(a->tipo, b->tipo, a->n) == 0 && memcmp(a->nemico_mr, b->nemico_mr, a->n) == 0
+        && memcmp(a->oggetto_mr, b->oggetto_mr, a->n) == 0 && memcmp(a->nemico_ss, b->nemico_ss, a->n) == 0;
+}
+
+static Sessione* sessione_con_mappa(const Parametri_mappa* p, int pigra, int giocatori) {
+    Sessione* s = sessione_crea(1);
+    motore_imposta_giocatori(s, giocatori, nomi, NULL);
+    int ok = pigra ? mappa_genera_pigra(s, p) : mappa_genera(s, p);
+    CONTROLLA(ok && mappa_chiudi(s));
+    return s;
+}
+
+// La mappa esportata di una sessione nuova con quei parametri
+static int esporta(const Parametri_mappa* p, int pigra, Mappa_soa* m) {
+    Sessione* s = sessione_con_mappa(p, pigra, 1);
+    int ok = mappa_esporta_soa(s, m);
+    sessione_distruggi(s);
+    return ok;
+}
+
+// Pigra, normale, compatta e con un altro numero di thread: la stessa mappa
+static void controlla_generazione(const Parametri_mappa* p) {
+    Mappa_soa normale, pigra, da_compatta, altri_thread;
+    Mappa_compatta compatta, convertita;
+    Parametri_mappa q = *p;
+    q.thread = p->thread == 1 ? 4 : 1;
+
+    CONTROLLA(esporta(p, 0, &normale));
+    CONTROLLA(esporta(p, 1, &pigra));
+    CONTROLLA(esporta(&q, 0, &altri_thread));
+    CONTROLLA(normale.n == p->zone && soa_valida(&normale) == SOA_VALIDA);
+    CONTROLLA(mappe_uguali(&normale, &pigra));
+    CONTROLLA(mappe_uguali(&normale, &altri_thread));
+
+    CONTROLLA(compatta_genera(&compatta, p));
+    CONTROLLA(compatta_da_soa(&convertita, &normale));
+    CONTROLLA(compatta.n == convertita.n && memcmp(compatta.zone, convertita.zone, compatta.n * sizeof(Zona_compatta)) == 0);
+    CONTROLLA(compatta_in_soa(&compatta, &da_compatta));
+    CONTROLLA(mappe_uguali(&normale, &da_compatta));
+
+    compatta_distruggi(&compatta);
+    compatta_distruggi(&convertita);
+    soa_distruggi(&normale);
+    soa_distruggi(&pigra);
+    soa_distruggi(&altri_thread);
+    soa_distruggi(&da_compatta);
+}
+
+// La stessa partita sulla mappa pigra e su quella normale: stesso risultato
+// e, alla fine, la stessa mappa (nemici sconfitti e oggetti raccolti)
+static void controlla_partita(const Parametri_mappa* p, unsigned long long seme, int giocatori) {
+    const Agente* agenti[4] = { &agente_esploratore, &agente_esploratore, &agente_esploratore, &agente_esploratore };
+    Sessione* normale = sessione_con_mappa(p, 0, giocatori);
+    Sessione* pigra = sessione_con_mappa(p, 1, giocatori);
+    gioco_semina(normale, seme);
+    gioco_semina(pigra, seme);
+    Risultato_partita a = motore_gioca(normale, agenti, 300);
+    Risultato_partita b = motore_gioca(pigra, agenti, 300);
+    CONTROLLA(a.esito == b.esito && a.vincitore == b.vincitore && a.round == b.round);
+    CONTROLLA(memcmp(a.ucciso_da, b.ucciso_da, sizeof(a.ucciso_da)) == 0);
+
+    // In memoria solo le zone raggiunte
+    Conteggi_mappa c;
+    mappa_conteggi(pigra, &c);
+    CONTROLLA(c.zone + c.da_generare == p->zone);
+    if (p->zone >= 10000) CONTROLLA(c.zone < p->zone / 2);
+
+    Mappa_soa ma, mb;
+    CONTROLLA(mappa_esporta_soa(normale, &ma) && mappa_esporta_soa(pigra, &mb));
+    CONTROLLA(mappe_uguali(&ma, &mb));
+    soa_distruggi(&ma);
+    soa_distruggi(&mb);
+    sessione_distruggi(normale);
+    sessione_distruggi(pigra);
+}
+
+// Esportata e reimportata, la mappa non cambia
+static void controlla_importazione(const Parametri_mappa* p) {
+    Mappa_soa m, di_nuovo;
+    Mappa_compatta c, ancora;
+    Sessione* s = sessione_crea(1);
+    CONTROLLA(esporta(p, 0, &m));
+    CONTROLLA(mappa_importa_soa(s, &m) && mappa_chiudi(s));
+    CONTROLLA(mappa_esporta_soa(s, &di_nuovo) && mappe_uguali(&m, &di_nuovo));
+    CONTROLLA(compatta_da_soa(&c, &m));
+    CONTROLLA(mappa_importa_compatta(s, &c) && mappa_chiudi(s));
+    CONTROLLA(mappa_esporta_compatta(s, &ancora));
+    CONTROLLA(c.n == ancora.n && memcmp(c.zone, ancora.zone, c.n * sizeof(Zona_compatta)) == 0);
+    compatta_distruggi(&c);
+    compatta_distruggi(&ancora);
+    soa_distruggi(&m);
+    soa_distruggi(&di_nuovo);
+    sessione_distruggi(s);
+}
+
+int main(void) {
+    uscita_imposta_verbosita(verbosita_silenziosa);
+    Parametri_mappa standard = PARAMETRI_MAPPA_DEFAULT;
+    Parametri_mappa grande = { 200000, 20, 5, 30, 40, 0, 0 };
+    Parametri_mappa affollata = { 5000, 50, 50, 90, 100, 0, 2 };
+
+    for (unsigned long long seme = 1; seme <= 30; seme++) {
+        standard.seme = affollata.seme = seme;
+        controlla_generazione(&standard);
+        controlla_partita(&standard, seme, 1 + (int) (seme % 3));
+        controlla_partita(&affollata, seme, 1 + (int) (seme % 3));
+    }
+    for (unsigned long long seme = 1; seme <= 3; seme++) {
+        grande.seme = seme;
+        controlla_generazione(&grande);
+        controlla_generazione(&affollata);
+        controlla_partita(&grande, seme, 3);
+        controlla_importazione(&grande);
+    }
+    controlla_importazione(&standard);
+    return fine_test("mappa");
+}
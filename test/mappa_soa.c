@@ -0,0 +1,106 @@
+#define _POSIX_C_SOURCE 200809L
+#include "verifica.h"
+#include "mappa_soa.h"
+#include "rng.h"
+
+static const char* const isa[] = { "scalare", "sse2", "avx2" };
+
+// Istogramma contato byte per byte, con le regole di soa_istogramma
+static void istogramma_atteso(const Mappa_soa* m, Istogramma_mappa* h) {
+    memset(h, 0, sizeof(*h));
+    h->tipo_massimo = -1;
+    for (size_t i = 0; i < m->n; i++) {
+        unsigned char mr = m->nemico_mr[i], ss = m->nemico_ss[i], o = m->oggetto_mr[i], t = m->tipo[i];
+        if (mr < 4) h->nemici_mr[mr]++;
+        if (mr != nessun_nemico && mr != billi && mr != democane) h->fuori_range++;
+        if (ss < 4) h->nemici_ss[ss]++;
+        if (ss != nessun_nemico && ss != democane && ss != demotorzone) h->fuori_range++;
+        if (o < 5) h->oggetti[o]++;
+        else h->fuori_range++;
+        if (t > stazione_polizia) h->fuori_range++;
+        if (t > h->tipo_massimo) h->tipo_massimo = t;
+    }
+}
+
+static int istogrammi_uguali(const Istogramma_mappa* a, const Istogramma_mappa* b) {
+    return memcmp(a->nemici_mr, b->nemici_mr, sizeof(a->nemici_mr)) == 0
+        && memcmp(a->nemici_ss, b->nemici_ss, sizeof(a->nemici_ss)) == 0
+        && memcmp(a->oggetti, b->oggetti, sizeof(a->oggetti)) == 0
+        && a->fuori_range == b->fuori_range && a->tipo_massimo == b->tipo_massimo;
+}
+
+// Byte quasi sempre validi, a volte fuori dal loro enum (fino a 255)
+static void riempi(unsigned char* a, size_t n, int massimo, Rng* rng) {
+    for (size_t i = 0; i < n; i++) {
+        uint32_t x = rng_limitato(rng, 64);
+        a[i] = x == 0 ? (unsigned char) rng_limitato(rng, 256) : (unsigned char) rng_limitato(rng, (uint32_t) massimo + 1);
+    }
+}
+
+// Tutti i kernel disponibili sulla stessa mappa
+static void controlla_kernel(const Mappa_soa* m) {
+    Istogramma_mappa atteso, h;
+    istogramma_atteso(m, &atteso);
+    for (size_t k = 0; k < sizeof(isa) / sizeof(isa[0]); k++) {
+        if (!soa_forza_isa(isa[k])) continue;
+        soa_istogramma(m, &h);
+        CONTROLLA(istogrammi_uguali(&h, &atteso));
+        CONTROLLA(soa_conta_boss(m) == atteso.nemici_ss[demotorzone]);
+    }
+}
+
+// Lunghezze attorno agli svuotamenti dei contatori a 8 bit (ogni 255
+// blocchi da 16 o 32 byte) e alle code scalari
+static void test_lunghezze(void) {
+    size_t lunghezze[160];
+    size_t n = 0;
+    for (size_t l = 0; l <= 100; l++) lunghezze[n++] = l;
+    const size_t soglie[] = { 16 * 255, 32 * 255, 2 * 16 * 255, 2 * 32 * 255 };
+    const int scarti[] = { -33, -32, -17, -16, -1, 0, 1, 15, 16, 17, 31, 32, 33 };
+    for (int s = 0; s < 4; s++)
+        for (int d = 0; d < 13; d++) lunghezze[n++] = (size_t) ((long) soglie[s] + scarti[d]);
+    lunghezze[n++] = 100003;
+
+    Rng rng;
+    rng_semina(&rng, 11);
+    for (size_t i = 0; i < n; i++) {
+        Mappa_soa m;
+        CONTROLLA(soa_crea(&m, lunghezze[i]));
+        riempi(m.nemico_mr, m.n, 3, &rng);
+        riempi(m.nemico_ss, m.n, 3, &rng);
+        riempi(m.oggetto_mr, m.n, 4, &rng);
+        riempi(m.tipo, m.n, stazione_polizia, &rng);
+        controlla_kernel(&m);
+        soa_distruggi(&m);
+    }
+}
+
+// Array costanti: ogni corsia del contatore arriva a 255 prima dello svuotamento
+static void test_costanti(void) {
+    const size_t lunghezze[] = { 16 * 255, 32 * 255, 32 * 255 + 1, 3 * 32 * 255 + 7 };
+    const unsigned char valori[] = { 0, 3, 4, 255 };
+    for (int l = 0; l < 4; l++) {
+        for (int v = 0; v < 4; v++) {
+            Mappa_soa m;
+            CONTROLLA(soa_crea(&m, lunghezze[l]));
+            memset(m.nemico_mr, valori[v], m.n);
+            memset(m.nemico_ss, valori[v], m.n);
+            memset(m.oggetto_mr, valori[v], m.n);
+            memset(m.tipo, valori[v], m.n);
+            controlla_kernel(&m);
+            soa_distruggi(&m);
+        }
+    }
+}
+
+int main(void) {
+    CONTROLLA(soa_forza_isa("scalare") && strcmp(soa_isa(), "scalare") == 0);
+    CONTROLLA(!soa_forza_isa("neon"));
+    CONTROLLA(strcmp(soa_isa(), "scalare") == 0);
+#if defined(__x86_64__) && defined(__SSE2__)
+    CONTROLLA(soa_forza_isa("sse2")); // Sempre disponibile su x86-64
+#endif
+    test_lunghezze();
+    test_costanti();
+    return fine_test("mappa_soa");
+}
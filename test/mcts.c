@@ -0,0 +1,74 @@
+#define _POSIX_C_SOURCE 200809L
+#include "verifica.h"
+#include "mcts.h"
+#include "salvataggio.h"
+#include "uscita.h"
+
+static const char* nomi[3] = { "Undici", "Mike", "Dustin" };
+
+// Stato del generatore della partita, letto da un salvataggio
+static void rng_della_partita(Sessione* s, Rng* rng) {
+    const char* percorso = file_test("stato.sav");
+    Stato_salvato st;
+    File_salvato f;
+    CONTROLLA(partita_salva(s, percorso) == salvataggio_ok);
+    CONTROLLA(salvataggio_apri(percorso, &st, &f) == salvataggio_ok);
+    memcpy(rng->s, st.rng, sizeof(rng->s));
+    salvataggio_chiudi(&f);
+}
+
+// Dallo stesso punto e con gli stessi dadi, il rollout dell'esploratore sul
+// ramo e la partita del motore con agente_esploratore finiscono uguali:
+// vincitore, giocatori, mappa e generatore
+static void controlla_rollout(unsigned long long seme, int giocatori, int max_round, int scelte) {
+    Sessione* s = sessione_crea(seme);
+    motore_imposta_giocatori(s, giocatori, nomi, NULL);
+    motore_genera_mappa(s);
+    const Richiesta* r = partita_inizia(s, max_round);
+    // Il ramo parte da un menu di turno, come le ricerche del consiglio
+    for (int k = 0; r->tipo != richiesta_nessuna && (k < scelte || r->tipo != richiesta_azione); k++)
+        r = partita_rispondi(s, agente_rispondi(&agente_esploratore, r));
+    if (r->tipo == richiesta_nessuna) { sessione_distruggi(s); return; } // Finita prima
+
+    Mappa_compatta base, dopo;
+    Arena_rami a = ARENA_RAMI_INIT;
+    Rng rng, rng_motore;
+    CONTROLLA(mappa_esporta_compatta(s, &base));
+    Ramo* ramo = partita_ramo(s, &a, &base);
+    CONTROLLA(ramo != NULL);
+    rng_della_partita(s, &rng);
+    CONTROLLA(mcts_gioca_esploratore(&a, ramo, &rng));
+
+    while (r->tipo != richiesta_nessuna) r = partita_rispondi(s, agente_rispondi(&agente_esploratore, r));
+    Risultato_partita ris = partita_risultato(s);
+    Ramo* fine = partita_ramo(s, &a, &base);
+    CONTROLLA(ris.vincitore == ramo->vincitore && ris.round + 1 == ramo->round);
+    for (int i = 0; i < giocatori; i++) {
+        const Giocatore_ramo* x = &fine->giocatori[i];
+        const Giocatore_ramo* y = &ramo->giocatori[i];
+        CONTROLLA((ris.ucciso_da[i] == nessun_nemico) == y->vivo && x->vivo == y->vivo);
+        if (x->vivo && y->vivo)
+            CONTROLLA(x->mondo == y->mondo && x->posizione == y->posizione && memcmp(x->zaino, y->zaino, sizeof(x->zaino)) == 0);
+    }
+    CONTROLLA(mappa_esporta_compatta(s, &dopo) && dopo.n == base.n);
+    size_t zone_diverse = 0;
+    for (size_t p = 0; p < base.n && p < dopo.n; p++) zone_diverse += ramo_zona(ramo, p) != dopo.zone[p];
+    CONTROLLA(zone_diverse == 0);
+    rng_della_partita(s, &rng_motore);
+    CONTROLLA(memcmp(rng.s, rng_motore.s, sizeof(rng.s)) == 0);
+
+    compatta_distruggi(&dopo);
+    compatta_distruggi(&base);
+    ramo_arena_distruggi(&a);
+    sessione_distruggi(s);
+}
+
+int main(void) {
+    uscita_imposta_verbosita(verbosita_silenziosa);
+    for (unsigned long long seme = 1; seme <= 200; seme++) {
+        int giocatori = 1 + (int) (seme % 3);
+        controlla_rollout(seme, giocatori, 60, 0);                // Dall'inizio della partita
+        controlla_rollout(seme, giocatori, 0, (int) (seme % 40)); // A metà, senza limite di round
+    }
+    return fine_test("mcts");
+}
@@ -0,0 +1,92 @@
+#define _POSIX_C_SOURCE 200809L
+#include "verifica.h"
+#include "gamelib.h"
+#include "probabilita.h"
+#include "regole.h"
+#include "uscita.h"
+#include <math.h>
+
+#define SCONTRI 20000
+#define TOLLERANZA 0.015 // Oltre 4 deviazioni standard con 20000 scontri
+
+// Sempre Attacco Pischico: lo scontro che la tabella descrive
+static int azione_ferma(struct Giocatore* g, int movimento_fatto, void* dati) {
+    (void) g; (void) movimento_fatto; (void) dati;
+    return 9;
+}
+
+static int sempre_attacco(struct Giocatore* g, Tipo_nemico nemico, int hp_g, int hp_n, void* dati) {
+    (void) g; (void) nemico; (void) hp_g; (void) hp_n; (void) dati;
+    return 1;
+}
+
+static int nessun_oggetto_scelto(struct Giocatore* g, int in_combattimento, void* dati) {
+    (void) g; (void) in_combattimento; (void) dati;
+    return 0;
+}
+
+static const Agente attaccante = { azione_ferma, sempre_attacco, nessun_oggetto_scelto, NULL };
+
+// Frazione di scontri vinti dal motore con quelle statistiche
+static double vittorie_simulate(Sessione* s, int attacco, int difesa, int fortuna, Tipo_nemico nemico) {
+    Giocatore g;
+    memset(&g, 0, sizeof(g));
+    snprintf(g.nome, sizeof(g.nome), "Prova");
+    g.attacco_pischico = attacco;
+    g.difesa_pischica = difesa;
+    g.fortuna = fortuna;
+    for (int i = 0; i < 3; i++) g.zaino[i] = nessun_oggetto;
+    int vinti = 0;
+    for (int k = 0; k < SCONTRI; k++) vinti += motore_scontro(s, &g, nemico, &attaccante) == scontro_vinto;
+    return (double) vinti / SCONTRI;
+}
+
+// Voci della tabella contro il motore, comprese le statistiche modificate
+// (-3/+3 e Undici) e le fortune fuori da 1-20
+static void test_contro_motore(void) {
+    static const struct { int attacco, difesa, fortuna; Tipo_nemico nemico; } casi[] = {
+        { 1, 14, 14, billi },       { 1, 18, 21, billi },        { 1, 20, 7, billi },
+        { 5, 14, 7, democane },     { 5, 19, 0, democane },      { 24, 1, 7, democane },
+        { 23, -2, 21, democane },   { 15, 4, -6, democane },     { 11, 18, 7, demotorzone },
+        { 11, 23, 0, demotorzone }, { 12, 16, 14, demotorzone }, { 10, 24, 25, demotorzone },
+        { -2, 17, 5, billi },       { 24, 24, 0, demotorzone },
+    };
+    Sessione* s = sessione_crea(7);
+    for (size_t i = 0; i < sizeof(casi) / sizeof(casi[0]); i++) {
+        double atteso = probabilita_vittoria(casi[i].attacco, casi[i].difesa, casi[i].fortuna, casi[i].nemico);
+        double simulato = vittorie_simulate(s, casi[i].attacco, casi[i].difesa, casi[i].fortuna, casi[i].nemico);
+        if (fabs(atteso - simulato) > TOLLERANZA)
+            fprintf(stderr, "  %d/%d/%d contro %d: tabella %.4f, motore %.4f\n", casi[i].attacco, casi[i].difesa,
+                    casi[i].fortuna, (int) casi[i].nemico, atteso, simulato);
+        CONTROLLA(fabs(atteso - simulato) <= TOLLERANZA);
+    }
+    sessione_distruggi(s);
+}
+
+// La tabella (calcolata alla prima richiesta o all'inizializzazione) contro
+// il calcolo completo, fino all'arrotondamento a 16 bit
+static void test_contro_calcolo(void) {
+    for (int n = billi; n <= demotorzone; n++) {
+        for (int a = -3; a <= 25; a += 2) {
+            for (int d = -3; d <= 25; d += 3) {
+                for (int f = -1; f <= 23; f += 4) {
+                    double t = probabilita_vittoria(a, d, f, (Tipo_nemico) n);
+                    double c = probabilita_vittoria_scontro(a, d, f, (Tipo_nemico) n, regole_hp_giocatore(d),
+                                                            statistiche_nemici[n].hp, 0, 0);
+                    CONTROLLA(fabs(t - c) <= 1.0 / 65535.0);
+                }
+            }
+        }
+    }
+}
+
+int main(void) {
+    uscita_imposta_verbosita(verbosita_silenziosa);
+    test_contro_calcolo(); // Prima di probabilita_inizializza: voci calcolate a richiesta
+    double prima = probabilita_vittoria(7, 9, 11, democane);
+    probabilita_inizializza();
+    CONTROLLA(probabilita_vittoria(7, 9, 11, democane) == prima);
+    test_contro_calcolo();
+    test_contro_motore();
+    return fine_test("probabilita");
+}
@@ -0,0 +1,157 @@
+#define _POSIX_C_SOURCE 200809L
+#include "verifica.h"
+#include "ramo.h"
+#include "rng.h"
+
+#define MAX_RAMI 4000
+
+// Ogni ramo ha accanto la copia completa della mappa con le stesse modifiche
+typedef struct Ramo_con_copia {
+    Ramo* ramo;
+    Zona_compatta* copia;
+    size_t modifiche;
+} Ramo_con_copia;
+
+static Ramo_con_copia rami[MAX_RAMI];
+static int n_rami = 0;
+
+static int aggiungi(Ramo* r, const Zona_compatta* da, size_t n, size_t modifiche) {
+    CONTROLLA(r != NULL && n_rami < MAX_RAMI);
+    if (r == NULL || n_rami >= MAX_RAMI) return 0;
+    Ramo_con_copia* c = &rami[n_rami++];
+    c->ramo = r;
+    c->copia = (Zona_compatta*) malloc(n * sizeof(Zona_compatta));
+    memcpy(c->copia, da, n * sizeof(Zona_compatta));
+    c->modifiche = modifiche;
+    return 1;
+}
+
+static void togli_dal(int primo) {
+    while (n_rami > primo) free(rami[--n_rami].copia);
+}
+
+// Una modifica a caso, sul ramo e sulla sua copia
+static void modifica(Arena_rami* a, Ramo_con_copia* c, size_t pos, Rng* rng) {
+    Zona_compatta z = c->copia[pos];
+    Tipo_nemico mr = COMPATTA_NEMICO_MR(z), ss = COMPATTA_NEMICO_SS(z);
+    Tipo_oggetto o = COMPATTA_OGGETTO(z);
+    int ok;
+    switch (rng_limitato(rng, 4)) {
+    case 0: ok = ramo_togli_nemico(a, c->ramo, pos, 0); mr = nessun_nemico; break;
+    case 1: ok = ramo_togli_nemico(a, c->ramo, pos, 1); ss = nessun_nemico; break;
+    case 2: ok = ramo_togli_oggetto(a, c->ramo, pos); o = nessun_oggetto; break;
+    default:
+        mr = (Tipo_nemico) rng_limitato(rng, 4);
+        o = (Tipo_oggetto) rng_limitato(rng, 5);
+        ss = (Tipo_nemico) rng_limitato(rng, 4);
+        ok = ramo_modifica_zona(a, c->ramo, pos, mr, o, ss);
+    }
+    CONTROLLA(ok);
+    c->copia[pos] = COMPATTA_CODIFICA(COMPATTA_TIPO(z), mr, o, ss);
+    c->modifiche++;
+}
+
+// Ogni lettura di ogni ramo contro la sua copia
+static void controlla_rami(const Mappa_compatta* base) {
+    size_t diverse = 0;
+    for (int i = 0; i < n_rami; i++) {
+        const Ramo_con_copia* c = &rami[i];
+        CONTROLLA(c->ramo->base == base && c->ramo->n_modifiche == c->modifiche);
+        for (size_t p = 0; p < base->n; p++) diverse += ramo_zona(c->ramo, p) != c->copia[p];
+    }
+    CONTROLLA(diverse == 0);
+}
+
+// Alberi casuali: si biforca o si modifica un ramo qualunque, anche uno che
+// ha già figli (i figli non devono vedere le modifiche successive del padre).
+// vicine restringe le modifiche alle prime zone, per avere lunghe catene
+// sulla stessa posizione
+static void albero_casuale(Arena_rami* a, const Mappa_compatta* base, uint64_t seme, int operazioni, size_t vicine) {
+    Rng rng;
+    rng_semina(&rng, seme);
+    int primo = n_rami;
+    aggiungi(ramo_radice(a, base), base->zone, base->n, 0);
+    for (int k = 0; k < operazioni; k++) {
+        Ramo_con_copia* c = &rami[primo + (int) rng_limitato(&rng, (uint32_t) (n_rami - primo))];
+        if (rng_limitato(&rng, 3) == 0 && n_rami < MAX_RAMI) {
+            aggiungi(ramo_biforca(a, c->ramo), c->copia, base->n, c->modifiche);
+        } else {
+            size_t limite = vicine > 0 && vicine < base->n ? vicine : base->n;
+            modifica(a, c, (size_t) rng_limitato(&rng, (uint32_t) limite), &rng);
+        }
+    }
+}
+
+static void test_alberi(const Mappa_compatta* base) {
+    Arena_rami a = ARENA_RAMI_INIT;
+    for (uint64_t seme = 1; seme <= 4; seme++) {
+        albero_casuale(&a, base, seme, 3 * MAX_RAMI, 0);
+        controlla_rami(base);
+        togli_dal(0);
+        ramo_arena_azzera(&a);
+    }
+    albero_casuale(&a, base, 5, 6000, 8);  // Molte modifiche sulle stesse zone
+    controlla_rami(base);
+    togli_dal(0);
+    ramo_arena_distruggi(&a);
+}
+
+// Oltre 256 posizioni modificate il filtro è pieno e ogni lettura scorre la
+// catena: le letture restano esatte, sia nel ramo saturo sia nei suoi figli
+static void test_filtro_saturo(const Mappa_compatta* base) {
+    Arena_rami a = ARENA_RAMI_INIT;
+    Rng rng;
+    rng_semina(&rng, 42);
+    aggiungi(ramo_radice(&a, base), base->zone, base->n, 0);
+    for (size_t p = 0; p < base->n; p += 3) modifica(&a, &rami[0], p, &rng);
+    CONTROLLA(rami[0].modifiche > 256);
+    for (int k = 0; k < 4; k++) CONTROLLA(rami[0].ramo->filtro[k] == UINT64_MAX);
+    aggiungi(ramo_biforca(&a, rami[0].ramo), rami[0].copia, base->n, rami[0].modifiche);
+    for (int k = 0; k < 300; k++) modifica(&a, &rami[1], (size_t) rng_limitato(&rng, (uint32_t) base->n), &rng);
+    for (int k = 0; k < 300; k++) modifica(&a, &rami[0], (size_t) rng_limitato(&rng, (uint32_t) base->n), &rng);
+    controlla_rami(base);
+
+    // Posizioni con lo stesso bit del filtro (p e p + 256): la catena decide
+    aggiungi(ramo_radice(&a, base), base->zone, base->n, 0);
+    Ramo_con_copia* c = &rami[n_rami - 1];
+    modifica(&a, c, 7, &rng);
+    CONTROLLA(ramo_zona(c->ramo, 7 + 256) == base->zone[7 + 256]);
+    CONTROLLA(ramo_zona(c->ramo, 7 + 512) == base->zone[7 + 512]);
+    controlla_rami(base);
+    togli_dal(0);
+    ramo_arena_distruggi(&a);
+}
+
+// Tornando a un segno spariscono solo i rami creati dopo; quelli di prima
+// restano validi e la memoria liberata viene riusata
+static void test_segni(const Mappa_compatta* base) {
+    Arena_rami a = ARENA_RAMI_INIT;
+    albero_casuale(&a, base, 6, 1500, 0);
+    int prima = n_rami;
+    Segno_arena s = ramo_arena_segna(&a);
+    for (uint64_t seme = 7; seme <= 10; seme++) {
+        albero_casuale(&a, base, seme, 1500, 0);
+        controlla_rami(base);
+        size_t byte = ramo_arena_byte(&a);
+        togli_dal(prima);
+        ramo_arena_torna(&a, s);
+        albero_casuale(&a, base, seme + 100, 1500, 0);
+        CONTROLLA(ramo_arena_byte(&a) <= byte + 2 * 64 * 1024);
+        controlla_rami(base);
+        togli_dal(prima);
+        ramo_arena_torna(&a, s);
+    }
+    togli_dal(0);
+    ramo_arena_distruggi(&a);
+}
+
+int main(void) {
+    Parametri_mappa p = { 2000, 30, 10, 40, 50, 3, 1 };
+    Mappa_compatta base;
+    CONTROLLA(compatta_genera(&base, &p));
+    test_alberi(&base);
+    test_filtro_saturo(&base);
+    test_segni(&base);
+    compatta_distruggi(&base);
+    return fine_test("ramo");
+}
@@ -0,0 +1,186 @@
+#define _POSIX_C_SOURCE 200809L
+#include "verifica.h"
+#include "salvataggio.h"
+#include "gamelib.h"
+#include "uscita.h"
+
+// Campi dell'intestazione usati per corrompere un file (come in salvataggio.c)
+#define OFF_VERSIONE   8
+#define OFF_CRC_INTEST 68
+
+static const char* nomi[3] = { "Undici", "Mike", "Dustin" };
+
+// Partita a n giocatori sulla mappa standard, ferma dopo 'scelte' risposte
+// dell'esploratore (o alla fine)
+static Sessione* partita_di_prova(unsigned long long seme, int n, int scelte) {
+    Sessione* s = sessione_crea(seme);
+    motore_imposta_giocatori(s, n, nomi, NULL);
+    motore_genera_mappa(s);
+    const Richiesta* r = partita_inizia(s, 100);
+    for (int k = 0; k < scelte && r->tipo != richiesta_nessuna; k++)
+        r = partita_rispondi(s, agente_rispondi(&agente_esploratore, r));
+    return s;
+}
+
+// Salva s, lo carica in una sessione nuova e risalva: i due file devono coincidere
+static void controlla_andata_ritorno(Sessione* s) {
+    const char* a = file_test("andata.sav");
+    const char* b = file_test("ritorno.sav");
+    CONTROLLA(partita_salva(s, a) == salvataggio_ok);
+    Sessione* c = sessione_crea(99);
+    CONTROLLA(partita_carica(c, a) == salvataggio_ok);
+    CONTROLLA(partita_salva(c, b) == salvataggio_ok);
+    CONTROLLA(file_uguali(a, b));
+    sessione_distruggi(c);
+}
+
+// Stato del file come Stato_salvato modificabile: la mappa è copiata
+static int leggi_stato(const char* percorso, Stato_salvato* st, Mappa_soa* copia) {
+    File_salvato f;
+    if (salvataggio_apri(percorso, st, &f) != salvataggio_ok) return 0;
+    int ok = soa_crea(copia, st->mappa.n);
+    if (ok) {
+        memcpy(copia->tipo, st->mappa.tipo, copia->n);
+        memcpy(copia->nemico_mr, st->mappa.nemico_mr, copia->n);
+        memcpy(copia->oggetto_mr, st->mappa.oggetto_mr, copia->n);
+        memcpy(copia->nemico_ss, st->mappa.nemico_ss, copia->n);
+        st->mappa = *copia;
+    }
+    salvataggio_chiudi(&f);
+    return ok;
+}
+
+// Scrive lo stato (con CRC corretti), lo carica nella partita di c e
+// controlla l'esito e che la partita di c non sia cambiata
+static void controlla_rifiutato(Sessione* c, const Stato_salvato* st, Esito_salvataggio atteso) {
+    const char* cattivo = file_test("cattivo.sav");
+    const char* prima = file_test("prima.sav");
+    const char* dopo = file_test("dopo.sav");
+    CONTROLLA(salvataggio_scrivi(cattivo, st) == salvataggio_ok);
+    CONTROLLA(partita_salva(c, prima) == salvataggio_ok);
+    CONTROLLA(partita_carica(c, cattivo) == atteso);
+    CONTROLLA(partita_salva(c, dopo) == salvataggio_ok);
+    CONTROLLA(file_uguali(prima, dopo));
+}
+
+static void controlla_file_rifiutato(Sessione* c, const unsigned char* dati, size_t n, Esito_salvataggio atteso) {
+    const char* cattivo = file_test("cattivo.sav");
+    const char* prima = file_test("prima.sav");
+    const char* dopo = file_test("dopo.sav");
+    CONTROLLA(scrivi_file(cattivo, dati, n));
+    CONTROLLA(partita_salva(c, prima) == salvataggio_ok);
+    CONTROLLA(partita_carica(c, cattivo) == atteso);
+    CONTROLLA(partita_salva(c, dopo) == salvataggio_ok);
+    CONTROLLA(file_uguali(prima, dopo));
+}
+
+static void scrivi_u32(unsigned char* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (unsigned char) (v >> (8 * i));
+}
+
+static void test_andata_ritorno(void) {
+    // Prima della partita, a metà e a partita finita (anche dopo la vittoria,
+    // quando il Demotorzone non c'è più)
+    int scelte[] = { 0, 30, 1000000 };
+    for (unsigned long long seme = 1; seme <= 20; seme++) {
+        for (int k = 0; k < 3; k++) {
+            Sessione* s = partita_di_prova(seme, 1 + (int) (seme % 3), scelte[k]);
+            controlla_andata_ritorno(s);
+            sessione_distruggi(s);
+        }
+    }
+
+    // In memoria: codifica e decodifica restituiscono lo stesso stato
+    Sessione* s = partita_di_prova(7, 2, 30);
+    CONTROLLA(partita_salva(s, file_test("memoria.sav")) == salvataggio_ok);
+    Stato_salvato st, letto;
+    Mappa_soa m;
+    CONTROLLA(leggi_stato(file_test("memoria.sav"), &st, &m));
+    size_t n = salvataggio_dimensione(&st);
+    unsigned char* buf = (unsigned char*) malloc(n);
+    salvataggio_codifica(&st, buf);
+    CONTROLLA(salvataggio_decodifica(buf, n, &letto) == salvataggio_ok);
+    CONTROLLA(letto.flag == st.flag && letto.numero_giocatori == st.numero_giocatori);
+    CONTROLLA(memcmp(letto.rng, st.rng, sizeof(st.rng)) == 0);
+    CONTROLLA(memcmp(letto.giocatori, st.giocatori, sizeof(st.giocatori)) == 0);
+    CONTROLLA(letto.mappa.n == st.mappa.n && memcmp(letto.mappa.tipo, st.mappa.tipo, st.mappa.n) == 0);
+    free(buf);
+    soa_distruggi(&m);
+    sessione_distruggi(s);
+}
+
+static void test_file_corrotti(void) {
+    Sessione* s = partita_di_prova(3, 2, 30);
+    Sessione* c = partita_di_prova(4, 3, 10); // La partita che deve restare intatta
+    const char* buono = file_test("buono.sav");
+    CONTROLLA(partita_salva(s, buono) == salvataggio_ok);
+    size_t n;
+    unsigned char* dati = leggi_file(buono, &n);
+    unsigned char* copia = (unsigned char*) malloc(n);
+
+    CONTROLLA(partita_carica(c, file_test("non_esiste.sav")) == salvataggio_errore_file);
+    controlla_file_rifiutato(c, dati, n - 1, salvataggio_errore_formato);     // Troncato
+    controlla_file_rifiutato(c, dati, 40, salvataggio_errore_formato);        // Solo metà intestazione
+    memcpy(copia, dati, n);
+    copia[0] ^= 1;
+    controlla_file_rifiutato(c, copia, n, salvataggio_errore_formato);        // Magic
+    memcpy(copia, dati, n);
+    scrivi_u32(copia + OFF_VERSIONE, SALVATAGGIO_VERSIONE + 1);
+    scrivi_u32(copia + OFF_CRC_INTEST, crc32_aggiorna(0, copia, OFF_CRC_INTEST));
+    controlla_file_rifiutato(c, copia, n, salvataggio_errore_versione);
+    memcpy(copia, dati, n);
+    copia[OFF_VERSIONE + 4] ^= 2;                                             // Flag, CRC dell'intestazione
+    controlla_file_rifiutato(c, copia, n, salvataggio_errore_checksum);
+    memcpy(copia, dati, n);
+    copia[n - 1] ^= 1;                                                        // Ultima zona, CRC del corpo
+    controlla_file_rifiutato(c, copia, n, salvataggio_errore_checksum);
+    free(copia);
+    free(dati);
+
+    // Valori fuori dagli intervalli, con CRC corretti
+    Stato_salvato st, cattivo;
+    Mappa_soa m;
+    CONTROLLA(leggi_stato(buono, &st, &m));
+    int g = st.giocatori[0].presente ? 0 : 1;
+    CONTROLLA(st.giocatori[g].presente);
+    int64_t n_zone = (int64_t) st.mappa.n;
+
+    cattivo = st;
+    cattivo.giocatori[g].pos_ss = (cattivo.giocatori[g].pos_mr + 1) % n_zone; // Mondi disallineati
+    controlla_rifiutato(c, &cattivo, salvataggio_errore_valori);
+    cattivo = st;
+    cattivo.giocatori[g].pos_mr = cattivo.giocatori[g].pos_ss = -1;         // Presente ma fuori mappa
+    controlla_rifiutato(c, &cattivo, salvataggio_errore_valori);
+    cattivo = st;
+    cattivo.giocatori[g].pos_mr = cattivo.giocatori[g].pos_ss = n_zone;
+    controlla_rifiutato(c, &cattivo, salvataggio_errore_valori);
+    cattivo = st;
+    cattivo.giocatori[g].mondo = 2;
+    controlla_rifiutato(c, &cattivo, salvataggio_errore_valori);
+    cattivo = st;
+    cattivo.giocatori[g].zaino[1] = 200;
+    controlla_rifiutato(c, &cattivo, salvataggio_errore_valori);
+
+    unsigned char tipo = m.tipo[3];
+    m.tipo[3] = 200;                                                          // Tipo di zona inesistente
+    controlla_rifiutato(c, &st, salvataggio_errore_valori);
+    m.tipo[3] = tipo;
+    unsigned char nemico = m.nemico_ss[5];
+    m.nemico_ss[5] = 9;
+    controlla_rifiutato(c, &st, salvataggio_errore_valori);
+    m.nemico_ss[5] = nemico;
+
+    // Lo stato originale riscritto si carica di nuovo
+    CONTROLLA(salvataggio_scrivi(file_test("riscritto.sav"), &st) == salvataggio_ok);
+    CONTROLLA(file_uguali(buono, file_test("riscritto.sav")));
+    soa_distruggi(&m);
+    sessione_distruggi(s);
+    sessione_distruggi(c);
+}
+
+int main(void) {
+    uscita_imposta_verbosita(verbosita_silenziosa);
+    test_andata_ritorno();
+    test_file_corrotti();
+    return fine_test("salvataggio");
+}
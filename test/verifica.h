@@ -0,0 +1,95 @@
+#ifndef VERIFICA_H
+#define VERIFICA_H
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// ============================================================================
+// CONTROLLI DEI TEST (make test)
+// ============================================================================
+// Ogni test è un programma a sé. CONTROLLA stampa su stderr il controllo
+// fallito e prosegue; fine_test() restituisce il codice di uscita (0 se
+// tutto è andato bene). I file di prova stanno in una cartella temporanea
+// creata da file_test e cancellata da fine_test. Chi lo include definisce
+// prima _POSIX_C_SOURCE (mkdtemp).
+
+static int controlli_falliti = 0;
+static char cartella_test[64] = "";
+
+#define CONTROLLA(condizione) do { \
+        if (!(condizione)) { \
+            controlli_falliti++; \
+            fprintf(stderr, "%s:%d: fallito: %s\n", __FILE__, __LINE__, #condizione); \
+        } \
+    } while (0)
+
+// Percorso di un file nella cartella temporanea. Il risultato resta valido
+// per le quattro chiamate successive
+static inline const char* file_test(const char* nome) {
+    static char percorsi[4][128];
+    static int prossimo = 0;
+    if (cartella_test[0] == '\0') {
+        strcpy(cartella_test, "/tmp/cose_strane_test_XXXXXX");
+        if (mkdtemp(cartella_test) == NULL) { perror("mkdtemp"); exit(2); }
+    }
+    char* p = percorsi[prossimo];
+    prossimo = (prossimo + 1) % 4;
+    snprintf(p, sizeof(percorsi[0]), "%s/%s", cartella_test, nome);
+    return p;
+}
+
+// Contenuto del file (da liberare), NULL se non leggibile
+static inline unsigned char* leggi_file(const char* percorso, size_t* n) {
+    FILE* f = fopen(percorso, "rb");
+    *n = 0;
+    if (f == NULL) return NULL;
+    fseek(f, 0, SEEK_END);
+    long dimensione = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    unsigned char* dati = (unsigned char*) malloc(dimensione > 0 ? (size_t) dimensione : 1);
+    if (dati != NULL && fread(dati, 1, (size_t) dimensione, f) != (size_t) dimensione) { free(dati); dati = NULL; }
+    fclose(f);
+    *n = (size_t) dimensione;
+    return dati;
+}
+
+static inline int scrivi_file(const char* percorso, const void* dati, size_t n) {
+    FILE* f = fopen(percorso, "wb");
+    if (f == NULL) return 0;
+    int ok = fwrite(dati, 1, n, f) == n;
+    return fclose(f) == 0 && ok;
+}
+
+// 1 se i due file esistono e hanno lo stesso contenuto
+static inline int file_uguali(const char* a, const char* b) {
+    size_t na, nb;
+    unsigned char* da = leggi_file(a, &na);
+    unsigned char* db = leggi_file(b, &nb);
+    int uguali = da != NULL && db != NULL && na == nb && memcmp(da, db, na) == 0;
+    free(da);
+    free(db);
+    return uguali;
+}
+
+static inline int fine_test(const char* nome) {
+    if (cartella_test[0] != '\0') {
+        DIR* d = opendir(cartella_test);
+        struct dirent* e;
+        char percorso[512];
+        while (d != NULL && (e = readdir(d)) != NULL) {
+            if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0) continue;
+            snprintf(percorso, sizeof(percorso), "%s/%s", cartella_test, e->d_name);
+            remove(percorso);
+        }
+        if (d != NULL) closedir(d);
+        rmdir(cartella_test);
+    }
+    if (controlli_falliti > 0) fprintf(stderr, "%s: %d controlli falliti\n", nome, controlli_falliti);
+    else fprintf(stderr, "%s: ok\n", nome);
+    return controlli_falliti > 0;
+}
+
+#endif
@@ -0,0 +1,309 @@
+#define _POSIX_C_SOURCE 200809L
+#include "torneo.h"
+#include "pianificatore.h"
+#include "uscita.h"
+#include <math.h>
+#include <stdint.h>
+#include <time.h>
+
+// Semi giocati da un compito: abbastanza da ammortizzare l'accodamento
+#define SEMI_PER_COMPITO 256
+#define LINEA_CACHE 64
+#define PROFILI 4
+#define Z_95 1.959963984540054
+
+static const char* const nomi_profili[PROFILI] = { "base", "+3 attacco", "+3 difesa", "Undici" };
+
+// ============================================================================
+// STRATEGIE PREDEFINITE
+// ============================================================================
+
+static Agente crea_esploratore(Sessione* s, unsigned long long seme, unsigned int* stato) {
+    (void) s; (void) seme; (void) stato;
+    return agente_esploratore;
+}
+
+static Agente crea_corridore(Sessione* s, unsigned long long seme, unsigned int* stato) {
+    (void) s; (void) seme; (void) stato;
+    return agente_corridore;
+}
+
+static Agente crea_combattente(Sessione* s, unsigned long long seme, unsigned int* stato) {
+    (void) s; (void) seme; (void) stato;
+    return agente_combattente;
+}
+
+static Agente crea_collezionista(Sessione* s, unsigned long long seme, unsigned int* stato) {
+    (void) s; (void) seme; (void) stato;
+    return agente_collezionista;
+}
+
+static Agente crea_saltatore(Sessione* s, unsigned long long seme, unsigned int* stato) {
+    (void) s; (void) seme; (void) stato;
+    return agente_saltatore;
+}
+
+static Agente crea_casuale(Sessione* s, unsigned long long seme, unsigned int* stato) {
+    (void) s;
+    *stato = (unsigned int) seme;
+    return agente_casuale(stato);
+}
+
+static Agente crea_ottimo(Sessione* s, unsigned long long seme, unsigned int* stato) {
+    (void) seme; (void) stato;
+    return agente_ottimo(s);
+}
+
+const Strategia_torneo strategie_predefinite[] = {
+    { "esploratore", crea_esploratore },
+    { "corridore", crea_corridore },
+    { "combattente", crea_combattente },
+    { "collezionista", crea_collezionista },
+    { "saltatore", crea_saltatore },
+    { "casuale", crea_casuale },
+    { "ottimo", crea_ottimo },
+};
+const size_t numero_strategie_predefinite = sizeof(strategie_predefinite) / sizeof(strategie_predefinite[0]);
+
+// ============================================================================
+// CONTATORI PER THREAD
+// ============================================================================
+
+typedef struct Statistiche_cella {
+    uint64_t partite, vittorie, sconfitte, limite, errori;
+    uint64_t round_vittorie;         // Somma dei round delle vittorie...
+    uint64_t round_vittorie_quadrati; // ...e dei loro quadrati (varianza)
+    uint64_t morti[4];               // Per Tipo_nemico che ha ucciso
+} Statistiche_cella;
+
+typedef struct Torneo {
+    const Opzioni_torneo* o;
+    const Strategia_torneo* strategie;
+    size_t celle;                    // Strategie x profili
+    Pianificatore* p;
+    unsigned char* contatori;        // Un blocco per thread (+1 per il chiamante)...
+    size_t passo;                    // ...di passo byte, multiplo della linea di cache
+    Sessione** sessioni;             // Una per thread, creata al primo compito
+} Torneo;
+
+typedef struct Compito_torneo {
+    Torneo* t;
+    size_t cella;
+    unsigned long long primo, n;     // Semi primo .. primo + n - 1
+} Compito_torneo;
+
+static Statistiche_cella* celle_del_thread(Torneo* t, int thread) {
+    return (Statistiche_cella*) (t->contatori + (size_t) thread * t->passo);
+}
+
+static void gioca_compito(void* dati) {
+    Compito_torneo* c = (Compito_torneo*) dati;
+    Torneo* t = c->t;
+    // Fuori dal pianificatore (compito non accodato) si usa l'ultimo blocco
+    int thread = pianificatore_indice_thread(t->p);
+    if (thread < 0) thread = pianificatore_thread(t->p);
+    Statistiche_cella* st = &celle_del_thread(t, thread)[c->cella];
+    const Strategia_torneo* strategia = &t->strategie[c->cella / PROFILI];
+    Modifica_statistiche profilo = (Modifica_statistiche) (c->cella % PROFILI);
+
+    Verbosita verbosita = verbosita_uscita;
+    uscita_imposta_verbosita(verbosita_silenziosa);
+    if (t->sessioni[thread] == NULL) {
+        t->sessioni[thread] = sessione_crea(0);
+        if (t->sessioni[thread] != NULL) motore_albo_condiviso(t->sessioni[thread], 0);
+    }
+    Sessione* s = t->sessioni[thread];
+    const char* nomi[1] = { "Bot" };
+    for (unsigned long long k = 0; k < c->n; k++) {
+        unsigned long long seme = c->primo + k;
+        st->partite++;
+        if (s == NULL) { st->errori++; continue; }
+        gioco_semina(s, seme);
+        motore_imposta_giocatori(s, 1, nomi, &profilo);
+        int pronta;
+        if (t->o->zone == 0) pronta = motore_genera_mappa(s);
+        else {
+            Parametri_mappa p = PARAMETRI_MAPPA_DEFAULT;
+            p.zone = t->o->zone;
+            p.seme = seme;
+            p.thread = 1; // Il parallelismo è tra le partite
+            pronta = mappa_genera(s, &p) && mappa_chiudi(s);
+        }
+        if (!pronta) { st->errori++; continue; }
+
+        unsigned int stato = 0;
+        Agente a = strategia->crea(s, seme, &stato);
+        const Agente* agenti[1] = { &a };
+        Risultato_partita r = motore_gioca(s, agenti, t->o->max_round);
+        if (r.esito == esito_vittoria) {
+            st->vittorie++;
+            st->round_vittorie += (uint64_t) r.round;
+            st->round_vittorie_quadrati += (uint64_t) r.round * (uint64_t) r.round;
+        } else if (r.esito == esito_sconfitta) {
+            st->sconfitte++;
+            if ((unsigned int) r.ucciso_da[0] <= demotorzone) st->morti[r.ucciso_da[0]]++;
+        } else {
+            st->limite++;
+        }
+    }
+    uscita_imposta_verbosita(verbosita);
+}
+
+static void somma_cella(Statistiche_cella* a, const Statistiche_cella* b) {
+    a->partite += b->partite; a->vittorie += b->vittorie; a->sconfitte += b->sconfitte;
+    a->limite += b->limite; a->errori += b->errori;
+    a->round_vittorie += b->round_vittorie;
+    a->round_vittorie_quadrati += b->round_vittorie_quadrati;
+    for (int e = 0; e < 4; e++) a->morti[e] += b->morti[e];
+}
+
+// ============================================================================
+// RAPPORTO
+// ============================================================================
+
+// Intervallo di Wilson al 95% per una proporzione (valido anche vicino a 0 e 1)
+static void intervallo_wilson(uint64_t successi, uint64_t n, double* basso, double* alto) {
+    if (n == 0) { *basso = 0.0; *alto = 1.0; return; }
+    double p = (double) successi / (double) n, z2 = Z_95 * Z_95, nn = (double) n;
+    double centro = (p + z2 / (2.0 * nn)) / (1.0 + z2 / nn);
+    double meta = Z_95 * sqrt(p * (1.0 - p) / nn + z2 / (4.0 * nn * nn)) / (1.0 + z2 / nn);
+    *basso = centro - meta;
+    *alto = centro + meta;
+}
+
+static double percento(uint64_t parte, uint64_t totale) {
+    return totale ? 100.0 * (double) parte / (double) totale : 0.0;
+}
+
+static void stampa_riga(const char* strategia, const char* profilo, const Statistiche_cella* c) {
+    uint64_t giocate = c->partite - c->errori;
+    double basso, alto;
+    intervallo_wilson(c->vittorie, giocate, &basso, &alto);
+    uscita_formatta("%-14s %-11s %6.2f%% [%6.2f, %6.2f]", strategia, profilo,
+                    percento(c->vittorie, giocate), 100.0 * basso, 100.0 * alto);
+    if (c->vittorie > 0) {
+        double v = (double) c->vittorie;
+        double media = (double) c->round_vittorie / v;
+        double varianza = c->vittorie > 1 ? ((double) c->round_vittorie_quadrati - v * media * media) / (v - 1.0) : 0.0;
+        if (varianza < 0.0) varianza = 0.0;
+        uscita_formatta(" %7.2f +- %5.2f", media, Z_95 * sqrt(varianza / v));
+    } else {
+        uscita_formatta(" %7s    %5s", "-", "-");
+    }
+    uscita_formatta(" %6.2f%% %6.2f%% | %6.2f%% %6.2f%% %6.2f%%", percento(c->sconfitte, giocate), percento(c->limite, giocate),
+                    percento(c->morti[billi], giocate), percento(c->morti[democane], giocate),
+                    percento(c->morti[demotorzone], giocate));
+    if (c->errori > 0) uscita_formatta("  (%llu non giocate)", (unsigned long long) c->errori);
+    uscita_formatta("\n");
+}
+
+static void stampa_intestazione(void) {
+    uscita_formatta("%-14s %-11s %-26s %-16s %7s %7s | %7s %7s %7s\n", "strategia", "profilo", "vittorie [IC 95%]",
+                    "round vittoria", "morti", "limite", "Billi", "Democ.", "Demot.");
+}
+
+static void stampa_rapporto(const Torneo* t, const Statistiche_cella* totali, double secondi) {
+    const Opzioni_torneo* o = t->o;
+    size_t strategie = t->celle / PROFILI;
+    uint64_t partite = 0;
+    for (size_t c = 0; c < t->celle; c++) partite += totali[c].partite;
+    uscita_formatta("\n--- TORNEO: %zu strategie x %d profili x %llu semi (%llu partite, %d thread, %.2f s, %.0f partite/s) ---\n",
+                    strategie, PROFILI, o->partite, (unsigned long long) partite, pianificatore_thread(t->p), secondi,
+                    secondi > 0.0 ? (double) partite / secondi : 0.0);
+    uscita_formatta("Mappe da %zu zone, al massimo %d round; morti e limite in %% delle partite, round con IC 95%%\n\n",
+                    o->zone ? o->zone : (size_t) 15, o->max_round);
+    stampa_intestazione();
+    for (size_t s = 0; s < strategie; s++)
+        for (int p = 0; p < PROFILI; p++) stampa_riga(t->strategie[s].nome, nomi_profili[p], &totali[s * PROFILI + (size_t) p]);
+
+    // Riepilogo per strategia, dalla migliore (tutti i profili insieme)
+    Statistiche_cella* riepilogo = (Statistiche_cella*) calloc(strategie, sizeof(Statistiche_cella));
+    size_t* ordine = (size_t*) calloc(strategie, sizeof(size_t));
+    if (riepilogo == NULL || ordine == NULL) { free(riepilogo); free(ordine); return; }
+    for (size_t s = 0; s < strategie; s++) {
+        for (int p = 0; p < PROFILI; p++) somma_cella(&riepilogo[s], &totali[s * PROFILI + (size_t) p]);
+        ordine[s] = s;
+    }
+    for (size_t i = 1; i < strategie; i++) {
+        size_t k = ordine[i], j = i;
+        double tasso = percento(riepilogo[k].vittorie, riepilogo[k].partite - riepilogo[k].errori);
+        while (j > 0 && percento(riepilogo[ordine[j - 1]].vittorie, riepilogo[ordine[j - 1]].partite - riepilogo[ordine[j - 1]].errori) < tasso) {
+            ordine[j] = ordine[j - 1];
+            j--;
+        }
+        ordine[j] = k;
+    }
+    uscita_formatta("\n--- CLASSIFICA DELLE STRATEGIE ---\n");
+    stampa_intestazione();
+    for (size_t i = 0; i < strategie; i++) stampa_riga(t->strategie[ordine[i]].nome, "tutti", &riepilogo[ordine[i]]);
+    free(riepilogo);
+    free(ordine);
+}
+
+// ============================================================================
+// ESECUZIONE
+// ============================================================================
+
+static double ora_secondi(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+int torneo_esegui(const Opzioni_torneo* o) {
+    Torneo t;
+    memset(&t, 0, sizeof(t));
+    t.o = o;
+    t.strategie = o->strategie ? o->strategie : strategie_predefinite;
+    size_t strategie = o->strategie ? o->numero_strategie : numero_strategie_predefinite;
+    if (strategie == 0 || o->partite == 0) return 0;
+    t.celle = strategie * PROFILI;
+    t.p = pianificatore_crea(o->thread);
+    if (t.p == NULL) { uscita_formatta("Errore: impossibile avviare i thread del torneo.\n"); return 1; }
+
+    int thread = pianificatore_thread(t.p);
+    t.passo = (t.celle * sizeof(Statistiche_cella) + LINEA_CACHE - 1) / LINEA_CACHE * LINEA_CACHE;
+    t.contatori = (unsigned char*) aligned_alloc(LINEA_CACHE, t.passo * (size_t) (thread + 1));
+    t.sessioni = (Sessione**) calloc((size_t) thread + 1, sizeof(Sessione*));
+    unsigned long long blocchi = (o->partite + SEMI_PER_COMPITO - 1) / SEMI_PER_COMPITO;
+    Compito_torneo* compiti = (Compito_torneo*) malloc((size_t) (blocchi * t.celle) * sizeof(Compito_torneo));
+    Statistiche_cella* totali = (Statistiche_cella*) calloc(t.celle, sizeof(Statistiche_cella));
+    int codice = 1;
+    if (t.contatori == NULL || t.sessioni == NULL || compiti == NULL || totali == NULL) {
+        uscita_formatta("Errore: memoria insufficiente per il torneo.\n");
+        goto fine;
+    }
+    memset(t.contatori, 0, t.passo * (size_t) (thread + 1));
+
+    double inizio = ora_secondi();
+    size_t n = 0;
+    for (unsigned long long b = 0; b < blocchi; b++) {
+        for (size_t c = 0; c < t.celle; c++) {
+            Compito_torneo* k = &compiti[n++];
+            k->t = &t;
+            k->cella = c;
+            k->primo = o->seme + b * SEMI_PER_COMPITO;
+            k->n = (b + 1 < blocchi) ? SEMI_PER_COMPITO : o->partite - b * SEMI_PER_COMPITO;
+            if (!pianificatore_invia(t.p, gioca_compito, k)) gioca_compito(k);
+        }
+    }
+    pianificatore_attendi(t.p);
+    double secondi = ora_secondi() - inizio;
+
+    for (int k = 0; k <= thread; k++) {
+        Statistiche_cella* celle = celle_del_thread(&t, k);
+        for (size_t c = 0; c < t.celle; c++) somma_cella(&totali[c], &celle[c]);
+    }
+    stampa_rapporto(&t, totali, secondi);
+    codice = 0;
+
+fine:
+    pianificatore_distruggi(t.p);
+    if (t.sessioni != NULL)
+        for (int k = 0; k <= thread; k++) sessione_distruggi(t.sessioni[k]);
+    free(t.sessioni);
+    free(t.contatori);
+    free(compiti);
+    free(totali);
+    return codice;
+}
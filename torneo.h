@@ -0,0 +1,44 @@
+#ifndef TORNEO_H
+#define TORNEO_H
+
+#include "gamelib.h"
+
+// ============================================================================
+// TORNEO DI STRATEGIE
+// ============================================================================
+// Gioca ogni strategia con ogni profilo di statistiche (le modifiche di
+// imposta_gioco, Undici VirgolaCinque compreso) sugli stessi semi: partite a
+// un giocatore con le regole vere del motore headless. Le combinazioni
+// strategia x profilo x blocco di semi sono compiti del pianificatore; ogni
+// thread somma i risultati nei propri contatori, allineati alla linea di
+// cache, e i contatori si uniscono solo alla fine. I risultati non dipendono
+// dal numero di thread.
+
+// Crea l'agente di una partita. stato è memoria privata della partita (per
+// gli agenti con stato come agente_casuale)
+typedef Agente (*Crea_agente)(Sessione* s, unsigned long long seme, unsigned int* stato);
+
+typedef struct Strategia_torneo {
+    const char* nome;
+    Crea_agente crea;
+} Strategia_torneo;
+
+// Esploratore, corridore, combattente, collezionista, saltatore, casuale, ottimo
+extern const Strategia_torneo strategie_predefinite[];
+extern const size_t numero_strategie_predefinite;
+
+typedef struct Opzioni_torneo {
+    unsigned long long partite;        // Semi per ogni combinazione strategia x profilo
+    unsigned long long seme;           // Primo seme (gli altri sono consecutivi)
+    int thread;                        // <= 0: uno per core
+    int max_round;                     // Limite di round per partita (<= 0: nessuno)
+    size_t zone;                       // Zone della mappa (0 = 15 come genera_mappa)
+    const Strategia_torneo* strategie; // NULL: strategie_predefinite
+    size_t numero_strategie;
+} Opzioni_torneo;
+
+// Gioca il torneo e ne stampa il rapporto (anche con verbosità silenziosa).
+// Restituisce 0, oppure 1 se mancano memoria o thread
+int torneo_esegui(const Opzioni_torneo* o);
+
+#endif
@@ -0,0 +1,206 @@
+#define _POSIX_C_SOURCE 200809L
+#include "uscita.h"
+#include <errno.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#define DIM_BUFFER (1 << 16)
+
+_Thread_local Verbosita verbosita_uscita = verbosita_normale;
+
+static char buffer[DIM_BUFFER];
+static size_t usati = 0;
+static int registrato = 0; // Svuotamento automatico all'uscita del programma
+static int terminale = 0;  // Lo standard output è un terminale (deciso da registra)
+
+// Destinazione deviata del thread (NULL: il buffer)
+static _Thread_local void (*deviata)(const char* s, size_t n, void* dati) = NULL;
+static _Thread_local void* dati_deviata = NULL;
+
+void uscita_imposta_verbosita(Verbosita v) {
+    verbosita_uscita = v;
+}
+
+void uscita_devia(void (*scrivi)(const char* s, size_t n, void* dati), void* dati) {
+    deviata = scrivi;
+    dati_deviata = dati;
+}
+
+// Messaggio formattato per la destinazione deviata
+static void formatta_deviato(const char* formato, va_list args) {
+    char breve[512];
+    va_list copia;
+    va_copy(copia, args);
+    int n = vsnprintf(breve, sizeof(breve), formato, copia);
+    va_end(copia);
+    if (n < 0) return;
+    if ((size_t) n < sizeof(breve)) { deviata(breve, (size_t) n, dati_deviata); return; }
+    char* grande = (char*) malloc((size_t) n + 1);
+    if (grande == NULL) return;
+    vsnprintf(grande, (size_t) n + 1, formato, args);
+    deviata(grande, (size_t) n, dati_deviata);
+    free(grande);
+}
+
+// Scrive tutti i vettori gestendo scritture parziali e interruzioni
+static void scrivi_tutto(struct iovec* v, int n) {
+    while (n > 0) {
+        ssize_t scritti = writev(STDOUT_FILENO, v, n);
+        if (scritti < 0) {
+            if (errno == EINTR) continue;
+            return; // Uscita chiusa: i messaggi vanno persi come con printf
+        }
+        while (n > 0 && (size_t) scritti >= v->iov_len) { scritti -= (ssize_t) v->iov_len; v++; n--; }
+        if (n > 0) { v->iov_base = (char*) v->iov_base + scritti; v->iov_len -= (size_t) scritti; }
+    }
+}
+
+void uscita_svuota(void) {
+    if (usati == 0) return;
+    struct iovec v = { buffer, usati };
+    scrivi_tutto(&v, 1);
+    usati = 0;
+}
+
+static void registra() {
+    if (!registrato) { atexit(uscita_svuota); terminale = isatty(STDOUT_FILENO); registrato = 1; }
+}
+
+// Sul terminale, a verbosità normale o dettagliata, ogni riga completa esce
+// subito: un'interruzione o un crash non fa perdere i messaggi già stampati.
+// Con -q o con l'uscita rediretta il buffer resta pieno fino in fondo
+static void svuota_a_capo(const char* testo, size_t n) {
+    if (terminale && verbosita_uscita >= verbosita_normale && memchr(testo, '\n', n) != NULL) uscita_svuota();
+}
+
+void uscita_scrivi(const char* s, size_t n) {
+    if (deviata != NULL) { deviata(s, n, dati_deviata); return; }
+    registra();
+    if (n <= DIM_BUFFER - usati) {
+        memcpy(buffer + usati, s, n);
+        usati += n;
+        svuota_a_capo(s, n);
+        return;
+    }
+    if (n < DIM_BUFFER) {
+        uscita_svuota();
+        memcpy(buffer, s, n);
+        usati = n;
+        svuota_a_capo(s, n);
+        return;
+    }
+    // Più grande del buffer: buffer e testo con una sola writev
+    struct iovec v[2] = { { buffer, usati }, { (void*) s, n } };
+    scrivi_tutto(v, 2);
+    usati = 0;
+}
+
+// Risultati di formatta_veloce
+#define VELOCE_OK           1
+#define VELOCE_NON_GESTITO  0  // Specificatore non supportato: serve vsnprintf
+#define VELOCE_SENZA_SPAZIO -1 // Il buffer si è riempito a metà messaggio
+
+static int accoda_intero(long long v, int segno) {
+    char cifre[24];
+    int k = 0;
+    unsigned long long u = v < 0 ? 0ull - (unsigned long long) v : (unsigned long long) v;
+    do { cifre[k++] = (char) ('0' + u % 10); u /= 10; } while (u > 0);
+    if (v < 0) cifre[k++] = '-';
+    else if (segno) cifre[k++] = '+';
+    if ((size_t) k > DIM_BUFFER - usati) return 0;
+    while (k > 0) buffer[usati++] = cifre[--k];
+    return 1;
+}
+
+// Formattatore ridotto per gli specificatori usati dal gioco (%s %c %d %+d
+// %zu %%): evita il costo di vsnprintf sui messaggi frequenti. Se il messaggio
+// non è completo il buffer torna com'era
+static int formatta_veloce(const char* formato, va_list args) {
+    size_t inizio = usati;
+    int esito = VELOCE_SENZA_SPAZIO;
+    for (const char* p = formato; *p != '\0'; p++) {
+        if (*p != '%') {
+            if (usati == DIM_BUFFER) goto annulla;
+            buffer[usati++] = *p;
+            continue;
+        }
+        int segno = 0;
+        if (*++p == '+') { segno = 1; p++; }
+        if (*p == 'd') {
+            if (!accoda_intero(va_arg(args, int), segno)) goto annulla;
+        } else if (*p == 'z' && p[1] == 'u' && !segno) {
+            p++;
+            if (!accoda_intero((long long) va_arg(args, size_t), 0)) goto annulla;
+        } else if (*p == 's' && !segno) {
+            const char* s = va_arg(args, const char*);
+            size_t n = strlen(s);
+            if (n > DIM_BUFFER - usati) goto annulla;
+            memcpy(buffer + usati, s, n);
+            usati += n;
+        } else if ((*p == 'c' || *p == '%') && !segno) {
+            if (usati == DIM_BUFFER) goto annulla;
+            buffer[usati++] = (*p == 'c') ? (char) va_arg(args, int) : '%';
+        } else {
+            esito = VELOCE_NON_GESTITO;
+            goto annulla;
+        }
+    }
+    return VELOCE_OK;
+annulla:
+    usati = inizio;
+    return esito;
+}
+
+void uscita_formatta(const char* formato, ...) {
+    // Senza specificatori il testo è già il risultato (menu e prompt)
+    if (strchr(formato, '%') == NULL) { uscita_scrivi(formato, strlen(formato)); return; }
+
+    va_list args;
+    if (deviata != NULL) {
+        va_start(args, formato);
+        formatta_deviato(formato, args);
+        va_end(args);
+        return;
+    }
+    registra();
+
+    for (int tentativo = 0; tentativo < 2; tentativo++) {
+        size_t inizio = usati;
+        va_start(args, formato);
+        int esito = formatta_veloce(formato, args);
+        va_end(args);
+        if (esito == VELOCE_OK) { svuota_a_capo(buffer + inizio, usati - inizio); return; }
+        if (esito == VELOCE_NON_GESTITO || usati == 0) break;
+        uscita_svuota(); // Riprova con il buffer vuoto
+    }
+
+    va_start(args, formato);
+    int n = vsnprintf(buffer + usati, DIM_BUFFER - usati, formato, args);
+    va_end(args);
+    if (n < 0) return;
+    if ((size_t) n < DIM_BUFFER - usati) {
+        usati += (size_t) n;
+        svuota_a_capo(buffer + usati - (size_t) n, (size_t) n);
+        return;
+    }
+
+    // Non c'era spazio: si svuota e si formatta di nuovo
+    uscita_svuota();
+    va_start(args, formato);
+    if ((size_t) n < DIM_BUFFER) {
+        vsnprintf(buffer, DIM_BUFFER, formato, args);
+        usati = (size_t) n;
+        svuota_a_capo(buffer, usati);
+    } else {
+        char* grande = (char*) malloc((size_t) n + 1);
+        if (grande != NULL) {
+            vsnprintf(grande, (size_t) n + 1, formato, args);
+            uscita_scrivi(grande, (size_t) n);
+            free(grande);
+        }
+    }
+    va_end(args);
+}
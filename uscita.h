@@ -0,0 +1,49 @@
+#ifndef USCITA_H
+#define USCITA_H
+
+#include <stdio.h>
+
+// ============================================================================
+// USCITA BUFFERIZZATA DEL GIOCO
+// ============================================================================
+// Tutti i messaggi passano da un unico buffer di 64 KiB scritto sullo
+// standard output con una sola chiamata di sistema quando è pieno, prima che
+// ingresso.c si blocchi in attesa di input (così i prompt compaiono prima di
+// attendere) e all'uscita del programma. Se lo standard output è un
+// terminale, a verbosità normale o dettagliata il buffer si svuota anche a
+// ogni fine riga, come lo stdio; con -q o con l'uscita rediretta resta
+// pieno. I byte prodotti sono gli stessi di printf.
+//
+// Il livello di verbosità è controllato prima di valutare gli argomenti:
+// in modalità silenziosa i messaggi non vengono nemmeno formattati. La
+// verbosità è per thread, il buffer no: i thread che giocano sessioni in
+// parallelo restano silenziosi e solo un thread scrive. Un thread può però
+// deviare i propri messaggi altrove (il server li manda ai giocatori del tavolo).
+
+typedef enum {
+    verbosita_silenziosa,  // Nessun messaggio (simulazioni)
+    verbosita_normale,     // Il gioco interattivo di sempre
+    verbosita_dettagliata  // In più i tiri di dado dei combattimenti
+} Verbosita;
+
+extern _Thread_local Verbosita verbosita_uscita; // Letta dalle macro, modificare con uscita_imposta_verbosita
+
+void uscita_imposta_verbosita(Verbosita v);
+// Accoda testo formattato come printf
+void uscita_formatta(const char* formato, ...)
+#if defined(__GNUC__)
+    __attribute__((format(printf, 1, 2)))
+#endif
+    ;
+// Accoda n byte
+void uscita_scrivi(const char* s, size_t n);
+// Scrive tutto il contenuto del buffer
+void uscita_svuota(void);
+// Da qui in poi i messaggi del thread corrente vanno a scrivi invece che nel
+// buffer dello standard output (NULL per tornare al buffer)
+void uscita_devia(void (*scrivi)(const char* s, size_t n, void* dati), void* dati);
+
+#define stampa(...) do { if (verbosita_uscita >= verbosita_normale) uscita_formatta(__VA_ARGS__); } while (0)
+#define stampa_dettaglio(...) do { if (verbosita_uscita >= verbosita_dettagliata) uscita_formatta(__VA_ARGS__); } while (0)
+
+#endif